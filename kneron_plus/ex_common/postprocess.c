@@ -12,6 +12,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "kp_inference.h"
 #include "postprocess.h"
 
 #define YOLO_V3_CELL_BOX_NUM 3
@@ -183,6 +184,82 @@ void boxes_scale(kp_bounding_box_t *boxes, int size, kp_hw_pre_proc_info_t *pre_
     }
 }
 
+/* non-maximum suppression of the candidate boxes of each class into yoloResult, temp_boxes must fit good_box_count boxes */
+static void yolo_nms(kp_bounding_box_t *possible_boxes, int good_box_count, kp_bounding_box_t *temp_boxes, int class_count,
+                     float nms_thresh, kp_hw_pre_proc_info_t *pre_proc_info, kp_yolo_result_t *yoloResult)
+{
+    int good_result_count = 0;
+
+    for (int i = 0; i < class_count; i++)
+    {
+        kp_bounding_box_t *bbox = possible_boxes;
+        kp_bounding_box_t *r_tmp_p = temp_boxes;
+
+        int class_good_box_count = 0;
+
+        for (int j = 0; j < good_box_count; j++)
+        {
+            if (bbox->class_num == i)
+            {
+                memcpy(r_tmp_p, bbox, sizeof(kp_bounding_box_t));
+                r_tmp_p++;
+                class_good_box_count++;
+            }
+            bbox++;
+        }
+
+        if (class_good_box_count == 1)
+        {
+            if (good_result_count < YOLO_GOOD_BOX_MAX)
+            {
+                memcpy(&(yoloResult->boxes[good_result_count]), &temp_boxes[0], sizeof(kp_bounding_box_t));
+                good_result_count++;
+            }
+        }
+        else if (class_good_box_count >= 2)
+        {
+            qsort(temp_boxes, class_good_box_count, sizeof(kp_bounding_box_t), box_comparator);
+            for (int j = 0; j < class_good_box_count; j++)
+            {
+                if (temp_boxes[j].score == 0)
+                    continue;
+                for (int k = j + 1; k < class_good_box_count; k++)
+                {
+                    if (box_iou(&temp_boxes[j], &temp_boxes[k], IOU_UNION) > nms_thresh)
+                    {
+                        temp_boxes[k].score = 0;
+                    }
+                }
+            }
+
+            int good_count = 0;
+            for (int j = 0; j < class_good_box_count; j++)
+            {
+                if (temp_boxes[j].score > 0 && good_result_count < YOLO_GOOD_BOX_MAX)
+                {
+                    memcpy(&(yoloResult->boxes[good_result_count]), &temp_boxes[j], sizeof(kp_bounding_box_t));
+                    good_result_count++;
+                    good_count++;
+                }
+                if (YOLO_MAX_DETECTION_PER_CLASS == good_count)
+                {
+                    break;
+                }
+            }
+        }
+
+        // FIXME: find a better policy to filter the detected bounding box result if total box count exceeds YOLO_GOOD_BOX_MAX
+        if (good_result_count >= YOLO_GOOD_BOX_MAX)
+            break;
+    }
+
+    yoloResult->box_count = good_result_count;
+    yoloResult->class_count = class_count;
+
+    // convert the coordinate of all bounding boxes to raw image
+    boxes_scale(yoloResult->boxes, yoloResult->box_count, pre_proc_info);
+}
+
 int post_process_yolo_v3(kp_inf_float_node_output_t *node_output[], int num_output_node,
                          kp_hw_pre_proc_info_t *pre_proc_info, float thresh_value, kp_yolo_result_t *yoloResult)
 {
@@ -291,76 +368,7 @@ int post_process_yolo_v3(kp_inf_float_node_output_t *node_output[], int num_outp
         }
     }
 
-    int good_result_count = 0;
-
-    for (int i = 0; i < class_count; i++)
-    {
-        kp_bounding_box_t *bbox = possible_boxes;
-        kp_bounding_box_t *r_tmp_p = temp_boxes;
-
-        int class_good_box_count = 0;
-
-        for (int j = 0; j < good_box_count; j++)
-        {
-            if (bbox->class_num == i)
-            {
-                memcpy(r_tmp_p, bbox, sizeof(kp_bounding_box_t));
-                r_tmp_p++;
-                class_good_box_count++;
-            }
-            bbox++;
-        }
-
-        if (class_good_box_count == 1)
-        {
-            if (good_result_count < YOLO_GOOD_BOX_MAX)
-            {
-                memcpy(&(yoloResult->boxes[good_result_count]), &temp_boxes[0], sizeof(kp_bounding_box_t));
-                good_result_count++;
-            }
-        }
-        else if (class_good_box_count >= 2)
-        {
-            qsort(temp_boxes, class_good_box_count, sizeof(kp_bounding_box_t), box_comparator);
-            for (int j = 0; j < class_good_box_count; j++)
-            {
-                if (temp_boxes[j].score == 0)
-                    continue;
-                for (int k = j + 1; k < class_good_box_count; k++)
-                {
-                    if (box_iou(&temp_boxes[j], &temp_boxes[k], IOU_UNION) > NMS_THRESH_YOLOV3_520)
-                    {
-                        temp_boxes[k].score = 0;
-                    }
-                }
-            }
-
-            int good_count = 0;
-            for (int j = 0; j < class_good_box_count; j++)
-            {
-                if (temp_boxes[j].score > 0 && good_result_count < YOLO_GOOD_BOX_MAX)
-                {
-                    memcpy(&(yoloResult->boxes[good_result_count]), &temp_boxes[j], sizeof(kp_bounding_box_t));
-                    good_result_count++;
-                    good_count++;
-                }
-                if (YOLO_MAX_DETECTION_PER_CLASS == good_count)
-                {
-                    break;
-                }
-            }
-        }
-
-        // FIXME: find a better policy to filter the detected bounding box result if total box count exceeds YOLO_GOOD_BOX_MAX
-        if (good_result_count >= YOLO_GOOD_BOX_MAX)
-            break;
-    }
-
-    yoloResult->box_count = good_result_count;
-    yoloResult->class_count = class_count;
-
-    // convert the coordinate of all bounding boxes to raw image
-    boxes_scale(yoloResult->boxes, yoloResult->box_count, pre_proc_info);
+    yolo_nms(possible_boxes, good_box_count, temp_boxes, class_count, NMS_THRESH_YOLOV3_520, pre_proc_info, yoloResult);
 
     free(box_class_probs);
     free(possible_boxes);
@@ -491,76 +499,7 @@ int post_process_yolo_v5_520(kp_inf_float_node_output_t *node_output[], int num_
         }
     }
 
-    int good_result_count = 0;
-
-    for (int i = 0; i < class_count; i++)
-    {
-        kp_bounding_box_t *bbox = possible_boxes;
-        kp_bounding_box_t *r_tmp_p = temp_boxes;
-
-        int class_good_box_count = 0;
-
-        for (int j = 0; j < good_box_count; j++)
-        {
-            if (bbox->class_num == i)
-            {
-                memcpy(r_tmp_p, bbox, sizeof(kp_bounding_box_t));
-                r_tmp_p++;
-                class_good_box_count++;
-            }
-            bbox++;
-        }
-
-        if (class_good_box_count == 1)
-        {
-            if (good_result_count < YOLO_GOOD_BOX_MAX)
-            {
-                memcpy(&(yoloResult->boxes[good_result_count]), &temp_boxes[0], sizeof(kp_bounding_box_t));
-                good_result_count++;
-            }
-        }
-        else if (class_good_box_count >= 2)
-        {
-            qsort(temp_boxes, class_good_box_count, sizeof(kp_bounding_box_t), box_comparator);
-            for (int j = 0; j < class_good_box_count; j++)
-            {
-                if (temp_boxes[j].score == 0)
-                    continue;
-                for (int k = j + 1; k < class_good_box_count; k++)
-                {
-                    if (box_iou(&temp_boxes[j], &temp_boxes[k], IOU_UNION) > NMS_THRESH_YOLOV3_520)
-                    {
-                        temp_boxes[k].score = 0;
-                    }
-                }
-            }
-
-            int good_count = 0;
-            for (int j = 0; j < class_good_box_count; j++)
-            {
-                if (temp_boxes[j].score > 0 && good_result_count < YOLO_GOOD_BOX_MAX)
-                {
-                    memcpy(&(yoloResult->boxes[good_result_count]), &temp_boxes[j], sizeof(kp_bounding_box_t));
-                    good_result_count++;
-                    good_count++;
-                }
-                if (YOLO_MAX_DETECTION_PER_CLASS == good_count)
-                {
-                    break;
-                }
-            }
-        }
-
-        // FIXME: find a better policy to filter the detected bounding box result if total box count exceeds YOLO_GOOD_BOX_MAX
-        if (good_result_count >= YOLO_GOOD_BOX_MAX)
-            break;
-    }
-
-    yoloResult->box_count = good_result_count;
-    yoloResult->class_count = class_count;
-
-    // convert the coordinate of all bounding boxes to raw image
-    boxes_scale(yoloResult->boxes, yoloResult->box_count, pre_proc_info);
+    yolo_nms(possible_boxes, good_box_count, temp_boxes, class_count, NMS_THRESH_YOLOV3_520, pre_proc_info, yoloResult);
 
     free(box_class_probs);
     free(possible_boxes);
@@ -799,3 +738,345 @@ err:
 
     return 0;
 }
+
+/******************************************************************
+ * fixed-point decoders
+ *
+ * Cells are read from the RAW output through tensor views, their objectness is compared in the
+ * fixed-point domain and only the cells which can make a box are converted to floating-point.
+ * A surviving cell is decoded with the same floating-point operations as the decoders above,
+ * so the result is the same as theirs.
+ ******************************************************************/
+
+typedef struct
+{
+    float float_scale;      // of the tensor view
+    float factor;           // the tested value is multiplied by it
+    float thresh_value;
+} fixed_test_t;
+
+typedef bool (*fixed_test_func_t)(int32_t value, const fixed_test_t *test);
+
+static bool sigmoid_reaches(int32_t value, const fixed_test_t *test)
+{
+    return sigmoid((float)value * test->float_scale) >= test->thresh_value;
+}
+
+static bool product_exceeds(int32_t value, const fixed_test_t *test)
+{
+    return ((float)value * test->float_scale) * test->factor > test->thresh_value;
+}
+
+// the same test on -value, a test which is nonincreasing in value becomes nondecreasing
+static bool negated_product_exceeds(int32_t value, const fixed_test_t *test)
+{
+    return product_exceeds(-value, test);
+}
+
+static void fixed_range(kp_inf_tensor_view_t *view, int32_t *min_value, int32_t *max_value)
+{
+    *min_value = (KP_FIXED_POINT_DTYPE_INT16 == view->fixed_point_dtype) ? INT16_MIN : INT8_MIN;
+    *max_value = (KP_FIXED_POINT_DTYPE_INT16 == view->fixed_point_dtype) ? INT16_MAX : INT8_MAX;
+}
+
+/*
+ * smallest value in [min_value, max_value] passing a test which is nondecreasing in the value, max_value + 1 if none
+ *
+ * estimate is the boundary in exact arithmetic, it is moved to where the rounded floating-point test changes.
+ */
+static int32_t fixed_lower_bound(int32_t min_value, int32_t max_value, double estimate, fixed_test_func_t test_func, const fixed_test_t *test)
+{
+    int32_t value = max_value + 1;
+
+    if (estimate < (double)max_value + 1)
+        value = (estimate > (double)min_value) ? (int32_t)floor(estimate) : min_value;
+
+    while (value > min_value && test_func(value - 1, test))
+        value--;
+
+    while (value <= max_value && !test_func(value, test))
+        value++;
+
+    return value;
+}
+
+/* smallest fixed-point objectness whose sigmoid reaches thresh_value, the score of a box is never above its objectness */
+static int32_t yolo_fixed_objectness_threshold(kp_inf_tensor_view_t *view, float thresh_value)
+{
+    fixed_test_t test = {view->float_scale, 1, thresh_value};
+    int32_t min_value, max_value;
+    double estimate;
+
+    fixed_range(view, &min_value, &max_value);
+
+    // inverse sigmoid, then the fixed-point scale/radix
+    if (thresh_value <= 0)
+        estimate = min_value;
+    else if (thresh_value >= 1)
+        estimate = max_value;
+    else
+        estimate = log(thresh_value / (1.0 - thresh_value)) / view->float_scale;
+
+    return fixed_lower_bound(min_value, max_value, estimate, sigmoid_reaches, &test);
+}
+
+static int yolo_v3_decode_fixed(kp_inf_tensor_view_t node_view[], int num_output_node, kp_hw_pre_proc_info_t *pre_proc_info, float thresh_value,
+                                bool is_v5, kp_bounding_box_t *possible_boxes, int *good_box_count)
+{
+    int class_count = (node_view[0].channel / YOLO_V3_CELL_BOX_NUM) - YOLO_V3_BOX_FIX_CH;
+
+    *good_box_count = 0;
+
+    for (int i = 0; i < num_output_node; i++)
+    {
+        kp_inf_tensor_view_t *view = &node_view[i];
+        int grid_w = view->width;
+        int grid_h = view->height;
+        int anchor_channel = view->channel / YOLO_V3_CELL_BOX_NUM;
+
+        float ratio_w = (float)pre_proc_info->model_input_width / grid_w;
+        float ratio_h = (float)pre_proc_info->model_input_height / grid_h;
+
+        int32_t objectness_min = yolo_fixed_objectness_threshold(view, thresh_value);
+
+        for (int row = 0; row < grid_h; row++)
+        {
+            for (int an = 0; an < YOLO_V3_CELL_BOX_NUM; an++)
+            {
+                int ch = an * anchor_channel;
+
+                for (int col = 0; col < grid_w; col++)
+                {
+                    int32_t objectness = kp_tensor_view_get_fixed(view, ch + 4, row, col);
+
+                    if (objectness < objectness_min)
+                        continue;
+
+                    float box_confidence = sigmoid((float)objectness * view->float_scale);
+                    float x1, y1, x2, y2;
+                    bool first_box = false;
+
+                    /* Get scores of all class */
+                    for (int j = 0; j < class_count; j++)
+                    {
+                        float max_score = sigmoid(kp_tensor_view_get_float(view, ch + YOLO_V3_BOX_FIX_CH + j, row, col)) * box_confidence;
+                        if (max_score >= thresh_value)
+                        {
+                            if (!first_box)
+                            {
+                                float box_x = kp_tensor_view_get_float(view, ch + 0, row, col);
+                                float box_y = kp_tensor_view_get_float(view, ch + 1, row, col);
+                                float box_w = kp_tensor_view_get_float(view, ch + 2, row, col);
+                                float box_h = kp_tensor_view_get_float(view, ch + 3, row, col);
+
+                                first_box = true;
+
+                                if (is_v5)
+                                {
+                                    box_x = sigmoid(box_x);
+                                    box_y = sigmoid(box_y);
+                                    box_w = sigmoid(box_w);
+                                    box_h = sigmoid(box_h);
+
+                                    box_x = ((box_x * 2 - 0.5f + col) * ratio_w);
+                                    box_y = ((box_y * 2 - 0.5f + row) * ratio_h);
+                                    box_w *= 2;
+                                    box_h *= 2;
+                                    box_w = box_w * box_w * yolo_v5_anchers[i][an][0];
+                                    box_h = box_h * box_h * yolo_v5_anchers[i][an][1];
+                                }
+                                else
+                                {
+                                    box_x = (sigmoid(box_x) + col) * ratio_w;
+                                    box_y = (sigmoid(box_y) + row) * ratio_h;
+                                    box_w = exp(box_w) * yolo_v3_anchers[i][an][0];
+                                    box_h = exp(box_h) * yolo_v3_anchers[i][an][1];
+                                }
+
+                                x1 = box_x - (box_w / 2);
+                                y1 = box_y - (box_h / 2);
+                                x2 = box_x + (box_w / 2);
+                                y2 = box_y + (box_h / 2);
+                            }
+
+                            possible_boxes[*good_box_count].x1 = x1;
+                            possible_boxes[*good_box_count].y1 = y1;
+                            possible_boxes[*good_box_count].x2 = x2;
+                            possible_boxes[*good_box_count].y2 = y2;
+                            possible_boxes[*good_box_count].score = max_score;
+                            possible_boxes[*good_box_count].class_num = j;
+                            (*good_box_count)++;
+
+                            if (*good_box_count >= MAX_POSSIBLE_BOXES)
+                            {
+                                printf("post yolo %s: error ! aborted due to too many boxes\n", is_v5 ? "v5" : "v3");
+                                return -1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int post_process_yolo_v3_family_fixed(kp_inf_tensor_view_t node_view[], int num_output_node, kp_hw_pre_proc_info_t *pre_proc_info,
+                                             float thresh_value, bool is_v5, kp_yolo_result_t *yoloResult)
+{
+    int class_count = (node_view[0].channel / YOLO_V3_CELL_BOX_NUM) - YOLO_V3_BOX_FIX_CH;
+    int good_box_count = 0;
+    kp_bounding_box_t *possible_boxes = (kp_bounding_box_t *)malloc(MAX_POSSIBLE_BOXES * sizeof(kp_bounding_box_t));
+    kp_bounding_box_t *temp_boxes = (kp_bounding_box_t *)malloc(MAX_POSSIBLE_BOXES * sizeof(kp_bounding_box_t));
+    int ret = -1;
+
+    if (NULL == possible_boxes || NULL == temp_boxes)
+    {
+        printf("Error! %s(): malloc memory for boxes failed\n", __FUNCTION__);
+        goto out;
+    }
+
+    if (0 != yolo_v3_decode_fixed(node_view, num_output_node, pre_proc_info, thresh_value, is_v5, possible_boxes, &good_box_count))
+        goto out;
+
+    yolo_nms(possible_boxes, good_box_count, temp_boxes, class_count, NMS_THRESH_YOLOV3_520, pre_proc_info, yoloResult);
+    ret = 0;
+
+out:
+    free(possible_boxes);
+    free(temp_boxes);
+
+    return ret;
+}
+
+int post_process_yolo_v3_fixed(kp_inf_tensor_view_t node_view[], int num_output_node,
+                               kp_hw_pre_proc_info_t *pre_proc_info, float thresh_value, kp_yolo_result_t *yoloResult)
+{
+    return post_process_yolo_v3_family_fixed(node_view, num_output_node, pre_proc_info, thresh_value, false, yoloResult);
+}
+
+int post_process_yolo_v5_520_fixed(kp_inf_tensor_view_t node_view[], int num_output_node,
+                                   kp_hw_pre_proc_info_t *pre_proc_info, float thresh_value, kp_yolo_result_t *yoloResult)
+{
+    return post_process_yolo_v3_family_fixed(node_view, num_output_node, pre_proc_info, thresh_value, true, yoloResult);
+}
+
+int post_process_yolo_v5_720_fixed(kp_inf_tensor_view_t node_view[], int num_output_node,
+                                   kp_hw_pre_proc_info_t *pre_proc_info, float thresh_value, kp_yolo_result_t *yoloResult)
+{
+    int class_count = (node_view[0].channel / YOLO_V3_CELL_BOX_NUM) - YOLO_V3_BOX_FIX_CH;
+    int good_box_count = 0;
+    int box_capacity = MAX_POSSIBLE_BOXES;
+    kp_bounding_box_t *possible_boxes = (kp_bounding_box_t *)malloc(box_capacity * sizeof(kp_bounding_box_t));
+    kp_bounding_box_t *temp_boxes = NULL;
+    int ret = -1;
+
+    if (NULL == possible_boxes)
+    {
+        printf("error! malloc failed\n");
+        goto out;
+    }
+
+    for (int i = 0; i < num_output_node; i++)
+    {
+        kp_inf_tensor_view_t *view = &node_view[i];
+        int ratio_w = pre_proc_info->model_input_width / view->width;
+        int ratio_h = pre_proc_info->model_input_height / view->height;
+        int nrows = view->height;
+        int ncols = view->width;
+        int anchor_channel = view->channel / YOLO_V3_CELL_BOX_NUM;
+        int32_t min_value, max_value;
+
+        /*
+         * outputs are already sigmoid, a score is the box probability times a class probability:
+         * a cell can make a box only if its box probability times the largest (or, when negative, the smallest) class value passes
+         */
+        fixed_range(view, &min_value, &max_value);
+
+        fixed_test_t pos_test = {view->float_scale, (float)max_value * view->float_scale, thresh_value};
+        fixed_test_t neg_test = {view->float_scale, (float)min_value * view->float_scale, thresh_value};
+        int32_t box_prob_min = fixed_lower_bound(min_value, max_value, (double)thresh_value / pos_test.factor / view->float_scale, product_exceeds, &pos_test);
+        int32_t box_prob_max = -fixed_lower_bound(-max_value, -min_value, -(double)thresh_value / neg_test.factor / view->float_scale, negated_product_exceeds, &neg_test);
+
+        // candidates are in the order of the floating-point decoder: anchor, row, column, then class
+        for (int k = 0; k < YOLO_V3_CELL_BOX_NUM; k++)
+        {
+            int ch = k * anchor_channel;
+
+            for (int row = 0; row < nrows; row++)
+            {
+                for (int col = 0; col < ncols; col++)
+                {
+                    int32_t box_prob_fixed = kp_tensor_view_get_fixed(view, ch + 4, row, col);
+
+                    if (box_prob_fixed < box_prob_min && box_prob_fixed > box_prob_max)
+                        continue;
+
+                    float box_prob = (float)box_prob_fixed * view->float_scale;
+                    float box_x = kp_tensor_view_get_float(view, ch + 0, row, col);
+                    float box_y = kp_tensor_view_get_float(view, ch + 1, row, col);
+                    float box_w = kp_tensor_view_get_float(view, ch + 2, row, col);
+                    float box_h = kp_tensor_view_get_float(view, ch + 3, row, col);
+                    float grid_x = (float)col;
+                    float grid_y = (float)row;
+
+                    box_w = (box_w * box_w);
+                    box_h = (box_h * box_h);
+                    float _x = (box_x * 2 - 0.5 + grid_x) * ratio_w;
+                    float _y = (box_y * 2 - 0.5 + grid_y) * ratio_h;
+                    float _w = box_w * 4 * yolo_v5_anchers[i][k][0];
+                    float _h = box_h * 4 * yolo_v5_anchers[i][k][1];
+                    float xleft = (_x - _w / 2);
+                    float yleft = (_y - _h / 2);
+
+                    for (int c = 0; c < class_count; c++)
+                    {
+                        float score = box_prob * kp_tensor_view_get_float(view, ch + YOLO_V3_BOX_FIX_CH + c, row, col);
+
+                        if (score <= thresh_value)
+                            continue;
+
+                        if (good_box_count == box_capacity)
+                        {
+                            kp_bounding_box_t *boxes = (kp_bounding_box_t *)realloc(possible_boxes, 2 * box_capacity * sizeof(kp_bounding_box_t));
+
+                            if (NULL == boxes)
+                            {
+                                printf("error! malloc failed\n");
+                                goto out;
+                            }
+
+                            possible_boxes = boxes;
+                            box_capacity *= 2;
+                        }
+
+                        possible_boxes[good_box_count].x1 = xleft;
+                        possible_boxes[good_box_count].y1 = yleft;
+                        possible_boxes[good_box_count].x2 = xleft + _w;
+                        possible_boxes[good_box_count].y2 = yleft + _h;
+                        possible_boxes[good_box_count].score = score;
+                        possible_boxes[good_box_count].class_num = c;
+                        good_box_count++;
+                    }
+                }
+            }
+        }
+    }
+
+    temp_boxes = (kp_bounding_box_t *)malloc((good_box_count + 1) * sizeof(kp_bounding_box_t));
+    if (NULL == temp_boxes)
+    {
+        printf("error! malloc temp working buffer failed\n");
+        goto out;
+    }
+
+    yolo_nms(possible_boxes, good_box_count, temp_boxes, class_count, NMS_THRESH_YOLOV5_720, pre_proc_info, yoloResult);
+    ret = 0;
+
+out:
+    free(possible_boxes);
+    free(temp_boxes);
+
+    return ret;
+}
@@ -56,3 +56,53 @@ int post_process_yolo_v5_520(kp_inf_float_node_output_t *node_output[], int num_
  */
 int post_process_yolo_v5_720(kp_inf_float_node_output_t *node_output[], int num_output_node,
                              kp_hw_pre_proc_info_t *pre_proc_info, float thresh_value, kp_yolo_result_t *yoloResult);
+
+/**
+ * @brief YOLO V3 post-processing function for KL520, reading fixed-point output nodes.
+ *
+ * Same result as post_process_yolo_v3(), the objectness of each cell is compared with the threshold in the fixed-point domain
+ * and only the cells which can make a box are converted to floating-point.
+ *
+ * @param[in] node_view tensor views of the output nodes, they should come from kp_generic_inference_retrieve_tensor_view().
+ * @param[in] num_output_node total number of output node.
+ * @param[in] pre_proc_info hardware pre-process related info.
+ * @param[in] thresh_value range from 0 ~ 1
+ * @param[out] yoloResult this is the yolo result output, users need to prepare a buffer of 'kp_yolo_result_t' for this.
+ *
+ * @return return 0 means sucessful, otherwise failed.
+ */
+int post_process_yolo_v3_fixed(kp_inf_tensor_view_t node_view[], int num_output_node,
+                               kp_hw_pre_proc_info_t *pre_proc_info, float thresh_value, kp_yolo_result_t *yoloResult);
+
+/**
+ * @brief YOLO V5 post-processing function (with sigmoid) for KL520, reading fixed-point output nodes.
+ *
+ * Same result as post_process_yolo_v5_520(), see post_process_yolo_v3_fixed().
+ *
+ * @param[in] node_view tensor views of the output nodes, they should come from kp_generic_inference_retrieve_tensor_view().
+ * @param[in] num_output_node total number of output node.
+ * @param[in] pre_proc_info hardware pre-process related info.
+ * @param[in] thresh_value range from 0 ~ 1
+ * @param[out] yoloResult this is the yolo result output, users need to prepare a buffer of 'kp_yolo_result_t' for this.
+ *
+ * @return return 0 means sucessful, otherwise failed.
+ */
+int post_process_yolo_v5_520_fixed(kp_inf_tensor_view_t node_view[], int num_output_node,
+                                   kp_hw_pre_proc_info_t *pre_proc_info, float thresh_value, kp_yolo_result_t *yoloResult);
+
+/**
+ * @brief YOLO V5 post-processing function (without sigmoid) for KL720, reading fixed-point output nodes.
+ *
+ * Same result as post_process_yolo_v5_720(), the box probability of each cell is compared with the threshold in the fixed-point domain
+ * and only the cells which can make a box are converted to floating-point.
+ *
+ * @param[in] node_view tensor views of the output nodes, they should come from kp_generic_inference_retrieve_tensor_view().
+ * @param[in] num_output_node total number of output node.
+ * @param[in] pre_proc_info hardware pre-process related info.
+ * @param[in] thresh_value range from 0 ~ 1
+ * @param[out] yoloResult this is the yolo result output, users need to prepare a buffer of 'kp_yolo_result_t' for this.
+ *
+ * @return return 0 means sucessful, otherwise failed.
+ */
+int post_process_yolo_v5_720_fixed(kp_inf_tensor_view_t node_view[], int num_output_node,
+                                   kp_hw_pre_proc_info_t *pre_proc_info, float thresh_value, kp_yolo_result_t *yoloResult);
@@ -116,19 +116,17 @@ int main(int argc, char *argv[])
 
     kp_yolo_result_t *yolo_result = (kp_yolo_result_t *)malloc(sizeof(kp_yolo_result_t));
 
-    kp_inf_float_node_output_t *output_nodes[2] = {NULL}; // tiny yolo v3 outputs only two nodes, described by _output_desc.num_output_node
+    kp_inf_tensor_view_t output_views[2]; // tiny yolo v3 outputs only two nodes, described by _output_desc.num_output_node
 
-    // retrieve output nodes in floating point format in first crop box
-    output_nodes[0] = kp_generic_inference_retrieve_float_node(0, raw_output_buf, KP_CHANNEL_ORDERING_HCW);
-    output_nodes[1] = kp_generic_inference_retrieve_float_node(1, raw_output_buf, KP_CHANNEL_ORDERING_HCW);
+    // retrieve views of the output nodes, their fixed-point data stays in raw_output_buf
+    kp_generic_inference_retrieve_tensor_view(0, raw_output_buf, &output_views[0]);
+    kp_generic_inference_retrieve_tensor_view(1, raw_output_buf, &output_views[1]);
 
-    // post-process yolo v3 output nodes to class/bounding boxes
-    post_process_yolo_v3(output_nodes, _output_desc.num_output_node, &_output_desc.pre_proc_info[0], 0.2, yolo_result);
+    // post-process yolo v3 output nodes to class/bounding boxes, only the cells passing the threshold are converted to floating point
+    post_process_yolo_v3_fixed(output_views, _output_desc.num_output_node, &_output_desc.pre_proc_info[0], 0.2, yolo_result);
 
     helper_print_yolo_box_on_bmp(yolo_result, _image_file_path);
 
-    free(output_nodes[0]);
-    free(output_nodes[1]);
     free(yolo_result);
 
     free(raw_output_buf);
@@ -0,0 +1,263 @@
+/**
+ * @file        startup_benchmark.c
+ * @brief       measure time-to-first-inference of device groups of different sizes
+ * @version     0.1
+ * @date        2026-10-18
+ *
+ * @copyright   Copyright (c) 2021 Kneron Inc. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/time.h>
+
+#include "kp_core.h"
+#include "kp_inference.h"
+
+#define MAX_DEV_COUNT 20 /* MAX device count of a device group */
+
+static char _model_file_path[128] = "../../res/models/KL720/YoloV5s_640_640_3/models_720.nef";
+static int _max_devices = MAX_DEV_COUNT;
+static int _num_sim_devices = 0;
+static char *_cache_dir = NULL;
+
+void print_settings()
+{
+    printf("startup_benchmark example\n");
+    printf("\n");
+    printf("  connect 1 ~ N devices, load the model and run the first inference on every device,\n");
+    printf("  then load the model again (devices holding it are not reloaded) and run the first inference again\n");
+    printf("\n");
+    printf("Arguments:\n");
+    printf("-help, h   : print help message\n");
+    printf("-model, m  : [model file path] = (default \"%s\")\n", _model_file_path);
+    printf("-num, n    : [max device count] = (default all found devices)\n");
+    printf("-sim, s    : [simulated device count] = (benchmark KL720 simulated devices instead of real devices)\n");
+    printf("-cache, c  : [model descriptor cache directory] = (keep parsed model descriptors in an existing directory)\n");
+    printf("\n");
+
+    return;
+}
+
+bool parse_arguments(int argc, char *argv[])
+{
+    int opt = 0;
+
+    static struct option long_options[] = {
+        {"help",  no_argument,       0, 'h'},
+        {"model", required_argument, 0, 'm'},
+        {"num",   required_argument, 0, 'n'},
+        {"sim",   required_argument, 0, 's'},
+        {"cache", required_argument, 0, 'c'},
+        {0, 0, 0, 0}};
+
+    int option_index = 0;
+
+    while ((opt = getopt_long(argc, argv, "hm:n:s:c:", long_options, &option_index)) != -1)
+    {
+        switch (opt)
+        {
+        case 'm':
+            snprintf(_model_file_path, sizeof(_model_file_path), "%s", optarg);
+            break;
+        case 'n':
+            _max_devices = atoi(optarg);
+            break;
+        case 's':
+            _num_sim_devices = atoi(optarg);
+            break;
+        case 'c':
+            _cache_dir = optarg;
+            break;
+        case 'h':
+        case '?':
+        default:
+            print_settings();
+            exit(0);
+        }
+    }
+
+    return true;
+}
+
+static double get_time_ms()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (double)tv.tv_sec * 1000 + (double)tv.tv_usec / 1000;
+}
+
+// run one inference on every device of the group, inferences are dispatched to the least loaded devices
+static int run_first_inferences(kp_device_group_t devices, int num_devices, kp_model_nef_descriptor_t *model_desc)
+{
+    kp_single_model_descriptor_t *model = &model_desc->models[0];
+    kp_tensor_descriptor_t *input_node = &model->input_nodes[0];
+    uint32_t width = input_node->shape_npu[3];
+    uint32_t height = input_node->shape_npu[2];
+    uint32_t raw_buf_size = model->max_raw_out_size;
+
+    uint8_t *img_buf = (uint8_t *)calloc(1, width * height * 2);
+    uint8_t *raw_output_buf = (uint8_t *)malloc(raw_buf_size);
+    int ret = KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+
+    if ((NULL == img_buf) || (NULL == raw_output_buf))
+        goto FUNC_OUT;
+
+    kp_generic_image_inference_desc_t input_desc;
+    kp_generic_image_inference_result_header_t output_desc;
+
+    memset(&input_desc, 0, sizeof(input_desc));
+    input_desc.model_id = model->id;
+    input_desc.num_input_node_image = 1;
+    input_desc.input_node_image_list[0].resize_mode = KP_RESIZE_DISABLE;
+    input_desc.input_node_image_list[0].padding_mode = KP_PADDING_DISABLE;
+    input_desc.input_node_image_list[0].normalize_mode = KP_NORMALIZE_KNERON;
+    input_desc.input_node_image_list[0].image_format = KP_IMAGE_FORMAT_RGB565;
+    input_desc.input_node_image_list[0].width = width;
+    input_desc.input_node_image_list[0].height = height;
+    input_desc.input_node_image_list[0].image_buffer = img_buf;
+
+    for (int i = 0; i < num_devices; i++)
+    {
+        input_desc.inference_number = i;
+
+        ret = kp_generic_image_inference_send(devices, &input_desc);
+        if (KP_SUCCESS != ret)
+            goto FUNC_OUT;
+    }
+
+    for (int i = 0; i < num_devices; i++)
+    {
+        ret = kp_generic_image_inference_receive(devices, &output_desc, raw_output_buf, raw_buf_size);
+        if (KP_SUCCESS != ret)
+            goto FUNC_OUT;
+    }
+
+FUNC_OUT:
+    free(img_buf);
+    free(raw_output_buf);
+
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    int port_ids[MAX_DEV_COUNT];
+    int num_found = 0;
+    int ret;
+
+    parse_arguments(argc, argv);
+
+    if (0 < _num_sim_devices)
+    {
+        kp_sim_device_config_t sim_config = {0};
+
+        sim_config.num_devices = _num_sim_devices;
+        sim_config.product_id = KP_DEVICE_KL720;
+        sim_config.usb_latency_us = 100;
+        sim_config.usb_bandwidth_mbps = 300;
+        sim_config.npu_time_us = 10000;
+
+        ret = kp_enable_simulated_devices(&sim_config);
+        if (KP_SUCCESS != ret)
+        {
+            printf("enable simulated devices failed, error = %d (%s)\n", ret, kp_error_string(ret));
+            return -1;
+        }
+    }
+
+    if (NULL != _cache_dir)
+    {
+        ret = kp_set_model_descriptor_cache_dir(_cache_dir);
+        if (KP_SUCCESS != ret)
+        {
+            printf("set model descriptor cache directory failed, error = %d (%s)\n", ret, kp_error_string(ret));
+            return -1;
+        }
+    }
+
+    /******* collect connectable devices of the first found target platform *******/
+    kp_devices_list_t *device_list = kp_scan_devices();
+
+    for (int i = 0; i < device_list->num_dev && num_found < MAX_DEV_COUNT; i++)
+    {
+        kp_device_descriptor_t *dev = &device_list->device[i];
+
+        if (dev->isConnectable && (dev->product_id == device_list->device[0].product_id))
+            port_ids[num_found++] = dev->port_id;
+    }
+
+    if (_max_devices > num_found)
+        _max_devices = num_found;
+
+    if (1 > _max_devices)
+    {
+        printf("no connectable device is found\n");
+        return -1;
+    }
+
+    printf("model: %s\n\n", _model_file_path);
+    printf("devices | connect (ms) | load model (ms) | first inference (ms) | total (ms) | reload model (ms) | first inference (ms)\n");
+
+    /******* time-to-first-inference of 1 ~ N devices *******/
+    for (int num_devices = 1; num_devices <= _max_devices; num_devices++)
+    {
+        kp_model_nef_descriptor_t model_desc;
+        memset(&model_desc, 0, sizeof(model_desc));
+
+        double t_start = get_time_ms();
+
+        kp_device_group_t devices = kp_connect_devices(num_devices, port_ids, &ret);
+        if (NULL == devices)
+        {
+            printf("connect %d devices failed, error = %d (%s)\n", num_devices, ret, kp_error_string(ret));
+            return -1;
+        }
+
+        kp_set_timeout(devices, 5000);
+
+        double t_connect = get_time_ms();
+
+        ret = kp_load_model_from_file(devices, _model_file_path, &model_desc);
+
+        double t_load = get_time_ms();
+
+        if (KP_SUCCESS == ret)
+            ret = run_first_inferences(devices, num_devices, &model_desc);
+
+        double t_inference = get_time_ms();
+
+        // loading the model again, as a restarted service does
+        if (KP_SUCCESS == ret)
+        {
+            kp_release_model_nef_descriptor(&model_desc);
+            ret = kp_load_model_from_file(devices, _model_file_path, &model_desc);
+        }
+
+        double t_reload = get_time_ms();
+
+        if (KP_SUCCESS == ret)
+            ret = run_first_inferences(devices, num_devices, &model_desc);
+
+        double t_reinference = get_time_ms();
+
+        kp_release_model_nef_descriptor(&model_desc);
+        kp_disconnect_devices(devices);
+
+        if (KP_SUCCESS != ret)
+        {
+            printf("benchmark %d devices failed, error = %d (%s)\n", num_devices, ret, kp_error_string(ret));
+            return -1;
+        }
+
+        printf("%7d | %12.1f | %15.1f | %20.1f | %10.1f | %17.1f | %20.1f\n", num_devices,
+               t_connect - t_start, t_load - t_connect, t_inference - t_load, t_inference - t_start,
+               t_reload - t_inference, t_reinference - t_reload);
+    }
+
+    return 0;
+}
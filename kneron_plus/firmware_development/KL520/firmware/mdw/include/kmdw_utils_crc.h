@@ -34,6 +34,13 @@ uint32_t kmdw_utils_crc_gen_sha32(uint8_t *data, uint32_t size);
  */
 uint32_t kmdw_utils_crc_gen_sum32(uint8_t *data, uint32_t size);
 
+/**
+ * @brief generate FNV-1a 32-bit hash, which unlike sum32 tells reordered data
+ * @param[in] data data for calculation
+ * @param[in] size data size
+ */
+uint32_t kmdw_utils_crc_gen_fnv1a32(uint8_t *data, uint32_t size);
+
 /**
  * @brief generate crc32 code
  * @param[in] data data for calculation
@@ -17,6 +17,8 @@
 #include "kmdw_console.h"
 #include "kmdw_model.h"
 #include "kmdw_memxfer.h"
+#include "kmdw_memory.h"
+#include "kmdw_utils_crc.h"
 
 
 
@@ -93,6 +95,22 @@ struct cnn_header_s
 extern int kdp_memxfer_flash_to_ddr(uint32_t dst, uint32_t src, size_t bytes);
 extern int kdp_memxfer_ddr_to_flash(u32 dst, u32 src, size_t bytes);
 
+#define FLASH_WRITE_ALIGNMENT (4 * 1024) // kdp_memxfer_ddr_to_flash() erases 4KB sectors
+#define FLAG_FLASH_WRITE_DONE 0x1
+
+typedef struct
+{
+    uint32_t flash_addr;
+    uint32_t buffer;
+    uint32_t length;
+} _flash_write_job_t;
+
+static osThreadId_t _flash_write_tid = NULL;
+static osMessageQueueId_t _flash_write_job_queue = NULL; // command handler -> flash write thread
+static osEventFlagsId_t _flash_write_evt = NULL;         // flash write thread -> command handler
+static volatile int32_t _flash_write_sts = KP_SUCCESS;
+static volatile uint32_t _flash_write_sum32 = 0;
+
 static uint32_t _flash_read_callback(uint32_t addr, uint32_t img_size)
 {
     fifo_cmd_dbg("[%s]\n", __FUNCTION__);
@@ -273,12 +291,46 @@ static int _update_model(kdp_model_update_cmd_t *kdp_cmd)
 }
 
 static uint8_t _dfu_buf[4 * 1024]; // kmdw_dfu_init() says it need at least 4KB buffer, and it cannot use DDR, really sucks
+
+// program one chunk of KDP2_COMMAND_WRITE_FLASH and read it back, while the command handler receives the next one
+static void _flash_write_thread(void *arg)
+{
+    _flash_write_job_t job;
+
+    while (1) {
+        osMessageQueueGet(_flash_write_job_queue, &job, NULL, osWaitForever);
+
+        if (0 != kdp_memxfer_ddr_to_flash(job.flash_addr, job.buffer, job.length) ||
+            0 != kdp_memxfer_flash_to_ddr(job.buffer, job.flash_addr, job.length)) {
+            fifo_cmd_dbg("[%s] write flash on addr %d failed\n", __FUNCTION__, job.flash_addr);
+            _flash_write_sts = KP_FW_ERROR_FLASH_WRITE_FAILED_124;
+        } else {
+            // chunks are word aligned, so sum32 of the region is the sum of the chunks
+            _flash_write_sum32 += kmdw_utils_crc_gen_sum32((uint8_t *)job.buffer, job.length);
+        }
+
+        osEventFlagsSet(_flash_write_evt, FLAG_FLASH_WRITE_DONE);
+    }
+}
+
 int kdp2_cmd_handler_initialize()
 {
     fifo_cmd_dbg("[%s]\n", __FUNCTION__);
 
     if(FLASH_TYPE != FLASH_TYPE_NULL) {
         kmdw_dfu_init(_dfu_buf, _flash_read_callback); // TODO: waste of memory
+
+        osThreadAttr_t attr;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.stack_size = 1024; // as the usb receiving thread, which runs the same SPI flash driver and debug printing for other commands
+        attr.priority = osPriorityBelowNormal; // below usb receiving, which only waits for DMA
+
+        _flash_write_job_queue = osMessageQueueNew(1, sizeof(_flash_write_job_t), NULL);
+        _flash_write_evt = osEventFlagsNew(NULL);
+
+        if (NULL != _flash_write_job_queue && NULL != _flash_write_evt)
+            _flash_write_tid = osThreadNew(_flash_write_thread, NULL, &attr);
     }
 
     return 0;
@@ -424,15 +476,10 @@ FUNC_OUT:
     return return_code;
 }
 
-static int _write_flash(kdp2_ipc_cmd_write_flash_t *cmd_buf)
+static int _write_flash_at_once(uint32_t buffer, uint32_t flash_addr, uint32_t length)
 {
     kdrv_status_t usb_sts;
     int32_t return_code = KP_SUCCESS; // FIXME: error handling
-    uint32_t buffer = (uint32_t)cmd_buf;
-    uint32_t flash_addr = cmd_buf->flash_offset;
-    uint32_t length = cmd_buf->length;
-
-    fifo_cmd_dbg("[%s] Write flash on addr %d\n", __FUNCTION__, flash_addr);
 
     usb_sts = usbd_hal_bulk_receive(KDP2_USB_ENDPOINT_DATA_OUT, (void *)buffer, &length, USB_NORMAL_TIMEOUT);
 
@@ -456,6 +503,152 @@ FUNC_OUT:
     return return_code;
 }
 
+// chunks are received into two halves of the command buffer, one is programmed while the other is received
+static int _write_flash_pipelined(uint32_t buffer, uint32_t flash_addr, uint32_t length, uint32_t chunk_size)
+{
+    kdrv_status_t usb_sts = KDRV_STATUS_OK;
+    kdp2_ipc_response_write_flash_t response = {KP_SUCCESS, 0};
+    bool programming = false;
+
+    _flash_write_sts = KP_SUCCESS;
+    _flash_write_sum32 = 0;
+
+    for (uint32_t offset = 0; offset < length; offset += chunk_size) {
+        _flash_write_job_t job;
+        uint32_t rx_len;
+
+        job.flash_addr = flash_addr + offset;
+        job.buffer = buffer + ((offset / chunk_size) & 1) * chunk_size;
+        job.length = (length - offset < chunk_size) ? length - offset : chunk_size;
+        rx_len = job.length;
+
+        usb_sts = usbd_hal_bulk_receive(KDP2_USB_ENDPOINT_DATA_OUT, (void *)job.buffer, &rx_len, USB_NORMAL_TIMEOUT);
+
+        if (usb_sts != KDRV_STATUS_OK || rx_len != job.length) {
+            fifo_cmd_dbg("[%s] receive data at %d failed, sts %d\n", __FUNCTION__, offset, usb_sts);
+            response.return_code = KP_FW_ERROR_USB_RECEIVE_FAILED_123;
+            break;
+        }
+
+        // the previous chunk must be done before its half receives the chunk after this one
+        if (programming)
+            osEventFlagsWait(_flash_write_evt, FLAG_FLASH_WRITE_DONE, osFlagsWaitAny, osWaitForever);
+
+        // after a flash error, remaining data is still received so that the host gets the return code
+        programming = (KP_SUCCESS == _flash_write_sts);
+
+        if (programming)
+            osMessageQueuePut(_flash_write_job_queue, &job, 0, osWaitForever);
+    }
+
+    if (programming)
+        osEventFlagsWait(_flash_write_evt, FLAG_FLASH_WRITE_DONE, osFlagsWaitAny, osWaitForever);
+
+    if (KP_SUCCESS == response.return_code) {
+        response.return_code = _flash_write_sts;
+        response.sum32 = _flash_write_sum32;
+    }
+
+    usb_sts = usbd_hal_bulk_send(KDP2_USB_ENDPOINT_DATA_IN, (void *)&response, sizeof(response), USB_NORMAL_TIMEOUT);
+    if (usb_sts != KDRV_STATUS_OK) {
+        fifo_cmd_dbg("[%s] send response failed, sts %d\n", __FUNCTION__, usb_sts);
+        return -1;
+    }
+
+    return (KP_SUCCESS == response.return_code) ? 0 : -1;
+}
+
+// size of the buffer a command is received into, the system reserve buffer or an image buffer of the FIFO queue
+static uint32_t _command_buffer_size(uint32_t buffer)
+{
+    uint32_t reserve_addr, reserve_size;
+    uint32_t input_buf_count, input_buf_size, result_buf_count, result_buf_size;
+
+    kmdw_ddr_get_system_reserve(&reserve_addr, &reserve_size);
+
+    if (buffer == reserve_addr)
+        return reserve_size;
+
+    kmdw_fifoq_manager_get_fifoq_config(&input_buf_count, &input_buf_size, &result_buf_count, &result_buf_size);
+
+    return input_buf_size;
+}
+
+static int _write_flash(kdp2_ipc_cmd_write_flash_t *cmd_buf)
+{
+    // the command is overwritten by received data
+    uint32_t buffer = (uint32_t)cmd_buf;
+    uint32_t flash_addr = cmd_buf->flash_offset;
+    uint32_t length = cmd_buf->length;
+    uint32_t chunk_size = 0;
+
+    if (sizeof(kdp2_ipc_cmd_write_flash_t) <= cmd_buf->total_size)
+        chunk_size = cmd_buf->chunk_size;
+
+    // chunk size is given by host, both halves must fit in the buffer, host sends the data in one go so any chunk size works
+    uint32_t max_chunk_size = (_command_buffer_size(buffer) / 2) & ~(FLASH_WRITE_ALIGNMENT - 1);
+
+    if (chunk_size > max_chunk_size)
+        chunk_size = max_chunk_size;
+
+    fifo_cmd_dbg("[%s] Write flash on addr %d, chunk size %d\n", __FUNCTION__, flash_addr, chunk_size);
+
+    if (0 == chunk_size || (chunk_size & (FLASH_WRITE_ALIGNMENT - 1)) || NULL == _flash_write_tid)
+        return _write_flash_at_once(buffer, flash_addr, length);
+
+    return _write_flash_pipelined(buffer, flash_addr, length, chunk_size);
+}
+
+// hashes are written at the beginning of the command buffer, and every block is read after them
+static int _hash_flash(kdp2_ipc_cmd_hash_flash_t *cmd_buf)
+{
+    kdrv_status_t usb_sts;
+    int32_t return_code = KP_SUCCESS;
+    uint32_t *hashes = (uint32_t *)cmd_buf;
+    uint32_t flash_addr = cmd_buf->flash_offset;
+    uint32_t length = cmd_buf->length;
+    uint32_t block_size = cmd_buf->block_size;
+
+    fifo_cmd_dbg("[%s] Hash flash on addr %d, length %d, block size %d\n", __FUNCTION__, flash_addr, length, block_size);
+
+    if (0 == block_size || (block_size & (FLASH_WRITE_ALIGNMENT - 1)) || (flash_addr & (FLASH_WRITE_ALIGNMENT - 1)) ||
+        0 == length || 0 != (length % block_size) || FLASH_END_ADDR < flash_addr || (FLASH_END_ADDR - flash_addr) < length - 1) {
+        return_code = KP_FW_ERROR_FLASH_READ_FAILED_125;
+    } else if ((length / block_size + 1) * sizeof(uint32_t) + block_size > _command_buffer_size((uint32_t)cmd_buf)) {
+        // hashes and the block being read must fit in the buffer, host hashes a long region piece by piece
+        return_code = KP_FW_ERROR_FLASH_READ_FAILED_125;
+    }
+
+    // firmware not supporting this command does not reply, so reply before reading flash
+    usb_sts = usbd_hal_bulk_send(KDP2_USB_ENDPOINT_DATA_IN, (void *)&return_code, sizeof(uint32_t), USB_NORMAL_TIMEOUT);
+    if (usb_sts != KDRV_STATUS_OK || KP_SUCCESS != return_code) {
+        fifo_cmd_dbg("[%s] send return code %d failed, sts %d\n", __FUNCTION__, return_code, usb_sts);
+        return -1;
+    }
+
+    uint32_t num_blocks = length / block_size;
+    uint32_t block_buf = (uint32_t)(hashes + num_blocks + 1);
+
+    for (uint32_t i = 0; i < num_blocks; i++) {
+        if (0 != kdp_memxfer_flash_to_ddr(block_buf, flash_addr + i * block_size, block_size)) {
+            return_code = KP_FW_ERROR_FLASH_READ_FAILED_125;
+            break;
+        }
+
+        hashes[i] = kmdw_utils_crc_gen_fnv1a32((uint8_t *)block_buf, block_size);
+    }
+
+    hashes[num_blocks] = (uint32_t)return_code;
+
+    usb_sts = usbd_hal_bulk_send(KDP2_USB_ENDPOINT_DATA_IN, (void *)hashes, (num_blocks + 1) * sizeof(uint32_t), USB_NORMAL_TIMEOUT);
+    if (usb_sts != KDRV_STATUS_OK) {
+        fifo_cmd_dbg("[%s] send hashes failed, sts %d\n", __FUNCTION__, usb_sts);
+        return -1;
+    }
+
+    return (KP_SUCCESS == return_code) ? 0 : -1;
+}
+
 #define OUT_NODE_HEAD_SIZE 20 // node's width, height, channel, radix, scale
 
 static int _get_model_info(kdp2_ipc_cmd_get_model_info_t *cmd_buf)
@@ -761,6 +954,9 @@ int kdp2_cmd_handle_kp_command(uint32_t command_buffer)
     case KDP2_COMMAND_WRITE_FLASH:
         ret = _write_flash((kdp2_ipc_cmd_write_flash_t *)command_buffer);
         break;
+    case KDP2_COMMAND_HASH_FLASH:
+        ret = _hash_flash((kdp2_ipc_cmd_hash_flash_t *)command_buffer);
+        break;
     case KDP2_COMMAND_GET_MODEL_INFO:
         ret = _get_model_info((kdp2_ipc_cmd_get_model_info_t *)command_buffer);
         break;
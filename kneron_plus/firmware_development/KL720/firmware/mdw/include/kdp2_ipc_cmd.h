@@ -50,6 +50,7 @@ enum kdp2_command_id
     KDP2_COMMAND_GET_FIFOQ_CONFIG = 0xA13,
     KDP2_COMMAND_READ_FLASH = 0xA98,        // not supported
     KDP2_COMMAND_WRITE_FLASH = 0xA99,       // not supported
+    KDP2_COMMAND_HASH_FLASH = 0xA9A,       // not supported
 };
 
 // below are for firmware serial number
@@ -175,9 +176,30 @@ typedef struct
 
     uint32_t flash_offset; // 4KB alignment
     uint32_t length;
+    uint32_t chunk_size;   // 4KB alignment, program each chunk while receiving the next one and reply
+                           // kdp2_ipc_response_write_flash_t, 0 (or old host) to reply return code only
 
 } __attribute__((aligned(4))) kdp2_ipc_cmd_write_flash_t;
 
+typedef struct
+{
+    uint32_t return_code; // KP_API_RETURN_CODE
+    uint32_t sum32;       // sum32 of the written region read back from flash
+} __attribute__((aligned(4))) kdp2_ipc_response_write_flash_t;
+
+typedef struct
+{
+    uint32_t magic_type; // should be 'KDP2_MAGIC_TYPE_COMMAND'
+    uint32_t total_size; // size of this data struct
+    uint32_t command_id; // should be 'KDP2_COMMAND_HASH_FLASH'
+
+    uint32_t flash_offset; // 4KB alignment
+    uint32_t length;       // multiple of block_size
+    uint32_t block_size;   // 4KB alignment
+
+    // reply return code, then FNV-1a of every block followed by return code of reading flash
+} __attribute__((aligned(4))) kdp2_ipc_cmd_hash_flash_t;
+
 typedef struct
 {
     uint32_t magic_type; // should be 'KDP2_MAGIC_TYPE_COMMAND'
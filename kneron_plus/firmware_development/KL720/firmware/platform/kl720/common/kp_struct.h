@@ -134,6 +134,8 @@ enum KP_API_RETURN_CODE
     KP_FW_ERROR_POSIX_SPAWN_FAILED_121 = 121,
     KP_FW_ERROR_USB_SEND_FAILED_122 = 122,
     KP_FW_ERROR_USB_RECEIVE_FAILED_123 = 123,
+    KP_FW_ERROR_FLASH_WRITE_FAILED_124 = 124,
+    KP_FW_ERROR_FLASH_READ_FAILED_125 = 125,
 
     /* ncpu error code (sync with ipc.h) */
     KP_FW_NCPU_ERR_BEGIN         = 200,
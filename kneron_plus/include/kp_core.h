@@ -53,6 +53,8 @@ kp_device_group_t kp_connect_devices_without_check(int num_devices, int device_p
 /**
  * @brief To disconnect a Kneron device.
  *
+ * It cannot be called from the callback of asynchronous inference, refer to kp_inference_stop_async().
+ *
  * @param[in] devices a set of devices handle.
  *
  * @return refer to KP_API_RETURN_CODE in kp_struct.h
@@ -68,6 +70,58 @@ int kp_disconnect_devices(kp_device_group_t devices);
  */
 void kp_set_timeout(kp_device_group_t devices, int milliseconds);
 
+/**
+ * @brief To set the number of USB bulk transfers kept in flight per endpoint for all devices.
+ *
+ * Large writes are split into chunks which are queued ahead, so the USB bus does not idle between chunks.
+ *
+ * @param[in] devices a set of devices handle.
+ * @param[in] queue_depth number of in-flight transfers, 1 ~ 16, default is 4.
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_set_usb_queue_depth(kp_device_group_t devices, int queue_depth);
+
+/**
+ * @brief To get where a device of the group is in USB topology, parsed from its port path.
+ *
+ * Devices under the same root hub port share its bandwidth, and all root hub ports of a bus share the host controller.
+ * Inferences are dispatched to the less loaded host controllers and root hub ports first, so devices of a large group can be spread over them.
+ *
+ * @param[in] devices a set of devices handle.
+ * @param[in] dev_port_id specified device port ID.
+ * @param[out] bus_number USB bus (host controller) of the device, -1 if unknown (e.g. simulated devices).
+ * @param[out] root_port port of the root hub which the device or its hubs are plugged into.
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_get_device_usb_topology(kp_device_group_t devices, int dev_port_id, int *bus_number, int *root_port);
+
+/**
+ * @brief To allocate a buffer for inference images or raw output data, which the devices transfer without extra copies.
+ *
+ * The buffer is USB zero-copy memory where the platform supports it, otherwise page-aligned memory.
+ * Space is reserved in front of the buffer, so the inference header and the image are sent in one transfer without copying the image.
+ * Only the returned pointer itself is sent without copying, data at an offset inside the buffer is copied as with any other memory.
+ * Freed buffers are kept by the devices handle and reused, so allocating in every inference does not hit the system allocator.
+ *
+ * @param[in] devices a set of devices handle.
+ * @param[in] size size of the buffer in bytes.
+ *
+ * @return pointer to the buffer, or NULL if failed. Buffers not freed by kp_free_io_buffer() are released by kp_disconnect_devices().
+ */
+void *kp_alloc_io_buffer(kp_device_group_t devices, uint32_t size);
+
+/**
+ * @brief To free a buffer allocated by kp_alloc_io_buffer().
+ *
+ * @param[in] devices a set of devices handle.
+ * @param[in] buffer buffer from kp_alloc_io_buffer(), the buffer must not be used by an inference in progress.
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_free_io_buffer(kp_device_group_t devices, void *buffer);
+
 /**
  * @brief reset the device in hardware mode or software mode.
  *
@@ -105,6 +159,8 @@ int kp_load_firmware_from_file(kp_device_group_t devices, const char *scpu_fw_pa
 /**
  * @brief upload models to device through USB, and return kp_model_nef_descriptor_t *model_desc (must release model_desc by kp_release_model_nef_descriptor)
  *
+ * model_desc shares one read-only memory block with the descriptor kept by the device group, the block is freed by the last release.
+ *
  * @param[in] devices a set of devices handle.
  * @param[in] nef_buf a buffer contains the content of NEF file.
  * @param[in] nef_size file size of the NEF.
@@ -117,6 +173,9 @@ int kp_load_model(kp_device_group_t devices, void *nef_buf, int nef_size, kp_mod
 /**
  * @brief Similar to kp_load_model(), and it accepts file path instead of a buffer (must release model_desc by kp_release_model_nef_descriptor)
  *
+ * The file is memory-mapped instead of being read into a buffer, and its CRC is checked while the models are uploaded.
+ * If the CRC does not match, the devices are rebooted to drop the uploaded models and KP_ERROR_INVALID_MODEL_21 is returned.
+ *
  * @param[in] devices a set of devices handle.
  * @param[in] file_path a buffer contains the content of NEF file.
  * @param[out] model_desc this parameter is output for describing the uploaded models.
@@ -125,6 +184,56 @@ int kp_load_model(kp_device_group_t devices, void *nef_buf, int nef_size, kp_mod
  */
 int kp_load_model_from_file(kp_device_group_t devices, const char *file_path, kp_model_nef_descriptor_t *model_desc);
 
+/**
+ * @brief upload models to some devices of the group through USB, other devices keep their models (must release model_desc by kp_release_model_nef_descriptor)
+ *
+ * One group can hold different NEFs on different devices, e.g. a detector on 3 devices and a classifier on 1 device.
+ * kp_generic_image_inference_send() and kp_generic_data_inference_send() then send an inference only to devices holding its model_id,
+ * and spread inferences of a model over the devices holding it. Model IDs should be unique among the NEFs of a group.
+ * Models loaded by kp_load_model() into all devices replace those loaded by this function.
+ * Customized inferences are sent to any device of the group.
+ *
+ * The devices are set up with automatic DDR attributes for their models.
+ * If loading fails, the devices hold no models and get no inferences until models are loaded into them again.
+ * With hotplug enabled, a device plugged in to replace one of the devices gets the same models.
+ * This must not be called while inferences are sent or received.
+ *
+ * @param[in] devices a set of devices handle.
+ * @param[in] num_devices number of devices to upload models to.
+ * @param[in] device_port_ids an array contains port IDs of the devices, they must be connected in the group.
+ * @param[in] nef_buf a buffer contains the content of NEF file.
+ * @param[in] nef_size file size of the NEF.
+ * @param[out] model_desc this parameter is output for describing the uploaded models.
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_load_model_to_devices(kp_device_group_t devices, int num_devices, int device_port_ids[], void *nef_buf, int nef_size, kp_model_nef_descriptor_t *model_desc);
+
+/**
+ * @brief Similar to kp_load_model_to_devices(), and it accepts file path instead of a buffer (must release model_desc by kp_release_model_nef_descriptor)
+ *
+ * @param[in] devices a set of devices handle.
+ * @param[in] num_devices number of devices to upload models to.
+ * @param[in] device_port_ids an array contains port IDs of the devices, they must be connected in the group.
+ * @param[in] file_path a buffer contains the content of NEF file.
+ * @param[out] model_desc this parameter is output for describing the uploaded models.
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_load_model_to_devices_from_file(kp_device_group_t devices, int num_devices, int device_port_ids[], const char *file_path, kp_model_nef_descriptor_t *model_desc);
+
+/**
+ * @brief Keep model descriptors built from NEF in a cache directory, so that loading the same NEF again (in any process) does not parse it.
+ *
+ * A cache entry is named by the NEF CRC and size, and is used only if it is written by the same PLUS version.
+ * Out of date or broken entries are ignored and written again. The setting applies to all loading of NEF in the process.
+ *
+ * @param[in] cache_dir an existing directory, NULL or "" to disable the cache (default).
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_set_model_descriptor_cache_dir(const char *cache_dir);
+
 /**
  * @brief upload encrypted models to multiple device through USB, and return kp_model_nef_descriptor_t *model_desc (must release model_desc by kp_release_model_nef_descriptor)
  *
@@ -199,6 +308,8 @@ int kp_get_model_info(kp_device_group_t devices, int dev_port_id, kp_model_nef_d
 /**
  * @brief To free a kp_model_nef_descriptor_t data buff.
  *
+ * All data of a descriptor is in one memory block, which may be shared with the device group. Release drops one reference in constant time.
+ *
  * @param[in] model_desc a model info descriptor.
  *
  * @return refer to KP_API_RETURN_CODE in kp_struct.h
@@ -232,6 +343,57 @@ int kp_install_driver_for_windows(kp_product_id_t device_pid);
  */
 int kp_store_ddr_manage_attr(kp_device_group_t devices, kp_ddr_manage_attr_t ddr_attr);
 
+/**
+ * @brief Let devices join and leave the device group when they are plugged or unplugged at runtime.
+ *
+ * A removed device is retired from dispatching, and its inferences in flight are sent again to other devices.
+ * An arrived device of the same product is connected, the firmware and models loaded into the group are loaded into it,
+ * and it is added to dispatching (into the slot of a retired device if any). Results of requeued inferences come in as usual.
+ *
+ * Firmware and models are kept by the devices handle for arriving devices when they are loaded after this function,
+ * so it should be called right after kp_connect_devices(). Inferences of kp_customized_inference_send() are not requeued.
+ * Inference data are copied to be kept until their results are received, and io buffers are always host memory.
+ *
+ * @param[in] devices a set of devices handle.
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h, KP_ERROR_HOTPLUG_NOT_SUPPORTED_51 if the platform does not report USB hotplug.
+ */
+int kp_enable_hotplug(kp_device_group_t devices);
+
+/**
+ * @brief Stop tracking plugged and unplugged devices, retired devices stay out of dispatching.
+ *
+ * @param[in] devices a set of devices handle, no inference should be in progress.
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_disable_hotplug(kp_device_group_t devices);
+
+/**
+ * @brief Plug or unplug a simulated device, it is reported to hotplug as a real device.
+ *
+ * An unplugged simulated device loses everything loaded, is not reported by kp_scan_devices(), and cannot be connected.
+ *
+ * @param[in] index index of the simulated device, 0 ~ (num_devices - 1) of kp_enable_simulated_devices().
+ * @param[in] plugged true to plug, false to unplug.
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_set_simulated_device_plugged(int index, bool plugged);
+
+/**
+ * @brief Enable simulated devices in-process for host side benchmarking and testing without hardware.
+ *
+ * Simulated devices are reported by kp_scan_devices() and connected by kp_connect_devices() like real devices.
+ * They accept KDP2 commands for loading model and configuring FIFO queue, and return generic raw inference results
+ * (output nodes are built from the loaded model) after the configured NPU time.
+ *
+ * @param[in] config configuration of simulated devices, refer to kp_sim_device_config_t.
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_enable_simulated_devices(kp_sim_device_config_t *config);
+
 /**
  * @brief Translate error code to char string.
  *
@@ -15,6 +15,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "kp_struct.h"
 
@@ -36,6 +37,10 @@ int kp_inference_configure(kp_device_group_t devices, kp_inf_configuration_t *co
  *
  * In addition, to have better performance, users can issue multiple kp_generic_image_inference_send() then start to receive results through kp_generic_image_inference_receive().
  *
+ * For multiple devices, the inference is sent to the device with the fewest inferences in progress.
+ *
+ * It is thread-safe, multiple threads can send to the same devices handle and all input nodes of one inference are sent to the device without being interleaved.
+ *
  * @param[in] devices a set of devices handle.
  * @param[in] inf_data inference data of needed parameters for performing inference including image buffer size, model id.
  *
@@ -46,6 +51,11 @@ int kp_generic_image_inference_send(kp_device_group_t devices, kp_generic_image_
 /**
  * @brief
  *
+ * For multiple devices, the result of whichever device completes first is returned, 'inference_number' in output_desc tells which inference it is,
+ * and kp_generic_image_inference_receive_with_port_id() also tells which device it comes from.
+ * While several devices have results pending, each is received into a buffer of its own and copied to raw_out_buffer,
+ * kp_inference_poll() of asynchronous inference hands over such buffers without copying.
+ *
  * @param[in] devices a set of devices handle.
  * @param[in] output_desc refer to kp_generic_image_inference_result_header_t for describing some information of received data.
  * @param[out] raw_out_buffer a user-allocated buffer for receiving the RAW data results, the needed buffer size can be known from the 'max_raw_out_size' in 'model_desc' through kp_load_model().
@@ -55,6 +65,52 @@ int kp_generic_image_inference_send(kp_device_group_t devices, kp_generic_image_
  */
 int kp_generic_image_inference_receive(kp_device_group_t devices, kp_generic_image_inference_result_header_t *output_desc, uint8_t *raw_out_buffer, uint32_t buf_size);
 
+/**
+ * @brief The same as kp_generic_image_inference_receive(), and gives the port ID of the device which did the inference.
+ *
+ * @param[in] devices a set of devices handle.
+ * @param[in] output_desc refer to kp_generic_image_inference_receive().
+ * @param[out] raw_out_buffer refer to kp_generic_image_inference_receive().
+ * @param[in] buf_size size of raw_out_buffer.
+ * @param[out] port_id port ID of the device which did the inference.
+ *
+ * @return int refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_generic_image_inference_receive_with_port_id(kp_device_group_t devices, kp_generic_image_inference_result_header_t *output_desc, uint8_t *raw_out_buffer, uint32_t buf_size, uint32_t *port_id);
+
+/**
+ * @brief Generic raw inference send of a batch of frames.
+ *
+ * It is the same as calling kp_generic_image_inference_send() for every frame, with less overhead per frame.
+ * All frames are validated before any is sent. Frames of each device are packed and sent together up to the device FIFO queue input buffer count,
+ * and the devices are served in turn.
+ *
+ * @param[in] devices a set of devices handle.
+ * @param[in] inf_data array of inference data, refer to kp_generic_image_inference_send().
+ * @param[in] num_inf number of frames in inf_data.
+ *
+ * @return int refer to KP_API_RETURN_CODE in kp_struct.h. If sending fails, some frames may have been sent and their results can still be received.
+ */
+int kp_generic_image_inference_send_batch(kp_device_group_t devices, kp_generic_image_inference_desc_t inf_data[], uint32_t num_inf);
+
+/**
+ * @brief Receive results of a batch of frames, refer to kp_generic_image_inference_receive().
+ *
+ * Results are filled in completion order, 'inference_number' in output_desc and port_id tell where each comes from.
+ *
+ * @param[in] devices a set of devices handle.
+ * @param[out] output_desc array of result headers.
+ * @param[out] raw_out_buffer array of user-allocated buffers for receiving the RAW data results.
+ * @param[in] buf_size size of each buffer in raw_out_buffer.
+ * @param[in] num_inf number of results to receive.
+ * @param[out] port_id optional, array of port IDs of the devices which did the inferences.
+ * @param[out] num_received optional, number of results received, which is less than num_inf if failed.
+ *
+ * @return int refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_generic_image_inference_receive_batch(kp_device_group_t devices, kp_generic_image_inference_result_header_t output_desc[], uint8_t *raw_out_buffer[], uint32_t buf_size, uint32_t num_inf,
+                                             uint32_t port_id[], uint32_t *num_received);
+
 /**
  * @brief Generic raw inference with multiple input images and bypass pre-process send.
  *
@@ -64,6 +120,10 @@ int kp_generic_image_inference_receive(kp_device_group_t devices, kp_generic_ima
  *
  * In addition, to have better performance, users can issue multiple kp_generic_data_inference_send() then start to receive results through kp_generic_data_inference_receive().
  *
+ * For multiple devices, the inference is sent to the device with the fewest inferences in progress.
+ *
+ * It is thread-safe, multiple threads can send to the same devices handle and all input nodes of one inference are sent to the device without being interleaved.
+ *
  * @param[in] devices a set of devices handle.
  * @param[in] inf_data inference data of needed parameters for performing inference including image buffer size, model id.
  *
@@ -78,6 +138,11 @@ int kp_generic_data_inference_send(kp_device_group_t devices, kp_generic_data_in
  *
  * Note that the data received is in Kneron RAW format, users need kp_generic_inference_retrieve_float_node() to convert RAW format data to floating-point data.
  *
+ * For multiple devices, the result of whichever device completes first is returned, 'inference_number' in output_desc tells which inference it is,
+ * and kp_generic_data_inference_receive_with_port_id() also tells which device it comes from.
+ * While several devices have results pending, each is received into a buffer of its own and copied to raw_out_buffer,
+ * kp_inference_poll() of asynchronous inference hands over such buffers without copying.
+ *
  * @param[in] devices a set of devices handle.
  * @param[in] output_desc refer to kp_generic_data_inference_result_header_t for describing some information of received data.
  * @param[out] raw_out_buffer a user-allocated buffer for receiving the RAW data results, the needed buffer size can be known from the 'max_raw_out_size' in 'model_desc' through kp_load_model().
@@ -87,6 +152,19 @@ int kp_generic_data_inference_send(kp_device_group_t devices, kp_generic_data_in
  */
 int kp_generic_data_inference_receive(kp_device_group_t devices, kp_generic_data_inference_result_header_t *output_desc, uint8_t *raw_out_buffer, uint32_t buf_size);
 
+/**
+ * @brief The same as kp_generic_data_inference_receive(), and gives the port ID of the device which did the inference.
+ *
+ * @param[in] devices a set of devices handle.
+ * @param[in] output_desc refer to kp_generic_data_inference_receive().
+ * @param[out] raw_out_buffer refer to kp_generic_data_inference_receive().
+ * @param[in] buf_size size of raw_out_buffer.
+ * @param[out] port_id port ID of the device which did the inference.
+ *
+ * @return int refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_generic_data_inference_receive_with_port_id(kp_device_group_t devices, kp_generic_data_inference_result_header_t *output_desc, uint8_t *raw_out_buffer, uint32_t buf_size, uint32_t *port_id);
+
 /**
  * @brief Retrieve single node output data from raw output buffer.
  *
@@ -101,6 +179,19 @@ int kp_generic_data_inference_receive(kp_device_group_t devices, kp_generic_data
  */
 kp_inf_raw_fixed_node_output_t *kp_generic_inference_retrieve_raw_fixed_node(uint32_t node_idx, uint8_t *raw_out_buffer);
 
+/**
+ * @brief Retrieve single node output data from raw output buffer into a user-provided structure.
+ *
+ * Same as kp_generic_inference_retrieve_raw_fixed_node() without allocating memory, 'data' of node_output points to raw_out_buffer.
+ *
+ * @param[in] node_idx wanted output node index, starts from 0.
+ * @param[in] raw_out_buffer the RAW output buffer, it should come from kp_generic_raw_inference_receive().
+ * @param[out] node_output user-allocated structure to be filled.
+ *
+ * @return int refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_generic_inference_retrieve_raw_fixed_node_to_buffer(uint32_t node_idx, uint8_t *raw_out_buffer, kp_inf_raw_fixed_node_output_t *node_output);
+
 /**
  * @brief Retrieve single node output data from raw output buffer.
  *
@@ -114,6 +205,21 @@ kp_inf_raw_fixed_node_output_t *kp_generic_inference_retrieve_raw_fixed_node(uin
  */
 kp_inf_fixed_node_output_t *kp_generic_inference_retrieve_fixed_node(uint32_t node_idx, uint8_t *raw_out_buffer, kp_channel_ordering_t ordering);
 
+/**
+ * @brief Retrieve single node output data from raw output buffer into a user-provided buffer.
+ *
+ * Same as kp_generic_inference_retrieve_fixed_node() without allocating memory, so the buffer can be reused for every inference.
+ *
+ * @param[in] node_idx wanted output node index, starts from 0.
+ * @param[in] raw_out_buffer the RAW output buffer, it should come from kp_generic_raw_inference_receive().
+ * @param[in] ordering the RAW output channel ordering
+ * @param[out] node_output user-allocated buffer to receive the node.
+ * @param[in] buf_size size of node_output in bytes, KP_ERROR_BUFFER_TOO_SMALL_53 is returned if the node does not fit.
+ *
+ * @return int refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_generic_inference_retrieve_fixed_node_to_buffer(uint32_t node_idx, uint8_t *raw_out_buffer, kp_channel_ordering_t ordering, kp_inf_fixed_node_output_t *node_output, uint32_t buf_size);
+
 /**
  * @brief Retrieve single node output data from raw output buffer.
  *
@@ -127,9 +233,155 @@ kp_inf_fixed_node_output_t *kp_generic_inference_retrieve_fixed_node(uint32_t no
  */
 kp_inf_float_node_output_t *kp_generic_inference_retrieve_float_node(uint32_t node_idx, uint8_t *raw_out_buffer, kp_channel_ordering_t ordering);
 
+/**
+ * @brief Retrieve single node output data from raw output buffer into a user-provided buffer.
+ *
+ * Same as kp_generic_inference_retrieve_float_node() without allocating memory, so the buffer can be reused for every inference.
+ *
+ * A buffer of the size given by kp_generic_inference_get_all_float_nodes_size() fits any single node of the model.
+ *
+ * @param[in] node_idx wanted output node index, starts from 0.
+ * @param[in] raw_out_buffer the RAW output buffer, it should come from kp_generic_raw_inference_receive().
+ * @param[in] ordering the RAW output channel ordering
+ * @param[out] node_output user-allocated buffer to receive the node.
+ * @param[in] buf_size size of node_output in bytes, KP_ERROR_BUFFER_TOO_SMALL_53 is returned if the node does not fit.
+ *
+ * @return int refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_generic_inference_retrieve_float_node_to_buffer(uint32_t node_idx, uint8_t *raw_out_buffer, kp_channel_ordering_t ordering, kp_inf_float_node_output_t *node_output, uint32_t buf_size);
+
+/**
+ * @brief Retrieve single node output data from raw output buffer into a user-provided buffer, with per-channel quantization.
+ *
+ * Same as kp_generic_inference_retrieve_float_node_to_buffer(), but the scale/radix of every channel is taken from the model descriptor,
+ * for models quantized per channel. The floating-point factors are computed when the model is loaded,
+ * or on every call if model_desc was not given by the library.
+ *
+ * Nodes with a single fixed-point quantization information are converted with the per-tensor scale/radix as usual.
+ *
+ * @param[in] model_desc descriptor of the model which made the output, e.g. from kp_model_nef_descriptor_t of the loaded models.
+ * @param[in] node_idx wanted output node index, starts from 0.
+ * @param[in] raw_out_buffer the RAW output buffer, it should come from kp_generic_raw_inference_receive().
+ * @param[in] ordering the RAW output channel ordering
+ * @param[out] node_output user-allocated buffer to receive the node.
+ * @param[in] buf_size size of node_output in bytes, KP_ERROR_BUFFER_TOO_SMALL_53 is returned if the node does not fit.
+ *
+ * @return int refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_generic_inference_retrieve_float_node_per_channel_to_buffer(kp_single_model_descriptor_t *model_desc, uint32_t node_idx, uint8_t *raw_out_buffer, kp_channel_ordering_t ordering,
+                                                                   kp_inf_float_node_output_t *node_output, uint32_t buf_size);
+
+/**
+ * @brief Get the buffer size needed by kp_generic_inference_retrieve_all_float_nodes() for a model.
+ *
+ * @param[in] model_desc the model, one of 'models' in the kp_model_nef_descriptor_t from kp_load_model().
+ * @param[out] buf_size size in bytes to hold all output nodes in floating-point.
+ *
+ * @return int refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_generic_inference_get_all_float_nodes_size(kp_single_model_descriptor_t *model_desc, uint32_t *buf_size);
+
+/**
+ * @brief Retrieve all node output data from raw output buffer into one user-provided buffer.
+ *
+ * The nodes are converted to floating-point and placed back to back in buf, no memory is allocated and nothing needs to be freed per node.
+ *
+ * The buffer can be allocated once with the size from kp_generic_inference_get_all_float_nodes_size() and reused for every inference.
+ *
+ * @param[in] raw_out_buffer the RAW output buffer, it should come from kp_generic_raw_inference_receive().
+ * @param[in] ordering the RAW output channel ordering
+ * @param[out] buf user-allocated buffer to receive all the nodes.
+ * @param[in] buf_size size of buf in bytes.
+ * @param[out] node_outputs pointers to each node in buf, in node index order.
+ * @param[in,out] num_nodes in: number of entries of node_outputs, out: number of output nodes.
+ *
+ * @return int refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_generic_inference_retrieve_all_float_nodes(uint8_t *raw_out_buffer, kp_channel_ordering_t ordering, void *buf, uint32_t buf_size,
+                                                  kp_inf_float_node_output_t *node_outputs[], uint32_t *num_nodes);
+
+/**
+ * @brief Get a zero-copy view of single node output data in raw output buffer.
+ *
+ * Nothing is converted or copied, elements are read and converted to floating-point on demand through the view.
+ *
+ * This suits post-processing which only looks at part of the output, such as class scores of the boxes which pass the objectness threshold.
+ *
+ * The view points to raw_out_buffer so do not free or reuse raw_out_buffer before completing the use of the view.
+ *
+ * @param[in] node_idx wanted output node index, starts from 0.
+ * @param[in] raw_out_buffer the RAW output buffer, it should come from kp_generic_raw_inference_receive().
+ * @param[out] view user-allocated view to be filled.
+ *
+ * @return int refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_generic_inference_retrieve_tensor_view(uint32_t node_idx, uint8_t *raw_out_buffer, kp_inf_tensor_view_t *view);
+
+/**
+ * @brief Offset in elements of element (c, h, w) from the 'data' of a tensor view.
+ */
+static inline size_t kp_tensor_view_offset(const kp_inf_tensor_view_t *view, uint32_t c, uint32_t h, uint32_t w)
+{
+    uint32_t channel_block_mask = (1U << view->channel_block_shift) - 1;
+
+    return (size_t)(c >> view->channel_block_shift) * view->channel_block_stride + (size_t)(c & channel_block_mask) * view->channel_stride +
+           (size_t)h * view->height_stride + (size_t)w * view->width_stride;
+}
+
+/**
+ * @brief Fixed-point value of element (c, h, w) of a tensor view, no range check is done.
+ */
+static inline int32_t kp_tensor_view_get_fixed(const kp_inf_tensor_view_t *view, uint32_t c, uint32_t h, uint32_t w)
+{
+    size_t offset = kp_tensor_view_offset(view, c, h, w);
+
+    if (KP_FIXED_POINT_DTYPE_INT16 == view->fixed_point_dtype)
+        return ((const int16_t *)view->data)[offset];
+    else
+        return ((const int8_t *)view->data)[offset];
+}
+
+/**
+ * @brief Floating-point value of element (c, h, w) of a tensor view, no range check is done.
+ */
+static inline float kp_tensor_view_get_float(const kp_inf_tensor_view_t *view, uint32_t c, uint32_t h, uint32_t w)
+{
+    return (float)kp_tensor_view_get_fixed(view, c, h, w) * view->float_scale;
+}
+
+/**
+ * @brief Read part of a row of a tensor view in floating-point.
+ *
+ * @param[in] view the tensor view from kp_generic_inference_retrieve_tensor_view().
+ * @param[in] c channel of the row.
+ * @param[in] h height of the row.
+ * @param[in] w_begin first column to read.
+ * @param[in] num number of columns to read.
+ * @param[out] values user-allocated array of at least num values.
+ *
+ * @return int refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_tensor_view_read_row(const kp_inf_tensor_view_t *view, uint32_t c, uint32_t h, uint32_t w_begin, uint32_t num, float *values);
+
+/**
+ * @brief Read channels of one position of a tensor view in floating-point.
+ *
+ * @param[in] view the tensor view from kp_generic_inference_retrieve_tensor_view().
+ * @param[in] h height of the position.
+ * @param[in] w width of the position.
+ * @param[in] c_begin first channel to read.
+ * @param[in] num number of channels to read.
+ * @param[out] values user-allocated array of at least num values.
+ *
+ * @return int refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_tensor_view_read_channels(const kp_inf_tensor_view_t *view, uint32_t h, uint32_t w, uint32_t c_begin, uint32_t num, float *values);
+
 /**
  * @brief send image for age gender inference
  *
+ * It is thread-safe, header and image are sent to the device without being interleaved with other inferences.
+ *
  * @param[in] devices a set of devices handle.
  * @param[in] header user-defined image header, shoud include 'kp_inference_header_stamp_t' in the beginning; in the header stamp, only 'job_id' is needed for user to fill in, others will be handled by API.
  * @param[in] header_size image header size.
@@ -152,9 +404,67 @@ int kp_customized_inference_send(kp_device_group_t devices, void *header, int he
  */
 int kp_customized_inference_receive(kp_device_group_t devices, void *result_buffer, int buf_size, int *recv_size);
 
+/**
+ * @brief Start asynchronous inference, results of all devices are received by per-device receiver threads.
+ *
+ * Each device of the group has its own receiver thread, so a slow device does not delay results of the others.
+ * Results are delivered through the callback if it is given, otherwise they are queued for kp_inference_poll().
+ *
+ * While asynchronous inference is started, inferences are sent as usual (e.g. by kp_generic_image_inference_send()),
+ * and kp_generic_image_inference_receive(), kp_generic_data_inference_receive() and kp_customized_inference_receive() return KP_ERROR_ASYNC_INFERENCE_ENABLED_48.
+ * It should be started before sending inferences, results already received by those functions are dropped.
+ *
+ * @param[in] devices a set of devices handle.
+ * @param[in] buf_size size of the RAW output buffer of each result, the needed buffer size can be known from the 'max_raw_out_size' in 'model_desc' through kp_load_model().
+ * @param[in] callback called in the receiver thread for every result, NULL to poll results by kp_inference_poll().
+ * @param[in] user_data user data passed to the callback.
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_inference_start_async(kp_device_group_t devices, uint32_t buf_size, kp_inference_callback_t callback, void *user_data);
+
+/**
+ * @brief Stop asynchronous inference, receiver threads are joined and all results (including the ones not released) are freed.
+ *
+ * It must not be called concurrently with kp_inference_poll(), and it is done by kp_disconnect_devices() as well.
+ * It cannot be called from the callback, which runs in a receiver thread to be joined, KP_ERROR_NOT_ALLOWED_IN_CALLBACK_54 is returned then.
+ * To stop from the callback, let another thread call it (e.g. the one which started asynchronous inference).
+ *
+ * @param[in] devices a set of devices handle.
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_inference_stop_async(kp_device_group_t devices);
+
+/**
+ * @brief Get the next result of asynchronous inference in completion order, when it is started without callback.
+ *
+ * A result with error status means the device of its 'port_id' failed, and no more results come from that device.
+ *
+ * @param[in] devices a set of devices handle.
+ * @param[in] timeout timeout in milliseconds, 0 to return immediately, negative to wait forever.
+ * @param[out] result the result, which must be given back by kp_inference_release_result() after use.
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h, KP_ERROR_POLL_TIMEOUT_50 if no result in the timeout.
+ */
+int kp_inference_poll(kp_device_group_t devices, int timeout, kp_inference_result_t **result);
+
+/**
+ * @brief Give back a result from kp_inference_poll(), so it and its RAW output buffer can be reused.
+ *
+ * @param[in] devices a set of devices handle.
+ * @param[in] result the result from kp_inference_poll().
+ *
+ * @return refer to KP_API_RETURN_CODE in kp_struct.h
+ */
+int kp_inference_release_result(kp_device_group_t devices, kp_inference_result_t *result);
+
 /**
  * @brief send a user-defined command and receive the command result, users also need to implement code in firmware side as well.
  *
+ * The command goes to a device without inference in progress, KP_ERROR_USB_BUSY_N6 is returned if there is none.
+ * It is not allowed while asynchronous inference is started, KP_ERROR_ASYNC_INFERENCE_ENABLED_48 is returned.
+ *
  * @param[in] devices a set of devices handle.
  * @param[in] cmd user-defined command buffer, shoud include 'kp_inference_header_stamp_t' in the beginning; using 'job_id' as user-defined command ID, others will be handled by API.
  * @param[in] cmd_size command buffer size.
@@ -180,6 +490,9 @@ int kp_dbg_set_enable_checkpoints(kp_device_group_t devices, uint32_t checkpoint
 /**
  * @brief To receive debug checkpoint data, use it only if you enable kp_dbg_set_enable_checkpoints().
  *
+ * The data is received from a device with inference in progress, KP_ERROR_USB_BUSY_N6 is returned if there is none.
+ * It is not allowed while asynchronous inference is started, KP_ERROR_ASYNC_INFERENCE_ENABLED_48 is returned.
+ *
  * @param[in] devices a set of devices handle.
  * @param[out] checkpoint_buf a buffer contains checkpoint data, memory is allocated automatically while needed.
  *
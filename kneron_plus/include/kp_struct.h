@@ -105,6 +105,13 @@ enum KP_API_RETURN_CODE
     KP_ERROR_IMAGE_INVALID_HEIGHT_45 = 45,
     KP_ERROR_ADJUST_DDR_HEAP_FAILED_46 = 46,
     KP_ERROR_DEVICE_NOT_ACCESSIBLE_47 = 47,
+    KP_ERROR_ASYNC_INFERENCE_ENABLED_48 = 48,
+    KP_ERROR_ASYNC_INFERENCE_NOT_ENABLED_49 = 49,
+    KP_ERROR_POLL_TIMEOUT_50 = 50,
+    KP_ERROR_HOTPLUG_NOT_SUPPORTED_51 = 51,
+    KP_ERROR_FLASH_VERIFY_FAILED_52 = 52,
+    KP_ERROR_BUFFER_TOO_SMALL_53 = 53,
+    KP_ERROR_NOT_ALLOWED_IN_CALLBACK_54 = 54,
 
     KP_ERROR_OTHER_99 = 99,
 
@@ -133,6 +140,8 @@ enum KP_API_RETURN_CODE
     KP_FW_ERROR_POSIX_SPAWN_FAILED_121 = 121,
     KP_FW_ERROR_USB_SEND_FAILED_122 = 122,
     KP_FW_ERROR_USB_RECEIVE_FAILED_123 = 123,
+    KP_FW_ERROR_FLASH_WRITE_FAILED_124 = 124,
+    KP_FW_ERROR_FLASH_READ_FAILED_125 = 125,
 
     /* ncpu error code (sync with ipc.h) */
     KP_FW_NCPU_ERR_BEGIN         = 200,
@@ -560,6 +569,26 @@ typedef struct
     uint32_t product_id;                    /**< product id, refer to kp_product_id_t */
 } __attribute__((packed, aligned(4))) kp_generic_data_inference_result_header_t;
 
+/**
+ * @brief inference result received by asynchronous inference, refer to kp_inference_start_async()
+ */
+typedef struct
+{
+    int status;                                             /**< KP_SUCCESS, or error code of the receiving, refer to KP_API_RETURN_CODE */
+    uint32_t job_id;                                        /**< job ID of the result, KDP2_INF_ID_GENERIC_RAW, KDP2_INF_ID_GENERIC_RAW_BYPASS_PRE_PROC or customized */
+    uint32_t port_id;                                       /**< port ID of the device which did the inference, always valid */
+    kp_generic_image_inference_result_header_t header;      /**< result header, num_pre_proc_info is 0 for bypass pre-process inference */
+    uint8_t *raw_out_buffer;                                /**< RAW output data, owned by the devices handle */
+    uint32_t raw_out_size;                                  /**< size of the RAW output data in bytes */
+} kp_inference_result_t;
+
+/**
+ * @brief callback of asynchronous inference, called in the receiver thread of the device which did the inference
+ *
+ * The result, including raw_out_buffer, is reused by the library when the callback returns.
+ */
+typedef void (*kp_inference_callback_t)(kp_inference_result_t *result, void *user_data);
+
 /**
  * @brief Metadata of RAW node output in fixed-point format
  */
@@ -621,6 +650,33 @@ typedef struct
     float data[];                           /**< array of floating-point values */
 } __attribute__((aligned(4))) kp_inf_float_node_output_t;
 
+/**
+ * @brief zero-copy view of a RAW node output, elements are read from raw_out_buffer and converted on demand
+ *
+ * Element (c, h, w) of a node is at data offset:
+ *   (c >> channel_block_shift) * channel_block_stride + (c & ((1 << channel_block_shift) - 1)) * channel_stride + h * height_stride + w * width_stride
+ *
+ * Strides are in elements and cover the width padding (KDP_COL_MIN_16 for 8-bit, KDP_COL_MIN_8 for 16-bit) and the 16-channel blocks of 1W16C8B.
+ */
+typedef struct
+{
+    uint32_t width;                         /**< node width */
+    uint32_t height;                        /**< node height */
+    uint32_t channel;                       /**< node channel */
+    int32_t radix;                          /**< radix for fixed/floating point conversion */
+    float scale;                            /**< scale for fixed/floating point conversion */
+    float float_scale;                      /**< a fixed-point value multiplied by it is the floating-point value */
+    uint32_t data_layout;                   /**< npu memory layout (ref. kp_model_tensor_data_layout_t) */
+    uint32_t fixed_point_dtype;             /**< enum kp_fixed_point_dtype_t */
+    uint32_t width_aligned;                 /**< width with padding, equals width for 1W16C8B */
+    uint32_t channel_block_shift;           /**< log2 of the number of channels interleaved in a block, 4 for 1W16C8B and 0 otherwise */
+    uint32_t channel_block_stride;          /**< elements between two channel blocks */
+    uint32_t channel_stride;                /**< elements between two channels of a block */
+    uint32_t height_stride;                 /**< elements between two rows */
+    uint32_t width_stride;                  /**< elements between two columns */
+    void *data;                             /**< first element of the node in raw_out_buffer, int8_t or int16_t (depended on fixed_point_dtype) */
+} kp_inf_tensor_view_t;
+
 /**
  * @brief describe a bounding box
  */
@@ -866,3 +922,16 @@ typedef struct
     uint32_t fifoq_result_buf_count;    /**< Input buffer count for FIFO queue, 0 if FIFO queue has not been set */
     uint32_t fifoq_result_buf_size;     /**< Input buffer size for FIFO queue, 0 if FIFO queue has not been set */
 } __attribute__((aligned(4))) kp_fifo_queue_config_t;
+
+/**
+ * @brief Describe simulated devices, which speak KDP2 protocol without real hardware
+ */
+typedef struct
+{
+    uint32_t num_devices;               /**< Number of simulated devices reported by kp_scan_devices(), 0 to disable */
+    uint32_t product_id;                /**< Simulated product ID, only KP_DEVICE_KL720 is supported */
+    uint32_t usb_latency_us;            /**< Latency of every bulk/control transfer in microseconds */
+    uint32_t usb_bandwidth_mbps;        /**< Bulk transfer bandwidth in megabytes per second, 0 for unlimited */
+    uint32_t npu_time_us;               /**< NPU processing time of one inference in microseconds */
+    uint32_t npu_time_step_us;          /**< Extra NPU time of each device over the previous one, to simulate unevenly throttled devices */
+} __attribute__((aligned(4))) kp_sim_device_config_t;
@@ -0,0 +1,536 @@
+/**
+ * @file        dequantize.c
+ * @brief       conversion of int8/int16 NPU output to float, with the reordering of output channels
+ * @version     0.1
+ * @date        2026-10-18
+ *
+ * @copyright   Copyright (c) 2021 Kneron Inc. All rights reserved.
+ */
+
+/**
+ * [Description]
+ *  Values are multiplied by the reciprocal of the fixed-point factor. Reordering between NPU layouts and channel orderings
+ *  is made of two operations: converting a contiguous row, and converting a matrix into its transpose.
+ *  Per-channel quantized outputs give every row or column of the transpose (or every value of a row) its own factor.
+ *
+ *  x86: AVX2 or SSE4.1 rows and SSE4.1 4x4 tiles, chosen at runtime by CPUID
+ *  ARM: NEON (4x4 tiles) when the compiler targets it, always on aarch64
+ *  others: scalar
+ */
+
+#include "internal_func.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DEQUANTIZE_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define DEQUANTIZE_NEON
+#include <arm_neon.h>
+#endif
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+/* how the scale array is indexed */
+#define SCALE_UNIFORM   0   /* scale[0] for every value */
+#define SCALE_PER_ROW   1   /* scale[r] for the source rows of a transpose */
+#define SCALE_PER_COL   2   /* scale[c] for the source columns of a transpose, scale[i] for a row */
+
+static ALWAYS_INLINE float _load_one(const void *src, size_t idx, bool is_int16)
+{
+    return is_int16 ? (float)((const int16_t *)src)[idx] : (float)((const int8_t *)src)[idx];
+}
+
+static ALWAYS_INLINE float _scale_of(const float *scale, int mode, size_t r, size_t c)
+{
+    return (SCALE_PER_ROW == mode) ? scale[r] : (SCALE_PER_COL == mode) ? scale[c] : scale[0];
+}
+
+static void _row_scalar(float *dst, const void *src, bool is_int16, uint32_t num, const float *scale, int mode)
+{
+    for (uint32_t i = 0; i < num; i++)
+        dst[i] = _load_one(src, i, is_int16) * _scale_of(scale, mode, 0, i);
+}
+
+static void _transpose_scalar(float *dst, uint32_t dst_stride, const void *src, bool is_int16, uint32_t src_stride,
+                              uint32_t row_begin, uint32_t rows, uint32_t col_begin, uint32_t cols, const float *scale, int mode)
+{
+    for (uint32_t r = row_begin; r < rows; r++) {
+        for (uint32_t c = col_begin; c < cols; c++)
+            dst[(size_t)c * dst_stride + r] = _load_one(src, (size_t)r * src_stride + c, is_int16) * _scale_of(scale, mode, r, c);
+    }
+}
+
+// rows and columns left over by the tiles, right edge first and then the bottom edge
+static void _transpose_edges(float *dst, uint32_t dst_stride, const void *src, bool is_int16, uint32_t src_stride,
+                             uint32_t rows, uint32_t cols, uint32_t tiled_rows, uint32_t tiled_cols, const float *scale, int mode)
+{
+    _transpose_scalar(dst, dst_stride, src, is_int16, src_stride, 0, tiled_rows, tiled_cols, cols, scale, mode);
+    _transpose_scalar(dst, dst_stride, src, is_int16, src_stride, tiled_rows, rows, 0, cols, scale, mode);
+}
+
+#ifdef DEQUANTIZE_X86
+
+/******************************************************************
+ * SSE4.1
+ ******************************************************************/
+
+__attribute__((target("sse4.1")))
+static ALWAYS_INLINE __m128 _sse_load4(const void *src, size_t idx, bool is_int16)
+{
+    __m128i v;
+
+    if (is_int16) {
+        v = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *)((const int16_t *)src + idx)));
+    } else {
+        int32_t bytes;
+        memcpy(&bytes, (const int8_t *)src + idx, sizeof(bytes));
+        v = _mm_cvtepi8_epi32(_mm_cvtsi32_si128(bytes));
+    }
+
+    return _mm_cvtepi32_ps(v);
+}
+
+// scale of row values i..i+3, vscale holds the broadcast uniform scale
+__attribute__((target("sse4.1")))
+static ALWAYS_INLINE __m128 _sse_row_scale(const float *scale, int mode, __m128 vscale, uint32_t i)
+{
+    return (SCALE_PER_COL == mode) ? _mm_loadu_ps(scale + i) : vscale;
+}
+
+// scale of source column c, the per-row scales are loaded by the tiles
+__attribute__((target("sse4.1")))
+static ALWAYS_INLINE __m128 _sse_col_scale(const float *scale, int mode, __m128 vscale, uint32_t c)
+{
+    return (SCALE_PER_COL == mode) ? _mm_set1_ps(scale[c]) : vscale;
+}
+
+__attribute__((target("sse4.1")))
+static ALWAYS_INLINE void _sse_row(float *dst, const void *src, bool is_int16, uint32_t num, const float *scale, int mode)
+{
+    __m128 vscale = _mm_set1_ps(scale[0]);
+    uint32_t i = 0;
+
+    for (; i + 16 <= num; i += 16) {
+        __m128 s0 = _sse_row_scale(scale, mode, vscale, i);
+        __m128 s1 = _sse_row_scale(scale, mode, vscale, i + 4);
+        __m128 s2 = _sse_row_scale(scale, mode, vscale, i + 8);
+        __m128 s3 = _sse_row_scale(scale, mode, vscale, i + 12);
+
+        if (is_int16) {
+            __m128i lo = _mm_loadu_si128((const __m128i *)((const int16_t *)src + i));
+            __m128i hi = _mm_loadu_si128((const __m128i *)((const int16_t *)src + i + 8));
+
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(lo)), s0));
+            _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(lo, 8))), s1));
+            _mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(hi)), s2));
+            _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(hi, 8))), s3));
+        } else {
+            __m128i v = _mm_loadu_si128((const __m128i *)((const int8_t *)src + i));
+
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi8_epi32(v)), s0));
+            _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_srli_si128(v, 4))), s1));
+            _mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_srli_si128(v, 8))), s2));
+            _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_srli_si128(v, 12))), s3));
+        }
+    }
+
+    for (; i + 4 <= num; i += 4)
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_sse_load4(src, i, is_int16), _sse_row_scale(scale, mode, vscale, i)));
+
+    for (; i < num; i++)
+        dst[i] = _load_one(src, i, is_int16) * _scale_of(scale, mode, 0, i);
+}
+
+__attribute__((target("sse4.1")))
+static ALWAYS_INLINE void _sse_transpose(float *dst, uint32_t dst_stride, const void *src, bool is_int16, uint32_t src_stride,
+                                         uint32_t rows, uint32_t cols, const float *scale, int mode)
+{
+    __m128 vscale = _mm_set1_ps(scale[0]);
+    uint32_t tiled_rows = rows & ~3U;
+    uint32_t tiled_cols = cols & ~3U;
+
+    // column blocks outermost, so that consecutive tiles are stored next to each other
+    for (uint32_t c = 0; c < tiled_cols; c += 4) {
+        __m128 c0 = _sse_col_scale(scale, mode, vscale, c);
+        __m128 c1 = _sse_col_scale(scale, mode, vscale, c + 1);
+        __m128 c2 = _sse_col_scale(scale, mode, vscale, c + 2);
+        __m128 c3 = _sse_col_scale(scale, mode, vscale, c + 3);
+
+        for (uint32_t r = 0; r < tiled_rows; r += 4) {
+            size_t idx = (size_t)r * src_stride + c;
+            __m128 r0 = _sse_load4(src, idx, is_int16);
+            __m128 r1 = _sse_load4(src, idx + src_stride, is_int16);
+            __m128 r2 = _sse_load4(src, idx + 2 * (size_t)src_stride, is_int16);
+            __m128 r3 = _sse_load4(src, idx + 3 * (size_t)src_stride, is_int16);
+            __m128 rs = (SCALE_PER_ROW == mode) ? _mm_loadu_ps(scale + r) : vscale;
+            __m128 s0 = (SCALE_PER_ROW == mode) ? rs : c0;
+            __m128 s1 = (SCALE_PER_ROW == mode) ? rs : c1;
+            __m128 s2 = (SCALE_PER_ROW == mode) ? rs : c2;
+            __m128 s3 = (SCALE_PER_ROW == mode) ? rs : c3;
+
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+            float *out = dst + (size_t)c * dst_stride + r;
+            _mm_storeu_ps(out, _mm_mul_ps(r0, s0));
+            _mm_storeu_ps(out + dst_stride, _mm_mul_ps(r1, s1));
+            _mm_storeu_ps(out + 2 * (size_t)dst_stride, _mm_mul_ps(r2, s2));
+            _mm_storeu_ps(out + 3 * (size_t)dst_stride, _mm_mul_ps(r3, s3));
+        }
+    }
+
+    _transpose_edges(dst, dst_stride, src, is_int16, src_stride, rows, cols, tiled_rows, tiled_cols, scale, mode);
+}
+
+// the kernels are specialized on a constant data type and scale mode
+__attribute__((target("sse4.1")))
+static void _sse_row_any(float *dst, const void *src, bool is_int16, uint32_t num, const float *scale, int mode)
+{
+    if (SCALE_PER_COL == mode) {
+        if (is_int16)
+            _sse_row(dst, src, true, num, scale, SCALE_PER_COL);
+        else
+            _sse_row(dst, src, false, num, scale, SCALE_PER_COL);
+    } else {
+        if (is_int16)
+            _sse_row(dst, src, true, num, scale, SCALE_UNIFORM);
+        else
+            _sse_row(dst, src, false, num, scale, SCALE_UNIFORM);
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void _sse_transpose_any(float *dst, uint32_t dst_stride, const void *src, bool is_int16, uint32_t src_stride,
+                               uint32_t rows, uint32_t cols, const float *scale, int mode)
+{
+    if (SCALE_PER_ROW == mode) {
+        if (is_int16)
+            _sse_transpose(dst, dst_stride, src, true, src_stride, rows, cols, scale, SCALE_PER_ROW);
+        else
+            _sse_transpose(dst, dst_stride, src, false, src_stride, rows, cols, scale, SCALE_PER_ROW);
+    } else if (SCALE_PER_COL == mode) {
+        if (is_int16)
+            _sse_transpose(dst, dst_stride, src, true, src_stride, rows, cols, scale, SCALE_PER_COL);
+        else
+            _sse_transpose(dst, dst_stride, src, false, src_stride, rows, cols, scale, SCALE_PER_COL);
+    } else {
+        if (is_int16)
+            _sse_transpose(dst, dst_stride, src, true, src_stride, rows, cols, scale, SCALE_UNIFORM);
+        else
+            _sse_transpose(dst, dst_stride, src, false, src_stride, rows, cols, scale, SCALE_UNIFORM);
+    }
+}
+
+/******************************************************************
+ * AVX2
+ ******************************************************************/
+
+__attribute__((target("avx2")))
+static ALWAYS_INLINE __m256 _avx_load8(const void *src, size_t idx, bool is_int16)
+{
+    __m256i v;
+
+    if (is_int16)
+        v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)((const int16_t *)src + idx)));
+    else
+        v = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)((const int8_t *)src + idx)));
+
+    return _mm256_cvtepi32_ps(v);
+}
+
+__attribute__((target("avx2")))
+static ALWAYS_INLINE __m256 _avx_row_scale(const float *scale, int mode, __m256 vscale, uint32_t i)
+{
+    return (SCALE_PER_COL == mode) ? _mm256_loadu_ps(scale + i) : vscale;
+}
+
+__attribute__((target("avx2")))
+static ALWAYS_INLINE void _avx_row(float *dst, const void *src, bool is_int16, uint32_t num, const float *scale, int mode)
+{
+    __m256 vscale = _mm256_set1_ps(scale[0]);
+    uint32_t i = 0;
+
+    for (; i + 16 <= num; i += 16) {
+        __m256 s0 = _avx_row_scale(scale, mode, vscale, i);
+        __m256 s1 = _avx_row_scale(scale, mode, vscale, i + 8);
+
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_avx_load8(src, i, is_int16), s0));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_avx_load8(src, i + 8, is_int16), s1));
+    }
+
+    for (; i + 8 <= num; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_avx_load8(src, i, is_int16), _avx_row_scale(scale, mode, vscale, i)));
+
+    for (; i < num; i++)
+        dst[i] = _load_one(src, i, is_int16) * _scale_of(scale, mode, 0, i);
+}
+
+__attribute__((target("avx2")))
+static void _avx_row_any(float *dst, const void *src, bool is_int16, uint32_t num, const float *scale, int mode)
+{
+    if (SCALE_PER_COL == mode) {
+        if (is_int16)
+            _avx_row(dst, src, true, num, scale, SCALE_PER_COL);
+        else
+            _avx_row(dst, src, false, num, scale, SCALE_PER_COL);
+    } else {
+        if (is_int16)
+            _avx_row(dst, src, true, num, scale, SCALE_UNIFORM);
+        else
+            _avx_row(dst, src, false, num, scale, SCALE_UNIFORM);
+    }
+}
+
+#define SIMD_NONE 0
+#define SIMD_SSE41 1
+#define SIMD_AVX2 2
+
+static int _cpu_simd_level()
+{
+    static int simd_level = -1;
+
+    if (0 > simd_level) {
+        unsigned int eax, ebx, ecx, edx;
+        int level = SIMD_NONE;
+
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_1)) {
+            level = SIMD_SSE41;
+
+            // AVX2 also needs the OS to save the YMM registers
+            if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+                uint32_t xcr0_lo, xcr0_hi;
+
+                __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+
+                if ((0x6 == (xcr0_lo & 0x6)) && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_AVX2))
+                    level = SIMD_AVX2;
+            }
+        }
+
+        // racing callers get the same answer
+        simd_level = level;
+    }
+
+    return simd_level;
+}
+
+#endif
+
+#ifdef DEQUANTIZE_NEON
+
+/******************************************************************
+ * NEON
+ ******************************************************************/
+
+static ALWAYS_INLINE float32x4_t _neon_load4(const void *src, size_t idx, bool is_int16)
+{
+    int32x4_t v;
+
+    if (is_int16) {
+        v = vmovl_s16(vld1_s16((const int16_t *)src + idx));
+    } else {
+        int32_t bytes;
+        memcpy(&bytes, (const int8_t *)src + idx, sizeof(bytes));
+        v = vmovl_s16(vget_low_s16(vmovl_s8(vreinterpret_s8_s32(vdup_n_s32(bytes)))));
+    }
+
+    return vcvtq_f32_s32(v);
+}
+
+static ALWAYS_INLINE float32x4_t _neon_row_scale(const float *scale, int mode, float32x4_t vscale, uint32_t i)
+{
+    return (SCALE_PER_COL == mode) ? vld1q_f32(scale + i) : vscale;
+}
+
+static ALWAYS_INLINE float32x4_t _neon_col_scale(const float *scale, int mode, float32x4_t vscale, uint32_t c)
+{
+    return (SCALE_PER_COL == mode) ? vdupq_n_f32(scale[c]) : vscale;
+}
+
+static ALWAYS_INLINE void _neon_row(float *dst, const void *src, bool is_int16, uint32_t num, const float *scale, int mode)
+{
+    float32x4_t vscale = vdupq_n_f32(scale[0]);
+    uint32_t i = 0;
+
+    for (; i + 16 <= num; i += 16) {
+        float32x4_t s0 = _neon_row_scale(scale, mode, vscale, i);
+        float32x4_t s1 = _neon_row_scale(scale, mode, vscale, i + 4);
+        float32x4_t s2 = _neon_row_scale(scale, mode, vscale, i + 8);
+        float32x4_t s3 = _neon_row_scale(scale, mode, vscale, i + 12);
+        int16x8_t lo, hi;
+
+        if (is_int16) {
+            lo = vld1q_s16((const int16_t *)src + i);
+            hi = vld1q_s16((const int16_t *)src + i + 8);
+        } else {
+            int8x16_t v = vld1q_s8((const int8_t *)src + i);
+            lo = vmovl_s8(vget_low_s8(v));
+            hi = vmovl_s8(vget_high_s8(v));
+        }
+
+        vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(lo))), s0));
+        vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(lo))), s1));
+        vst1q_f32(dst + i + 8, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(hi))), s2));
+        vst1q_f32(dst + i + 12, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(hi))), s3));
+    }
+
+    for (; i + 4 <= num; i += 4)
+        vst1q_f32(dst + i, vmulq_f32(_neon_load4(src, i, is_int16), _neon_row_scale(scale, mode, vscale, i)));
+
+    for (; i < num; i++)
+        dst[i] = _load_one(src, i, is_int16) * _scale_of(scale, mode, 0, i);
+}
+
+static ALWAYS_INLINE void _neon_transpose(float *dst, uint32_t dst_stride, const void *src, bool is_int16, uint32_t src_stride,
+                                          uint32_t rows, uint32_t cols, const float *scale, int mode)
+{
+    float32x4_t vscale = vdupq_n_f32(scale[0]);
+    uint32_t tiled_rows = rows & ~3U;
+    uint32_t tiled_cols = cols & ~3U;
+
+    // column blocks outermost, so that consecutive tiles are stored next to each other
+    for (uint32_t c = 0; c < tiled_cols; c += 4) {
+        float32x4_t c0 = _neon_col_scale(scale, mode, vscale, c);
+        float32x4_t c1 = _neon_col_scale(scale, mode, vscale, c + 1);
+        float32x4_t c2 = _neon_col_scale(scale, mode, vscale, c + 2);
+        float32x4_t c3 = _neon_col_scale(scale, mode, vscale, c + 3);
+
+        for (uint32_t r = 0; r < tiled_rows; r += 4) {
+            size_t idx = (size_t)r * src_stride + c;
+            float32x4x2_t t01 = vtrnq_f32(_neon_load4(src, idx, is_int16), _neon_load4(src, idx + src_stride, is_int16));
+            float32x4x2_t t23 = vtrnq_f32(_neon_load4(src, idx + 2 * (size_t)src_stride, is_int16), _neon_load4(src, idx + 3 * (size_t)src_stride, is_int16));
+            float32x4_t rs = (SCALE_PER_ROW == mode) ? vld1q_f32(scale + r) : vscale;
+            float32x4_t s0 = (SCALE_PER_ROW == mode) ? rs : c0;
+            float32x4_t s1 = (SCALE_PER_ROW == mode) ? rs : c1;
+            float32x4_t s2 = (SCALE_PER_ROW == mode) ? rs : c2;
+            float32x4_t s3 = (SCALE_PER_ROW == mode) ? rs : c3;
+
+            float *out = dst + (size_t)c * dst_stride + r;
+            vst1q_f32(out, vmulq_f32(vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])), s0));
+            vst1q_f32(out + dst_stride, vmulq_f32(vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])), s1));
+            vst1q_f32(out + 2 * (size_t)dst_stride, vmulq_f32(vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])), s2));
+            vst1q_f32(out + 3 * (size_t)dst_stride, vmulq_f32(vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])), s3));
+        }
+    }
+
+    _transpose_edges(dst, dst_stride, src, is_int16, src_stride, rows, cols, tiled_rows, tiled_cols, scale, mode);
+}
+
+// the kernels are specialized on a constant data type and scale mode
+static void _neon_row_any(float *dst, const void *src, bool is_int16, uint32_t num, const float *scale, int mode)
+{
+    if (SCALE_PER_COL == mode) {
+        if (is_int16)
+            _neon_row(dst, src, true, num, scale, SCALE_PER_COL);
+        else
+            _neon_row(dst, src, false, num, scale, SCALE_PER_COL);
+    } else {
+        if (is_int16)
+            _neon_row(dst, src, true, num, scale, SCALE_UNIFORM);
+        else
+            _neon_row(dst, src, false, num, scale, SCALE_UNIFORM);
+    }
+}
+
+static void _neon_transpose_any(float *dst, uint32_t dst_stride, const void *src, bool is_int16, uint32_t src_stride,
+                                uint32_t rows, uint32_t cols, const float *scale, int mode)
+{
+    if (SCALE_PER_ROW == mode) {
+        if (is_int16)
+            _neon_transpose(dst, dst_stride, src, true, src_stride, rows, cols, scale, SCALE_PER_ROW);
+        else
+            _neon_transpose(dst, dst_stride, src, false, src_stride, rows, cols, scale, SCALE_PER_ROW);
+    } else if (SCALE_PER_COL == mode) {
+        if (is_int16)
+            _neon_transpose(dst, dst_stride, src, true, src_stride, rows, cols, scale, SCALE_PER_COL);
+        else
+            _neon_transpose(dst, dst_stride, src, false, src_stride, rows, cols, scale, SCALE_PER_COL);
+    } else {
+        if (is_int16)
+            _neon_transpose(dst, dst_stride, src, true, src_stride, rows, cols, scale, SCALE_UNIFORM);
+        else
+            _neon_transpose(dst, dst_stride, src, false, src_stride, rows, cols, scale, SCALE_UNIFORM);
+    }
+}
+
+#endif
+
+static void _dequantize_row(float *dst, const void *src, bool is_int16, uint32_t num, const float *scale, int mode)
+{
+#if defined(DEQUANTIZE_X86)
+    int simd_level = _cpu_simd_level();
+
+    if (SIMD_AVX2 == simd_level)
+        _avx_row_any(dst, src, is_int16, num, scale, mode);
+    else if (SIMD_SSE41 == simd_level)
+        _sse_row_any(dst, src, is_int16, num, scale, mode);
+    else
+        _row_scalar(dst, src, is_int16, num, scale, mode);
+#elif defined(DEQUANTIZE_NEON)
+    _neon_row_any(dst, src, is_int16, num, scale, mode);
+#else
+    _row_scalar(dst, src, is_int16, num, scale, mode);
+#endif
+}
+
+static void _dequantize_transpose(float *dst, uint32_t dst_stride, const void *src, bool is_int16, uint32_t src_stride,
+                                  uint32_t rows, uint32_t cols, const float *scale, int mode)
+{
+#if defined(DEQUANTIZE_X86)
+    int simd_level = _cpu_simd_level();
+
+    // 8x8 AVX2 tiles measured no faster than 4x4 ones, the strided stores dominate
+    if (SIMD_SSE41 <= simd_level)
+        _sse_transpose_any(dst, dst_stride, src, is_int16, src_stride, rows, cols, scale, mode);
+    else
+        _transpose_scalar(dst, dst_stride, src, is_int16, src_stride, 0, rows, 0, cols, scale, mode);
+#elif defined(DEQUANTIZE_NEON)
+    _neon_transpose_any(dst, dst_stride, src, is_int16, src_stride, rows, cols, scale, mode);
+#else
+    _transpose_scalar(dst, dst_stride, src, is_int16, src_stride, 0, rows, 0, cols, scale, mode);
+#endif
+}
+
+float dequantize_float_scale(float scale, int32_t radix)
+{
+    float ffactor = 0;
+
+    #ifdef OPTIMIZED_FIXED_TO_FLOAT
+    {
+        ffactor = (float)1 / (float)(scale * ldexpf(1.0f, radix));
+    }
+    #else
+    {
+        ffactor = (float)(scale * ldexpf(1.0f, radix));
+    }
+    #endif
+
+    return (float)1 / ffactor;
+}
+
+void dequantize_row(float *dst, const void *src, bool is_int16, uint32_t num, float scale)
+{
+    _dequantize_row(dst, src, is_int16, num, &scale, SCALE_UNIFORM);
+}
+
+void dequantize_row_per_channel(float *dst, const void *src, bool is_int16, uint32_t num, const float *scale)
+{
+    _dequantize_row(dst, src, is_int16, num, scale, SCALE_PER_COL);
+}
+
+void dequantize_transpose(float *dst, uint32_t dst_stride, const void *src, bool is_int16, uint32_t src_stride, uint32_t rows, uint32_t cols, float scale)
+{
+    _dequantize_transpose(dst, dst_stride, src, is_int16, src_stride, rows, cols, &scale, SCALE_UNIFORM);
+}
+
+void dequantize_transpose_per_row(float *dst, uint32_t dst_stride, const void *src, bool is_int16, uint32_t src_stride, uint32_t rows, uint32_t cols, const float *row_scale)
+{
+    _dequantize_transpose(dst, dst_stride, src, is_int16, src_stride, rows, cols, row_scale, SCALE_PER_ROW);
+}
+
+void dequantize_transpose_per_col(float *dst, uint32_t dst_stride, const void *src, bool is_int16, uint32_t src_stride, uint32_t rows, uint32_t cols, const float *col_scale)
+{
+    _dequantize_transpose(dst, dst_stride, src, is_int16, src_stride, rows, cols, col_scale, SCALE_PER_COL);
+}
@@ -41,26 +41,91 @@ typedef struct
     uint32_t all_models_size;   /**< Size of all_model part */
 } kp_nef_info_t;
 
+/**
+ * @brief location of single model setup.bin in all_models data
+ */
+typedef struct
+{
+    uint32_t model_id;          /**< model ID */
+    uint32_t setup_offset;      /**< Offset of setup.bin from the beginning of all_models */
+    uint32_t setup_size;        /**< Size of setup.bin */
+} kp_model_setup_location_t;
+
 /******************************************************************
  * [private] utils
  ******************************************************************/
 
+/**
+ * @brief bump allocator for building a model descriptor, all memory is released at once
+ */
+typedef struct scratch_chunk_s scratch_chunk_t;
+
+typedef struct
+{
+    scratch_chunk_t* head;      /**< the chunk being allocated from, older chunks follow */
+} scratch_arena_t;
+
 void* realloc_zero(void* memory, size_t new_size);
-void* strcpy_dst_realloc(char* dst_buff, const char* src_buff);
+void* scratch_alloc(scratch_arena_t* scratch, size_t size);
+char* scratch_strdup(scratch_arena_t* scratch, const char* src_buff);
+void scratch_release(scratch_arena_t* scratch);
 
 /******************************************************************
  * [private] setup_reader
  ******************************************************************/
 
-int construct_single_setup_info(uintptr_t setup_buff, size_t setup_buff_size, kp_single_model_descriptor_t *single_model_descriptor);
+int construct_single_setup_info(uintptr_t setup_buff, size_t setup_buff_size, scratch_arena_t *scratch, kp_single_model_descriptor_t *single_model_descriptor);
 
 /******************************************************************
  * [private] model_descriptor_builder
  ******************************************************************/
 
-uint32_t* realloc_tensor_shape(uint32_t *shape, uint32_t element_num);
-kp_tensor_descriptor_t* realloc_tensor_list(kp_tensor_descriptor_t *tensor_list, uint32_t element_num);
-kp_quantized_fixed_point_descriptor_t* realloc_quantized_fixed_point_descriptor_list(kp_quantized_fixed_point_descriptor_t *quantized_fixed_point_descriptor_list, uint32_t element_num);
+uint32_t* alloc_tensor_shape(scratch_arena_t *scratch, uint32_t element_num);
+kp_tensor_descriptor_t* alloc_tensor_list(scratch_arena_t *scratch, uint32_t element_num);
+kp_quantized_fixed_point_descriptor_t* alloc_quantized_fixed_point_descriptor_list(scratch_arena_t *scratch, uint32_t element_num);
+
+/******************************************************************
+ * [public] checksum
+ ******************************************************************/
+
+uint32_t crc_cal(uint8_t *buf, uint32_t size);
+uint16_t crc16_cal(uint8_t *buf, uint32_t size);
+uint32_t sum32_cal(uint8_t *buf, uint32_t size);
+uint32_t fnv1a32_cal(uint8_t *buf, uint32_t size);
+
+/******************************************************************
+ * [public] dequantize
+ ******************************************************************/
+
+/**
+ * dst[i] = src[i] * scale, src is int8 or int16 (is_int16)
+ */
+void dequantize_row(float *dst, const void *src, bool is_int16, uint32_t num, float scale);
+
+/**
+ * dst[i] = src[i] * scale[i], for a row running across channels
+ */
+void dequantize_row_per_channel(float *dst, const void *src, bool is_int16, uint32_t num, const float *scale);
+
+/**
+ * dst[c * dst_stride + r] = src[r * src_stride + c] * scale for a rows x cols matrix, strides are in elements
+ */
+void dequantize_transpose(float *dst, uint32_t dst_stride, const void *src, bool is_int16, uint32_t src_stride, uint32_t rows, uint32_t cols, float scale);
+
+/**
+ * as dequantize_transpose, with scale row_scale[r] for source row r
+ */
+void dequantize_transpose_per_row(float *dst, uint32_t dst_stride, const void *src, bool is_int16, uint32_t src_stride, uint32_t rows, uint32_t cols, const float *row_scale);
+
+/**
+ * as dequantize_transpose, with scale col_scale[c] for source column c
+ */
+void dequantize_transpose_per_col(float *dst, uint32_t dst_stride, const void *src, bool is_int16, uint32_t src_stride, uint32_t rows, uint32_t cols, const float *col_scale);
+
+/**
+ * the factor a fixed-point value of the given scale/radix is multiplied by to give its floating-point value
+ */
+float dequantize_float_scale(float scale, int32_t radix);
 
 /******************************************************************
  * [public] setup_reader
@@ -73,14 +138,39 @@ uint32_t convert_data_format_to_kp_tensor_format(uint32_t data_format, uint32_t
  ******************************************************************/
 
 int read_nef(char *nef_data, uint32_t nef_size, kp_metadata_t *metadata, kp_nef_info_t *nef_info);
+int parse_nef(char *nef_data, uint32_t nef_size, kp_metadata_t *metadata, kp_nef_info_t *nef_info);
+int check_nef_crc(char *nef_data, uint32_t nef_size);
 
 /******************************************************************
  * [public] model_descriptor_builder
  ******************************************************************/
 
 int deconstruct_model_nef_descriptor(kp_model_nef_descriptor_t* loaded_model_desc);
+int share_model_nef_descriptor(kp_model_nef_descriptor_t* src_model_desc, kp_model_nef_descriptor_t* dst_model_desc);
 int build_model_nef_descriptor_from_nef(kp_metadata_t *metadata, kp_nef_info_t *nef_info, kp_model_nef_descriptor_t* loaded_model_desc);
 int build_model_nef_descriptor_from_device(kp_nef_info_t *nef_info, kp_model_nef_descriptor_t* loaded_model_desc);
+int export_model_nef_descriptor_image(kp_model_nef_descriptor_t* model_desc, kp_model_nef_descriptor_t* image_desc, void **image, uint32_t *image_size);
+int import_model_nef_descriptor_image(kp_model_nef_descriptor_t* image_desc, void *image, uint32_t image_size, kp_model_nef_descriptor_t* model_desc);
+int get_model_setup_location_list(kp_nef_info_t *nef_info, kp_model_setup_location_t **location_list, uint32_t *model_num);
 int load_model_info_from_nef(void *nef_buf, int nef_size, kp_product_id_t target_pid /* input */, kp_metadata_t *metadata, kp_nef_info_t *nef_info, kp_model_nef_descriptor_t *loaded_model_desc /* output */);
+int load_model_info_from_nef_without_crc(void *nef_buf, int nef_size, kp_product_id_t target_pid /* input */, kp_metadata_t *metadata, kp_nef_info_t *nef_info, kp_model_nef_descriptor_t *loaded_model_desc /* output */);
+
+// precomputed factors of quantization parameters in a built descriptor, one per fixed-point descriptor, NULL if not known
+const float* get_quantization_float_scale(const kp_quantization_parameters_t *quantization_parameters);
+
+/******************************************************************
+ * [public] model_descriptor_cache
+ ******************************************************************/
+
+bool is_model_desc_cache_enabled();
+int load_model_nef_descriptor_from_cache(void *nef_buf, int nef_size, kp_model_nef_descriptor_t *model_desc);
+int save_model_nef_descriptor_to_cache(void *nef_buf, int nef_size, kp_model_nef_descriptor_t *model_desc);
+
+/******************************************************************
+ * [public] kp_core
+ ******************************************************************/
+
+char *map_file_to_buffer(const char *file_path, long *buffer_size);
+void unmap_file_buffer(char *buffer, long buffer_size);
 
 #endif
@@ -9,9 +9,42 @@
 
 #pragma once
 
+#include <semaphore.h>
+
 #include "kp_usb.h"
+#include "kp_update_flash.h"
+
+#define MAX_GROUP_DEVICE 256  // sanity limit of devices connected as one group
+#define MIN_GROUP_CAPACITY 20 // slots of a group are at least this many, so hotplug can add devices to a small group
+
+#define KP_IO_BUFFER_HEADROOM 4096 // space in front of an io buffer for the inference header, keeps the buffer page-aligned
 
-#define MAX_GROUP_DEVICE 20
+typedef struct _kp_io_buffer
+{
+    struct _kp_io_buffer *next;
+    uint8_t *base;          // allocated memory, headroom included
+    uint32_t size;          // allocated size, headroom included
+    kp_usb_device_t *owner; // device of the usbfs memory, NULL for page-aligned host memory
+    bool in_use;
+} _kp_io_buffer_t;
+
+// devices under the same root hub port share its bandwidth, and all root hub ports of a bus share the host controller
+typedef struct
+{
+    int bus_number; // host controller
+    int root_port;  // port of the root hub, -1 for the entry of the whole bus
+    int in_flight;  // inferences in flight on devices of the tree, accessed atomically
+} _kp_usb_tree_t;
+
+#define ANY_MODEL_ID 0xFFFFFFFF // inference is dispatched regardless of the models held by devices
+
+// models loaded into a device alone by kp_load_model_to_devices(), they replace the models of the group on it
+typedef struct
+{
+    bool loaded;                           // false if the device runs the models of the group
+    kp_model_nef_descriptor_t model_desc;  // no models if loading failed, the device is then not dispatched to
+    kp_ddr_manage_attr_t ddr_attr;
+} _kp_device_model_t;
 
 typedef struct
 {
@@ -23,12 +56,166 @@ typedef struct
     kp_ddr_manage_attr_t ddr_attr;
 
     // private
-    int cur_send; // record current sending device index
-    int cur_recv; // record current receiving device index
-    kp_usb_device_t *ll_device[MAX_GROUP_DEVICE];
+    uint32_t cur_send; // ticket of next sending, taken atomically
+    uint32_t cur_recv; // ticket of next receiving, taken atomically
+    kp_usb_device_t **ll_device;
+    int capacity;                // number of slots of the per-device arrays, num_device grows up to it with hotplug
+    int *in_flight;              // inferences sent but whose last result is not received yet, accessed atomically
+    uint8_t **recv_buf;          // buffer of the posted read of each device, protected by recv_mutex
+    uint32_t *recv_buf_size;
+    pthread_mutex_t recv_mutex;
+    uint8_t **send_buf;          // inference headers to be sent with their images, per device
+    uint32_t *send_buf_size;
+    pthread_mutex_t *send_mutex; // protects send_buf
+    _kp_io_buffer_t *io_buf_list; // buffers of kp_alloc_io_buffer(), freed ones are kept as a pool
+    uint32_t io_buf_dev_mem_size; // total size of usbfs memory in io_buf_list
+    int io_buf_dev_idx;           // device to allocate next usbfs memory from
+    pthread_mutex_t io_buf_mutex;
+    struct _kp_async_inference *async; // receiver threads of kp_inference_start_async(), NULL if not started
+    bool *dev_active;                   // device can be dispatched to, cleared when it is removed, accessed atomically
+    _kp_usb_tree_t *usb_tree;           // root hub ports and buses of the devices, 2 entries per slot at most
+    int num_usb_tree;
+    int *dev_usb_port;                  // usb_tree entry of the root hub port of each device
+    int *dev_usb_bus;                   // usb_tree entry of the bus of each device
+    pthread_t *log_thread;              // kp_enable_firmware_log() of each device
+    _kp_device_model_t *dev_model;      // models of each device, changed only while no inference is sent
+    bool model_affinity;                // some device has its own models, so inferences go to devices holding their model
+    pthread_mutex_t slot_mutex;         // serializes replacing devices in their slots and starting receiver threads
+    kp_usb_device_t **retired_device;   // devices replaced in their slots, closed by kp_disconnect_devices()
+    int num_retired_device;
+    struct _kp_hotplug *hotplug;        // kp_enable_hotplug(), NULL if not enabled
+    kp_flash_write_statistics_t flash_write_stats; // of the last kp_update_kdp2_firmware()
 
 } __attribute__((aligned(4))) _kp_devices_group_t;
 
+typedef struct _kp_async_result
+{
+    struct _kp_async_result *next;     // link of the completion queue or the free list
+    struct _kp_async_result *all_next; // link of all allocated results
+    kp_inference_result_t result;
+} _kp_async_result_t;
+
+typedef struct
+{
+    _kp_devices_group_t *devices_grp;
+    int dev_idx;
+    pthread_t thread;
+    bool created;
+} _kp_async_receiver_t;
+
+typedef struct _kp_async_inference
+{
+    int running;
+    uint32_t buf_size;
+    kp_inference_callback_t callback;
+    void *user_data;
+    // completion queue, receiver threads push without locking and kp_inference_poll() pops
+    _kp_async_result_t *queue_head; // last pushed result
+    _kp_async_result_t *queue_tail; // next result to pop, protected by poll_mutex
+    _kp_async_result_t queue_stub;
+    sem_t queue_count;
+    pthread_mutex_t poll_mutex;
+
+    _kp_async_result_t *free_list; // results released by user, protected by result_mutex
+    _kp_async_result_t *all_list;
+    pthread_mutex_t result_mutex;
+
+    _kp_async_receiver_t receiver[]; // one receiver thread per slot of the group
+} _kp_async_inference_t;
+
+#define KP_HOTPLUG_MAX_EVENT 32 // ports waiting to be checked by the hotplug worker
+
+typedef struct _kp_hotplug_job
+{
+    struct _kp_hotplug_job *next;
+    int dev_idx; // device the job is sent to, -1 if it waits for requeue
+    uint32_t inference_number;
+    uint32_t model_id; // the job is sent again only to devices holding the model
+    int num_buf;
+    uint32_t buf_len[2 * MAX_INPUT_NODE_COUNT]; // transfers as written to the device
+    uint8_t data[];
+} _kp_hotplug_job_t;
+
+// a NEF shared by the slots it is loaded into
+typedef struct
+{
+    int ref_count; // protected by setup_mutex
+    int nef_size;
+    uint8_t nef_buf[];
+} _kp_hotplug_nef_t;
+
+typedef struct _kp_hotplug
+{
+    _kp_devices_group_t *devices_grp;
+    int handle; // of kp_usb_register_hotplug()
+    pthread_t thread;
+    bool running;
+    uint32_t event_port_id[KP_HOTPLUG_MAX_EVENT];
+    int num_event;
+    pthread_mutex_t event_mutex;
+    pthread_cond_t event_cond;
+
+    // copies of what is loaded into the group, loaded into arrived devices
+    void *scpu_fw_buf;
+    int scpu_fw_size;
+    void *ncpu_fw_buf;
+    int ncpu_fw_size;
+    void *nef_buf;
+    int nef_size;
+    bool model_from_flash;
+    pthread_mutex_t setup_mutex; // also held while the group reboots devices
+
+    // in-flight jobs of each device in sending order, jobs of removed devices wait in orphan list for requeue
+    _kp_hotplug_nef_t **slot_nef; // per slot of the group, models of kp_load_model_to_devices(), NULL for the models of the group
+    _kp_hotplug_job_t **job_head; // per slot of the group
+    _kp_hotplug_job_t **job_tail;
+    _kp_hotplug_job_t *orphan_head;
+    _kp_hotplug_job_t *orphan_tail;
+    pthread_mutex_t job_mutex;
+} _kp_hotplug_t;
+
+// device dispatching of kp_inference.c, model_id is ANY_MODEL_ID if the inference can go to any device
+int acquire_send_device(_kp_devices_group_t *_devices_grp, uint32_t model_id);
+void release_device(_kp_devices_group_t *_devices_grp, int dev_idx);
+void clear_in_flight(_kp_devices_group_t *_devices_grp, int dev_idx);
+
+// find the root hub port and bus of the device in a slot from its port path, called before the slot is activated
+void assign_usb_tree(_kp_devices_group_t *_devices_grp, int dev_idx);
+
+// receiver thread of a device slot for kp_inference_start_async(), called with slot_mutex locked
+int async_attach_device(_kp_devices_group_t *_devices_grp, int dev_idx);
+void async_detach_device(_kp_devices_group_t *_devices_grp, int dev_idx);
+// the calling thread is a receiver thread, i.e. the callback of asynchronous inference is running
+bool is_async_receiver_thread(_kp_devices_group_t *_devices_grp);
+
+// journal of inferences sent while hotplug is enabled, so those of a removed device can be sent again
+// record is called with send_mutex of dev_idx locked before writing, *job is NULL if out of memory (sent without journal)
+// return false if the device is removed meanwhile, then the job waits for another device and must not be written
+bool hotplug_record_job(_kp_devices_group_t *_devices_grp, int dev_idx, uint32_t inference_number, uint32_t model_id, kp_usb_buffer_t usb_buf[], int num_usb_buf, _kp_hotplug_job_t **job);
+void hotplug_drop_job(_kp_devices_group_t *_devices_grp, _kp_hotplug_job_t *job);
+void hotplug_job_done(_kp_devices_group_t *_devices_grp, int dev_idx, bool match_number, uint32_t inference_number);
+
+// stop dispatching to a device which is gone, its in-flight jobs are sent to other devices by the hotplug worker
+void hotplug_retire_device(_kp_devices_group_t *_devices_grp, int dev_idx);
+
+// keep what is loaded into the group for devices arriving later, nef_buf NULL means models are loaded from flash
+void hotplug_keep_firmware(_kp_devices_group_t *_devices_grp, void *scpu_fw_buf, int scpu_fw_size, void *ncpu_fw_buf, int ncpu_fw_size);
+void hotplug_keep_model(_kp_devices_group_t *_devices_grp, void *nef_buf, int nef_size);
+
+// keep models loaded into some slots alone, dev_idx NULL means all slots, nef_buf NULL makes the slots take the models of the group
+void hotplug_keep_device_model(_kp_devices_group_t *_devices_grp, int dev_idx[], int num_dev, void *nef_buf, int nef_size);
+
+// hold hotplug events while devices of the group are rebooted and reconnected by the library
+void hotplug_pause(_kp_devices_group_t *_devices_grp);
+void hotplug_resume(_kp_devices_group_t *_devices_grp);
+
+// KP_ERROR_INVALID_FIRMWARE_24 if any device is not running KDP2 firmware
+int check_fw_is_loaded(kp_device_group_t devices);
+
+// check if buf is the start of an io buffer from kp_alloc_io_buffer() holding size bytes, only then the headroom in front of buf is ours to write;
+// an interior pointer (e.g. a second node packed into the same io buffer) has caller data in front of it and must take the copying path
+bool is_io_buffer(_kp_devices_group_t *_devices_grp, void *buf, uint32_t size);
+
 #define MAX_RAW_OUTPUT_NODE 50 // guess this number is enough !!!???
 
 #define IMAGE_FORMAT_RAW_OUTPUT 0x10000000
@@ -14,6 +14,14 @@
 
 #include "kp_struct.h"
 
+typedef struct
+{
+    uint64_t bytes_written;    // bytes written to flash of all devices
+    uint64_t write_time_us;    // time of writing them, summed over devices
+    uint64_t bytes_unverified; // bytes written by firmware which does not read back flash
+    uint64_t bytes_skipped;    // bytes not written since flash already holds them
+} kp_flash_write_statistics_t;
+
 int kp_update_kdp2_firmware(kp_device_group_t devices, void *scpu_fw_buf, int scpu_fw_size,
                             void *ncpu_fw_buf, int ncpu_fw_size, bool auto_reboot);
 
@@ -40,4 +48,8 @@ int kp_update_kdp2_usb_loader_from_file(kp_device_group_t devices, const char *u
 
 int kp_switch_to_kdp2_usb_boot(kp_device_group_t devices, bool auto_reboot);
 
+// flash written by the last kp_update_kdp2_firmware() or kp_update_model() of KL520,
+// throughput of one device is bytes_written / write_time_us
+int kp_get_flash_write_statistics(kp_device_group_t devices, kp_flash_write_statistics_t *statistics);
+
 #endif // __KP_UPDATE_FLASH_H__
\ No newline at end of file
@@ -19,8 +19,35 @@
 
 // kdp2 Low Level API
 
+#define KP_USB_MAX_QUEUE_DEPTH 16           // max number of bulk transfers in flight per endpoint
+#define KP_USB_DEFAULT_QUEUE_DEPTH 4        // default number of bulk transfers in flight per endpoint
+#define KP_USB_ASYNC_CHUNK_SIZE (512 * 1024) // size of one queued bulk-out transfer
+
+struct _kp_usb_async_queue;
+
 typedef struct
 {
+    struct libusb_transfer *transfer;
+    struct _kp_usb_async_queue *queue;
+    int expected_length;
+    int completed; // set by the event thread when the transfer is done
+} kp_usb_async_slot_t;
+
+typedef struct _kp_usb_async_queue
+{
+    kp_usb_async_slot_t slot[KP_USB_MAX_QUEUE_DEPTH];
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    unsigned int zlp_buf; // must stay valid until the (fake) ZLP transfer is completed
+    bool notify_read_any; // completion also wakes up kp_usb_wait_read_any()
+} kp_usb_async_queue_t;
+
+struct _kp_usb_transport;
+
+typedef struct
+{
+    const struct _kp_usb_transport *transport; // libusb or simulated device
+    void *transport_priv;                      // private data of the transport
     libusb_device_handle *usb_handle;
     kp_device_descriptor_t dev_descp;
     pthread_mutex_t mutex_send;
@@ -29,6 +56,13 @@ typedef struct
     uint8_t endpoint_cmd_in;
     uint8_t endpoint_cmd_out;
     uint8_t endpoint_log_in;
+    int queue_depth;                // number of bulk-out transfers kept in flight
+    kp_usb_async_queue_t queue_out; // protected by mutex_send
+    kp_usb_async_queue_t queue_in;  // protected by mutex_recv
+    void *posted_buf;               // buffer of the posted read, NULL if no read is posted, protected by mutex_recv
+    int posted_len;
+    int posted_recv;                // size received so far
+    bool posted_zlp;                // reading the zero length packet after data
 } kp_usb_device_t;
 
 typedef enum
@@ -51,6 +85,7 @@ typedef enum
     KP_USB_CONFIGURE_ERR = 98,
     KP_USB_RET_ERR = 99,
     KP_USB_RET_UNSUPPORTED = 100,
+    KP_USB_RET_PENDING = 101, // posted read is not completed yet
 } kp_usb_status_t;
 
 typedef struct
@@ -60,6 +95,27 @@ typedef struct
     unsigned short arg2;
 } kp_usb_control_t;
 
+typedef struct
+{
+    void *buf;
+    int len;
+} kp_usb_buffer_t;
+
+// transport backend behind kp_usb_write_data(), kp_usb_read_data() and kp_usb_control()
+typedef struct _kp_usb_transport
+{
+    const char *name;
+    int (*write_data)(kp_usb_device_t *dev, void *buf, int len, int timeout);
+    int (*write_data_list)(kp_usb_device_t *dev, kp_usb_buffer_t buf_list[], int num_buf, int timeout);
+    int (*read_data)(kp_usb_device_t *dev, void *buf, int len, int timeout);
+    int (*control)(kp_usb_device_t *dev, kp_usb_control_t *control_request, int timeout);
+    void (*flush_out_buffers)(kp_usb_device_t *dev);
+    int (*disconnect)(kp_usb_device_t *dev);
+    int (*submit_read)(kp_usb_device_t *dev, void *buf, int len);
+    int (*poll_read)(kp_usb_device_t *dev, int *wait_us); // wait_us is a hint of time to complete, -1 if unknown
+    void (*cancel_read)(kp_usb_device_t *dev);
+} kp_usb_transport_t;
+
 // scan all Kneron connectable devices and report a list.
 kp_devices_list_t *kp_usb_scan_devices();
 
@@ -70,20 +126,63 @@ int kp_usb_connect_multiple_devices_v2(int num_open, int port_id[], kp_usb_devic
 int kp_usb_disconnect_device(kp_usb_device_t *dev);
 int kp_usb_disconnect_multiple_devices(int num_dev, kp_usb_device_t *devs[]);
 
+// called when a Kneron device arrives or leaves, in the usb event thread (or the thread plugging a simulated device)
+// it must not block or call back into kp_usb functions of hotplug
+typedef void (*kp_usb_hotplug_callback_t)(bool arrived, uint32_t port_id, uint16_t product_id, void *user_data);
+
+// true if libusb reports hotplug events on this platform, simulated devices always report
+bool kp_usb_has_hotplug();
+
+// return a handle >= 0 for kp_usb_deregister_hotplug(), or < 0 if failed
+int kp_usb_register_hotplug(kp_usb_hotplug_callback_t callback, void *user_data);
+void kp_usb_deregister_hotplug(int handle);
+
+// report an arrived or left device to all registered callbacks
+void kp_usb_notify_hotplug(bool arrived, uint32_t port_id, uint16_t product_id);
+
+// true if a Kneron device is attached at port_id, without opening any device
+bool kp_usb_is_port_present(uint32_t port_id);
+
 kp_device_descriptor_t *kp_usb_get_device_descriptor(kp_usb_device_t *dev);
 
 void kp_usb_flush_out_buffers(kp_usb_device_t *dev);
 
+// set number of bulk transfers kept in flight per endpoint (1 ~ KP_USB_MAX_QUEUE_DEPTH)
+int kp_usb_set_queue_depth(kp_usb_device_t *dev, int queue_depth);
+
+// allocate usbfs memory of the device, transfers from/to it skip the kernel copy
+// return NULL if it is not supported by the platform or transport
+void *kp_usb_dev_mem_alloc(kp_usb_device_t *dev, size_t size);
+int kp_usb_dev_mem_free(kp_usb_device_t *dev, void *buf, size_t size);
+
 int kp_usb_control(kp_usb_device_t *dev, kp_usb_control_t *control_request, int timeout);
 
 // return 0 (KP_USB_RET_OK) on success, or < 0 if failed
 // timeout in milliseconds, 0 means blocking wait, if timeout it returns KP_USB_USB_TIMEOUT
 int kp_usb_write_data(kp_usb_device_t *dev, void *buf, int len, int timeout);
 
+// write buffers back-to-back without waiting in between, each buffer is one transfer as kp_usb_write_data()
+// return 0 (KP_USB_RET_OK) on success, or < 0 if failed
+int kp_usb_write_data_list(kp_usb_device_t *dev, kp_usb_buffer_t buf_list[], int num_buf, int timeout);
+
 // return read size on success, or < 0 if failed
 // timeout in milliseconds, 0 means blocking wait, if timeout it returns KP_USB_USB_TIMEOUT
 int kp_usb_read_data(kp_usb_device_t *dev, void *buf, int len, int timeout);
 
+// post a read which is completed in background, so that reads of multiple devices can be waited together
+// kp_usb_read_data() returns KP_USB_USB_BUSY until the posted read is completed or cancelled
+int kp_usb_submit_read(kp_usb_device_t *dev, void *buf, int len);
+
+// wait until any posted read of devs[] is completed, or kp_usb_notify_read_any() is called
+// return read size and set *index on completion, KP_USB_RET_PENDING if none completed in timeout milliseconds (0 means no limit), or < 0 if failed
+int kp_usb_wait_read_any(kp_usb_device_t *devs[], int num_dev, int timeout, int *index);
+
+// wake up threads in kp_usb_wait_read_any()
+void kp_usb_notify_read_any();
+
+// cancel the posted read, data being received is dropped
+void kp_usb_cancel_read(kp_usb_device_t *dev);
+
 int kp_usb_endpoint_write_data(kp_usb_device_t *dev, int endpoint, void *buf, int len, int timeout);
 int kp_usb_endpoint_read_data(kp_usb_device_t *dev, int endpoint, void *buf, int len, int timeout);
 
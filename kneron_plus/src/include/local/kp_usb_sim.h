@@ -0,0 +1,40 @@
+/**
+ * @file        kp_usb_sim.h
+ * @brief       internal simulated device (KDP2 protocol) functions
+ * @version     0.1
+ * @date        2023-03-01
+ *
+ * @copyright   Copyright (c) 2021 Kneron Inc. All rights reserved.
+ */
+
+#ifndef __KP_USB_SIM_H__
+#define __KP_USB_SIM_H__
+
+#include <stdbool.h>
+#include "kp_struct.h"
+#include "kp_usb.h"
+
+#define KP_USB_SIM_PORT_ID_BASE 0x7FFF0000  // port ID of simulated devices, never generated by libusb bus/port numbers
+#define KP_USB_SIM_MAX_DEVICE 64
+
+// configure simulated devices, num_devices = 0 disables them
+// fw_version is reported by KDP2_COMMAND_GET_SYSTEM_INFO
+int kp_usb_sim_configure(kp_sim_device_config_t *config, const int fw_version[4]);
+
+// number of simulated devices should be reported by scanning
+int kp_usb_sim_get_num_devices();
+
+void kp_usb_sim_get_device_descriptor(int index, kp_device_descriptor_t *dev_descp);
+
+bool kp_usb_sim_is_port_id(uint32_t port_id);
+
+// false if the simulated device is unplugged or not configured
+bool kp_usb_sim_is_plugged(int index);
+
+// plug or unplug a simulated device, hotplug callbacks are notified as a real device
+int kp_usb_sim_set_plugged(int index, bool plugged);
+
+// connect simulated devices, all port_id must belong to simulated devices
+int kp_usb_sim_connect_devices(int num_dev, int port_id[], kp_usb_device_t *output_devs[]);
+
+#endif
@@ -20,10 +20,12 @@
 #include <pthread.h>
 
 #include "kp_usb.h"
+#include "kp_usb_sim.h"
 #include "kp_internal.h"
 #include "kp_update_flash.h"
 
 #include "kp_core.h"
+#include "kp_inference.h"
 
 #include "kdp2_ipc_cmd.h"
 #include "kdp2_inf_generic_raw.h"
@@ -34,6 +36,10 @@
 
 #ifdef _WIN32
     #include "libwdi.h"
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
 #endif
 
 #ifdef DEBUG_PRINT
@@ -213,13 +219,169 @@ static int get_system_info(kp_usb_device_t *ll_dev, kp_system_info_t *system_inf
     }
 }
 
+// run the routine for each package on a thread of its own, the current thread takes the first package
+// a package whose thread cannot be created is run by the current thread
+static void _run_on_devices_in_parallel(int num_device, void *(*routine)(void *), void *packs, size_t pack_size)
+{
+    if (1 > num_device)
+        return;
+
+    pthread_t thd[num_device];
+    bool created[num_device];
+
+    for (int i = 1; i < num_device; i++) {
+        void *pack = (uint8_t *)packs + i * pack_size;
+
+        created[i] = (0 == pthread_create(&thd[i], NULL, routine, pack));
+
+        if (!created[i])
+            routine(pack);
+    }
+
+    routine(packs);
+
+    for (int i = 1; i < num_device; i++) {
+        if (created[i])
+            pthread_join(thd[i], NULL);
+    }
+}
+
+typedef struct
+{
+    kp_usb_device_t *ll_device;
+    kp_system_info_t system_info;
+    int timeout;
+    int sts;
+} _get_system_info_package;
+
+static void *_get_system_info_of_single_device(void *data)
+{
+    _get_system_info_package *pack = (_get_system_info_package *)data;
+
+    pack->sts = get_system_info(pack->ll_device, &pack->system_info, pack->timeout);
+
+    return NULL;
+}
+
 kp_devices_list_t *kp_scan_devices()
 {
     return kp_usb_scan_devices();
 }
 
 // FIXME
-static int _kp_set_up_inference_queues(kp_device_group_t devices, uint32_t image_count, uint32_t image_size, uint32_t result_count, uint32_t result_size);
+static int _kp_set_up_inference_queues(kp_device_group_t devices, uint32_t image_count, uint32_t image_size, uint32_t result_count, uint32_t result_size, bool skip[]);
+
+#define IO_BUFFER_ALIGNMENT 4096
+#define IO_BUFFER_MAX_DEV_MEM_SIZE (8 * 1024 * 1024) // usbfs memory is limited (usbfs_memory_mb, 16 MB by default) and shared with transfers
+#define IO_BUFFER_MAX_IDLE_COUNT 32                  // freed io buffers kept for reuse
+
+static void release_io_buffer(_kp_io_buffer_t *io_buf)
+{
+    if (NULL != io_buf->owner)
+        kp_usb_dev_mem_free(io_buf->owner, io_buf->base, io_buf->size);
+    else
+#ifdef _WIN32
+        _aligned_free(io_buf->base);
+#else
+        free(io_buf->base);
+#endif
+
+    free(io_buf);
+}
+
+static uint8_t *alloc_aligned_memory(uint32_t size)
+{
+#ifdef _WIN32
+    return (uint8_t *)_aligned_malloc(size, IO_BUFFER_ALIGNMENT);
+#else
+    void *buf = NULL;
+
+    if (0 != posix_memalign(&buf, IO_BUFFER_ALIGNMENT, size))
+        return NULL;
+
+    return (uint8_t *)buf;
+#endif
+}
+
+bool is_io_buffer(_kp_devices_group_t *_devices_grp, void *buf, uint32_t size)
+{
+    bool found = false;
+    uint8_t *start = (uint8_t *)buf;
+
+    pthread_mutex_lock(&_devices_grp->io_buf_mutex);
+
+    for (_kp_io_buffer_t *io_buf = _devices_grp->io_buf_list; NULL != io_buf; io_buf = io_buf->next) {
+        if (io_buf->in_use &&
+            (start == io_buf->base + KP_IO_BUFFER_HEADROOM) &&
+            (size <= io_buf->size - KP_IO_BUFFER_HEADROOM)) {
+            found = true;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&_devices_grp->io_buf_mutex);
+
+    return found;
+}
+
+static void free_group_slots(_kp_devices_group_t *_devices_grp)
+{
+    for (int i = 0; i < _devices_grp->capacity; i++) {
+        pthread_mutex_destroy(&_devices_grp->send_mutex[i]);
+        deconstruct_model_nef_descriptor(&_devices_grp->dev_model[i].model_desc);
+    }
+
+    free(_devices_grp->ll_device);
+    free(_devices_grp->in_flight);
+    free(_devices_grp->recv_buf);
+    free(_devices_grp->recv_buf_size);
+    free(_devices_grp->send_buf);
+    free(_devices_grp->send_buf_size);
+    free(_devices_grp->send_mutex);
+    free(_devices_grp->dev_active);
+    free(_devices_grp->usb_tree);
+    free(_devices_grp->dev_usb_port);
+    free(_devices_grp->dev_usb_bus);
+    free(_devices_grp->log_thread);
+    free(_devices_grp->dev_model);
+    _devices_grp->capacity = 0;
+}
+
+// per-device arrays of the group, slots are never moved afterwards since senders and receivers access them without locking
+static int alloc_group_slots(_kp_devices_group_t *_devices_grp, int capacity)
+{
+    _devices_grp->ll_device = (kp_usb_device_t **)calloc(capacity, sizeof(kp_usb_device_t *));
+    _devices_grp->in_flight = (int *)calloc(capacity, sizeof(int));
+    _devices_grp->recv_buf = (uint8_t **)calloc(capacity, sizeof(uint8_t *));
+    _devices_grp->recv_buf_size = (uint32_t *)calloc(capacity, sizeof(uint32_t));
+    _devices_grp->send_buf = (uint8_t **)calloc(capacity, sizeof(uint8_t *));
+    _devices_grp->send_buf_size = (uint32_t *)calloc(capacity, sizeof(uint32_t));
+    _devices_grp->send_mutex = (pthread_mutex_t *)calloc(capacity, sizeof(pthread_mutex_t));
+    _devices_grp->dev_active = (bool *)calloc(capacity, sizeof(bool));
+    _devices_grp->usb_tree = (_kp_usb_tree_t *)calloc(2 * capacity, sizeof(_kp_usb_tree_t));
+    _devices_grp->dev_usb_port = (int *)calloc(capacity, sizeof(int));
+    _devices_grp->dev_usb_bus = (int *)calloc(capacity, sizeof(int));
+    _devices_grp->log_thread = (pthread_t *)calloc(capacity, sizeof(pthread_t));
+    _devices_grp->dev_model = (_kp_device_model_t *)calloc(capacity, sizeof(_kp_device_model_t));
+
+    if ((NULL == _devices_grp->ll_device) || (NULL == _devices_grp->in_flight) ||
+        (NULL == _devices_grp->recv_buf) || (NULL == _devices_grp->recv_buf_size) ||
+        (NULL == _devices_grp->send_buf) || (NULL == _devices_grp->send_buf_size) ||
+        (NULL == _devices_grp->send_mutex) || (NULL == _devices_grp->dev_active) ||
+        (NULL == _devices_grp->usb_tree) || (NULL == _devices_grp->dev_usb_port) ||
+        (NULL == _devices_grp->dev_usb_bus) || (NULL == _devices_grp->log_thread) ||
+        (NULL == _devices_grp->dev_model)) {
+        free_group_slots(_devices_grp);
+        return KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+    }
+
+    for (int i = 0; i < capacity; i++)
+        pthread_mutex_init(&_devices_grp->send_mutex[i], NULL);
+
+    _devices_grp->capacity = capacity;
+
+    return KP_SUCCESS;
+}
 
 kp_device_group_t connect_devices(int num_devices, int device_port_ids[], int *error_code, bool with_examination)
 {
@@ -260,6 +422,19 @@ CONNECT_DEVICE:
 
     memset(_devices_grp, 0, sizeof(_kp_devices_group_t));
 
+    // a large group gets as many slots as its devices, a small one has spare slots for hotplug
+    if (KP_SUCCESS != alloc_group_slots(_devices_grp, (num_devices > MIN_GROUP_CAPACITY) ? num_devices : MIN_GROUP_CAPACITY))
+    {
+        if (error_code)
+            *error_code = KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+        free(_devices_grp);
+        return NULL;
+    }
+
+    pthread_mutex_init(&_devices_grp->io_buf_mutex, NULL);
+    pthread_mutex_init(&_devices_grp->recv_mutex, NULL);
+    pthread_mutex_init(&_devices_grp->slot_mutex, NULL);
+
     int ret = kp_usb_connect_multiple_devices_v2(num_devices, device_port_ids, _devices_grp->ll_device, 10);
 
     if (ret != KP_USB_RET_OK)
@@ -274,6 +449,10 @@ CONNECT_DEVICE:
                 *error_code = KP_ERROR_CONNECT_FAILED_28;
         }
 
+        pthread_mutex_destroy(&_devices_grp->io_buf_mutex);
+        pthread_mutex_destroy(&_devices_grp->recv_mutex);
+        pthread_mutex_destroy(&_devices_grp->slot_mutex);
+        free_group_slots(_devices_grp);
         free(_devices_grp);
         return NULL;
     }
@@ -312,11 +491,20 @@ CONNECT_DEVICE:
     if (!check_pass)
     {
         kp_usb_disconnect_multiple_devices(num_devices, _devices_grp->ll_device);
+        pthread_mutex_destroy(&_devices_grp->io_buf_mutex);
+        pthread_mutex_destroy(&_devices_grp->recv_mutex);
+        pthread_mutex_destroy(&_devices_grp->slot_mutex);
+        free_group_slots(_devices_grp);
         free(_devices_grp);
         return NULL;
     }
 
     _devices_grp->num_device = num_devices;
+    for (int i = 0; i < num_devices; i++)
+    {
+        assign_usb_tree(_devices_grp, i);
+        _devices_grp->dev_active[i] = true;
+    }
     _devices_grp->timeout = 0;
     _devices_grp->cur_send = 0;
     _devices_grp->cur_recv = 0;
@@ -326,12 +514,14 @@ CONNECT_DEVICE:
     /* Set up fifo queue */
     kp_reset_device((kp_device_group_t)_devices_grp, KP_RESET_INFERENCE);
 
+    /* check kneron plus & firmware version is compatible for flash-boot, system info of devices is got in parallel */
+    _get_system_info_package info_packs[num_devices];
+    int num_info = 0;
+
     if (false == with_examination) {
         goto FUNC_OUT;
     }
 
-    /* check kneron plus & firmware version is compatible for flash-boot */
-    bool is_device_connected = true;
     for (int i = 0; i < num_devices; i++)
     {
         kp_usb_device_t *ll_dev = _devices_grp->ll_device[i];
@@ -342,45 +532,56 @@ CONNECT_DEVICE:
             (KP_KDP2_FW_FLASH_TYPE_V2 == fw_type) ||
             (KP_KDP2_FW_USB_TYPE == fw_type_legacy) ||
             (KP_KDP2_FW_FLASH_TYPE == fw_type_legacy)) {
-            kp_system_info_t system_info = {0};
-            int ret = get_system_info(ll_dev, &system_info, _devices_grp->timeout);
-            const int *fw_version = NULL;
+            memset(&info_packs[num_info], 0, sizeof(_get_system_info_package));
+            info_packs[num_info].ll_device = ll_dev;
+            info_packs[num_info].timeout = _devices_grp->timeout;
+            num_info++;
+        }
+    }
 
-            if (KP_USB_RET_OK == ret) {
-                if (KP_DEVICE_KL520 == ll_dev->dev_descp.product_id) {
-                    fw_version = kl520_fw_version;
-                } else if ((KP_DEVICE_KL720 == ll_dev->dev_descp.product_id) ||
-                           (KP_DEVICE_KL720_LEGACY == ll_dev->dev_descp.product_id)) {
-                    fw_version = kl720_fw_version;
-                } else if (KP_DEVICE_KL630 == ll_dev->dev_descp.product_id) {
-                    fw_version = kl630_fw_version;
-                } else {
-                    printf("invalid device product ID ... %d\n", ll_dev->dev_descp.product_id);
-                    continue;
-                }
+    _run_on_devices_in_parallel(num_info, _get_system_info_of_single_device, info_packs, sizeof(_get_system_info_package));
 
-                if ((fw_version[VERSION_INDEX_MAJOR] == 0) &&
-                    (fw_version[VERSION_INDEX_MINOR] == 0) &&
-                    (fw_version[VERSION_INDEX_REVISION] == 0) &&
-                    (fw_version[VERSION_INDEX_BUILD] == 0)) {
-                    /* no firmware version check when kp_version.h is default setting */
-                    continue;
-                }
-
-                if ((fw_version[VERSION_INDEX_MAJOR] != system_info.firmware_version.major) ||
-                    (fw_version[VERSION_INDEX_MINOR] != system_info.firmware_version.minor) ||
-                    (fw_version[VERSION_INDEX_REVISION] != system_info.firmware_version.update) ||
-                    (fw_version[VERSION_INDEX_BUILD] != system_info.firmware_version.build)) {
-                    printf("\033[0;33m[warnning] The version of firmware (%d.%d.%d.%d) on the port ID %u is not the corresponding version for this Kneron PLUS (%d.%d.%d.%d).\n\033[0m",
-                           system_info.firmware_version.major, system_info.firmware_version.minor, system_info.firmware_version.update, system_info.firmware_version.build,
-                           ll_dev->dev_descp.port_id,
-                           fw_version[VERSION_INDEX_MAJOR], fw_version[VERSION_INDEX_MINOR], fw_version[VERSION_INDEX_REVISION], fw_version[VERSION_INDEX_BUILD]);
-                    fflush(stdout);
-                }
+    bool is_device_connected = true;
+    for (int i = 0; i < num_info; i++)
+    {
+        kp_usb_device_t *ll_dev = info_packs[i].ll_device;
+        kp_system_info_t system_info = info_packs[i].system_info;
+        const int *fw_version = NULL;
+
+        if (KP_USB_RET_OK == info_packs[i].sts) {
+            if (KP_DEVICE_KL520 == ll_dev->dev_descp.product_id) {
+                fw_version = kl520_fw_version;
+            } else if ((KP_DEVICE_KL720 == ll_dev->dev_descp.product_id) ||
+                       (KP_DEVICE_KL720_LEGACY == ll_dev->dev_descp.product_id)) {
+                fw_version = kl720_fw_version;
+            } else if (KP_DEVICE_KL630 == ll_dev->dev_descp.product_id) {
+                fw_version = kl630_fw_version;
             } else {
-                is_device_connected = false;
-                break;
+                printf("invalid device product ID ... %d\n", ll_dev->dev_descp.product_id);
+                continue;
             }
+
+            if ((fw_version[VERSION_INDEX_MAJOR] == 0) &&
+                (fw_version[VERSION_INDEX_MINOR] == 0) &&
+                (fw_version[VERSION_INDEX_REVISION] == 0) &&
+                (fw_version[VERSION_INDEX_BUILD] == 0)) {
+                /* no firmware version check when kp_version.h is default setting */
+                continue;
+            }
+
+            if ((fw_version[VERSION_INDEX_MAJOR] != system_info.firmware_version.major) ||
+                (fw_version[VERSION_INDEX_MINOR] != system_info.firmware_version.minor) ||
+                (fw_version[VERSION_INDEX_REVISION] != system_info.firmware_version.update) ||
+                (fw_version[VERSION_INDEX_BUILD] != system_info.firmware_version.build)) {
+                printf("\033[0;33m[warnning] The version of firmware (%d.%d.%d.%d) on the port ID %u is not the corresponding version for this Kneron PLUS (%d.%d.%d.%d).\n\033[0m",
+                       system_info.firmware_version.major, system_info.firmware_version.minor, system_info.firmware_version.update, system_info.firmware_version.build,
+                       ll_dev->dev_descp.port_id,
+                       fw_version[VERSION_INDEX_MAJOR], fw_version[VERSION_INDEX_MINOR], fw_version[VERSION_INDEX_REVISION], fw_version[VERSION_INDEX_BUILD]);
+                fflush(stdout);
+            }
+        } else {
+            is_device_connected = false;
+            break;
         }
     }
 
@@ -424,11 +625,38 @@ int kp_disconnect_devices(kp_device_group_t devices)
 {
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
 
+    if (is_async_receiver_thread(_devices_grp))
+        return KP_ERROR_NOT_ALLOWED_IN_CALLBACK_54;
+
+    if (NULL != _devices_grp->hotplug)
+        kp_disable_hotplug(devices);
+
+    if (NULL != _devices_grp->async)
+        kp_inference_stop_async(devices);
+
     kp_release_model_nef_descriptor(&(_devices_grp->loaded_model_desc));
 
-    for (int i = 0; i < _devices_grp->num_device; i++)
+    // usbfs memory must be released before the device is closed
+    while (NULL != _devices_grp->io_buf_list) {
+        _kp_io_buffer_t *io_buf = _devices_grp->io_buf_list;
+        _devices_grp->io_buf_list = io_buf->next;
+        release_io_buffer(io_buf);
+    }
+
+    for (int i = 0; i < _devices_grp->num_device; i++) {
         kp_usb_disconnect_device(_devices_grp->ll_device[i]);
+        free(_devices_grp->send_buf[i]);
+        free(_devices_grp->recv_buf[i]);
+    }
 
+    for (int i = 0; i < _devices_grp->num_retired_device; i++)
+        kp_usb_disconnect_device(_devices_grp->retired_device[i]);
+    free(_devices_grp->retired_device);
+
+    pthread_mutex_destroy(&_devices_grp->io_buf_mutex);
+    pthread_mutex_destroy(&_devices_grp->recv_mutex);
+    pthread_mutex_destroy(&_devices_grp->slot_mutex);
+    free_group_slots(_devices_grp);
     free(_devices_grp);
 
     return KP_SUCCESS;
@@ -440,6 +668,156 @@ void kp_set_timeout(kp_device_group_t devices, int milliseconds)
     _devices_grp->timeout = milliseconds;
 }
 
+int kp_set_usb_queue_depth(kp_device_group_t devices, int queue_depth)
+{
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+
+    if (queue_depth < 1 || queue_depth > KP_USB_MAX_QUEUE_DEPTH)
+        return KP_ERROR_INVALID_PARAM_12;
+
+    for (int i = 0; i < _devices_grp->num_device; i++)
+        kp_usb_set_queue_depth(_devices_grp->ll_device[i], queue_depth);
+
+    return KP_SUCCESS;
+}
+
+int kp_get_device_usb_topology(kp_device_group_t devices, int dev_port_id, int *bus_number, int *root_port)
+{
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    int ret = KP_ERROR_DEVICE_NOT_EXIST_10;
+
+    if ((NULL == bus_number) || (NULL == root_port))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    // slots are replaced by hotplug under slot_mutex
+    pthread_mutex_lock(&_devices_grp->slot_mutex);
+
+    for (int i = 0; i < _devices_grp->num_device; i++)
+    {
+        if (_devices_grp->dev_active[i] && ((uint32_t)dev_port_id == _devices_grp->ll_device[i]->dev_descp.port_id))
+        {
+            _kp_usb_tree_t *usb_tree = &_devices_grp->usb_tree[_devices_grp->dev_usb_port[i]];
+
+            *bus_number = usb_tree->bus_number;
+            *root_port = usb_tree->root_port;
+            ret = KP_SUCCESS;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&_devices_grp->slot_mutex);
+
+    return ret;
+}
+
+void *kp_alloc_io_buffer(kp_device_group_t devices, uint32_t size)
+{
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    _kp_io_buffer_t *io_buf = NULL;
+    _kp_io_buffer_t *best_fit = NULL;
+
+    if ((0 == size) || (size > UINT32_MAX - KP_IO_BUFFER_HEADROOM - IO_BUFFER_ALIGNMENT))
+        return NULL;
+
+    uint32_t alloc_size = (size + KP_IO_BUFFER_HEADROOM + IO_BUFFER_ALIGNMENT - 1) & ~(IO_BUFFER_ALIGNMENT - 1);
+
+    pthread_mutex_lock(&_devices_grp->io_buf_mutex);
+
+    // reuse the smallest freed buffer which is large enough, so steady-state inference does not allocate
+    for (io_buf = _devices_grp->io_buf_list; NULL != io_buf; io_buf = io_buf->next) {
+        if (!io_buf->in_use && (io_buf->size >= alloc_size) && ((NULL == best_fit) || (io_buf->size < best_fit->size)))
+            best_fit = io_buf;
+    }
+
+    if (NULL != best_fit) {
+        best_fit->in_use = true;
+        pthread_mutex_unlock(&_devices_grp->io_buf_mutex);
+        return best_fit->base + KP_IO_BUFFER_HEADROOM;
+    }
+
+    io_buf = (_kp_io_buffer_t *)calloc(1, sizeof(_kp_io_buffer_t));
+    if (NULL == io_buf) {
+        pthread_mutex_unlock(&_devices_grp->io_buf_mutex);
+        return NULL;
+    }
+
+    // usbfs memory is spread over devices, transfers of other devices still work with a kernel copy
+    // with hotplug, memory of a device is not used as the device may be removed while the buffer is in use
+    if ((NULL == _devices_grp->hotplug) && (_devices_grp->io_buf_dev_mem_size + alloc_size <= IO_BUFFER_MAX_DEV_MEM_SIZE)) {
+        kp_usb_device_t *ll_dev = _devices_grp->ll_device[_devices_grp->io_buf_dev_idx];
+
+        io_buf->base = (uint8_t *)kp_usb_dev_mem_alloc(ll_dev, alloc_size);
+
+        if (NULL != io_buf->base) {
+            io_buf->owner = ll_dev;
+            _devices_grp->io_buf_dev_mem_size += alloc_size;
+            _devices_grp->io_buf_dev_idx = (_devices_grp->io_buf_dev_idx + 1) % _devices_grp->num_device;
+        }
+    }
+
+    if (NULL == io_buf->base) {
+        io_buf->base = alloc_aligned_memory(alloc_size);
+
+        if (NULL == io_buf->base) {
+            pthread_mutex_unlock(&_devices_grp->io_buf_mutex);
+            free(io_buf);
+            return NULL;
+        }
+    }
+
+    io_buf->size = alloc_size;
+    io_buf->in_use = true;
+    io_buf->next = _devices_grp->io_buf_list;
+    _devices_grp->io_buf_list = io_buf;
+
+    pthread_mutex_unlock(&_devices_grp->io_buf_mutex);
+
+    return io_buf->base + KP_IO_BUFFER_HEADROOM;
+}
+
+int kp_free_io_buffer(kp_device_group_t devices, void *buffer)
+{
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    _kp_io_buffer_t **prev = &_devices_grp->io_buf_list;
+    _kp_io_buffer_t *io_buf = NULL;
+    int num_idle = 0;
+
+    if (NULL == buffer)
+        return KP_SUCCESS;
+
+    pthread_mutex_lock(&_devices_grp->io_buf_mutex);
+
+    for (io_buf = _devices_grp->io_buf_list; NULL != io_buf; io_buf = io_buf->next) {
+        if (!io_buf->in_use)
+            num_idle++;
+    }
+
+    for (io_buf = _devices_grp->io_buf_list; NULL != io_buf; prev = &io_buf->next, io_buf = io_buf->next) {
+        if (io_buf->in_use && (io_buf->base + KP_IO_BUFFER_HEADROOM == (uint8_t *)buffer))
+            break;
+    }
+
+    if (NULL == io_buf) {
+        pthread_mutex_unlock(&_devices_grp->io_buf_mutex);
+        return KP_ERROR_INVALID_PARAM_12;
+    }
+
+    if (num_idle < IO_BUFFER_MAX_IDLE_COUNT) {
+        io_buf->in_use = false;
+    } else {
+        *prev = io_buf->next;
+
+        if (NULL != io_buf->owner)
+            _devices_grp->io_buf_dev_mem_size -= io_buf->size;
+
+        release_io_buffer(io_buf);
+    }
+
+    pthread_mutex_unlock(&_devices_grp->io_buf_mutex);
+
+    return KP_SUCCESS;
+}
+
 typedef struct
 {
     kp_usb_device_t *ll_device;
@@ -689,7 +1067,8 @@ static int _spawn_thread_to_load_nef_to_devices(int num_device, _load_nef_comman
     return KP_SUCCESS;
 }
 
-static int _kp_adjust_ddr_heap_boundary(kp_device_group_t devices, uint32_t boundary_addr)
+// devices marked in skip[] are left as they are, skip can be NULL
+static int _kp_adjust_ddr_heap_boundary(kp_device_group_t devices, uint32_t boundary_addr, bool skip[])
 {
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
     int timeout = _devices_grp->timeout;
@@ -705,6 +1084,9 @@ static int _kp_adjust_ddr_heap_boundary(kp_device_group_t devices, uint32_t boun
     {
         kp_usb_device_t *ll_dev = _devices_grp->ll_device[i];
 
+        if ((NULL != skip) && (true == skip[i]))
+            continue;
+
         ret = kp_usb_control(ll_dev, &kctrl, timeout);
 
         if (ret != KP_USB_RET_OK)
@@ -719,7 +1101,8 @@ static int _kp_adjust_ddr_heap_boundary(kp_device_group_t devices, uint32_t boun
     return ret;
 }
 
-static int _kp_get_device_available_ddr_config(kp_device_group_t devices, kp_available_ddr_config_t *ddr_config)
+// devices are asked in turn starting from first_dev, the first answer is taken
+static int _kp_get_device_available_ddr_config(kp_device_group_t devices, int first_dev, kp_available_ddr_config_t *ddr_config)
 {
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
     int timeout = _devices_grp->timeout;
@@ -731,10 +1114,11 @@ static int _kp_get_device_available_ddr_config(kp_device_group_t devices, kp_ava
     cmd_buf.command_id = KDP2_COMMAND_GET_DDR_CONFIG;
 
     for (int i = 0; i < _devices_grp->num_device; i++) {
-        int status = kp_usb_write_data(_devices_grp->ll_device[i], (void *)&cmd_buf, sizeof(kdp2_ipc_cmd_get_available_ddr_config_t), timeout);
+        kp_usb_device_t *ll_dev = _devices_grp->ll_device[(first_dev + i) % _devices_grp->num_device];
+        int status = kp_usb_write_data(ll_dev, (void *)&cmd_buf, sizeof(kdp2_ipc_cmd_get_available_ddr_config_t), timeout);
 
         if (KP_SUCCESS == status) {
-            status = kp_usb_read_data(_devices_grp->ll_device[i], (void *)ddr_config, sizeof(kp_available_ddr_config_t), timeout);
+            status = kp_usb_read_data(ll_dev, (void *)ddr_config, sizeof(kp_available_ddr_config_t), timeout);
 
             if (0 < status) {
                 return KP_SUCCESS;
@@ -745,7 +1129,8 @@ static int _kp_get_device_available_ddr_config(kp_device_group_t devices, kp_ava
     return KP_ERROR_OTHER_99;
 }
 
-static int _kp_get_device_fifo_queue_config(kp_device_group_t devices, kp_fifo_queue_config_t *fifo_queue_config)
+// devices are asked in turn starting from first_dev, the first answer is taken
+static int _kp_get_device_fifo_queue_config(kp_device_group_t devices, int first_dev, kp_fifo_queue_config_t *fifo_queue_config)
 {
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
     int timeout = _devices_grp->timeout;
@@ -757,10 +1142,11 @@ static int _kp_get_device_fifo_queue_config(kp_device_group_t devices, kp_fifo_q
     cmd_buf.command_id = KDP2_COMMAND_GET_FIFOQ_CONFIG;
 
     for (int i = 0; i < _devices_grp->num_device; i++) {
-        int status = kp_usb_write_data(_devices_grp->ll_device[i], (void *)&cmd_buf, sizeof(kdp2_ipc_cmd_get_fifo_queue_config_t), timeout);
+        kp_usb_device_t *ll_dev = _devices_grp->ll_device[(first_dev + i) % _devices_grp->num_device];
+        int status = kp_usb_write_data(ll_dev, (void *)&cmd_buf, sizeof(kdp2_ipc_cmd_get_fifo_queue_config_t), timeout);
 
         if (KP_SUCCESS == status) {
-            status = kp_usb_read_data(_devices_grp->ll_device[i], (void *)fifo_queue_config, sizeof(kp_fifo_queue_config_t), timeout);
+            status = kp_usb_read_data(ll_dev, (void *)fifo_queue_config, sizeof(kp_fifo_queue_config_t), timeout);
 
             if (0 < status) {
                 return KP_SUCCESS;
@@ -791,7 +1177,8 @@ static void _kp_set_ddr_attr_to_zero(kp_device_group_t devices)
     ddr_attr->result_buffer_size = 0;
 }
 
-static int _kp_allocate_ddr_memory(kp_device_group_t devices)
+// keep[] marks devices keeping their models and FIFO queue from an earlier load, keep can be NULL
+static int _kp_allocate_ddr_memory(kp_device_group_t devices, bool keep[])
 {
     kp_model_nef_descriptor_t *model_desc = &devices->loaded_model_desc;
     kp_ddr_manage_attr_t *ddr_attr = &devices->ddr_attr;
@@ -803,8 +1190,17 @@ static int _kp_allocate_ddr_memory(kp_device_group_t devices)
     uint32_t auto_allocate_min_input_size = (uint32_t)ceil(((double)AUTO_ALLOCATE_MIN_INPUT_SIZE / BUFFER_SIZE_10_KB)) * BUFFER_SIZE_10_KB;
     uint32_t auto_allocate_max_input_size = (uint32_t)ceil(((double)AUTO_ALLOCATE_MAX_INPUT_SIZE / BUFFER_SIZE_10_KB)) * BUFFER_SIZE_10_KB;
     uint32_t min_input_buffer_count = MINIMUM_INPUT_BUF_COUNT;
+    int first_dev = 0;
 
-    int ret = _kp_get_device_available_ddr_config(devices, &ddr_config);
+    // the DDR layout is taken from a kept device, so that freshly loaded devices follow it
+    for (int i = 0; (NULL != keep) && (i < devices->num_device); i++) {
+        if (true == keep[i]) {
+            first_dev = i;
+            break;
+        }
+    }
+
+    int ret = _kp_get_device_available_ddr_config(devices, first_dev, &ddr_config);
 
     if (KP_SUCCESS != ret) {
         return ret;
@@ -812,7 +1208,7 @@ static int _kp_allocate_ddr_memory(kp_device_group_t devices)
         dbg_print("[%s] Fifoq memory has been allocated.\n", __FUNCTION__);
         devices->ddr_attr.model_size = ddr_config.ddr_model_end - ddr_config.ddr_available_begin;
 
-        ret = _kp_get_device_fifo_queue_config(devices, &fifo_queue_config);
+        ret = _kp_get_device_fifo_queue_config(devices, first_dev, &fifo_queue_config);
 
         if (KP_SUCCESS != ret) {
             return ret;
@@ -823,7 +1219,24 @@ static int _kp_allocate_ddr_memory(kp_device_group_t devices)
             devices->ddr_attr.result_buffer_size = fifo_queue_config.fifoq_result_buf_size;
         }
 
-        return KP_SUCCESS;
+        if (NULL == keep)
+            return KP_SUCCESS;
+
+        // devices loaded freshly along with devices keeping their models are set up the same way
+        ret = _kp_adjust_ddr_heap_boundary(devices, ddr_config.ddr_model_end, keep);
+
+        if (KP_SUCCESS == ret) {
+            ret = _kp_set_up_inference_queues(devices, ddr_attr->input_buffer_count, ddr_attr->input_buffer_size / BUFFER_SIZE_10_KB,
+                                              ddr_attr->result_buffer_count, ddr_attr->result_buffer_size / BUFFER_SIZE_10_KB, keep);
+
+            if (KP_SUCCESS != ret)
+                ret = KP_ERROR_FIFOQ_SETTING_FAILED_43;
+        }
+
+        if (KP_SUCCESS != ret)
+            _kp_set_ddr_attr_to_zero(devices);
+
+        return ret;
     }
 
     available_ddr_size = ddr_config.ddr_available_end - ddr_config.ddr_available_begin;
@@ -835,7 +1248,7 @@ static int _kp_allocate_ddr_memory(kp_device_group_t devices)
     heap_size = available_ddr_size - ddr_attr->model_size;
     heap_boundary_addr = ddr_config.ddr_available_end - heap_size;
 
-    ret = _kp_adjust_ddr_heap_boundary(devices, heap_boundary_addr);
+    ret = _kp_adjust_ddr_heap_boundary(devices, heap_boundary_addr, NULL);
 
     if (KP_SUCCESS != ret) {
         return ret;
@@ -1025,7 +1438,7 @@ FUNC_OUT:
         ret = KP_ERROR_FIFOQ_SETTING_FAILED_43;
     } else {
         ret = _kp_set_up_inference_queues(devices, ddr_attr->input_buffer_count, ddr_attr->input_buffer_size / BUFFER_SIZE_10_KB,
-                                          ddr_attr->result_buffer_count, ddr_attr->result_buffer_size / BUFFER_SIZE_10_KB);
+                                          ddr_attr->result_buffer_count, ddr_attr->result_buffer_size / BUFFER_SIZE_10_KB, NULL);
 
         if (KP_SUCCESS != ret) {
             printf("[%s] Error: Fifo Queue setup failed for input buf %u x %u, result buf %u x %u\n", __FUNCTION__,
@@ -1065,15 +1478,118 @@ int reboot_one_device(kp_device_group_t devices, int dev_index)
     return KP_SUCCESS;
 }
 
-int reboot_if_model_is_loaded(kp_device_group_t devices)
+typedef struct
+{
+    kp_device_group_t devices;
+    int dev_index;
+    int sts;
+} _reboot_package;
+
+static void *_reboot_single_device(void *data)
+{
+    _reboot_package *pack = (_reboot_package *)data;
+
+    pack->sts = reboot_one_device(pack->devices, pack->dev_index);
+
+    return NULL;
+}
+
+// reconnect a rebooted device alone, with retries
+static int _reconnect_rebooted_device(int port_id, int timeout, kp_usb_device_t **dev)
+{
+    int ret = KP_USB_RET_ERR;
+
+    for (int j = 0; j < 3; j++) {
+        int port_ids[1] = {port_id};
+        kp_usb_device_t *devs[1];
+
+        ret = kp_usb_connect_multiple_devices_v2(1, port_ids, devs, 100);
+
+        if (KP_USB_RET_OK != ret) {
+            usleep(USB_DISCONNECT_WAIT_DELAY_US * (j + 1));
+            continue;
+        }
+
+        kp_system_info_t system_info;
+
+        ret = get_system_info(devs[0], &system_info, timeout);
+
+        if (KP_USB_RET_OK != ret) {
+            kp_usb_disconnect_device(devs[0]);
+            usleep(USB_DISCONNECT_WAIT_DELAY_US * (j + 1));
+            continue;
+        } else {
+            *dev = devs[0];
+            break;
+        }
+    }
+
+    return ret;
+}
+
+typedef struct
+{
+    kp_device_group_t devices;
+    int port_id;
+    kp_model_nef_descriptor_t *keep_desc;
+    bool has_model;
+    bool same_models;
+    int sts;
+} _model_info_package;
+
+static bool _is_same_models(kp_model_nef_descriptor_t *desc_a, kp_model_nef_descriptor_t *desc_b)
+{
+    if ((desc_a->target != desc_b->target) || (desc_a->crc != desc_b->crc) || (desc_a->num_models != desc_b->num_models))
+        return false;
+
+    for (int i = 0; i < desc_a->num_models; i++) {
+        if ((desc_a->models[i].id != desc_b->models[i].id) || (desc_a->models[i].version != desc_b->models[i].version))
+            return false;
+    }
+
+    return true;
+}
+
+// ask a device which models it holds, and whether they are the models to keep
+static void *_get_model_info_of_single_device(void *data)
+{
+    _model_info_package *pack = (_model_info_package *)data;
+    kp_model_nef_descriptor_t all_models_desc;
+
+    memset(&all_models_desc, 0, sizeof(kp_model_nef_descriptor_t));
+
+    pack->sts = kp_get_model_info(pack->devices, pack->port_id, &all_models_desc);
+
+    if (KP_SUCCESS == pack->sts) {
+        pack->has_model = (0 != all_models_desc.num_models);
+        pack->same_models = pack->has_model && (NULL != pack->keep_desc) && _is_same_models(&all_models_desc, pack->keep_desc);
+    }
+
+    kp_release_model_nef_descriptor(&all_models_desc);
+
+    return NULL;
+}
+
+/**
+ * Reboot devices holding models, so that new models can be loaded.
+ * If keep_desc is given, devices already holding the same models (same CRC and model IDs) are not rebooted,
+ * and keep[] tells them so that loading the models again can be skipped.
+ */
+int reboot_if_model_is_loaded(kp_device_group_t devices, kp_model_nef_descriptor_t *keep_desc, bool keep[])
 {
     int ret = KP_SUCCESS;
     bool usb_boot = false;
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
-    int num_device = _devices_grp->num_device;
+    bool group_loaded = (0 != _devices_grp->loaded_model_desc.num_models);
     int num_reboot_device = 0;
-    uint32_t *reboot_dev_port_id = (uint32_t *)malloc(num_device * sizeof(uint32_t));
-    uint32_t *reboot_dev_scan_idx = (uint32_t *)malloc(num_device * sizeof(uint32_t));
+    int reboot_dev_port_id[_devices_grp->num_device];
+    _reboot_package reboot_packs[_devices_grp->num_device];
+    _model_info_package info_packs[_devices_grp->num_device];
+    kp_usb_device_t *devs[_devices_grp->num_device];
+    kp_usb_device_t *connected_devs[_devices_grp->num_device];
+
+    // rebooted devices are reconnected here, not by hotplug
+    hotplug_pause(_devices_grp);
 
     /* Check whether usb boot exist */
     for (int i = 0; i < _devices_grp->num_device; i++) {
@@ -1084,108 +1600,117 @@ int reboot_if_model_is_loaded(kp_device_group_t devices)
         }
     }
 
-    /* Reboot all devices if _devices_grp has loaded model */
-    if (0 != _devices_grp->loaded_model_desc.num_models) {
-        for (int i = 0; i < _devices_grp->num_device; i++) {
-            if (false == usb_boot) {
-                reboot_dev_port_id[num_reboot_device] = _devices_grp->ll_device[i]->dev_descp.port_id;
-                reboot_dev_scan_idx[num_reboot_device] = i;
-                ret = reboot_one_device(devices, i);
-            } else {
-                ret = KP_ERROR_USB_BOOT_LOAD_SECOND_MODEL_40;
-            }
-
-            if (KP_SUCCESS != ret) {
-                goto FUNC_OUT;
-            }
-
-            num_reboot_device++;
-        }
+    for (int i = 0; i < _devices_grp->num_device; i++) {
+        memset(&info_packs[i], 0, sizeof(_model_info_package));
+        info_packs[i].devices = devices;
+        info_packs[i].port_id = _devices_grp->ll_device[i]->dev_descp.port_id;
+        info_packs[i].keep_desc = keep_desc;
+        info_packs[i].sts = KP_ERROR_OTHER_99;
 
-        goto RECONNECT;
+        if (NULL != keep)
+            keep[i] = false;
     }
 
-    kp_model_nef_descriptor_t all_models_desc;
-    int port_id = 0;
+    /* Models held by devices are asked in parallel, unless all devices are rebooted anyway */
+    if ((false == group_loaded) || (NULL != keep_desc))
+        _run_on_devices_in_parallel(_devices_grp->num_device, _get_model_info_of_single_device, info_packs, sizeof(_model_info_package));
 
-    /* Reboot the device which has loaded model */
+    /* Reboot all devices if _devices_grp has loaded model, otherwise reboot the device which has loaded model */
     for (int i = 0; i < _devices_grp->num_device; i++) {
-        port_id = _devices_grp->ll_device[i]->dev_descp.port_id;
-        ret = kp_get_model_info(devices, port_id, &all_models_desc);
+        if ((KP_SUCCESS == info_packs[i].sts) && (true == info_packs[i].same_models)) {
+            if (NULL != keep)
+                keep[i] = true;
 
-        if (KP_SUCCESS != ret) {
             continue;
-        } else if (0 != all_models_desc.num_models) {
-            if (false == usb_boot) {
-                reboot_dev_port_id[num_reboot_device] = _devices_grp->ll_device[i]->dev_descp.port_id;
-                reboot_dev_scan_idx[num_reboot_device] = i;
-                ret = reboot_one_device(devices, i);
-            } else {
-                ret = KP_ERROR_USB_BOOT_LOAD_SECOND_MODEL_40;
-            }
+        }
 
-            if (KP_SUCCESS != ret) {
-                kp_release_model_nef_descriptor(&all_models_desc);
-                goto FUNC_OUT;
-            }
+        if ((false == group_loaded) && ((KP_SUCCESS != info_packs[i].sts) || (false == info_packs[i].has_model)))
+            continue;
 
-            num_reboot_device++;
+        if (true == usb_boot) {
+            ret = KP_ERROR_USB_BOOT_LOAD_SECOND_MODEL_40;
+            goto FUNC_OUT;
         }
 
-        kp_release_model_nef_descriptor(&all_models_desc);
+        reboot_dev_port_id[num_reboot_device] = _devices_grp->ll_device[i]->dev_descp.port_id;
+        reboot_packs[num_reboot_device].devices = devices;
+        reboot_packs[num_reboot_device].dev_index = i;
+        reboot_packs[num_reboot_device].sts = KP_SUCCESS;
+        num_reboot_device++;
+    }
+
+    if (0 == num_reboot_device) {
+        goto FUNC_OUT;
+    }
+
+    // devices are rebooted and re-enumerated at the same time
+    _run_on_devices_in_parallel(num_reboot_device, _reboot_single_device, reboot_packs, sizeof(_reboot_package));
+
+    for (int i = 0; i < num_reboot_device; i++) {
+        if (KP_SUCCESS != reboot_packs[i].sts) {
+            ret = reboot_packs[i].sts;
+            goto FUNC_OUT;
+        }
     }
 
-RECONNECT:
+    usleep(USB_DISCONNECT_WAIT_DELAY_US);
 
-    if (0 == num_reboot_device) {
-        goto FUNC_OUT;
-    }
+    memset(devs, 0, sizeof(devs));
 
-    usleep(USB_DISCONNECT_WAIT_DELAY_US);
+    // all rebooted devices are reconnected in one go, connected devices may come in any order
+    if (KP_USB_RET_OK == kp_usb_connect_multiple_devices_v2(num_reboot_device, reboot_dev_port_id, connected_devs, 100)) {
+        _get_system_info_package info_packs[num_reboot_device];
 
-    for (int i = 0; i < num_reboot_device; i++) {
-        int port_ids[1] = {reboot_dev_port_id[i]};
-        kp_usb_device_t *devs[1];
+        for (int i = 0; i < num_reboot_device; i++) {
+            memset(&info_packs[i], 0, sizeof(_get_system_info_package));
+            info_packs[i].ll_device = connected_devs[i];
+            info_packs[i].timeout = _devices_grp->timeout;
+        }
 
-        for(int j = 0; j < 3; j++) {
-            ret = kp_usb_connect_multiple_devices_v2(1, port_ids, devs, 100);
+        _run_on_devices_in_parallel(num_reboot_device, _get_system_info_of_single_device, info_packs, sizeof(_get_system_info_package));
 
-            if (KP_USB_RET_OK != ret) {
-                usleep(USB_DISCONNECT_WAIT_DELAY_US * (j + 1));
+        for (int i = 0; i < num_reboot_device; i++) {
+            if (KP_USB_RET_OK != info_packs[i].sts) {
+                kp_usb_disconnect_device(connected_devs[i]);
                 continue;
             }
 
-            kp_system_info_t system_info;
-
-            ret = get_system_info(devs[0], &system_info, _devices_grp->timeout);
-
-            if (KP_USB_RET_OK != ret) {
-                kp_usb_disconnect_device(devs[0]);
-                usleep(USB_DISCONNECT_WAIT_DELAY_US * (j + 1));
-                continue;
-            } else {
-                break;
+            for (int j = 0; j < num_reboot_device; j++) {
+                if ((uint32_t)reboot_dev_port_id[j] == connected_devs[i]->dev_descp.port_id)
+                    devs[j] = connected_devs[i];
             }
         }
+    }
+
+    for (int i = 0; i < num_reboot_device; i++) {
+        // update back
+        if (NULL != devs[i])
+            _devices_grp->ll_device[reboot_packs[i].dev_index] = devs[i];
+    }
+
+    for (int i = 0; i < num_reboot_device; i++) {
+        if (NULL != devs[i])
+            continue;
+
+        // a device not ready yet is retried alone
+        ret = _reconnect_rebooted_device(reboot_dev_port_id[i], _devices_grp->timeout, &devs[i]);
 
         if (KP_USB_RET_OK != ret) {
             ret = KP_ERROR_DEVICE_NOT_EXIST_10;
             goto FUNC_OUT;
         }
 
-        // update back
-        _devices_grp->ll_device[reboot_dev_scan_idx[i]] = devs[0];
+        _devices_grp->ll_device[reboot_packs[i].dev_index] = devs[i];
     }
 
 FUNC_OUT:
 
-    free(reboot_dev_port_id);
-    free(reboot_dev_scan_idx);
+    hotplug_resume(_devices_grp);
 
     return KP_SUCCESS;
 }
 
-static int check_fw_is_loaded(kp_device_group_t devices)
+int check_fw_is_loaded(kp_device_group_t devices)
 {
     int ret = KP_SUCCESS;
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
@@ -1204,65 +1729,142 @@ static int check_fw_is_loaded(kp_device_group_t devices)
     return ret;
 }
 
-int kp_load_model(kp_device_group_t devices, void *nef_buf, int nef_size, kp_model_nef_descriptor_t *model_desc)
+// models loaded into all devices replace those loaded into devices alone
+static void reset_device_models(_kp_devices_group_t *_devices_grp)
+{
+    if (false == _devices_grp->model_affinity)
+        return;
+
+    for (int i = 0; i < _devices_grp->capacity; i++)
+        _devices_grp->dev_model[i].loaded = false;
+
+    _devices_grp->model_affinity = false;
+
+    if (NULL != _devices_grp->hotplug)
+        hotplug_keep_device_model(_devices_grp, NULL, 0, NULL, 0);
+}
+
+typedef struct
+{
+    char *nef_buf;
+    int nef_size;
+    int sts;
+} _nef_crc_package;
+
+static void *_check_nef_crc(void *data)
+{
+    _nef_crc_package *crc_pack = (_nef_crc_package *)data;
+
+    crc_pack->sts = (0 == check_nef_crc(crc_pack->nef_buf, crc_pack->nef_size)) ? KP_SUCCESS : KP_ERROR_INVALID_MODEL_21;
+
+    return NULL;
+}
+
+// if crc_checked is false, the NEF CRC is checked while the models are uploaded
+static int _kp_load_model(kp_device_group_t devices, void *nef_buf, int nef_size, bool crc_checked, kp_model_nef_descriptor_t *model_desc)
 {
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
 
     kp_metadata_t metadata;
     kp_nef_info_t nef_info;
+    kp_model_nef_descriptor_t nef_desc;
+    bool keep[_devices_grp->num_device];
+    int num_load_device = 0;
+
+    _nef_crc_package crc_pack = {(char *)nef_buf, nef_size, KP_SUCCESS};
+    pthread_t crc_thd;
+    bool crc_thd_created = false;
 
     int ret = check_fw_is_loaded(devices);
 
     if (KP_SUCCESS != ret)
         return ret;
 
-    ret = reboot_if_model_is_loaded(devices);
-
-    if (KP_SUCCESS != ret)
-        return ret;
+    memset(&nef_desc, 0, sizeof(kp_model_nef_descriptor_t));
 
-    ret = load_model_info_from_nef(nef_buf, nef_size, _devices_grp->product_id, &metadata, &nef_info, &(_devices_grp->loaded_model_desc));
+    if (true == crc_checked)
+        ret = load_model_info_from_nef(nef_buf, nef_size, _devices_grp->product_id, &metadata, &nef_info, &nef_desc);
+    else
+        ret = load_model_info_from_nef_without_crc(nef_buf, nef_size, _devices_grp->product_id, &metadata, &nef_info, &nef_desc);
 
-    if (KP_SUCCESS != ret)
+    if (KP_SUCCESS != ret) {
+        deconstruct_model_nef_descriptor(&nef_desc);
         return ret;
+    }
 
     // The input model is an encrypted model
     if ((metadata.kn_num != 0 && metadata.enc_type != 0) &&
-        (_devices_grp->num_device > 1 || _devices_grp->ll_device[0]->dev_descp.kn_number != metadata.kn_num))
-         return KP_ERROR_INVALID_MODEL_21;
+        (_devices_grp->num_device > 1 || _devices_grp->ll_device[0]->dev_descp.kn_number != metadata.kn_num)) {
+        deconstruct_model_nef_descriptor(&nef_desc);
+        return KP_ERROR_INVALID_MODEL_21;
+    }
+
+    if (false == crc_checked) {
+        // reading the whole NEF for CRC also brings it in from disk ahead of the upload
+        crc_thd_created = (0 == pthread_create(&crc_thd, NULL, _check_nef_crc, (void *)&crc_pack));
+
+        if (false == crc_thd_created)
+            _check_nef_crc((void *)&crc_pack);
+
+        if ((false == crc_thd_created) && (KP_SUCCESS != crc_pack.sts)) {
+            deconstruct_model_nef_descriptor(&nef_desc);
+            return crc_pack.sts;
+        }
+    }
+
+    // devices holding the same models are neither rebooted nor loaded again
+    ret = reboot_if_model_is_loaded(devices, &nef_desc, keep);
+
+    if (KP_SUCCESS != ret) {
+        if (true == crc_thd_created)
+            pthread_join(crc_thd, NULL);
+
+        deconstruct_model_nef_descriptor(&nef_desc);
+        return ret;
+    }
+
+    reset_device_models(_devices_grp);
+    deconstruct_model_nef_descriptor(&_devices_grp->loaded_model_desc);
+    memcpy(&_devices_grp->loaded_model_desc, &nef_desc, sizeof(kp_model_nef_descriptor_t));
 
     if (KP_DEVICE_KL630 == devices->product_id) {
         kdp2_ipc_cmd_load_nef_t *cmd_buf = (kdp2_ipc_cmd_load_nef_t *)malloc(sizeof(kdp2_ipc_cmd_load_nef_t));
+        if (NULL == cmd_buf) {
+            ret = KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+            goto FUNC_OUT;
+        }
 
         cmd_buf->magic_type = KDP2_MAGIC_TYPE_COMMAND;
         cmd_buf->total_size = sizeof(kdp2_ipc_cmd_load_nef_t);
         cmd_buf->command_id = KDP2_COMMAND_LOAD_NEF;
         cmd_buf->nef_size = nef_size;
 
-        _load_nef_command_package cmd_packs[MAX_GROUP_DEVICE];
-        pthread_t load_nef_thd[MAX_GROUP_DEVICE];
-
-        cmd_packs[0].ll_device = _devices_grp->ll_device[0];
-        cmd_packs[0].cmd_buf = cmd_buf;
-        cmd_packs[0].nef_buf = nef_buf;
-        cmd_packs[0].timeout = _devices_grp->timeout;
+        _load_nef_command_package cmd_packs[_devices_grp->num_device];
+        pthread_t load_nef_thd[_devices_grp->num_device];
 
-        for (int i = 1; i < _devices_grp->num_device; i++)
+        for (int i = 0; i < _devices_grp->num_device; i++)
         {
-            memcpy((void *)&cmd_packs[i], (void *)&cmd_packs[0], sizeof(_load_nef_command_package));
-            cmd_packs[i].ll_device = _devices_grp->ll_device[i];
+            if (keep[i])
+                continue;
+
+            cmd_packs[num_load_device].ll_device = _devices_grp->ll_device[i];
+            cmd_packs[num_load_device].cmd_buf = cmd_buf;
+            cmd_packs[num_load_device].nef_buf = nef_buf;
+            cmd_packs[num_load_device].timeout = _devices_grp->timeout;
+            num_load_device++;
         }
 
-        ret = _spawn_thread_to_load_nef_to_devices(_devices_grp->num_device, cmd_packs, load_nef_thd);
-        free(cmd_buf);
+        if (0 < num_load_device)
+            ret = _spawn_thread_to_load_nef_to_devices(num_load_device, cmd_packs, load_nef_thd);
 
-        if (ret != KP_SUCCESS)
-            return ret;
+        free(cmd_buf);
     } else {
         uint32_t transfer_size = sizeof(kdp2_ipc_cmd_load_model_t) + nef_info.fw_info_size;
         kdp2_ipc_cmd_load_model_t *cmd_buf = (kdp2_ipc_cmd_load_model_t *)malloc(transfer_size);
-        if (NULL == cmd_buf)
-            return KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+        if (NULL == cmd_buf) {
+            ret = KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+            goto FUNC_OUT;
+        }
 
         cmd_buf->magic_type = KDP2_MAGIC_TYPE_COMMAND;
         cmd_buf->total_size = transfer_size;
@@ -1271,35 +1873,69 @@ int kp_load_model(kp_device_group_t devices, void *nef_buf, int nef_size, kp_mod
         cmd_buf->fw_info_size = nef_info.fw_info_size;
         memcpy(cmd_buf->fw_info, nef_info.fw_info_addr, nef_info.fw_info_size);
 
-        _load_model_command_package cmd_packs[MAX_GROUP_DEVICE];
-        pthread_t load_model_thd[MAX_GROUP_DEVICE];
+        _load_model_command_package cmd_packs[_devices_grp->num_device];
+        pthread_t load_model_thd[_devices_grp->num_device];
 
-        cmd_packs[0].ll_device = _devices_grp->ll_device[0];
-        cmd_packs[0].cmd_buf = cmd_buf;
-        cmd_packs[0].model_buf = nef_info.all_models_addr;
-        cmd_packs[0].timeout = _devices_grp->timeout;
-
-        for (int i = 1; i < _devices_grp->num_device; i++)
+        for (int i = 0; i < _devices_grp->num_device; i++)
         {
-            memcpy((void *)&cmd_packs[i], (void *)&cmd_packs[0], sizeof(_load_model_command_package));
-            cmd_packs[i].ll_device = _devices_grp->ll_device[i];
+            if (keep[i])
+                continue;
+
+            cmd_packs[num_load_device].ll_device = _devices_grp->ll_device[i];
+            cmd_packs[num_load_device].cmd_buf = cmd_buf;
+            cmd_packs[num_load_device].model_buf = nef_info.all_models_addr;
+            cmd_packs[num_load_device].timeout = _devices_grp->timeout;
+            num_load_device++;
         }
 
-        ret = _spawn_thread_to_load_model_to_devices(_devices_grp->num_device, cmd_packs, load_model_thd);
+        if (0 < num_load_device)
+            ret = _spawn_thread_to_load_model_to_devices(num_load_device, cmd_packs, load_model_thd);
+
         free(cmd_buf);
+    }
+
+FUNC_OUT:
+    if (true == crc_thd_created)
+        pthread_join(crc_thd, NULL);
+
+    if (KP_SUCCESS != crc_pack.sts) {
+        dbg_print("[%s] NEF CRC mismatch, %d devices have got the models uploaded\n", __func__, num_load_device);
+
+        // with the group descriptor set, all devices are rebooted to drop the uploaded models
+        if (0 < num_load_device)
+            reboot_if_model_is_loaded(devices, NULL, NULL);
+
+        deconstruct_model_nef_descriptor(&_devices_grp->loaded_model_desc);
+
+        return crc_pack.sts;
+    }
+
+    if (ret != KP_SUCCESS)
+        return ret;
+
+    dbg_print("[%s] models are loaded to %d devices, %d devices hold them already\n", __func__, num_load_device, _devices_grp->num_device - num_load_device);
+
+    // the caller shares the group descriptor
+    if (model_desc != NULL) {
+        ret = share_model_nef_descriptor(&_devices_grp->loaded_model_desc, model_desc);
 
         if (ret != KP_SUCCESS)
             return ret;
     }
 
-    if (ret == KP_SUCCESS && model_desc != NULL)
-        ret = load_model_info_from_nef(nef_buf, nef_size, _devices_grp->product_id, &metadata, &nef_info, model_desc);
+    ret = _kp_allocate_ddr_memory(devices, keep);
 
-    ret = _kp_allocate_ddr_memory(devices);
+    if (KP_SUCCESS == ret && NULL != _devices_grp->hotplug)
+        hotplug_keep_model(_devices_grp, nef_buf, nef_size);
 
     return ret;
 }
 
+int kp_load_model(kp_device_group_t devices, void *nef_buf, int nef_size, kp_model_nef_descriptor_t *model_desc)
+{
+    return _kp_load_model(devices, nef_buf, nef_size, true, model_desc);
+}
+
 static char *read_file_to_buffer_auto_malloc(const char *file_path, long *buffer_size)
 {
     FILE *file = fopen(file_path, "rb");
@@ -1339,16 +1975,188 @@ static char *read_file_to_buffer_auto_malloc(const char *file_path, long *buffer
     return buffer;
 }
 
+// read-only mapping of a file, pages are read from disk when they are touched and can be dropped again under memory pressure
+char *map_file_to_buffer(const char *file_path, long *buffer_size)
+{
+#ifdef _WIN32
+    return read_file_to_buffer_auto_malloc(file_path, buffer_size);
+#else
+    int fd = open(file_path, O_RDONLY);
+    if (0 > fd)
+    {
+        dbg_print("%s(): open failed, file:%s, %s\n", __FUNCTION__, file_path, strerror(errno));
+        return NULL;
+    }
+
+    struct stat file_stat;
+    char *buffer = NULL;
+
+    if ((0 == fstat(fd, &file_stat)) && (0 < file_stat.st_size) && (INT32_MAX >= file_stat.st_size))
+    {
+        buffer = (char *)mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (MAP_FAILED == buffer)
+        {
+            dbg_print("%s(): mmap failed, file:%s, %s\n", __FUNCTION__, file_path, strerror(errno));
+            buffer = NULL;
+        }
+        else
+        {
+            // start reading ahead, data is consumed from beginning to end
+            madvise(buffer, file_stat.st_size, MADV_SEQUENTIAL);
+            madvise(buffer, file_stat.st_size, MADV_WILLNEED);
+            *buffer_size = (long)file_stat.st_size;
+        }
+    }
+
+    close(fd);
+
+    return buffer;
+#endif
+}
+
+void unmap_file_buffer(char *buffer, long buffer_size)
+{
+#ifdef _WIN32
+    free(buffer);
+#else
+    munmap(buffer, buffer_size);
+#endif
+}
+
 int kp_load_model_from_file(kp_device_group_t devices, const char *file_path, kp_model_nef_descriptor_t *model_desc)
 {
     long nef_size;
-    char *nef_buf = read_file_to_buffer_auto_malloc(file_path, &nef_size);
+    char *nef_buf = map_file_to_buffer(file_path, &nef_size);
+    if (!nef_buf)
+        return KP_ERROR_FILE_OPEN_FAILED_20;
+
+    int ret = _kp_load_model(devices, (void *)nef_buf, (int)nef_size, false, model_desc);
+
+    unmap_file_buffer(nef_buf, nef_size);
+
+    return ret;
+}
+
+// a group of some devices of another group, models are loaded through it while the other devices keep theirs
+static _kp_devices_group_t *create_sub_group(_kp_devices_group_t *_devices_grp, int num_dev, int dev_idx[])
+{
+    _kp_devices_group_t *_sub_grp = (_kp_devices_group_t *)calloc(1, sizeof(_kp_devices_group_t));
+
+    if (NULL == _sub_grp)
+        return NULL;
+
+    if (KP_SUCCESS != alloc_group_slots(_sub_grp, num_dev)) {
+        free(_sub_grp);
+        return NULL;
+    }
+
+    pthread_mutex_init(&_sub_grp->io_buf_mutex, NULL);
+    pthread_mutex_init(&_sub_grp->recv_mutex, NULL);
+    pthread_mutex_init(&_sub_grp->slot_mutex, NULL);
+
+    for (int i = 0; i < num_dev; i++) {
+        _sub_grp->ll_device[i] = _devices_grp->ll_device[dev_idx[i]];
+        _sub_grp->dev_active[i] = true;
+    }
+
+    _sub_grp->num_device = num_dev;
+    _sub_grp->timeout = _devices_grp->timeout;
+    _sub_grp->product_id = _devices_grp->product_id;
+
+    return _sub_grp;
+}
+
+static int _kp_load_model_to_devices(kp_device_group_t devices, int num_devices, int device_port_ids[], void *nef_buf, int nef_size, bool crc_checked, kp_model_nef_descriptor_t *model_desc)
+{
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+
+    if ((NULL == device_port_ids) || (1 > num_devices) || (_devices_grp->num_device < num_devices))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    int dev_idx[num_devices];
+    int ret = KP_SUCCESS;
+
+    // rebooted devices are reconnected here, not by hotplug
+    hotplug_pause(_devices_grp);
+
+    for (int i = 0; (i < num_devices) && (KP_SUCCESS == ret); i++) {
+        dev_idx[i] = -1;
+
+        for (int j = 0; (j < _devices_grp->num_device) && (0 > dev_idx[i]); j++) {
+            if (_devices_grp->dev_active[j] && ((uint32_t)device_port_ids[i] == _devices_grp->ll_device[j]->dev_descp.port_id))
+                dev_idx[i] = j;
+        }
+
+        if (0 > dev_idx[i])
+            ret = KP_ERROR_DEVICE_NOT_EXIST_10;
+
+        for (int k = 0; (k < i) && (KP_SUCCESS == ret); k++) {
+            if (dev_idx[k] == dev_idx[i])
+                ret = KP_ERROR_INVALID_PARAM_12;
+        }
+    }
+
+    _kp_devices_group_t *_sub_grp = NULL;
+
+    if ((KP_SUCCESS == ret) && (NULL == (_sub_grp = create_sub_group(_devices_grp, num_devices, dev_idx))))
+        ret = KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+
+    if (KP_SUCCESS != ret) {
+        hotplug_resume(_devices_grp);
+        return ret;
+    }
+
+    ret = _kp_load_model((kp_device_group_t)_sub_grp, nef_buf, nef_size, crc_checked, model_desc);
+
+    for (int i = 0; i < num_devices; i++) {
+        _kp_device_model_t *dev_model = &_devices_grp->dev_model[dev_idx[i]];
+
+        // devices rebooted for the models are reconnected as new ones
+        pthread_mutex_lock(&_devices_grp->send_mutex[dev_idx[i]]);
+        _devices_grp->ll_device[dev_idx[i]] = _sub_grp->ll_device[i];
+        pthread_mutex_unlock(&_devices_grp->send_mutex[dev_idx[i]]);
+
+        deconstruct_model_nef_descriptor(&dev_model->model_desc);
+        dev_model->loaded = true;
+
+        if (KP_SUCCESS == ret) {
+            share_model_nef_descriptor(&_sub_grp->loaded_model_desc, &dev_model->model_desc);
+            dev_model->ddr_attr = _sub_grp->ddr_attr;
+        }
+    }
+
+    _devices_grp->model_affinity = true;
+
+    // the devices stay in the group, the sub group is released without closing them
+    _sub_grp->num_device = 0;
+    kp_disconnect_devices((kp_device_group_t)_sub_grp);
+
+    hotplug_resume(_devices_grp);
+
+    if (NULL != _devices_grp->hotplug)
+        hotplug_keep_device_model(_devices_grp, dev_idx, num_devices, (KP_SUCCESS == ret) ? nef_buf : NULL, nef_size);
+
+    dbg_print("[%s] models are loaded to %d devices, error %d\n", __func__, num_devices, ret);
+
+    return ret;
+}
+
+int kp_load_model_to_devices(kp_device_group_t devices, int num_devices, int device_port_ids[], void *nef_buf, int nef_size, kp_model_nef_descriptor_t *model_desc)
+{
+    return _kp_load_model_to_devices(devices, num_devices, device_port_ids, nef_buf, nef_size, true, model_desc);
+}
+
+int kp_load_model_to_devices_from_file(kp_device_group_t devices, int num_devices, int device_port_ids[], const char *file_path, kp_model_nef_descriptor_t *model_desc)
+{
+    long nef_size;
+    char *nef_buf = map_file_to_buffer(file_path, &nef_size);
     if (!nef_buf)
         return KP_ERROR_FILE_OPEN_FAILED_20;
 
-    int ret = kp_load_model(devices, (void *)nef_buf, (int)nef_size, model_desc);
+    int ret = _kp_load_model_to_devices(devices, num_devices, device_port_ids, (void *)nef_buf, (int)nef_size, false, model_desc);
 
-    free(nef_buf);
+    unmap_file_buffer(nef_buf, nef_size);
 
     return ret;
 }
@@ -1360,21 +2168,22 @@ int kp_load_encrypted_models(kp_device_group_t devices, void *nef_buf[], int nef
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
     kdp2_ipc_cmd_load_model_t *cmd_buf = NULL;
 
-    // At most 20 devices and 20 models are supported
     // Number of encrypted models should be the same as number of devices in the device group (Can change the rule ?)
     if (nef_num <= 0 || nef_num > MAX_GROUP_DEVICE || nef_num != _devices_grp->num_device)
         return KP_ERROR_INVALID_PARAM_12;
 
-    kp_metadata_t metadata[MAX_GROUP_DEVICE];
-    kp_nef_info_t nef_info[MAX_GROUP_DEVICE];
-    kp_model_nef_descriptor_t temp_model_desc[MAX_GROUP_DEVICE];
+    kp_metadata_t metadata[nef_num];
+    kp_nef_info_t nef_info[nef_num];
+    kp_model_nef_descriptor_t temp_model_desc[nef_num];
+    _load_model_command_package cmd_packs[nef_num];
+    pthread_t load_model_thd[nef_num];
 
     int ret = check_fw_is_loaded(devices);
 
     if (KP_SUCCESS != ret)
         return ret;
 
-    ret = reboot_if_model_is_loaded(devices);
+    ret = reboot_if_model_is_loaded(devices, NULL, NULL);
 
     if (KP_SUCCESS != ret)
         return ret;
@@ -1407,9 +2216,6 @@ int kp_load_encrypted_models(kp_device_group_t devices, void *nef_buf[], int nef
     cmd_buf->fw_info_size = nef_info[0].fw_info_size;
     memcpy(cmd_buf->fw_info, nef_info[0].fw_info_addr, nef_info[0].fw_info_size);
 
-    _load_model_command_package cmd_packs[MAX_GROUP_DEVICE];
-    pthread_t load_model_thd[MAX_GROUP_DEVICE];
-
     // Find the target device of the encrypted model through KN number
     // FIXME: search could be faster
     int match_count = 0;
@@ -1437,6 +2243,8 @@ int kp_load_encrypted_models(kp_device_group_t devices, void *nef_buf[], int nef
 
     _spawn_thread_to_load_model_to_devices(_devices_grp->num_device, cmd_packs, load_model_thd);
 
+    reset_device_models(_devices_grp);
+
     if (ret == KP_SUCCESS) {
         ret = load_model_info_from_nef(nef_buf[0], nef_size, _devices_grp->product_id, &metadata[0], &nef_info[0], &_devices_grp->loaded_model_desc);
         if (ret != KP_SUCCESS) {
@@ -1444,14 +2252,14 @@ int kp_load_encrypted_models(kp_device_group_t devices, void *nef_buf[], int nef
         }
 
         if (model_desc != NULL) {
-            ret = load_model_info_from_nef(nef_buf[0], nef_size, _devices_grp->product_id, &metadata[0], &nef_info[0], model_desc);
+            ret = share_model_nef_descriptor(&_devices_grp->loaded_model_desc, model_desc);
             if (ret != KP_SUCCESS) {
                 goto FUNC_OUT;
             }
         }
     }
 
-    ret = _kp_allocate_ddr_memory(devices);
+    ret = _kp_allocate_ddr_memory(devices, NULL);
 
 FUNC_OUT:
     if (NULL != cmd_buf) {
@@ -1471,7 +2279,10 @@ FUNC_OUT:
 
 int kp_load_encrypted_models_from_file(kp_device_group_t devices, char *file_path[], int nef_num, kp_model_nef_descriptor_t *model_desc)
 {
-    void *nef_buf[MAX_GROUP_DEVICE];
+    if (nef_num <= 0 || nef_num > MAX_GROUP_DEVICE)
+        return KP_ERROR_INVALID_PARAM_12;
+
+    void *nef_buf[nef_num];
 
     long nef_size_prev = 0;
     long nef_size = 0;
@@ -1913,60 +2724,6 @@ int _load_firmware_to_630(kp_device_group_t devices, void *scpu_fw_buf, int scpu
 // Note: below code is original from host_lib 'kl720_usb_dfw' with some modifications
 // FIXME: better efficiency
 
-#define CRC16_CONSTANT 0x8005
-static uint16_t gen_crc16(uint8_t *data, uint16_t size)
-{
-    uint16_t out = 0;
-    int bits_read = 0, bit_flag, i;
-
-    /* Sanity check: */
-    if (data == NULL)
-        return 0;
-
-    while (size > 0)
-    {
-        bit_flag = out >> 15;
-
-        /* Get next bit: */
-        out <<= 1;
-        out |= (*data >> bits_read) & 1; // item a) work from the least significant bits
-
-        /* Increment bit counter: */
-        bits_read++;
-        if (bits_read > 7)
-        {
-            bits_read = 0;
-            data++;
-            size--;
-        }
-
-        /* Cycle check: */
-        if (bit_flag)
-            out ^= CRC16_CONSTANT;
-    }
-
-    // push out the last 16 bits
-    for (i = 0; i < 16; ++i)
-    {
-        bit_flag = out >> 15;
-        out <<= 1;
-        if (bit_flag)
-            out ^= CRC16_CONSTANT;
-    }
-
-    // reverse the bits
-    uint16_t crc = 0;
-    i = 0x8000;
-    int j = 0x0001;
-    for (; i != 0; i >>= 1, j <<= 1)
-    {
-        if (i & out)
-            crc |= j;
-    }
-
-    return crc;
-}
-
 typedef struct
 {
     uint16_t header;
@@ -2018,7 +2775,8 @@ static int _720_send_data_to_usb_minion(kp_usb_device_t *usb_dev, uintptr_t p_bu
         msghdr.addr = mem_addr + (repeat * MSG_DATA_BUF_MAX);
         msghdr.len = len;
         memcpy(&fw_buf[0], &msghdr, MSG_HDR_SIZE);
-        msghdr.crc16 = gen_crc16(&fw_buf[4], (len + MSG_HDR_SIZE - 4));
+        // the size has always been cut to 16 bits, keep sending the USB boot loader the same header CRC
+        msghdr.crc16 = crc16_cal(&fw_buf[4], (uint16_t)(len + MSG_HDR_SIZE - 4));
         memcpy(&fw_buf[2], &msghdr.crc16, 2);
 
         unsigned char *fw_buf_addr = &fw_buf[0];
@@ -2093,7 +2851,7 @@ int _load_firmware_to_720(kp_device_group_t devices, void *scpu_fw_buf, int scpu
         msghdr->cmd = CMD_SCPU_RUN;
         msghdr->len = 0;
         msghdr->addr = KL720_SCPU_START_ADDR;
-        msghdr->crc16 = gen_crc16((uint8_t *)(msg_tbuf + 4), MSG_HDR_SIZE - 4);
+        msghdr->crc16 = crc16_cal((uint8_t *)(msg_tbuf + 4), MSG_HDR_SIZE - 4);
 
         // printf("send scpu_run command to boot from 0x%x\n", msghdr->addr);
 
@@ -2145,6 +2903,9 @@ int kp_load_firmware(kp_device_group_t devices, void *scpu_fw_buf, int scpu_fw_s
     int status = KP_SUCCESS;
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
 
+    // devices rebooted into the firmware are reconnected here, not by hotplug
+    hotplug_pause(_devices_grp);
+
     if (_devices_grp->product_id == KP_DEVICE_KL520)
         status = _load_firmware_to_520(devices, scpu_fw_buf, scpu_fw_size, ncpu_fw_buf, ncpu_fw_size);
     else if (_devices_grp->product_id == KP_DEVICE_KL720)
@@ -2213,6 +2974,11 @@ int kp_load_firmware(kp_device_group_t devices, void *scpu_fw_buf, int scpu_fw_s
 
 FUNC_OUT:
 
+    hotplug_resume(_devices_grp);
+
+    if (KP_SUCCESS == status && NULL != _devices_grp->hotplug)
+        hotplug_keep_firmware(_devices_grp, scpu_fw_buf, scpu_fw_size, ncpu_fw_buf, ncpu_fw_size);
+
     return status;
 }
 
@@ -2256,7 +3022,8 @@ int kp_load_firmware_from_file(kp_device_group_t devices, const char *scpu_fw_pa
 // image_size : image buffer size in 10-KB, value 1~8192 (10KB~80MB)
 // result_count : number of result buffers, value 1~8
 // result_size : result buffer size in 10-KB, value 1~8192 (10KB~80MB)
-static int _kp_set_up_inference_queues(kp_device_group_t devices, uint32_t image_count, uint32_t image_size, uint32_t result_count, uint32_t result_size)
+// skip : devices left as they are, can be NULL
+static int _kp_set_up_inference_queues(kp_device_group_t devices, uint32_t image_count, uint32_t image_size, uint32_t result_count, uint32_t result_size, bool skip[])
 {
 #define MAX_BUF_COUNT 8
 #define MAX_BUF_SIZE 8192 // 10-KB unit
@@ -2285,17 +3052,40 @@ static int _kp_set_up_inference_queues(kp_device_group_t devices, uint32_t image
     {
         kp_usb_device_t *ll_dev = _devices_grp->ll_device[i];
 
-        ret = kp_usb_control(ll_dev, &kctrl, timeout);
-        if (ret != KP_USB_RET_OK)
+        if ((NULL != skip) && (true == skip[i]))
+            continue;
+
+        int sts = kp_usb_control(ll_dev, &kctrl, timeout);
+        if (sts != KP_USB_RET_OK)
         {
             // this could happen if FW has already complete the set-up
-            dbg_print("[%s] set up inference queue failed return code = [%d]\n", __func__, ret);
+            dbg_print("[%s] set up inference queue failed return code = [%d]\n", __func__, sts);
+            ret = sts;
         }
     }
 
     return ret;
 }
 
+typedef struct
+{
+    kp_usb_device_t *ll_device;
+    int timeout;
+    int sts;
+} _reset_inference_package;
+
+static void *_reset_inference_of_single_device(void *data)
+{
+    _reset_inference_package *pack = (_reset_inference_package *)data;
+    kp_usb_control_t kctrl = {KDP2_CONTROL_FIFOQ_RESET, 0, 0};
+
+    kp_usb_flush_out_buffers(pack->ll_device);
+
+    pack->sts = kp_usb_control(pack->ll_device, &kctrl, pack->timeout);
+
+    return NULL;
+}
+
 int kp_reset_device(kp_device_group_t devices, kp_reset_mode_t reset_mode)
 {
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
@@ -2327,9 +3117,12 @@ int kp_reset_device(kp_device_group_t devices, kp_reset_mode_t reset_mode)
     }
     else if (reset_mode == KP_RESET_INFERENCE)
     {
-        kctrl.command = KDP2_CONTROL_FIFOQ_RESET;
-        kctrl.arg1 = 0;
-        kctrl.arg2 = 0;
+        _reset_inference_package reset_packs[_devices_grp->num_device];
+        int num_reset = 0;
+
+        // results of inferences in flight are dropped with FIFO queue
+        for (int i = 0; i < _devices_grp->num_device; i++)
+            clear_in_flight(_devices_grp, i);
 
         for (int i = 0; i < _devices_grp->num_device; i++)
         {
@@ -2343,14 +3136,22 @@ int kp_reset_device(kp_device_group_t devices, kp_reset_mode_t reset_mode)
                 (KP_KDP2_FW_USB_TYPE == fw_type_legacy) ||
                 (KP_KDP2_FW_FLASH_TYPE == fw_type_legacy))
             {
-                kp_usb_flush_out_buffers(ll_dev);
+                reset_packs[num_reset].ll_device = ll_dev;
+                reset_packs[num_reset].timeout = timeout;
+                reset_packs[num_reset].sts = KP_USB_RET_OK;
+                num_reset++;
+            }
+        }
 
-                int ret = kp_usb_control(ll_dev, &kctrl, timeout);
-                if (ret != KP_USB_RET_OK)
-                {
-                    dbg_print("[%s] Send usb control endpoint failed. libusb_control_transfer() return code = [%d]\n", __func__, ret);
-                    return ret;
-                }
+        // devices are drained and reset at the same time
+        _run_on_devices_in_parallel(num_reset, _reset_inference_of_single_device, reset_packs, sizeof(_reset_inference_package));
+
+        for (int i = 0; i < num_reset; i++)
+        {
+            if (reset_packs[i].sts != KP_USB_RET_OK)
+            {
+                dbg_print("[%s] Send usb control endpoint failed. libusb_control_transfer() return code = [%d]\n", __func__, reset_packs[i].sts);
+                return reset_packs[i].sts;
             }
         }
     }
@@ -2409,7 +3210,6 @@ int kp_reset_device(kp_device_group_t devices, kp_reset_mode_t reset_mode)
     return KP_SUCCESS;
 }
 
-static pthread_t print_log_thd[MAX_GROUP_DEVICE] = {0};
 static bool stop_print_log = false;
 
 typedef struct
@@ -2498,7 +3298,7 @@ int kp_enable_firmware_log(kp_device_group_t devices, int dev_port_id, char *log
     log_context->ll_dev = _devices_grp->ll_device[scan_index];
     log_context->file = file;
 
-    pthread_create(&print_log_thd[scan_index], NULL, _print_log_function_per_dev, log_context);
+    pthread_create(&_devices_grp->log_thread[scan_index], NULL, _print_log_function_per_dev, log_context);
 
     return KP_SUCCESS;
 }
@@ -2511,8 +3311,11 @@ int kp_disable_firmware_log(kp_device_group_t devices)
 
     for (int i = 0; i < _devices_grp->num_device; i++)
     {
-        if (print_log_thd[i])
-            pthread_join(print_log_thd[i], NULL);
+        if (_devices_grp->log_thread[i])
+        {
+            pthread_join(_devices_grp->log_thread[i], NULL);
+            _devices_grp->log_thread[i] = 0;
+        }
     }
 
     return KP_SUCCESS;
@@ -2692,7 +3495,7 @@ int kp_load_model_from_flash(kp_device_group_t devices, kp_model_nef_descriptor_
     if (KP_SUCCESS != ret)
         return ret;
 
-    ret = reboot_if_model_is_loaded(devices);
+    ret = reboot_if_model_is_loaded(devices, NULL, NULL);
 
     if (KP_SUCCESS != ret)
         return ret;
@@ -2709,8 +3512,8 @@ int kp_load_model_from_flash(kp_device_group_t devices, kp_model_nef_descriptor_
     cmd_buf.command_id = KDP2_COMMAND_LOAD_MODEL_FROM_FLASH;
     cmd_buf.total_size = sizeof(kdp2_ipc_cmd_load_model_from_flash_t);
 
-    _load_model_from_flash_command_package cmd_packs[MAX_GROUP_DEVICE];
-    pthread_t update_fw_thd[MAX_GROUP_DEVICE];
+    _load_model_from_flash_command_package cmd_packs[_devices_grp->num_device];
+    pthread_t update_fw_thd[_devices_grp->num_device];
 
     cmd_packs[0].dev_idx = 0;
     cmd_packs[0].ll_device = ll_dev[0];
@@ -2792,15 +3595,20 @@ int kp_load_model_from_flash(kp_device_group_t devices, kp_model_nef_descriptor_
         }
     }
 
+    reset_device_models(_devices_grp);
+
     if (KP_SUCCESS == ret) {
         ret = kp_get_model_info(devices, ll_dev[0]->dev_descp.port_id, &_devices_grp->loaded_model_desc);
 
         if ((NULL != model_desc) && (KP_SUCCESS == ret)) {
-            ret = kp_get_model_info(devices, ll_dev[0]->dev_descp.port_id, model_desc);
+            ret = share_model_nef_descriptor(&_devices_grp->loaded_model_desc, model_desc);
         }
     }
 
-    ret = _kp_allocate_ddr_memory(devices);
+    ret = _kp_allocate_ddr_memory(devices, NULL);
+
+    if (KP_SUCCESS == ret && NULL != _devices_grp->hotplug)
+        hotplug_keep_model(_devices_grp, NULL, 0);
 
 FUNC_OUT:
     if (KP_SUCCESS != kp_release_model_nef_descriptor(&temp_model_desc)) {
@@ -2957,6 +3765,22 @@ FUNC_OUT:
     return Ret;
 }
 
+int kp_enable_simulated_devices(kp_sim_device_config_t *config)
+{
+    if (NULL == config)
+        return KP_ERROR_INVALID_PARAM_12;
+
+    return kp_usb_sim_configure(config, kl720_fw_version);
+}
+
+int kp_set_simulated_device_plugged(int index, bool plugged)
+{
+    if (KP_USB_RET_OK != kp_usb_sim_set_plugged(index, plugged))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    return KP_SUCCESS;
+}
+
 int kp_store_ddr_manage_attr(kp_device_group_t devices, kp_ddr_manage_attr_t ddr_attr)
 {
     memcpy(&devices->ddr_attr, &ddr_attr, sizeof(kp_ddr_manage_attr_t));
@@ -91,6 +91,13 @@ static err_str_map _errmap[] = {
     {KP_ERROR_IMAGE_INVALID_HEIGHT_45, "Image height is not compliant with the image format requirement"},
     {KP_ERROR_ADJUST_DDR_HEAP_FAILED_46, "Adjust boundary between model and DDR heap failed"},
     {KP_ERROR_DEVICE_NOT_ACCESSIBLE_47, "Device is not accessible"},
+    {KP_ERROR_ASYNC_INFERENCE_ENABLED_48, "Not allowed when asynchronous inference is started"},
+    {KP_ERROR_ASYNC_INFERENCE_NOT_ENABLED_49, "Asynchronous inference is not started"},
+    {KP_ERROR_POLL_TIMEOUT_50, "No inference result in the poll timeout"},
+    {KP_ERROR_HOTPLUG_NOT_SUPPORTED_51, "USB hotplug events are not supported on this platform"},
+    {KP_ERROR_FLASH_VERIFY_FAILED_52, "Data read back from device flash does not match the written data"},
+    {KP_ERROR_BUFFER_TOO_SMALL_53, "User buffer is too small for the output"},
+    {KP_ERROR_NOT_ALLOWED_IN_CALLBACK_54, "Not allowed in the callback of asynchronous inference"},
     {KP_ERROR_OTHER_99, "Other/unknown errors !"},
     {KP_FW_ERROR_UNKNOWN_APP, "Device cannot handle the specified APP (or JOB ID)"},
     {KP_FW_INFERENCE_ERROR_101, "Device inference failed"},
@@ -105,6 +112,8 @@ static err_str_map _errmap[] = {
     {KP_FW_WRONG_INPUT_BUFFER_COUNT_110, "The number of input data device received is different from model request"},
     {KP_FW_INVALID_PRE_PROC_MODEL_INPUT_SIZE_111, "Device hardware preprocess cannot handle the specified model input size"},
     {KP_FW_INVALID_INPUT_CROP_PARAM_112, "The crop area can not exceed the boundary of input image"},
+    {KP_FW_ERROR_FLASH_WRITE_FAILED_124, "Device failed to erase or program flash"},
+    {KP_FW_ERROR_FLASH_READ_FAILED_125, "Device failed to read flash or the flash region is invalid"},
     {KP_FW_NCPU_INVALID_IMAGE_201, "NPU cannot handle this image data under current pre-process setting (e.g. Padding > 127)"},
     {KP_FW_EFUSE_CAN_NOT_BURN_300, "Device cannot burn eFuse"},
     {KP_FW_EFUSE_PROTECTED_301, "Device eFuse protected"},
@@ -0,0 +1,733 @@
+/**
+ * @file        kp_hotplug.c
+ * @brief       hotplug-aware device groups, devices join and leave a connected group at runtime
+ * @version     0.1
+ * @date        2026-10-18
+ *
+ * @copyright   Copyright (c) 2021 Kneron Inc. All rights reserved.
+ */
+
+// #define DEBUG_PRINT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
+
+#include <pthread.h>
+
+#include "kp_usb.h"
+#include "kp_usb_sim.h"
+#include "kp_internal.h"
+
+#include "kp_core.h"
+
+#include "kdp2_ipc_cmd.h"
+
+#ifdef DEBUG_PRINT
+#define dbg_print(format, ...)  { printf(format, ##__VA_ARGS__); fflush(stdout); }
+#else
+#define dbg_print(format, ...)
+#endif
+
+#define HOTPLUG_RETRY_INTERVAL_MS 1000 // worker retries jobs waiting for a device in this interval
+
+static void job_list_append(_kp_hotplug_job_t **head, _kp_hotplug_job_t **tail, _kp_hotplug_job_t *job)
+{
+    job->next = NULL;
+
+    if (NULL == *tail)
+        *head = job;
+    else
+        (*tail)->next = job;
+
+    *tail = job;
+}
+
+static bool job_list_remove(_kp_hotplug_job_t **head, _kp_hotplug_job_t **tail, _kp_hotplug_job_t *job)
+{
+    _kp_hotplug_job_t *prev = NULL;
+
+    for (_kp_hotplug_job_t *cur = *head; NULL != cur; prev = cur, cur = cur->next) {
+        if (cur != job)
+            continue;
+
+        if (NULL == prev)
+            *head = cur->next;
+        else
+            prev->next = cur->next;
+
+        if (*tail == cur)
+            *tail = prev;
+
+        return true;
+    }
+
+    return false;
+}
+
+static void free_job_list(_kp_hotplug_job_t *job)
+{
+    while (NULL != job) {
+        _kp_hotplug_job_t *next = job->next;
+        free(job);
+        job = next;
+    }
+}
+
+bool hotplug_record_job(_kp_devices_group_t *_devices_grp, int dev_idx, uint32_t inference_number, uint32_t model_id, kp_usb_buffer_t usb_buf[], int num_usb_buf, _kp_hotplug_job_t **job)
+{
+    _kp_hotplug_t *hotplug = _devices_grp->hotplug;
+    uint32_t size = 0;
+
+    for (int i = 0; i < num_usb_buf; i++)
+        size += usb_buf[i].len;
+
+    _kp_hotplug_job_t *new_job = (_kp_hotplug_job_t *)malloc(sizeof(_kp_hotplug_job_t) + size);
+
+    if (NULL != new_job) {
+        uint8_t *data = new_job->data;
+
+        new_job->inference_number = inference_number;
+        new_job->model_id = model_id;
+        new_job->num_buf = num_usb_buf;
+
+        for (int i = 0; i < num_usb_buf; i++) {
+            memcpy(data, usb_buf[i].buf, usb_buf[i].len);
+            new_job->buf_len[i] = usb_buf[i].len;
+            data += usb_buf[i].len;
+        }
+    }
+
+    *job = new_job;
+
+    pthread_mutex_lock(&hotplug->job_mutex);
+
+    // the device may be removed since it is acquired, then the job waits for another one
+    bool active = __atomic_load_n(&_devices_grp->dev_active[dev_idx], __ATOMIC_ACQUIRE);
+
+    if (NULL != new_job) {
+        if (active) {
+            new_job->dev_idx = dev_idx;
+            job_list_append(&hotplug->job_head[dev_idx], &hotplug->job_tail[dev_idx], new_job);
+        } else {
+            new_job->dev_idx = -1;
+            job_list_append(&hotplug->orphan_head, &hotplug->orphan_tail, new_job);
+        }
+    }
+
+    pthread_mutex_unlock(&hotplug->job_mutex);
+
+    if (!active && NULL != new_job) {
+        release_device(_devices_grp, dev_idx);
+        *job = NULL; // owned by the orphan list, it may be sent and freed by others from now on
+        return false;
+    }
+
+    return true;
+}
+
+void hotplug_drop_job(_kp_devices_group_t *_devices_grp, _kp_hotplug_job_t *job)
+{
+    _kp_hotplug_t *hotplug = _devices_grp->hotplug;
+    bool found = false;
+
+    if (NULL == job)
+        return;
+
+    pthread_mutex_lock(&hotplug->job_mutex);
+
+    // the job may be moved to the orphan list by retiring its device meanwhile
+    for (int i = 0; i < _devices_grp->capacity && !found; i++)
+        found = job_list_remove(&hotplug->job_head[i], &hotplug->job_tail[i], job);
+
+    if (!found)
+        found = job_list_remove(&hotplug->orphan_head, &hotplug->orphan_tail, job);
+
+    pthread_mutex_unlock(&hotplug->job_mutex);
+
+    if (found)
+        free(job);
+}
+
+void hotplug_job_done(_kp_devices_group_t *_devices_grp, int dev_idx, bool match_number, uint32_t inference_number)
+{
+    _kp_hotplug_t *hotplug = _devices_grp->hotplug;
+    _kp_hotplug_job_t *done_head = NULL;
+
+    pthread_mutex_lock(&hotplug->job_mutex);
+
+    _kp_hotplug_job_t *done = hotplug->job_head[dev_idx];
+
+    if (match_number) {
+        while (NULL != done && done->inference_number != inference_number)
+            done = done->next;
+    }
+
+    // the device works in sending order, jobs before the done one are done too or dropped by the firmware
+    if (NULL != done) {
+        done_head = hotplug->job_head[dev_idx];
+        hotplug->job_head[dev_idx] = done->next;
+
+        if (NULL == done->next)
+            hotplug->job_tail[dev_idx] = NULL;
+
+        done->next = NULL;
+    }
+
+    pthread_mutex_unlock(&hotplug->job_mutex);
+
+    free_job_list(done_head);
+}
+
+static void queue_event(_kp_hotplug_t *hotplug, uint32_t port_id)
+{
+    pthread_mutex_lock(&hotplug->event_mutex);
+
+    bool queued = false;
+
+    for (int i = 0; i < hotplug->num_event && !queued; i++)
+        queued = (hotplug->event_port_id[i] == port_id);
+
+    if (!queued && hotplug->num_event < KP_HOTPLUG_MAX_EVENT)
+        hotplug->event_port_id[hotplug->num_event++] = port_id;
+
+    pthread_cond_signal(&hotplug->event_cond);
+    pthread_mutex_unlock(&hotplug->event_mutex);
+}
+
+// stop dispatching to the device and move its jobs to the orphan list, return false if it is already retired
+static bool retire_slot(_kp_devices_group_t *_devices_grp, int dev_idx)
+{
+    _kp_hotplug_t *hotplug = _devices_grp->hotplug;
+    uint32_t port_id = _devices_grp->ll_device[dev_idx]->dev_descp.port_id;
+    bool active = true;
+
+    if (!__atomic_compare_exchange_n(&_devices_grp->dev_active[dev_idx], &active, false, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return false;
+
+    dbg_print("[%s] port id %u is retired from slot %d\n", __func__, port_id, dev_idx);
+
+    clear_in_flight(_devices_grp, dev_idx);
+
+    // receivers stop waiting for the device
+    kp_usb_notify_read_any();
+
+    pthread_mutex_lock(&hotplug->job_mutex);
+
+    for (_kp_hotplug_job_t *job = hotplug->job_head[dev_idx]; NULL != job; job = job->next)
+        job->dev_idx = -1;
+
+    if (NULL != hotplug->job_head[dev_idx]) {
+        if (NULL == hotplug->orphan_tail)
+            hotplug->orphan_head = hotplug->job_head[dev_idx];
+        else
+            hotplug->orphan_tail->next = hotplug->job_head[dev_idx];
+
+        hotplug->orphan_tail = hotplug->job_tail[dev_idx];
+        hotplug->job_head[dev_idx] = NULL;
+        hotplug->job_tail[dev_idx] = NULL;
+    }
+
+    pthread_mutex_unlock(&hotplug->job_mutex);
+
+    // the port is checked again, a device plugged back quickly may be reported before this one is found gone
+    queue_event(hotplug, port_id);
+
+    return true;
+}
+
+// send orphan jobs to active devices, jobs are kept if no device holding their model is active
+static void requeue_jobs(_kp_devices_group_t *_devices_grp)
+{
+    _kp_hotplug_t *hotplug = _devices_grp->hotplug;
+    _kp_hotplug_job_t *wait_head = NULL; // jobs kept for the worker to retry later
+    _kp_hotplug_job_t *wait_tail = NULL;
+
+    while (1) {
+        pthread_mutex_lock(&hotplug->job_mutex);
+
+        _kp_hotplug_job_t *job = hotplug->orphan_head;
+
+        if (NULL != job) {
+            hotplug->orphan_head = job->next;
+
+            if (NULL == hotplug->orphan_head)
+                hotplug->orphan_tail = NULL;
+        }
+
+        pthread_mutex_unlock(&hotplug->job_mutex);
+
+        if (NULL == job)
+            break;
+
+        int dev_idx = acquire_send_device(_devices_grp, job->model_id);
+        int ret = KP_USB_RET_OK;
+
+        pthread_mutex_lock(&_devices_grp->send_mutex[dev_idx]);
+        pthread_mutex_lock(&hotplug->job_mutex);
+
+        bool active = __atomic_load_n(&_devices_grp->dev_active[dev_idx], __ATOMIC_ACQUIRE);
+
+        if (active) {
+            job->dev_idx = dev_idx;
+            job_list_append(&hotplug->job_head[dev_idx], &hotplug->job_tail[dev_idx], job);
+        } else {
+            job_list_append(&wait_head, &wait_tail, job);
+        }
+
+        pthread_mutex_unlock(&hotplug->job_mutex);
+
+        if (active) {
+            kp_usb_buffer_t usb_buf[2 * MAX_INPUT_NODE_COUNT];
+            uint8_t *data = job->data;
+
+            for (int i = 0; i < job->num_buf; i++) {
+                usb_buf[i].buf = data;
+                usb_buf[i].len = job->buf_len[i];
+                data += job->buf_len[i];
+            }
+
+            ret = kp_usb_write_data_list(_devices_grp->ll_device[dev_idx], usb_buf, job->num_buf, _devices_grp->timeout);
+        }
+
+        pthread_mutex_unlock(&_devices_grp->send_mutex[dev_idx]);
+
+        if (!active) {
+            release_device(_devices_grp, dev_idx);
+            continue; // jobs of other models may still find a device
+        }
+
+        if (KP_USB_USB_NO_DEVICE == ret) {
+            retire_slot(_devices_grp, dev_idx); // the job is an orphan again
+        } else if (KP_USB_RET_OK != ret) {
+            dbg_print("[%s] inference %u is lost, error %d\n", __func__, job->inference_number, ret);
+            hotplug_drop_job(_devices_grp, job);
+            release_device(_devices_grp, dev_idx);
+        }
+    }
+
+    if (NULL == wait_head)
+        return;
+
+    // kept jobs go before those orphaned meanwhile, they were sent first
+    pthread_mutex_lock(&hotplug->job_mutex);
+
+    wait_tail->next = hotplug->orphan_head;
+    hotplug->orphan_head = wait_head;
+
+    if (NULL == hotplug->orphan_tail)
+        hotplug->orphan_tail = wait_tail;
+
+    pthread_mutex_unlock(&hotplug->job_mutex);
+}
+
+// jobs are requeued by the worker, the caller may be the receiver which other devices wait on to make room for them
+void hotplug_retire_device(_kp_devices_group_t *_devices_grp, int dev_idx)
+{
+    retire_slot(_devices_grp, dev_idx);
+}
+
+void hotplug_keep_firmware(_kp_devices_group_t *_devices_grp, void *scpu_fw_buf, int scpu_fw_size, void *ncpu_fw_buf, int ncpu_fw_size)
+{
+    _kp_hotplug_t *hotplug = _devices_grp->hotplug;
+    void *scpu_copy = NULL;
+    void *ncpu_copy = NULL;
+
+    if ((NULL != scpu_fw_buf) && (0 < scpu_fw_size) && (NULL != (scpu_copy = malloc(scpu_fw_size))))
+        memcpy(scpu_copy, scpu_fw_buf, scpu_fw_size);
+
+    if ((NULL != ncpu_fw_buf) && (0 < ncpu_fw_size) && (NULL != (ncpu_copy = malloc(ncpu_fw_size))))
+        memcpy(ncpu_copy, ncpu_fw_buf, ncpu_fw_size);
+
+    pthread_mutex_lock(&hotplug->setup_mutex);
+
+    free(hotplug->scpu_fw_buf);
+    free(hotplug->ncpu_fw_buf);
+    hotplug->scpu_fw_buf = scpu_copy;
+    hotplug->scpu_fw_size = (NULL != scpu_copy) ? scpu_fw_size : 0;
+    hotplug->ncpu_fw_buf = ncpu_copy;
+    hotplug->ncpu_fw_size = (NULL != ncpu_copy) ? ncpu_fw_size : 0;
+
+    pthread_mutex_unlock(&hotplug->setup_mutex);
+}
+
+void hotplug_keep_model(_kp_devices_group_t *_devices_grp, void *nef_buf, int nef_size)
+{
+    _kp_hotplug_t *hotplug = _devices_grp->hotplug;
+    void *nef_copy = NULL;
+
+    if ((NULL != nef_buf) && (0 < nef_size) && (NULL != (nef_copy = malloc(nef_size))))
+        memcpy(nef_copy, nef_buf, nef_size);
+
+    pthread_mutex_lock(&hotplug->setup_mutex);
+
+    free(hotplug->nef_buf);
+    hotplug->nef_buf = nef_copy;
+    hotplug->nef_size = (NULL != nef_copy) ? nef_size : 0;
+    hotplug->model_from_flash = (NULL == nef_buf);
+
+    pthread_mutex_unlock(&hotplug->setup_mutex);
+}
+
+// called with setup_mutex locked
+static void release_slot_nef(_kp_hotplug_t *hotplug, int slot)
+{
+    _kp_hotplug_nef_t *nef = hotplug->slot_nef[slot];
+
+    hotplug->slot_nef[slot] = NULL;
+
+    if ((NULL != nef) && (0 == --nef->ref_count))
+        free(nef);
+}
+
+void hotplug_keep_device_model(_kp_devices_group_t *_devices_grp, int dev_idx[], int num_dev, void *nef_buf, int nef_size)
+{
+    _kp_hotplug_t *hotplug = _devices_grp->hotplug;
+    _kp_hotplug_nef_t *nef = NULL;
+    int num_slot = (NULL != dev_idx) ? num_dev : _devices_grp->capacity;
+
+    // one copy is shared by the slots, a slot without a copy gets the models of the group
+    if ((NULL != nef_buf) && (0 < nef_size) && (NULL != (nef = (_kp_hotplug_nef_t *)malloc(sizeof(_kp_hotplug_nef_t) + nef_size)))) {
+        memcpy(nef->nef_buf, nef_buf, nef_size);
+        nef->nef_size = nef_size;
+        nef->ref_count = 0;
+    }
+
+    pthread_mutex_lock(&hotplug->setup_mutex);
+
+    for (int i = 0; i < num_slot; i++) {
+        int slot = (NULL != dev_idx) ? dev_idx[i] : i;
+
+        release_slot_nef(hotplug, slot);
+
+        if (NULL != nef) {
+            nef->ref_count++;
+            hotplug->slot_nef[slot] = nef;
+        }
+    }
+
+    // once unlocked, the copy may be released by another thread if any slot holds it
+    bool unused = (NULL != nef) && (0 == nef->ref_count);
+
+    pthread_mutex_unlock(&hotplug->setup_mutex);
+
+    if (unused)
+        free(nef);
+}
+
+void hotplug_pause(_kp_devices_group_t *_devices_grp)
+{
+    if (NULL != _devices_grp->hotplug)
+        pthread_mutex_lock(&_devices_grp->hotplug->setup_mutex);
+}
+
+void hotplug_resume(_kp_devices_group_t *_devices_grp)
+{
+    if (NULL != _devices_grp->hotplug)
+        pthread_mutex_unlock(&_devices_grp->hotplug->setup_mutex);
+}
+
+// the first retired slot or a new one, capacity if the group is full
+// slots are only activated by the worker, so the slot stays free until the device is published
+static int find_free_slot(_kp_devices_group_t *_devices_grp)
+{
+    int num_device = __atomic_load_n(&_devices_grp->num_device, __ATOMIC_ACQUIRE);
+
+    for (int i = 0; i < num_device; i++) {
+        if (!__atomic_load_n(&_devices_grp->dev_active[i], __ATOMIC_ACQUIRE))
+            return i;
+    }
+
+    return (num_device < _devices_grp->capacity) ? num_device : _devices_grp->capacity;
+}
+
+// put a set up device into the slot of find_free_slot()
+static void publish_device(_kp_devices_group_t *_devices_grp, kp_usb_device_t *ll_dev, int slot)
+{
+    pthread_mutex_lock(&_devices_grp->slot_mutex);
+
+    int num_device = _devices_grp->num_device;
+
+    if (slot < num_device) {
+        kp_usb_device_t *old_dev = _devices_grp->ll_device[slot];
+
+        // the replaced device is kept open, other threads may still hold it from before it was retired
+        kp_usb_device_t **retired_device = (kp_usb_device_t **)realloc(_devices_grp->retired_device, (_devices_grp->num_retired_device + 1) * sizeof(kp_usb_device_t *));
+
+        if (NULL == retired_device) {
+            pthread_mutex_unlock(&_devices_grp->slot_mutex);
+            kp_usb_disconnect_device(ll_dev);
+            return;
+        }
+
+        _devices_grp->retired_device = retired_device;
+        _devices_grp->retired_device[_devices_grp->num_retired_device++] = old_dev;
+
+        async_detach_device(_devices_grp, slot);
+        kp_usb_cancel_read(old_dev);
+    }
+
+    pthread_mutex_lock(&_devices_grp->send_mutex[slot]);
+    _devices_grp->ll_device[slot] = ll_dev;
+    pthread_mutex_unlock(&_devices_grp->send_mutex[slot]);
+
+    // the slot is inactive, so no sender counts in_flight on its old tree meanwhile
+    assign_usb_tree(_devices_grp, slot);
+
+    __atomic_store_n(&_devices_grp->dev_active[slot], true, __ATOMIC_RELEASE);
+
+    if (slot == num_device)
+        __atomic_store_n(&_devices_grp->num_device, num_device + 1, __ATOMIC_RELEASE);
+
+    async_attach_device(_devices_grp, slot);
+
+    pthread_mutex_unlock(&_devices_grp->slot_mutex);
+
+    dbg_print("[%s] port id %u is added to slot %d\n", __func__, ll_dev->dev_descp.port_id, slot);
+
+    kp_usb_notify_read_any();
+}
+
+// connect the arrived device and load what is loaded into the group, called with setup_mutex locked
+static void insert_device(_kp_hotplug_t *hotplug, uint32_t port_id)
+{
+    _kp_devices_group_t *_devices_grp = hotplug->devices_grp;
+    int port_ids[1] = {(int)port_id};
+    int ret = KDP_MAGIC_CONNECTION_PASS; // device with loader is accepted, firmware is loaded below
+    int slot = find_free_slot(_devices_grp);
+
+    if (_devices_grp->capacity == slot) {
+        dbg_print("[%s] no slot for port id %u\n", __func__, port_id);
+        return;
+    }
+
+    // a device taking the slot of one with its own models gets the same models
+    _kp_hotplug_nef_t *slot_nef = hotplug->slot_nef[slot];
+
+    // the device is set up in its own group, so a failure does not disturb inferences of the group
+    kp_device_group_t new_devices = kp_connect_devices_without_check(1, port_ids, &ret);
+
+    if (NULL == new_devices) {
+        dbg_print("[%s] connect port id %u failed, error %d\n", __func__, port_id, ret);
+        return;
+    }
+
+    _kp_devices_group_t *_new_devices_grp = (_kp_devices_group_t *)new_devices;
+
+    kp_set_timeout(new_devices, _devices_grp->timeout);
+    kp_usb_set_queue_depth(_new_devices_grp->ll_device[0], _devices_grp->ll_device[0]->queue_depth);
+
+    if (_new_devices_grp->product_id != _devices_grp->product_id)
+        ret = KP_ERROR_DEVICE_GROUP_MIX_PRODUCT_29;
+    else if ((KP_SUCCESS != check_fw_is_loaded(new_devices)) && (NULL != hotplug->scpu_fw_buf))
+        ret = kp_load_firmware(new_devices, hotplug->scpu_fw_buf, hotplug->scpu_fw_size, hotplug->ncpu_fw_buf, hotplug->ncpu_fw_size);
+
+    if (KP_SUCCESS == ret)
+        ret = check_fw_is_loaded(new_devices);
+
+    if ((KP_SUCCESS == ret) && (NULL != slot_nef))
+        ret = kp_load_model(new_devices, slot_nef->nef_buf, slot_nef->nef_size, NULL);
+    else if ((KP_SUCCESS == ret) && (NULL != hotplug->nef_buf))
+        ret = kp_load_model(new_devices, hotplug->nef_buf, hotplug->nef_size, NULL);
+    else if ((KP_SUCCESS == ret) && hotplug->model_from_flash)
+        ret = kp_load_model_from_flash(new_devices, NULL);
+
+    if (KP_SUCCESS != ret) {
+        dbg_print("[%s] set up port id %u failed, error %d\n", __func__, port_id, ret);
+        kp_disconnect_devices(new_devices);
+        return;
+    }
+
+    // the device is moved into the group, the temporary group is released without closing it
+    kp_usb_device_t *ll_dev = _new_devices_grp->ll_device[0];
+    _new_devices_grp->num_device = 0;
+    kp_disconnect_devices(new_devices);
+
+    // the slot is inactive, so no sender looks at its models meanwhile
+    if (NULL == slot_nef)
+        _devices_grp->dev_model[slot].loaded = false;
+
+    publish_device(_devices_grp, ll_dev, slot);
+}
+
+// a device at the port arrived or left, or a device of the port failed
+static void check_port(_kp_hotplug_t *hotplug, uint32_t port_id)
+{
+    _kp_devices_group_t *_devices_grp = hotplug->devices_grp;
+    int num_device = __atomic_load_n(&_devices_grp->num_device, __ATOMIC_ACQUIRE);
+    int slot = -1;
+
+    // slots are only replaced by this thread, so ll_device can be read without locking
+    for (int i = 0; i < num_device && slot < 0; i++) {
+        if (__atomic_load_n(&_devices_grp->dev_active[i], __ATOMIC_ACQUIRE) && (_devices_grp->ll_device[i]->dev_descp.port_id == port_id))
+            slot = i;
+    }
+
+    bool present = kp_usb_is_port_present(port_id);
+
+    if ((0 <= slot) && !present)
+        retire_slot(_devices_grp, slot);
+    else if ((0 > slot) && present)
+        insert_device(hotplug, port_id);
+}
+
+static void *hotplug_worker_thread(void *data)
+{
+    _kp_hotplug_t *hotplug = (_kp_hotplug_t *)data;
+
+    pthread_mutex_lock(&hotplug->event_mutex);
+
+    while (hotplug->running) {
+        if (0 == hotplug->num_event) {
+            struct timeval now;
+            struct timespec abstime;
+
+            gettimeofday(&now, NULL);
+            uint64_t nsec = (uint64_t)now.tv_usec * 1000 + (uint64_t)HOTPLUG_RETRY_INTERVAL_MS * 1000000;
+            abstime.tv_sec = now.tv_sec + nsec / 1000000000;
+            abstime.tv_nsec = nsec % 1000000000;
+
+            if (ETIMEDOUT == pthread_cond_timedwait(&hotplug->event_cond, &hotplug->event_mutex, &abstime)) {
+                // jobs left by a device retired while others were requeueing
+                pthread_mutex_unlock(&hotplug->event_mutex);
+                requeue_jobs(hotplug->devices_grp);
+                pthread_mutex_lock(&hotplug->event_mutex);
+            }
+
+            continue;
+        }
+
+        uint32_t port_id = hotplug->event_port_id[0];
+
+        hotplug->num_event--;
+        memmove(&hotplug->event_port_id[0], &hotplug->event_port_id[1], hotplug->num_event * sizeof(uint32_t));
+
+        pthread_mutex_unlock(&hotplug->event_mutex);
+
+        // group operations rebooting devices hold setup_mutex, their reconnection is not taken as hotplug
+        pthread_mutex_lock(&hotplug->setup_mutex);
+        check_port(hotplug, port_id);
+        pthread_mutex_unlock(&hotplug->setup_mutex);
+
+        requeue_jobs(hotplug->devices_grp);
+
+        pthread_mutex_lock(&hotplug->event_mutex);
+    }
+
+    pthread_mutex_unlock(&hotplug->event_mutex);
+
+    return NULL;
+}
+
+// called in the usb event thread, libusb functions must not be called here
+static void hotplug_usb_callback(bool arrived, uint32_t port_id, uint16_t product_id, void *user_data)
+{
+    dbg_print("[%s] port id %u product id 0x%x %s\n", __func__, port_id, product_id, arrived ? "arrived" : "left");
+
+    queue_event((_kp_hotplug_t *)user_data, port_id);
+}
+
+static void free_hotplug(_kp_hotplug_t *hotplug)
+{
+    free_job_list(hotplug->orphan_head);
+
+    for (int i = 0; (NULL != hotplug->job_head) && (i < hotplug->devices_grp->capacity); i++)
+        free_job_list(hotplug->job_head[i]);
+
+    free(hotplug->job_head);
+    free(hotplug->job_tail);
+
+    for (int i = 0; (NULL != hotplug->slot_nef) && (i < hotplug->devices_grp->capacity); i++)
+        release_slot_nef(hotplug, i);
+
+    free(hotplug->slot_nef);
+
+    free(hotplug->scpu_fw_buf);
+    free(hotplug->ncpu_fw_buf);
+    free(hotplug->nef_buf);
+
+    pthread_mutex_destroy(&hotplug->event_mutex);
+    pthread_cond_destroy(&hotplug->event_cond);
+    pthread_mutex_destroy(&hotplug->setup_mutex);
+    pthread_mutex_destroy(&hotplug->job_mutex);
+    free(hotplug);
+}
+
+int kp_enable_hotplug(kp_device_group_t devices)
+{
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    bool all_sim = true;
+
+    if (NULL != _devices_grp->hotplug)
+        return KP_SUCCESS;
+
+    // simulated devices always report, real devices need hotplug events from libusb
+    for (int i = 0; i < _devices_grp->num_device; i++)
+        all_sim = all_sim && kp_usb_sim_is_port_id(_devices_grp->ll_device[i]->dev_descp.port_id);
+
+    if (!all_sim && !kp_usb_has_hotplug())
+        return KP_ERROR_HOTPLUG_NOT_SUPPORTED_51;
+
+    _kp_hotplug_t *hotplug = (_kp_hotplug_t *)calloc(1, sizeof(_kp_hotplug_t));
+    if (NULL == hotplug)
+        return KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+
+    hotplug->devices_grp = _devices_grp;
+    hotplug->running = true;
+    hotplug->job_head = (_kp_hotplug_job_t **)calloc(_devices_grp->capacity, sizeof(_kp_hotplug_job_t *));
+    hotplug->job_tail = (_kp_hotplug_job_t **)calloc(_devices_grp->capacity, sizeof(_kp_hotplug_job_t *));
+    hotplug->slot_nef = (_kp_hotplug_nef_t **)calloc(_devices_grp->capacity, sizeof(_kp_hotplug_nef_t *));
+
+    pthread_mutex_init(&hotplug->event_mutex, NULL);
+    pthread_cond_init(&hotplug->event_cond, NULL);
+    pthread_mutex_init(&hotplug->setup_mutex, NULL);
+    pthread_mutex_init(&hotplug->job_mutex, NULL);
+
+    if ((NULL == hotplug->job_head) || (NULL == hotplug->job_tail) || (NULL == hotplug->slot_nef)) {
+        free_hotplug(hotplug);
+        return KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+    }
+
+    _devices_grp->hotplug = hotplug;
+
+    if (0 != pthread_create(&hotplug->thread, NULL, hotplug_worker_thread, hotplug)) {
+        _devices_grp->hotplug = NULL;
+        free_hotplug(hotplug);
+        return KP_ERROR_OTHER_99;
+    }
+
+    hotplug->handle = kp_usb_register_hotplug(hotplug_usb_callback, hotplug);
+
+    if (0 > hotplug->handle) {
+        kp_disable_hotplug(devices);
+        return KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+    }
+
+    return KP_SUCCESS;
+}
+
+int kp_disable_hotplug(kp_device_group_t devices)
+{
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    _kp_hotplug_t *hotplug = _devices_grp->hotplug;
+
+    if (NULL == hotplug)
+        return KP_SUCCESS;
+
+    // no callback comes after deregistering
+    kp_usb_deregister_hotplug(hotplug->handle);
+
+    pthread_mutex_lock(&hotplug->event_mutex);
+    hotplug->running = false;
+    pthread_cond_signal(&hotplug->event_cond);
+    pthread_mutex_unlock(&hotplug->event_mutex);
+
+    pthread_join(hotplug->thread, NULL);
+
+    _devices_grp->hotplug = NULL;
+    free_hotplug(hotplug);
+
+    return KP_SUCCESS;
+}
@@ -14,6 +14,9 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sys/time.h>
+#include <stddef.h>
+#include <sched.h>
 
 #include "kp_inference.h"
 #include "kp_usb.h"
@@ -31,17 +34,6 @@
 #define dbg_print(format, ...)
 #endif
 
-static int check_inf_desc_error(int ll_return)
-{
-    if (ll_return == KP_USB_USB_TIMEOUT)
-        return KP_ERROR_USB_TIMEOUT_N7;
-
-    if (ll_return != KP_USB_RET_OK)
-        return KP_ERROR_SEND_DESC_FAIL_13;
-
-    return KP_SUCCESS;
-}
-
 static int check_send_image_error(int ll_return)
 {
     if (ll_return == KP_USB_USB_TIMEOUT)
@@ -85,37 +77,371 @@ static int get_image_size(kp_image_format_t format, int width, int height, uint3
     }
 }
 
-static bool check_model_id_is_exist_in_nef(_kp_devices_group_t *_devices_grp, uint32_t model_id)
+static uint8_t *get_send_buffer(_kp_devices_group_t *_devices_grp, int dev_idx, uint32_t size)
 {
-    bool ret = false;
-
-    for (int m = 0; m < _devices_grp->loaded_model_desc.num_models; m++)
+    if (_devices_grp->send_buf_size[dev_idx] < size)
     {
-        if (_devices_grp->loaded_model_desc.models[m].id == model_id)
-        {
-            ret = true;
+        uint8_t *buf = (uint8_t *)realloc(_devices_grp->send_buf[dev_idx], size);
+        if (NULL == buf)
+            return NULL;
+
+        _devices_grp->send_buf[dev_idx] = buf;
+        _devices_grp->send_buf_size[dev_idx] = size;
+    }
+
+    return _devices_grp->send_buf[dev_idx];
+}
+
+// take a ticket for round-robin without locking
+static int take_ticket(uint32_t *ticket, int num_device)
+{
+    return (int)(__atomic_fetch_add(ticket, 1, __ATOMIC_RELAXED) % (uint32_t)num_device);
+}
+
+// the entry of a root hub port (or a whole bus with root_port -1) in usb_tree, added if not found
+static int find_usb_tree(_kp_devices_group_t *_devices_grp, int bus_number, int root_port)
+{
+    for (int i = 0; i < _devices_grp->num_usb_tree; i++) {
+        if ((bus_number == _devices_grp->usb_tree[i].bus_number) && (root_port == _devices_grp->usb_tree[i].root_port))
+            return i;
+    }
+
+    // entries are never removed, at most one bus and one root hub port per slot
+    int idx = _devices_grp->num_usb_tree;
+
+    if (idx >= 2 * _devices_grp->capacity)
+        return 0;
+
+    _devices_grp->usb_tree[idx].bus_number = bus_number;
+    _devices_grp->usb_tree[idx].root_port = root_port;
+    _devices_grp->usb_tree[idx].in_flight = 0;
+    _devices_grp->num_usb_tree++;
+
+    return idx;
+}
+
+void assign_usb_tree(_kp_devices_group_t *_devices_grp, int dev_idx)
+{
+    int bus_number = -1;
+    int root_port = -1;
+
+    // port path is "bus-port-port...", the first port is on the root hub, simulated devices share one unknown tree
+    if (2 != sscanf(_devices_grp->ll_device[dev_idx]->dev_descp.port_path, "%d-%d", &bus_number, &root_port)) {
+        bus_number = -1;
+        root_port = 0;
+    }
+
+    _devices_grp->dev_usb_bus[dev_idx] = find_usb_tree(_devices_grp, bus_number, -1);
+    _devices_grp->dev_usb_port[dev_idx] = find_usb_tree(_devices_grp, bus_number, root_port);
+}
+
+static void add_in_flight(_kp_devices_group_t *_devices_grp, int dev_idx, int count)
+{
+    __atomic_fetch_add(&_devices_grp->usb_tree[_devices_grp->dev_usb_bus[dev_idx]].in_flight, count, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&_devices_grp->usb_tree[_devices_grp->dev_usb_port[dev_idx]].in_flight, count, __ATOMIC_RELAXED);
+}
+
+// whether the device in a slot holds the model, models loaded into the device alone replace those of the group
+static bool device_has_model(_kp_devices_group_t *_devices_grp, int dev_idx, uint32_t model_id)
+{
+    _kp_device_model_t *dev_model = &_devices_grp->dev_model[dev_idx];
+    kp_model_nef_descriptor_t *model_desc = dev_model->loaded ? &dev_model->model_desc : &_devices_grp->loaded_model_desc;
+
+    for (uint32_t m = 0; m < model_desc->num_models; m++) {
+        if (model_desc->models[m].id == model_id)
+            return true;
+    }
+
+    return false;
+}
+
+// pick the active device with the fewest inferences in flight,
+// ties go to the device whose host controller and then root hub port carry the fewest inferences,
+// so a light load is spread over USB trees instead of filling the devices of one hub first,
+// remaining ties are broken round-robin by the ticket
+// if devices have their own models, only those holding the model are picked, so replicas of a model share its load
+// if no such device is active (all removed with hotplug), an inactive one is returned and hotplug keeps the inference
+int acquire_send_device(_kp_devices_group_t *_devices_grp, uint32_t model_id)
+{
+    int num_device = __atomic_load_n(&_devices_grp->num_device, __ATOMIC_ACQUIRE);
+    int start = take_ticket(&_devices_grp->cur_send, num_device);
+    bool by_model = _devices_grp->model_affinity && (ANY_MODEL_ID != model_id);
+    int dev_idx = -1;
+    int min_in_flight = 0;
+    int min_bus_in_flight = 0;
+    int min_port_in_flight = 0;
+
+    // concurrent senders may pick the same device on a race, it only costs balance for a moment
+    for (int i = 0; i < num_device && (0 > dev_idx || 0 < min_in_flight || 0 < min_bus_in_flight); i++) {
+        int idx = (start + i) % num_device;
+
+        if (!__atomic_load_n(&_devices_grp->dev_active[idx], __ATOMIC_ACQUIRE))
+            continue;
+
+        if (by_model && !device_has_model(_devices_grp, idx, model_id))
+            continue;
+
+        int in_flight = __atomic_load_n(&_devices_grp->in_flight[idx], __ATOMIC_RELAXED);
+        int bus_in_flight = __atomic_load_n(&_devices_grp->usb_tree[_devices_grp->dev_usb_bus[idx]].in_flight, __ATOMIC_RELAXED);
+        int port_in_flight = __atomic_load_n(&_devices_grp->usb_tree[_devices_grp->dev_usb_port[idx]].in_flight, __ATOMIC_RELAXED);
+
+        if ((0 > dev_idx) || (in_flight < min_in_flight) ||
+            ((in_flight == min_in_flight) && ((bus_in_flight < min_bus_in_flight) ||
+                                              ((bus_in_flight == min_bus_in_flight) && (port_in_flight < min_port_in_flight))))) {
+            dev_idx = idx;
+            min_in_flight = in_flight;
+            min_bus_in_flight = bus_in_flight;
+            min_port_in_flight = port_in_flight;
+        }
+    }
+
+    // a retired slot of the model is preferred, a device plugged into it later gets the same models
+    for (int i = 0; i < num_device && 0 > dev_idx && by_model; i++) {
+        if (device_has_model(_devices_grp, (start + i) % num_device, model_id))
+            dev_idx = (start + i) % num_device;
+    }
+
+    if (0 > dev_idx)
+        dev_idx = start;
+
+    __atomic_fetch_add(&_devices_grp->in_flight[dev_idx], 1, __ATOMIC_RELAXED);
+    add_in_flight(_devices_grp, dev_idx, 1);
+
+    // receiver may be waiting for a device to have inference in flight
+    kp_usb_notify_read_any();
+
+    return dev_idx;
+}
+
+// an inference is done (or never sent) on the device
+void release_device(_kp_devices_group_t *_devices_grp, int dev_idx)
+{
+    int *in_flight = &_devices_grp->in_flight[dev_idx];
+    int cur = __atomic_load_n(in_flight, __ATOMIC_RELAXED);
+
+    // never below 0, in_flight may be cleared by device error or reset meanwhile
+    while (cur > 0) {
+        if (__atomic_compare_exchange_n(in_flight, &cur, cur - 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            add_in_flight(_devices_grp, dev_idx, -1);
             break;
         }
     }
+}
+
+// inferences in flight are lost
+void clear_in_flight(_kp_devices_group_t *_devices_grp, int dev_idx)
+{
+    int cleared = __atomic_exchange_n(&_devices_grp->in_flight[dev_idx], 0, __ATOMIC_RELAXED);
+
+    if (0 < cleared)
+        add_in_flight(_devices_grp, dev_idx, -cleared);
+}
+
+// the last result of an inference is received, or the inference failed on the device
+static void finish_inference(_kp_devices_group_t *_devices_grp, int dev_idx, bool match_number, uint32_t inference_number)
+{
+    release_device(_devices_grp, dev_idx);
+
+    if (NULL != _devices_grp->hotplug)
+        hotplug_job_done(_devices_grp, dev_idx, match_number, inference_number);
+}
+
+// a device is found gone while sending or receiving, return true if hotplug takes care of its inferences
+static bool retire_lost_device(_kp_devices_group_t *_devices_grp, int dev_idx, int usb_ret)
+{
+    if (KP_USB_USB_NO_DEVICE != usb_ret || NULL == _devices_grp->hotplug)
+        return false;
+
+    hotplug_retire_device(_devices_grp, dev_idx);
+
+    return true;
+}
+
+static uint64_t get_time_ms()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+// receive one result from the device which completes first, return received size or < 0 if failed
+static int receive_from_any_device(_kp_devices_group_t *_devices_grp, void *buf, uint32_t buf_size, int *dev_idx)
+{
+    int timeout = _devices_grp->timeout;
+    uint64_t deadline_ms = (timeout > 0) ? get_time_ms() + timeout : 0;
+    int ret = KP_USB_RET_PENDING;
+
+    // devices may join with hotplug, so reads are always posted
+    if (1 == _devices_grp->num_device && NULL == _devices_grp->hotplug) {
+        // read into caller buffer directly, recv_mutex keeps command replies from being taken
+        *dev_idx = 0;
+        pthread_mutex_lock(&_devices_grp->recv_mutex);
+        ret = kp_usb_read_data(_devices_grp->ll_device[0], buf, buf_size, timeout);
+        pthread_mutex_unlock(&_devices_grp->recv_mutex);
+        return ret;
+    }
+
+    int capacity = _devices_grp->capacity;
+    kp_usb_device_t *devs[capacity];
+    int devs_idx[capacity];
+    int num_devs = 0;
+    bool direct = false; // the read of devs[0] is posted into the caller buffer
+
+    pthread_mutex_lock(&_devices_grp->recv_mutex);
+
+    while (KP_USB_RET_PENDING == ret) {
+        int num_device = __atomic_load_n(&_devices_grp->num_device, __ATOMIC_ACQUIRE);
+
+        // a read into the caller buffer is waited for alone, it must not be left posted when returning
+        if (!direct) {
+            num_devs = 0;
+
+            // a read is posted on every device with inference in flight, devices are polled from cur_recv for fairness
+            for (int i = 0; i < num_device; i++) {
+                int idx = (_devices_grp->cur_recv + i) % num_device;
+                kp_usb_device_t *ll_dev = _devices_grp->ll_device[idx];
+
+                if (!__atomic_load_n(&_devices_grp->dev_active[idx], __ATOMIC_ACQUIRE)) {
+                    kp_usb_cancel_read(ll_dev); // removed by hotplug
+                    continue;
+                }
+
+                if (0 < __atomic_load_n(&_devices_grp->in_flight[idx], __ATOMIC_RELAXED) || NULL != ll_dev->posted_buf) {
+                    devs[num_devs] = ll_dev;
+                    devs_idx[num_devs++] = idx;
+                }
+            }
+
+            // only one device to wait for, it reads into the caller buffer without copying
+            if (1 == num_devs && NULL == devs[0]->posted_buf) {
+                ret = kp_usb_submit_read(devs[0], buf, buf_size);
+                if (retire_lost_device(_devices_grp, devs_idx[0], ret)) {
+                    ret = KP_USB_RET_PENDING;
+                    continue;
+                } else if (KP_USB_RET_OK != ret) {
+                    *dev_idx = devs_idx[0];
+                    goto FUNC_OUT;
+                }
+
+                direct = true;
+            }
+        }
+
+        // the others read into their staging buffers, as the result of any device can complete first
+        for (int i = 0; i < num_devs; i++) {
+            int idx = devs_idx[i];
+
+            if (NULL != devs[i]->posted_buf)
+                continue;
+
+            if (_devices_grp->recv_buf_size[idx] < buf_size) {
+                uint8_t *recv_buf = (uint8_t *)realloc(_devices_grp->recv_buf[idx], buf_size);
+                if (NULL == recv_buf) {
+                    ret = KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+                    goto FUNC_OUT;
+                }
+
+                _devices_grp->recv_buf[idx] = recv_buf;
+                _devices_grp->recv_buf_size[idx] = buf_size;
+            }
+
+            ret = kp_usb_submit_read(devs[i], _devices_grp->recv_buf[idx], buf_size);
+            if (retire_lost_device(_devices_grp, idx, ret)) {
+                ret = KP_USB_RET_PENDING;
+            } else if (KP_USB_RET_OK != ret) {
+                *dev_idx = idx;
+                goto FUNC_OUT;
+            }
+        }
+
+        int wait_ms = 0;
+
+        if (0 < deadline_ms) {
+            uint64_t now_ms = get_time_ms();
+            if (now_ms >= deadline_ms) {
+                if (direct)
+                    kp_usb_cancel_read(devs[0]);
+
+                ret = KP_USB_USB_TIMEOUT;
+                break;
+            }
+            wait_ms = (int)(deadline_ms - now_ms);
+        }
+
+        int index = 0;
+        ret = kp_usb_wait_read_any(devs, num_devs, wait_ms, &index);
+
+        if (KP_USB_RET_PENDING == ret)
+            continue;
+
+        // the read is done, whether it is completed, failed or cancelled
+        bool in_caller_buf = direct;
+        direct = false;
+
+        // the device is replaced by hotplug meanwhile, its read is cancelled
+        if (devs[index] != _devices_grp->ll_device[devs_idx[index]] || !__atomic_load_n(&_devices_grp->dev_active[devs_idx[index]], __ATOMIC_ACQUIRE)) {
+            ret = KP_USB_RET_PENDING;
+            continue;
+        }
+
+        if (retire_lost_device(_devices_grp, devs_idx[index], ret)) {
+            ret = KP_USB_RET_PENDING;
+            continue;
+        }
+
+        *dev_idx = devs_idx[index];
+        _devices_grp->cur_recv = (devs_idx[index] + 1) % num_device;
+
+        if (0 > ret) {
+            clear_in_flight(_devices_grp, devs_idx[index]);
+        } else if (!in_caller_buf) {
+            if ((uint32_t)ret > buf_size)
+                ret = KP_USB_USB_OVERFLOW; // read was posted by a previous call with larger buffer
+            else
+                memcpy(buf, _devices_grp->recv_buf[devs_idx[index]], ret);
+        }
+    }
+
+FUNC_OUT:
+    pthread_mutex_unlock(&_devices_grp->recv_mutex);
 
     return ret;
 }
 
-static bool check_model_input_node_number_is_correct(_kp_devices_group_t *_devices_grp, uint32_t model_id, uint32_t num_input_node_data)
+static kp_single_model_descriptor_t *search_model(kp_model_nef_descriptor_t *model_desc, uint32_t model_id)
+{
+    for (uint32_t m = 0; m < model_desc->num_models; m++)
+    {
+        if (model_desc->models[m].id == model_id)
+            return &model_desc->models[m];
+    }
+
+    return NULL;
+}
+
+// NULL if the model is not loaded, ddr_attr is of the devices holding it
+static kp_single_model_descriptor_t *find_model(_kp_devices_group_t *_devices_grp, uint32_t model_id, kp_ddr_manage_attr_t **ddr_attr)
 {
-    bool ret = false;
+    *ddr_attr = &_devices_grp->ddr_attr;
+
+    if (!_devices_grp->model_affinity)
+        return search_model(&_devices_grp->loaded_model_desc, model_id);
+
+    int num_device = __atomic_load_n(&_devices_grp->num_device, __ATOMIC_ACQUIRE);
 
-    for (int m = 0; m < _devices_grp->loaded_model_desc.num_models; m++)
+    for (int i = 0; i < num_device; i++)
     {
-        if ((_devices_grp->loaded_model_desc.models[m].id == model_id) &&
-            (_devices_grp->loaded_model_desc.models[m].input_nodes_num == num_input_node_data))
+        _kp_device_model_t *dev_model = &_devices_grp->dev_model[i];
+        kp_single_model_descriptor_t *model = search_model(dev_model->loaded ? &dev_model->model_desc : &_devices_grp->loaded_model_desc, model_id);
+
+        if (NULL != model)
         {
-            ret = true;
-            break;
+            *ddr_attr = dev_model->loaded ? &dev_model->ddr_attr : &_devices_grp->ddr_attr;
+            return model;
         }
     }
 
-    return ret;
+    return NULL;
 }
 
 static int verify_result_header_stamp(kp_inference_header_stamp_t *stamp, uint32_t check_total_size, uint32_t check_job_id)
@@ -135,6 +461,22 @@ static int verify_result_header_stamp(kp_inference_header_stamp_t *stamp, uint32
     return KP_SUCCESS;
 }
 
+// raw_cnn_res points to the RAW output data following the result header
+static uint32_t get_raw_output_node_number(uint32_t product_id, uint8_t *raw_cnn_res)
+{
+    switch (product_id)
+    {
+    case KP_DEVICE_KL520:
+        return *(uint32_t *)raw_cnn_res;
+    case KP_DEVICE_KL720:
+        return ((_720_raw_cnn_res_t *)raw_cnn_res)->total_nodes;
+    case KP_DEVICE_KL630:
+        return ((_630_raw_cnn_res_t *)raw_cnn_res)->total_nodes;
+    default:
+        return 0;
+    }
+}
+
 static kp_channel_ordering_convert_t get_channel_ordering_convert_code(int product_id, kp_channel_ordering_t ordering)
 {
     switch (product_id)
@@ -205,82 +547,177 @@ int kp_inference_configure(kp_device_group_t devices, kp_inf_configuration_t *co
     return KP_SUCCESS;
 }
 
-int kp_generic_image_inference_send(kp_device_group_t devices, kp_generic_image_inference_desc_t *inf_data)
+// image inference which passed validation, what is needed to send it
+typedef struct
 {
-    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    uint32_t image_size[MAX_INPUT_NODE_COUNT];
+    bool in_io_buf[MAX_INPUT_NODE_COUNT];
+    uint32_t send_buf_size; // size needed in staging buffer
+} image_send_info_t;
 
-    kp_usb_device_t *ll_dev = _devices_grp->ll_device[_devices_grp->cur_send++];
-
-    if (_devices_grp->cur_send >= _devices_grp->num_device)
-        _devices_grp->cur_send = 0;
-
-    int timeout = _devices_grp->timeout;
-
-    uint32_t image_size = 0;
+// model and ddr_attr are a cache of the last found model, so frames of the same model are not searched again
+static int validate_image_inference(_kp_devices_group_t *_devices_grp, kp_generic_image_inference_desc_t *inf_data, kp_single_model_descriptor_t **model, kp_ddr_manage_attr_t **ddr_attr, image_send_info_t *info)
+{
+    uint32_t num_input_node_image = inf_data->num_input_node_image;
 
-    int ret = 0;
-    int num_input_node_image = inf_data->num_input_node_image;
+    if ((NULL == *model) || ((*model)->id != inf_data->model_id))
+        *model = find_model(_devices_grp, inf_data->model_id, ddr_attr);
 
-    if ((MAX_INPUT_NODE_COUNT < num_input_node_image) ||
-        (false == check_model_input_node_number_is_correct(_devices_grp, inf_data->model_id, num_input_node_image))) {
+    if ((MAX_INPUT_NODE_COUNT < num_input_node_image) || (NULL == *model) || ((*model)->input_nodes_num != num_input_node_image)) {
+        dbg_print("[%s] model id [%d] not exist in nef or input node number mismatch\n", __func__, inf_data->model_id);
         return KP_ERROR_INVALID_PARAM_12;
-    } else if (_devices_grp->ddr_attr.input_buffer_count < num_input_node_image) {
+    } else if ((*ddr_attr)->input_buffer_count < num_input_node_image) {
         return KP_ERROR_FIFOQ_INPUT_BUFF_COUNT_NOT_ENOUGH_42;
     }
 
-    for (int i = 0; i < num_input_node_image; i++) {
-        ret = get_image_size(inf_data->input_node_image_list[i].image_format, inf_data->input_node_image_list[i].width, inf_data->input_node_image_list[i].height, &image_size);
+    info->send_buf_size = 0;
+
+    for (uint32_t i = 0; i < num_input_node_image; i++) {
+        int ret = get_image_size(inf_data->input_node_image_list[i].image_format, inf_data->input_node_image_list[i].width, inf_data->input_node_image_list[i].height, &info->image_size[i]);
         if (ret != KP_SUCCESS)
             return ret;
 
-        if (false == check_model_id_is_exist_in_nef(_devices_grp, inf_data->model_id))
+        if (sizeof(kdp2_ipc_generic_raw_inf_header_t) + info->image_size[i] > (*ddr_attr)->input_buffer_size)
         {
-            dbg_print("[%s] model id [%d] not exist in nef\n", __func__, inf_data->model_id);
-            return KP_ERROR_MODEL_NOT_LOADED_35;
+            dbg_print("[%s] image buffer size is not enough in firmware\n", __func__);
+            return KP_ERROR_SEND_DATA_TOO_LARGE_15;
         }
 
-        kdp2_ipc_generic_raw_inf_header_t raw_inf_header;
+        // the header of an image in io buffer is put into the headroom in front of it
+        info->in_io_buf[i] = is_io_buffer(_devices_grp, inf_data->input_node_image_list[i].image_buffer, info->image_size[i]);
 
-        raw_inf_header.header_stamp.magic_type = KDP2_MAGIC_TYPE_INFERENCE;
-        raw_inf_header.header_stamp.total_size = sizeof(raw_inf_header) + image_size;
-        raw_inf_header.header_stamp.job_id = KDP2_INF_ID_GENERIC_RAW;
-        raw_inf_header.header_stamp.total_image = num_input_node_image;
-        raw_inf_header.header_stamp.image_index = i;
+        if (!info->in_io_buf[i])
+            info->send_buf_size += sizeof(kdp2_ipc_generic_raw_inf_header_t);
+    }
 
-        if (raw_inf_header.header_stamp.total_size > _devices_grp->ddr_attr.input_buffer_size)
-        {
-            dbg_print("[%s] image buffer size is not enough in firmware\n", __func__);
-            return KP_ERROR_SEND_DATA_TOO_LARGE_15;
+    return KP_SUCCESS;
+}
+
+// build headers of all input nodes into staging buffer (or io buffer headroom) and append them to usb_buf,
+// image is sent from where it is as the write returns after the last transfer, send_buf is advanced by info->send_buf_size
+static void pack_image_inference(kp_generic_image_inference_desc_t *inf_data, image_send_info_t *info, uint8_t **send_buf, kp_usb_buffer_t usb_buf[], int *num_usb_buf)
+{
+    uint32_t num_input_node_image = inf_data->num_input_node_image;
+    uint8_t *buf = *send_buf;
+    int num = *num_usb_buf;
+
+    for (uint32_t i = 0; i < num_input_node_image; i++) {
+        uint8_t *image_buffer = inf_data->input_node_image_list[i].image_buffer;
+        uint32_t image_size = info->image_size[i];
+        kdp2_ipc_generic_raw_inf_header_t *raw_inf_header = (kdp2_ipc_generic_raw_inf_header_t *)(info->in_io_buf[i] ? image_buffer - sizeof(kdp2_ipc_generic_raw_inf_header_t) : buf);
+
+        raw_inf_header->header_stamp.magic_type = KDP2_MAGIC_TYPE_INFERENCE;
+        raw_inf_header->header_stamp.total_size = sizeof(kdp2_ipc_generic_raw_inf_header_t) + image_size;
+        raw_inf_header->header_stamp.job_id = KDP2_INF_ID_GENERIC_RAW;
+        raw_inf_header->header_stamp.status_code = 0;
+        raw_inf_header->header_stamp.total_image = num_input_node_image;
+        raw_inf_header->header_stamp.image_index = i;
+
+        raw_inf_header->inference_number = inf_data->inference_number;
+        raw_inf_header->model_id = inf_data->model_id;
+
+        memcpy((void *)&raw_inf_header->image_header, &inf_data->input_node_image_list[i], sizeof(kdp2_ipc_generic_raw_inf_image_header_t));
+
+        if (info->in_io_buf[i]) {
+            usb_buf[num].buf = raw_inf_header;
+            usb_buf[num++].len = raw_inf_header->header_stamp.total_size;
+        } else {
+            buf += sizeof(kdp2_ipc_generic_raw_inf_header_t);
+
+            usb_buf[num].buf = raw_inf_header;
+            usb_buf[num++].len = sizeof(kdp2_ipc_generic_raw_inf_header_t);
+            usb_buf[num].buf = image_buffer;
+            usb_buf[num++].len = image_size;
         }
+    }
+
+    *send_buf = buf;
+    *num_usb_buf = num;
+}
+
+// write an inference to the device with send_mutex locked, it is kept by hotplug until its last result is received
+static int write_inference(_kp_devices_group_t *_devices_grp, int dev_idx, uint32_t inference_number, uint32_t model_id, kp_usb_buffer_t usb_buf[], int num_usb_buf)
+{
+    _kp_hotplug_job_t *job = NULL;
+
+    // the device is removed, the inference is sent to another device later
+    if ((NULL != _devices_grp->hotplug) && !hotplug_record_job(_devices_grp, dev_idx, inference_number, model_id, usb_buf, num_usb_buf, &job))
+        return KP_USB_RET_OK;
+
+    int ret = kp_usb_write_data_list(_devices_grp->ll_device[dev_idx], usb_buf, num_usb_buf, _devices_grp->timeout);
+
+    if ((KP_USB_RET_OK != ret) && (KP_USB_USB_NO_DEVICE != ret) && (NULL != job))
+        hotplug_drop_job(_devices_grp, job);
+
+    return ret;
+}
+
+// called after send_mutex is unlocked
+static int finish_send(_kp_devices_group_t *_devices_grp, int dev_idx, int usb_ret)
+{
+    // the inference is requeued to another device
+    if (retire_lost_device(_devices_grp, dev_idx, usb_ret))
+        return KP_SUCCESS;
+
+    if (KP_USB_RET_OK != usb_ret)
+        release_device(_devices_grp, dev_idx);
+
+    return check_send_image_error(usb_ret);
+}
+
+int kp_generic_image_inference_send(kp_device_group_t devices, kp_generic_image_inference_desc_t *inf_data)
+{
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    kp_single_model_descriptor_t *model = NULL;
+    kp_ddr_manage_attr_t *ddr_attr = NULL;
+    image_send_info_t info;
 
-        raw_inf_header.inference_number = inf_data->inference_number;
-        raw_inf_header.model_id = inf_data->model_id;
+    int ret = validate_image_inference(_devices_grp, inf_data, &model, &ddr_attr, &info);
+    if (KP_SUCCESS != ret)
+        return ret;
 
-        memcpy((void *)&raw_inf_header.image_header, &inf_data->input_node_image_list[i], sizeof(kdp2_ipc_generic_raw_inf_image_header_t));
+    int dev_idx = acquire_send_device(_devices_grp, inf_data->model_id);
 
-        ret = kp_usb_write_data(ll_dev, (void *)&raw_inf_header, sizeof(raw_inf_header), timeout);
-        int status = check_inf_desc_error(ret);
-        if (status != KP_SUCCESS)
-            return status;
+    pthread_mutex_lock(&_devices_grp->send_mutex[dev_idx]);
 
-        ret = kp_usb_write_data(ll_dev, (void *)inf_data->input_node_image_list[i].image_buffer, image_size, timeout);
-        status = check_send_image_error(ret);
-        if (status != KP_SUCCESS)
-            return status;
+    uint8_t *send_buf = NULL;
+    if ((0 < info.send_buf_size) && (NULL == (send_buf = get_send_buffer(_devices_grp, dev_idx, info.send_buf_size)))) {
+        pthread_mutex_unlock(&_devices_grp->send_mutex[dev_idx]);
+        release_device(_devices_grp, dev_idx);
+        return KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
     }
 
-    return KP_SUCCESS;
+    // header and image of all input nodes are sent in one go
+    kp_usb_buffer_t usb_buf[2 * MAX_INPUT_NODE_COUNT];
+    int num_usb_buf = 0;
+
+    pack_image_inference(inf_data, &info, &send_buf, usb_buf, &num_usb_buf);
+
+    ret = write_inference(_devices_grp, dev_idx, inf_data->inference_number, inf_data->model_id, usb_buf, num_usb_buf);
+
+    pthread_mutex_unlock(&_devices_grp->send_mutex[dev_idx]);
+
+    return finish_send(_devices_grp, dev_idx, ret);
 }
 
 int kp_generic_image_inference_receive(kp_device_group_t devices, kp_generic_image_inference_result_header_t *output_desc, uint8_t *raw_out_buffer, uint32_t buf_size)
+{
+    uint32_t port_id;
+
+    return kp_generic_image_inference_receive_with_port_id(devices, output_desc, raw_out_buffer, buf_size, &port_id);
+}
+
+int kp_generic_image_inference_receive_with_port_id(kp_device_group_t devices, kp_generic_image_inference_result_header_t *output_desc, uint8_t *raw_out_buffer, uint32_t buf_size, uint32_t *port_id)
 {
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
-    kp_usb_device_t *ll_dev = _devices_grp->ll_device[_devices_grp->cur_recv];
+    int dev_idx = 0;
 
-    int timeout = _devices_grp->timeout;
+    // results are received by the receiver threads
+    if (NULL != _devices_grp->async)
+        return KP_ERROR_ASYNC_INFERENCE_ENABLED_48;
 
     // if return < 0 means libusb error, otherwise return  received size
-    int usb_ret = kp_usb_read_data(ll_dev, (void *)raw_out_buffer, buf_size, timeout);
+    int usb_ret = receive_from_any_device(_devices_grp, (void *)raw_out_buffer, buf_size, &dev_idx);
     if (usb_ret < 0)
         return usb_ret;
 
@@ -291,164 +728,314 @@ int kp_generic_image_inference_receive(kp_device_group_t devices, kp_generic_ima
     int status = verify_result_header_stamp((kp_inference_header_stamp_t *)ipc_result, 0, KDP2_INF_ID_GENERIC_RAW);
 
     if (status != KP_SUCCESS) {
+        finish_inference(_devices_grp, dev_idx, false, 0);
         return status;
     }
 
+    if (ipc_result->is_last_crop == 1)
+        finish_inference(_devices_grp, dev_idx, true, ipc_result->inf_number);
+
+    *port_id = _devices_grp->ll_device[dev_idx]->dev_descp.port_id;
     output_desc->inference_number = ipc_result->inf_number;
     output_desc->crop_number = ipc_result->crop_number;
     output_desc->product_id = ipc_result->product_id;
 
-    switch (ipc_result->product_id)
-    {
-    case KP_DEVICE_KL520:
-    {
-        output_desc->num_output_node = *(uint32_t *)(raw_out_buffer + sizeof(kdp2_ipc_generic_raw_result_t));
-        break;
-    }
-    case KP_DEVICE_KL720:
-    {
-        _720_raw_cnn_res_t *raw_cnn_res = (_720_raw_cnn_res_t *)(raw_out_buffer + sizeof(kdp2_ipc_generic_raw_result_t));
-        output_desc->num_output_node = raw_cnn_res->total_nodes;
-        break;
-    }
-    case KP_DEVICE_KL630:
-    {
-        _630_raw_cnn_res_t *raw_cnn_res = (_630_raw_cnn_res_t *)(raw_out_buffer + sizeof(kdp2_ipc_generic_raw_result_t));
-        output_desc->num_output_node = raw_cnn_res->total_nodes;
-        break;
-    }
-    default:
-        break;
-    }
+    output_desc->num_output_node = get_raw_output_node_number(ipc_result->product_id, raw_out_buffer + sizeof(kdp2_ipc_generic_raw_result_t));
 
     output_desc->num_pre_proc_info = ipc_result->num_of_pre_proc_info;
 
     memcpy(output_desc->pre_proc_info, ipc_result->pre_proc_info, output_desc->num_pre_proc_info * sizeof(kp_hw_pre_proc_info_t));
 
-    if (ipc_result->is_last_crop == 1)
-        _devices_grp->cur_recv++;
-
-    if (_devices_grp->cur_recv >= _devices_grp->num_device)
-        _devices_grp->cur_recv = 0;
-
     return KP_SUCCESS;
 }
 
-int kp_generic_data_inference_send(kp_device_group_t devices, kp_generic_data_inference_desc_t *inf_data)
+// send frames queued for a device in one go, their headers are packed in the staging buffer of the device
+static int flush_image_batch(_kp_devices_group_t *_devices_grp, int dev_idx, kp_generic_image_inference_desc_t inf_data[], image_send_info_t info[],
+                             uint32_t frame_idx[], uint32_t num_frame, kp_usb_buffer_t usb_buf[])
 {
-    int num_input_node_data = inf_data->num_input_node_data;
-    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
-    kp_usb_device_t *ll_dev = _devices_grp->ll_device[_devices_grp->cur_send++];
+    uint32_t send_buf_size = 0;
+    int num_usb_buf = 0;
+    int ret;
 
-    if (_devices_grp->cur_send >= _devices_grp->num_device)
-        _devices_grp->cur_send = 0;
+    for (uint32_t i = 0; i < num_frame; i++)
+        send_buf_size += info[frame_idx[i]].send_buf_size;
 
-    if ((MAX_INPUT_NODE_COUNT < num_input_node_data) ||
-        (false == check_model_input_node_number_is_correct(_devices_grp, inf_data->model_id, num_input_node_data))) {
-        return KP_ERROR_INVALID_PARAM_12;
-    } else if (_devices_grp->ddr_attr.input_buffer_count < num_input_node_data) {
-        return KP_ERROR_FIFOQ_INPUT_BUFF_COUNT_NOT_ENOUGH_42;
-    }
+    pthread_mutex_lock(&_devices_grp->send_mutex[dev_idx]);
 
-    int timeout = _devices_grp->timeout;
+    uint8_t *send_buf = NULL;
+    uint32_t num_sent = 0; // frames not to be released on failure
+    if ((0 < send_buf_size) && (NULL == (send_buf = get_send_buffer(_devices_grp, dev_idx, send_buf_size)))) {
+        ret = KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+    } else if (NULL != _devices_grp->hotplug) {
+        // each frame is kept by hotplug on its own, frames are still written if the device is gone so that all are requeued
+        int usb_ret = KP_USB_RET_OK;
 
-    for (int i = 0; i < num_input_node_data; i++) {
-        uint32_t buffer_size = inf_data->input_node_data_list[i].buffer_size;
+        for (; num_sent < num_frame && (KP_USB_RET_OK == usb_ret || KP_USB_USB_NO_DEVICE == usb_ret); num_sent++) {
+            uint32_t idx = frame_idx[num_sent];
+            int frame_ret;
 
-        int ret = 0;
+            num_usb_buf = 0;
+            pack_image_inference(&inf_data[idx], &info[idx], &send_buf, usb_buf, &num_usb_buf);
+            frame_ret = write_inference(_devices_grp, dev_idx, inf_data[idx].inference_number, inf_data[idx].model_id, usb_buf, num_usb_buf);
 
-        if (false == check_model_id_is_exist_in_nef(_devices_grp, inf_data->model_id))
-        {
-            dbg_print("[%s] model id [%d] not exist in nef\n", __func__, inf_data->model_id);
-            return KP_ERROR_MODEL_NOT_LOADED_35;
+            if (KP_USB_RET_OK != frame_ret)
+                usb_ret = frame_ret;
         }
 
-        kdp2_ipc_generic_raw_inf_bypass_pre_proc_header_t raw_inf_header;
-
-        raw_inf_header.header_stamp.magic_type = KDP2_MAGIC_TYPE_INFERENCE;
-        raw_inf_header.header_stamp.total_size = sizeof(raw_inf_header) + buffer_size;
-        raw_inf_header.header_stamp.job_id = KDP2_INF_ID_GENERIC_RAW_BYPASS_PRE_PROC;
-        raw_inf_header.header_stamp.total_image = num_input_node_data;
-        raw_inf_header.header_stamp.image_index = i;
+        if (KP_USB_RET_OK != usb_ret && KP_USB_USB_NO_DEVICE != usb_ret)
+            num_sent--; // the failed frame
+        ret = usb_ret;
+    } else {
+        for (uint32_t i = 0; i < num_frame; i++)
+            pack_image_inference(&inf_data[frame_idx[i]], &info[frame_idx[i]], &send_buf, usb_buf, &num_usb_buf);
 
-        if (raw_inf_header.header_stamp.total_size > _devices_grp->ddr_attr.input_buffer_size)
-        {
-            dbg_print("[%s] image buffer size is not enough in firmware\n", __func__);
-            return KP_ERROR_SEND_DATA_TOO_LARGE_15;
-        }
+        ret = kp_usb_write_data_list(_devices_grp->ll_device[dev_idx], usb_buf, num_usb_buf, _devices_grp->timeout);
+    }
 
-        raw_inf_header.inference_number = inf_data->inference_number;
-        raw_inf_header.model_id = inf_data->model_id;
-        raw_inf_header.image_buffer_size = buffer_size;
+    pthread_mutex_unlock(&_devices_grp->send_mutex[dev_idx]);
 
-        ret = kp_usb_write_data(ll_dev, (void *)&raw_inf_header, sizeof(raw_inf_header), timeout);
-        int status = check_inf_desc_error(ret);
-        if (status != KP_SUCCESS)
-            return status;
+    // frames are requeued to other devices
+    if (retire_lost_device(_devices_grp, dev_idx, ret))
+        return KP_SUCCESS;
 
-        ret = kp_usb_write_data(ll_dev, (void *)inf_data->input_node_data_list[i].buffer, buffer_size, timeout);
-        status = check_send_image_error(ret);
-        if (status != KP_SUCCESS)
-            return status;
+    if (KP_USB_RET_OK != ret) {
+        for (uint32_t i = num_sent; i < num_frame; i++)
+            release_device(_devices_grp, dev_idx);
     }
 
-    return KP_SUCCESS;
+    return (KP_ERROR_MEMORY_ALLOCATION_FAILURE_9 == ret) ? ret : check_send_image_error(ret);
 }
 
-int kp_generic_data_inference_receive(kp_device_group_t devices, kp_generic_data_inference_result_header_t *output_desc, uint8_t *raw_out_buffer, uint32_t buf_size)
+int kp_generic_image_inference_send_batch(kp_device_group_t devices, kp_generic_image_inference_desc_t inf_data[], uint32_t num_inf)
 {
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
-    kp_usb_device_t *ll_dev = _devices_grp->ll_device[_devices_grp->cur_recv];
+    uint32_t chunk_size = _devices_grp->ddr_attr.input_buffer_count; // input nodes sent to a device at a time
+    kp_single_model_descriptor_t *model = NULL;
+    kp_ddr_manage_attr_t *ddr_attr = NULL;
+    int ret = KP_SUCCESS;
+
+    // devices with their own models have their own input buffers
+    for (int i = 0; (i < _devices_grp->num_device) && _devices_grp->model_affinity; i++) {
+        if (_devices_grp->dev_model[i].loaded && (chunk_size < _devices_grp->dev_model[i].ddr_attr.input_buffer_count))
+            chunk_size = _devices_grp->dev_model[i].ddr_attr.input_buffer_count;
+    }
 
-    int timeout = _devices_grp->timeout;
+    if ((NULL == inf_data) || (0 == num_inf) || (0 == chunk_size))
+        return KP_ERROR_INVALID_PARAM_12;
 
-    // if return < 0 means libusb error, otherwise return  received size
-    int usb_ret = kp_usb_read_data(ll_dev, (void *)raw_out_buffer, buf_size, timeout);
-    if (usb_ret < 0)
-        return usb_ret;
+    image_send_info_t *info = (image_send_info_t *)malloc(num_inf * sizeof(image_send_info_t));
+    uint32_t *pending = (uint32_t *)malloc(_devices_grp->capacity * chunk_size * sizeof(uint32_t)); // hotplug may add devices while sending
+    kp_usb_buffer_t *usb_buf = (kp_usb_buffer_t *)malloc(chunk_size * 2 * sizeof(kp_usb_buffer_t));
+    uint32_t *num_pending = (uint32_t *)calloc(_devices_grp->capacity, sizeof(uint32_t));
+    uint32_t *pending_nodes = (uint32_t *)calloc(_devices_grp->capacity, sizeof(uint32_t));
 
-    // parsing result buffer
+    if ((NULL == info) || (NULL == pending) || (NULL == usb_buf) || (NULL == num_pending) || (NULL == pending_nodes)) {
+        ret = KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+        goto FUNC_OUT;
+    }
 
-    kdp2_ipc_generic_raw_bypass_pre_proc_result_t *ipc_result = (kdp2_ipc_generic_raw_bypass_pre_proc_result_t *)raw_out_buffer;
+    // all frames are validated before any is sent, frames of the same model share one model search
+    for (uint32_t i = 0; i < num_inf; i++) {
+        ret = validate_image_inference(_devices_grp, &inf_data[i], &model, &ddr_attr, &info[i]);
+        if (KP_SUCCESS != ret)
+            goto FUNC_OUT;
+    }
 
-    int status = verify_result_header_stamp((kp_inference_header_stamp_t *)ipc_result, 0, KDP2_INF_ID_GENERIC_RAW_BYPASS_PRE_PROC);
+    // frames are queued per device and sent when they fill the device input buffers,
+    // so devices are served in turn and each one works on its frames while the others are sent
+    for (uint32_t i = 0; i < num_inf; i++) {
+        int dev_idx = acquire_send_device(_devices_grp, inf_data[i].model_id);
+        uint32_t num_nodes = inf_data[i].num_input_node_image;
 
-    if (status != KP_SUCCESS) {
-        return status;
+        if (pending_nodes[dev_idx] + num_nodes > chunk_size) {
+            ret = flush_image_batch(_devices_grp, dev_idx, inf_data, info, &pending[dev_idx * chunk_size], num_pending[dev_idx], usb_buf);
+            num_pending[dev_idx] = 0;
+            pending_nodes[dev_idx] = 0;
+
+            if (KP_SUCCESS != ret) {
+                release_device(_devices_grp, dev_idx);
+                break;
+            }
+        }
+
+        pending[dev_idx * chunk_size + num_pending[dev_idx]++] = i;
+        pending_nodes[dev_idx] += num_nodes;
     }
 
-    output_desc->inference_number = ipc_result->inf_number;
-    output_desc->crop_number = ipc_result->crop_number;
-    output_desc->product_id = ipc_result->product_id;
+    for (int dev_idx = 0; dev_idx < _devices_grp->capacity; dev_idx++) {
+        if (0 == num_pending[dev_idx])
+            continue;
 
-    switch (ipc_result->product_id)
-    {
-    case KP_DEVICE_KL520:
-    {
-        output_desc->num_output_node = *(uint32_t *)(raw_out_buffer + sizeof(kdp2_ipc_generic_raw_bypass_pre_proc_result_t));
-        break;
+        if (KP_SUCCESS == ret) {
+            ret = flush_image_batch(_devices_grp, dev_idx, inf_data, info, &pending[dev_idx * chunk_size], num_pending[dev_idx], usb_buf);
+        } else {
+            for (uint32_t i = 0; i < num_pending[dev_idx]; i++)
+                release_device(_devices_grp, dev_idx);
+        }
     }
-    case KP_DEVICE_KL720:
-    {
-        _720_raw_cnn_res_t *raw_cnn_res = (_720_raw_cnn_res_t *)(raw_out_buffer + sizeof(kdp2_ipc_generic_raw_bypass_pre_proc_result_t));
-        output_desc->num_output_node = raw_cnn_res->total_nodes;
-        break;
+
+FUNC_OUT:
+    free(info);
+    free(pending);
+    free(usb_buf);
+    free(num_pending);
+    free(pending_nodes);
+
+    return ret;
+}
+
+int kp_generic_image_inference_receive_batch(kp_device_group_t devices, kp_generic_image_inference_result_header_t output_desc[], uint8_t *raw_out_buffer[], uint32_t buf_size, uint32_t num_inf,
+                                             uint32_t port_id[], uint32_t *num_received)
+{
+    int ret = KP_SUCCESS;
+    uint32_t i;
+
+    if ((NULL == output_desc) || (NULL == raw_out_buffer))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    for (i = 0; i < num_inf; i++) {
+        uint32_t dev_port_id;
+
+        ret = kp_generic_image_inference_receive_with_port_id(devices, &output_desc[i], raw_out_buffer[i], buf_size, &dev_port_id);
+        if (KP_SUCCESS != ret)
+            break;
+
+        if (NULL != port_id)
+            port_id[i] = dev_port_id;
     }
-    case KP_DEVICE_KL630:
-    {
-        _630_raw_cnn_res_t *raw_cnn_res = (_630_raw_cnn_res_t *)(raw_out_buffer + sizeof(kdp2_ipc_generic_raw_bypass_pre_proc_result_t));
-        output_desc->num_output_node = raw_cnn_res->total_nodes;
-        break;
+
+    if (NULL != num_received)
+        *num_received = i;
+
+    return ret;
+}
+
+int kp_generic_data_inference_send(kp_device_group_t devices, kp_generic_data_inference_desc_t *inf_data)
+{
+    int num_input_node_data = inf_data->num_input_node_data;
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+
+    kp_ddr_manage_attr_t *ddr_attr = NULL;
+    kp_single_model_descriptor_t *model = find_model(_devices_grp, inf_data->model_id, &ddr_attr);
+
+    if ((MAX_INPUT_NODE_COUNT < num_input_node_data) || (NULL == model) || (model->input_nodes_num != num_input_node_data)) {
+        dbg_print("[%s] model id [%d] not exist in nef or input node number mismatch\n", __func__, inf_data->model_id);
+        return KP_ERROR_INVALID_PARAM_12;
+    } else if (ddr_attr->input_buffer_count < num_input_node_data) {
+        return KP_ERROR_FIFOQ_INPUT_BUFF_COUNT_NOT_ENOUGH_42;
     }
-    default:
-        break;
+
+    bool in_io_buf[MAX_INPUT_NODE_COUNT] = {false};
+    uint32_t send_buf_size = 0;
+
+    for (int i = 0; i < num_input_node_data; i++) {
+        uint32_t buffer_size = inf_data->input_node_data_list[i].buffer_size;
+
+        if (sizeof(kdp2_ipc_generic_raw_inf_bypass_pre_proc_header_t) + buffer_size > ddr_attr->input_buffer_size)
+        {
+            dbg_print("[%s] image buffer size is not enough in firmware\n", __func__);
+            return KP_ERROR_SEND_DATA_TOO_LARGE_15;
+        }
+
+        // the header of data in io buffer is put into the headroom in front of it
+        in_io_buf[i] = is_io_buffer(_devices_grp, inf_data->input_node_data_list[i].buffer, buffer_size);
+
+        if (!in_io_buf[i])
+            send_buf_size += sizeof(kdp2_ipc_generic_raw_inf_bypass_pre_proc_header_t);
+    }
+
+    int dev_idx = acquire_send_device(_devices_grp, inf_data->model_id);
+
+    pthread_mutex_lock(&_devices_grp->send_mutex[dev_idx]);
+
+    uint8_t *send_buf = NULL;
+    if ((0 < send_buf_size) && (NULL == (send_buf = get_send_buffer(_devices_grp, dev_idx, send_buf_size)))) {
+        pthread_mutex_unlock(&_devices_grp->send_mutex[dev_idx]);
+        release_device(_devices_grp, dev_idx);
+        return KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+    }
+
+    // header and data of all input nodes are sent in one go, data is not copied as the write returns after the last transfer
+    kp_usb_buffer_t usb_buf[2 * MAX_INPUT_NODE_COUNT];
+    int num_usb_buf = 0;
+
+    for (int i = 0; i < num_input_node_data; i++) {
+        uint8_t *buffer = inf_data->input_node_data_list[i].buffer;
+        uint32_t buffer_size = inf_data->input_node_data_list[i].buffer_size;
+        kdp2_ipc_generic_raw_inf_bypass_pre_proc_header_t *raw_inf_header = (kdp2_ipc_generic_raw_inf_bypass_pre_proc_header_t *)(in_io_buf[i] ? buffer - sizeof(kdp2_ipc_generic_raw_inf_bypass_pre_proc_header_t) : send_buf);
+
+        raw_inf_header->header_stamp.magic_type = KDP2_MAGIC_TYPE_INFERENCE;
+        raw_inf_header->header_stamp.total_size = sizeof(kdp2_ipc_generic_raw_inf_bypass_pre_proc_header_t) + buffer_size;
+        raw_inf_header->header_stamp.job_id = KDP2_INF_ID_GENERIC_RAW_BYPASS_PRE_PROC;
+        raw_inf_header->header_stamp.status_code = 0;
+        raw_inf_header->header_stamp.total_image = num_input_node_data;
+        raw_inf_header->header_stamp.image_index = i;
+
+        raw_inf_header->inference_number = inf_data->inference_number;
+        raw_inf_header->model_id = inf_data->model_id;
+        raw_inf_header->image_buffer_size = buffer_size;
+
+        if (in_io_buf[i]) {
+            usb_buf[num_usb_buf].buf = raw_inf_header;
+            usb_buf[num_usb_buf++].len = raw_inf_header->header_stamp.total_size;
+        } else {
+            send_buf += sizeof(kdp2_ipc_generic_raw_inf_bypass_pre_proc_header_t);
+
+            usb_buf[num_usb_buf].buf = raw_inf_header;
+            usb_buf[num_usb_buf++].len = sizeof(kdp2_ipc_generic_raw_inf_bypass_pre_proc_header_t);
+            usb_buf[num_usb_buf].buf = buffer;
+            usb_buf[num_usb_buf++].len = buffer_size;
+        }
+    }
+
+    int ret = write_inference(_devices_grp, dev_idx, inf_data->inference_number, inf_data->model_id, usb_buf, num_usb_buf);
+
+    pthread_mutex_unlock(&_devices_grp->send_mutex[dev_idx]);
+
+    return finish_send(_devices_grp, dev_idx, ret);
+}
+
+int kp_generic_data_inference_receive(kp_device_group_t devices, kp_generic_data_inference_result_header_t *output_desc, uint8_t *raw_out_buffer, uint32_t buf_size)
+{
+    uint32_t port_id;
+
+    return kp_generic_data_inference_receive_with_port_id(devices, output_desc, raw_out_buffer, buf_size, &port_id);
+}
+
+int kp_generic_data_inference_receive_with_port_id(kp_device_group_t devices, kp_generic_data_inference_result_header_t *output_desc, uint8_t *raw_out_buffer, uint32_t buf_size, uint32_t *port_id)
+{
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    int dev_idx = 0;
+
+    // results are received by the receiver threads
+    if (NULL != _devices_grp->async)
+        return KP_ERROR_ASYNC_INFERENCE_ENABLED_48;
+
+    // if return < 0 means libusb error, otherwise return  received size
+    int usb_ret = receive_from_any_device(_devices_grp, (void *)raw_out_buffer, buf_size, &dev_idx);
+    if (usb_ret < 0)
+        return usb_ret;
+
+    // parsing result buffer
+
+    kdp2_ipc_generic_raw_bypass_pre_proc_result_t *ipc_result = (kdp2_ipc_generic_raw_bypass_pre_proc_result_t *)raw_out_buffer;
+
+    int status = verify_result_header_stamp((kp_inference_header_stamp_t *)ipc_result, 0, KDP2_INF_ID_GENERIC_RAW_BYPASS_PRE_PROC);
+
+    if (status != KP_SUCCESS) {
+        finish_inference(_devices_grp, dev_idx, false, 0);
+        return status;
     }
 
     if (ipc_result->is_last_crop == 1)
-        _devices_grp->cur_recv++;
+        finish_inference(_devices_grp, dev_idx, true, ipc_result->inf_number);
+
+    *port_id = _devices_grp->ll_device[dev_idx]->dev_descp.port_id;
+    output_desc->inference_number = ipc_result->inf_number;
+    output_desc->crop_number = ipc_result->crop_number;
+    output_desc->product_id = ipc_result->product_id;
 
-    if (_devices_grp->cur_recv >= _devices_grp->num_device)
-        _devices_grp->cur_recv = 0;
+    output_desc->num_output_node = get_raw_output_node_number(ipc_result->product_id, raw_out_buffer + sizeof(kdp2_ipc_generic_raw_bypass_pre_proc_result_t));
 
     return KP_SUCCESS;
 }
@@ -456,12 +1043,13 @@ int kp_generic_data_inference_receive(kp_device_group_t devices, kp_generic_data
 #define KDP_COL_MIN_8       8
 #define KDP_COL_MIN_16      16
 #define KDP_CHANNEL_MIN_16  16
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
 uint32_t round_up(uint32_t num, uint32_t round_num)
 {
     return ((num + (round_num - 1)) & ~(round_num - 1));
 }
 
-kp_inf_raw_fixed_node_output_t *kp_generic_inference_retrieve_raw_fixed_node(uint32_t node_idx, uint8_t *raw_out_buffer)
+static int get_raw_fixed_node(uint32_t node_idx, uint8_t *raw_out_buffer, kp_inf_raw_fixed_node_output_t *node_output)
 {
     kdp2_ipc_generic_raw_result_t *raw_result = (kdp2_ipc_generic_raw_result_t *)raw_out_buffer;
 
@@ -473,11 +1061,8 @@ kp_inf_raw_fixed_node_output_t *kp_generic_inference_retrieve_raw_fixed_node(uin
         uint32_t out_node_num = *(uint32_t *)data_start;
 
         if (node_idx > out_node_num - 1)
-            return NULL;
+            return KP_ERROR_INVALID_PARAM_12;
 
-        kp_inf_raw_fixed_node_output_t *node_output = (kp_inf_raw_fixed_node_output_t *)malloc(sizeof(kp_inf_raw_fixed_node_output_t));
-        if (NULL == node_output)
-            return NULL;
         kp_inf_raw_fixed_node_metadata_t *node_desc = (kp_inf_raw_fixed_node_metadata_t *)(data_start + 4);
 
         uint32_t raw_offset = 4 + out_node_num * sizeof(kp_inf_raw_fixed_node_metadata_t);
@@ -492,7 +1077,7 @@ kp_inf_raw_fixed_node_output_t *kp_generic_inference_retrieve_raw_fixed_node(uin
         // cast npu data layout to kp_tensor_format
         node_output->metadata.data_layout = convert_data_format_to_kp_tensor_format(node_output->metadata.data_layout, KP_MODEL_TARGET_CHIP_KL520);
 
-        return node_output;
+        return KP_SUCCESS;
     }
     break;
 
@@ -501,11 +1086,8 @@ kp_inf_raw_fixed_node_output_t *kp_generic_inference_retrieve_raw_fixed_node(uin
         _720_raw_cnn_res_t *pRawHead = (_720_raw_cnn_res_t *)(raw_out_buffer + sizeof(kdp2_ipc_generic_raw_result_t));
 
         if (node_idx > pRawHead->total_nodes - 1)
-            return NULL;
+            return KP_ERROR_INVALID_PARAM_12;
 
-        kp_inf_raw_fixed_node_output_t *node_output = (kp_inf_raw_fixed_node_output_t *)malloc(sizeof(kp_inf_raw_fixed_node_output_t));
-        if (NULL == node_output)
-            return NULL;
         node_output->metadata.height = pRawHead->onode_a[node_idx].row_length;
         node_output->metadata.channel = pRawHead->onode_a[node_idx].ch_length;
         node_output->metadata.width = pRawHead->onode_a[node_idx].col_length;
@@ -519,7 +1101,7 @@ kp_inf_raw_fixed_node_output_t *kp_generic_inference_retrieve_raw_fixed_node(uin
         // cast npu data layout to kp_tensor_format
         node_output->metadata.data_layout = convert_data_format_to_kp_tensor_format(node_output->metadata.data_layout, KP_MODEL_TARGET_CHIP_KL720);
 
-        return node_output;
+        return KP_SUCCESS;
     }
     break;
 
@@ -528,11 +1110,8 @@ kp_inf_raw_fixed_node_output_t *kp_generic_inference_retrieve_raw_fixed_node(uin
         _630_raw_cnn_res_t *pRawHead = (_630_raw_cnn_res_t *)(raw_out_buffer + sizeof(kdp2_ipc_generic_raw_result_t));
 
         if (node_idx > (uint32_t)(pRawHead->total_nodes - 1))
-            return NULL;
+            return KP_ERROR_INVALID_PARAM_12;
 
-        kp_inf_raw_fixed_node_output_t *node_output = (kp_inf_raw_fixed_node_output_t *)malloc(sizeof(kp_inf_raw_fixed_node_output_t));
-        if (NULL == node_output)
-            return NULL;
         node_output->metadata.height = pRawHead->onode_a[node_idx].row_length;
         node_output->metadata.channel = pRawHead->onode_a[node_idx].ch_length;
         node_output->metadata.width = pRawHead->onode_a[node_idx].col_length;
@@ -546,7 +1125,7 @@ kp_inf_raw_fixed_node_output_t *kp_generic_inference_retrieve_raw_fixed_node(uin
         // cast npu data layout to kp_tensor_format
         node_output->metadata.data_layout = convert_data_format_to_kp_tensor_format(node_output->metadata.data_layout, KP_MODEL_TARGET_CHIP_KL630);
 
-        return node_output;
+        return KP_SUCCESS;
     }
     break;
 
@@ -554,33 +1133,23 @@ kp_inf_raw_fixed_node_output_t *kp_generic_inference_retrieve_raw_fixed_node(uin
     break;
     }
 
-    return NULL;
+    return KP_ERROR_INVALID_PARAM_12;
 }
 
 #define SIZE_OF_FIXED_NODE_DATA 4 // sizeof(int16_t) + padding size for align 4 (ref. kp_inf_fixed_node_output_t)
 
-kp_inf_fixed_node_output_t *kp_generic_inference_retrieve_fixed_node(uint32_t node_idx, uint8_t *raw_out_buffer, kp_channel_ordering_t ordering)
+static uint32_t get_fixed_node_size(kp_inf_raw_fixed_node_output_t *raw_fixed_node_output)
 {
-    kp_inf_raw_fixed_node_output_t *raw_fixed_node_output = kp_generic_inference_retrieve_raw_fixed_node(node_idx, raw_out_buffer);
-    kdp2_ipc_generic_raw_result_t *raw_result = (kdp2_ipc_generic_raw_result_t *)raw_out_buffer;
-
-    if (NULL == raw_fixed_node_output)
-        return NULL;
+    uint32_t num_data = raw_fixed_node_output->metadata.height * raw_fixed_node_output->metadata.channel * raw_fixed_node_output->metadata.width; // FIXME width
+    uint32_t data_size = num_data * ((KP_MODEL_TENSOR_DATA_LAYOUT_8W1C16B == raw_fixed_node_output->metadata.data_layout) ? sizeof(int16_t) : sizeof(int8_t));
 
-    kp_inf_fixed_node_output_t *fixed_node_output = NULL;
+    return sizeof(kp_inf_fixed_node_output_t) - SIZE_OF_FIXED_NODE_DATA + data_size;
+}
 
+static int convert_fixed_node(kp_inf_raw_fixed_node_output_t *raw_fixed_node_output, uint32_t product_id, kp_channel_ordering_t ordering, kp_inf_fixed_node_output_t *fixed_node_output)
+{
     uint32_t fixed_point_dtype = (KP_MODEL_TENSOR_DATA_LAYOUT_8W1C16B == raw_fixed_node_output->metadata.data_layout) ? KP_FIXED_POINT_DTYPE_INT16 : KP_FIXED_POINT_DTYPE_INT8;
     uint32_t num_data = raw_fixed_node_output->metadata.height * raw_fixed_node_output->metadata.channel * raw_fixed_node_output->metadata.width; // FIXME width
-    uint32_t data_size = num_data * ((KP_FIXED_POINT_DTYPE_INT16 == fixed_point_dtype) ? sizeof(int16_t) : sizeof(int8_t));
-
-    fixed_node_output = (kp_inf_fixed_node_output_t *)malloc(sizeof(kp_inf_fixed_node_output_t) - SIZE_OF_FIXED_NODE_DATA + data_size);
-
-    if (NULL == fixed_node_output)
-    {
-        printf("memory is insufficient to allocate buffer for node output\n");
-        free(raw_fixed_node_output); //memory is allocated in kp_generic_inference_retrieve_raw_fixed_node()
-        return NULL;
-    }
 
     fixed_node_output->width = raw_fixed_node_output->metadata.width;
     fixed_node_output->height = raw_fixed_node_output->metadata.height;
@@ -600,7 +1169,7 @@ kp_inf_fixed_node_output_t *kp_generic_inference_retrieve_fixed_node(uint32_t no
     }
     #endif
 
-    kp_channel_ordering_convert_t channel_ordering_convert_code = get_channel_ordering_convert_code(raw_result->product_id, ordering);
+    kp_channel_ordering_convert_t channel_ordering_convert_code = get_channel_ordering_convert_code(product_id, ordering);
     int width_aligned = 0;
     int n = 0;
 
@@ -681,8 +1250,7 @@ kp_inf_fixed_node_output_t *kp_generic_inference_retrieve_fixed_node(uint32_t no
         case KP_CHANNEL_ORDERING_CVT_HCW2HWC:
             /* KL520 not support 1W16C8B ouput NPU data layout format */
             printf("Invalid NPU data layout of HCW to CHW/HWC channel order conversion, NPU data layout = KP_MODEL_TENSOR_DATA_LAYOUT_1W16C8B.\n");
-            free(raw_fixed_node_output);
-            return NULL;
+            return KP_ERROR_INVALID_PARAM_12;
             break;
         case KP_CHANNEL_ORDERING_CVT_CHW2HCW:
             for (int h = 0; h < fixed_node_output->height; h++)
@@ -795,126 +1363,40 @@ kp_inf_fixed_node_output_t *kp_generic_inference_retrieve_fixed_node(uint32_t no
         }
     }
 
-    free(raw_fixed_node_output);
-
-    return fixed_node_output;
+    return KP_SUCCESS;
 }
 
-kp_inf_float_node_output_t *kp_generic_inference_retrieve_float_node(uint32_t node_idx, uint8_t *raw_out_buffer, kp_channel_ordering_t ordering)
+static uint32_t get_float_node_size(kp_inf_raw_fixed_node_output_t *raw_fixed_node_output)
 {
-    kp_inf_raw_fixed_node_output_t *raw_fixed_node_output = kp_generic_inference_retrieve_raw_fixed_node(node_idx, raw_out_buffer);
-    kdp2_ipc_generic_raw_result_t *raw_result = (kdp2_ipc_generic_raw_result_t *)raw_out_buffer;
-
-    if (NULL == raw_fixed_node_output)
-        return NULL;
-
-    kp_inf_float_node_output_t *float_node_output = NULL;
-
-    int num_data = raw_fixed_node_output->metadata.height * raw_fixed_node_output->metadata.channel * raw_fixed_node_output->metadata.width; // FIXME width
-
-    float_node_output = (kp_inf_float_node_output_t *)malloc(sizeof(kp_inf_float_node_output_t) + num_data * sizeof(float));
-
-    if (NULL == float_node_output)
-    {
-        printf("memory is insufficient to allocate buffer for node output\n");
+    uint32_t num_data = raw_fixed_node_output->metadata.height * raw_fixed_node_output->metadata.channel * raw_fixed_node_output->metadata.width; // FIXME width
 
-        free(raw_fixed_node_output); //memory is allocated in kp_generic_inference_retrieve_raw_fixed_node()
-        return NULL;
-    }
+    return sizeof(kp_inf_float_node_output_t) + num_data * sizeof(float);
+}
 
+/* channel_scale: NULL for the per-tensor scale/radix of the metadata, else one factor per channel */
+static int convert_float_node(kp_inf_raw_fixed_node_output_t *raw_fixed_node_output, uint32_t product_id, kp_channel_ordering_t ordering,
+                              const float *channel_scale, kp_inf_float_node_output_t *float_node_output)
+{
     float_node_output->channel = raw_fixed_node_output->metadata.channel;
     float_node_output->height = raw_fixed_node_output->metadata.height;
     float_node_output->width = raw_fixed_node_output->metadata.width;
-    float_node_output->num_data = num_data;
-
-    float scale = raw_fixed_node_output->metadata.scale;
-    int32_t radix = raw_fixed_node_output->metadata.radix;
-    float ffactor = 0;
-
-    #ifdef OPTIMIZED_FIXED_TO_FLOAT
-    {
-        ffactor = (float)1 / (float)(scale * pow2(radix));
-    }
-    #else
-    {
-        ffactor = (float)(scale * pow2(radix));
-    }
-    #endif
+    float_node_output->num_data = raw_fixed_node_output->metadata.height * raw_fixed_node_output->metadata.channel * raw_fixed_node_output->metadata.width; // FIXME width
 
-    kp_channel_ordering_convert_t channel_ordering_convert_code = get_channel_ordering_convert_code(raw_result->product_id, ordering);
-    int width_aligned = 0;
-    int n = 0;
+    kp_channel_ordering_convert_t channel_ordering_convert_code = get_channel_ordering_convert_code(product_id, ordering);
+    uint32_t channel = float_node_output->channel;
+    uint32_t height = float_node_output->height;
+    uint32_t width = float_node_output->width;
+    float *data = float_node_output->data;
+    void *raw_data = raw_fixed_node_output->data;
 
-    if (KP_MODEL_TENSOR_DATA_LAYOUT_8W1C16B == raw_fixed_node_output->metadata.data_layout)
-    {
-        /* standard 16-bit floating-point output */
-        width_aligned = round_up(float_node_output->width, KDP_COL_MIN_8);
+    /* every ordering is made of row conversions and transposes, which are vectorized in dequantize.c */
+    float inv_ffactor = dequantize_float_scale(raw_fixed_node_output->metadata.scale, raw_fixed_node_output->metadata.radix);
 
-        switch (channel_ordering_convert_code)
-        {
-        case KP_CHANNEL_ORDERING_CVT_HCW2CHW:
-            for (int c = 0; c < float_node_output->channel; c++)
-            {
-                for (int h = 0; h < float_node_output->height; h++)
-                {
-                    for (int w = 0; w < float_node_output->width; w++)
-                        float_node_output->data[n++] = (float)((int16_t *)(raw_fixed_node_output->data))[(h * float_node_output->channel * width_aligned) +
-                                                                                                         (c * width_aligned) +
-                                                                                                          w] / ffactor;
-                }
-            }
-            break;
-        case KP_CHANNEL_ORDERING_CVT_CHW2HCW:
-            for (int h = 0; h < float_node_output->height; h++)
-            {
-                for (int c = 0; c < float_node_output->channel; c++)
-                {
-                    for (int w = 0; w < float_node_output->width; w++)
-                        float_node_output->data[n++] = (float)((int16_t *)(raw_fixed_node_output->data))[(c * float_node_output->height * width_aligned) +
-                                                                                                          (h * width_aligned) +
-                                                                                                           w] / ffactor;
-                }
-            }
-            break;
-        case KP_CHANNEL_ORDERING_CVT_HCW2HWC:
-            for (int h = 0; h < float_node_output->height; h++)
-            {
-                for (int w = 0; w < float_node_output->width; w++)
-                {
-                    for (int c = 0; c < float_node_output->channel; c++)
-                        float_node_output->data[n++] = (float)((int16_t *)(raw_fixed_node_output->data))[(h * float_node_output->channel * width_aligned) +
-                                                                                                         (c * width_aligned) +
-                                                                                                          w] / ffactor;
-                }
-            }
-            break;
-        case KP_CHANNEL_ORDERING_CVT_CHW2HWC:
-            for (int h = 0; h < float_node_output->height; h++)
-            {
-                for (int w = 0; w < float_node_output->width; w++)
-                {
-                    for (int c = 0; c < float_node_output->channel; c++)
-                        float_node_output->data[n++] = (float)((int16_t *)(raw_fixed_node_output->data))[(c * float_node_output->height * width_aligned) +
-                                                                                                         (h * width_aligned) +
-                                                                                                          w] / ffactor;
-                }
-            }
-            break;
-        default:
-            for (int i = 0; i < float_node_output->height * float_node_output->channel; i++)
-            {
-                for (int j = 0; j < float_node_output->width; j++)
-                    float_node_output->data[n++] = (float)((int16_t *)(raw_fixed_node_output->data))[i * width_aligned + j] / ffactor;
-            }
-            break;
-        }
-    }
-    else if (KP_MODEL_TENSOR_DATA_LAYOUT_1W16C8B == raw_fixed_node_output->metadata.data_layout)
+    if (KP_MODEL_TENSOR_DATA_LAYOUT_1W16C8B == raw_fixed_node_output->metadata.data_layout)
     {
-        /* 8-bit fixed-point output */
-        int channel_block_idx = 0;
-        int channel_offset_idx = 0;
-        int channel_block_size = float_node_output->height * float_node_output->width * KDP_CHANNEL_MIN_16;
+        /* 8-bit fixed-point output, channels are interleaved in blocks of 16 */
+        uint32_t channel_block_size = height * width * KDP_CHANNEL_MIN_16;
+        uint32_t num_channel_block = (channel + KDP_CHANNEL_MIN_16 - 1) / KDP_CHANNEL_MIN_16;
 
         switch (channel_ordering_convert_code)
         {
@@ -922,180 +1404,538 @@ kp_inf_float_node_output_t *kp_generic_inference_retrieve_float_node(uint32_t no
         case KP_CHANNEL_ORDERING_CVT_HCW2HWC:
             /* KL520 not support 1W16C8B ouput NPU data layout format */
             printf("Invalid NPU data layout of HCW to CHW/HWC channel order conversion, NPU data layout = KP_MODEL_TENSOR_DATA_LAYOUT_1W16C8B.\n");
-            free(raw_fixed_node_output);
-            return NULL;
+            return KP_ERROR_INVALID_PARAM_12;
             break;
         case KP_CHANNEL_ORDERING_CVT_CHW2HCW:
-            for (int h = 0; h < float_node_output->height; h++)
+            for (uint32_t h = 0; h < height; h++)
             {
-                for (int c = 0; c < float_node_output->channel; c++)
+                for (uint32_t cb = 0; cb < num_channel_block; cb++)
                 {
-                    channel_block_idx = c / KDP_CHANNEL_MIN_16;
-                    channel_offset_idx = c % KDP_CHANNEL_MIN_16;
-                    for (int w = 0; w < float_node_output->width; w++)
-                        float_node_output->data[n++] = (float)((int8_t *)(raw_fixed_node_output->data))[(channel_block_idx * channel_block_size) +
-                                                                                                        (h * float_node_output->width * KDP_CHANNEL_MIN_16) +
-                                                                                                        (w * KDP_CHANNEL_MIN_16) +
-                                                                                                        (channel_offset_idx)] / ffactor;
+                    uint32_t num_c = MIN(KDP_CHANNEL_MIN_16, channel - cb * KDP_CHANNEL_MIN_16);
+                    float *out = data + (h * channel + cb * KDP_CHANNEL_MIN_16) * width;
+                    int8_t *in = (int8_t *)raw_data + cb * channel_block_size + h * width * KDP_CHANNEL_MIN_16;
+
+                    if (NULL != channel_scale)
+                        dequantize_transpose_per_col(out, width, in, false, KDP_CHANNEL_MIN_16, width, num_c, channel_scale + cb * KDP_CHANNEL_MIN_16);
+                    else
+                        dequantize_transpose(out, width, in, false, KDP_CHANNEL_MIN_16, width, num_c, inv_ffactor);
                 }
             }
             break;
         case KP_CHANNEL_ORDERING_CVT_CHW2HWC:
-            for (int h = 0; h < float_node_output->height; h++)
+            for (uint32_t hw = 0; hw < height * width; hw++)
             {
-                for (int w = 0; w < float_node_output->width; w++)
+                for (uint32_t cb = 0; cb < num_channel_block; cb++)
                 {
-                    for (int c = 0; c < float_node_output->channel; c++)
-                    {
-                        channel_block_idx = c / KDP_CHANNEL_MIN_16;
-                        channel_offset_idx = c % KDP_CHANNEL_MIN_16;
-                        float_node_output->data[n++] = (float)((int8_t *)(raw_fixed_node_output->data))[(channel_block_idx * channel_block_size) +
-                                                                                                        (h * float_node_output->width * KDP_CHANNEL_MIN_16) +
-                                                                                                        (w * KDP_CHANNEL_MIN_16) +
-                                                                                                        (channel_offset_idx)] / ffactor;
-                    }
+                    uint32_t num_c = MIN(KDP_CHANNEL_MIN_16, channel - cb * KDP_CHANNEL_MIN_16);
+                    float *out = data + hw * channel + cb * KDP_CHANNEL_MIN_16;
+                    int8_t *in = (int8_t *)raw_data + cb * channel_block_size + hw * KDP_CHANNEL_MIN_16;
+
+                    if (NULL != channel_scale)
+                        dequantize_row_per_channel(out, in, false, num_c, channel_scale + cb * KDP_CHANNEL_MIN_16);
+                    else
+                        dequantize_row(out, in, false, num_c, inv_ffactor);
                 }
             }
             break;
         default:
-            for (int c = 0; c < float_node_output->channel; c++)
+            for (uint32_t cb = 0; cb < num_channel_block; cb++)
             {
-                channel_block_idx = c / KDP_CHANNEL_MIN_16;
-                channel_offset_idx = c % KDP_CHANNEL_MIN_16;
-                for (int i = 0; i < float_node_output->height * float_node_output->width; i++)
-                    float_node_output->data[n++] = (float)((int8_t *)(raw_fixed_node_output->data))[(channel_block_idx * channel_block_size) +
-                                                                                                    (i * KDP_CHANNEL_MIN_16) +
-                                                                                                    (channel_offset_idx)] / ffactor;
+                uint32_t num_c = MIN(KDP_CHANNEL_MIN_16, channel - cb * KDP_CHANNEL_MIN_16);
+                float *out = data + cb * KDP_CHANNEL_MIN_16 * height * width;
+                int8_t *in = (int8_t *)raw_data + cb * channel_block_size;
+
+                if (NULL != channel_scale)
+                    dequantize_transpose_per_col(out, height * width, in, false, KDP_CHANNEL_MIN_16, height * width, num_c, channel_scale + cb * KDP_CHANNEL_MIN_16);
+                else
+                    dequantize_transpose(out, height * width, in, false, KDP_CHANNEL_MIN_16, height * width, num_c, inv_ffactor);
             }
             break;
         }
     }
     else
     {
-        /* standard 8-bit floating-point output */
-        width_aligned = round_up(float_node_output->width, KDP_COL_MIN_16);
+        /* standard 16-bit (8W1C16B) or 8-bit output, each row of width is padded */
+        bool is_int16 = (KP_MODEL_TENSOR_DATA_LAYOUT_8W1C16B == raw_fixed_node_output->metadata.data_layout);
+        uint32_t width_aligned = is_int16 ? round_up(width, KDP_COL_MIN_8) : round_up(width, KDP_COL_MIN_16);
+        size_t elem_size = is_int16 ? sizeof(int16_t) : sizeof(int8_t);
+        uint8_t *raw_bytes = (uint8_t *)raw_data;
 
         switch (channel_ordering_convert_code)
         {
         case KP_CHANNEL_ORDERING_CVT_HCW2CHW:
-            for (int c = 0; c < float_node_output->channel; c++)
+            for (uint32_t c = 0; c < channel; c++)
             {
-                for (int h = 0; h < float_node_output->height; h++)
-                {
-                    for (int w = 0; w < float_node_output->width; w++)
-                        float_node_output->data[n++] = (float)((int8_t *)(raw_fixed_node_output->data))[(h * float_node_output->channel * width_aligned) +
-                                                                                                        (c * width_aligned) +
-                                                                                                         w] / ffactor;
-                }
+                float c_scale = (NULL != channel_scale) ? channel_scale[c] : inv_ffactor;
+
+                for (uint32_t h = 0; h < height; h++)
+                    dequantize_row(data + (c * height + h) * width, raw_bytes + (size_t)(h * channel + c) * width_aligned * elem_size, is_int16, width, c_scale);
             }
             break;
         case KP_CHANNEL_ORDERING_CVT_CHW2HCW:
-            for (int h = 0; h < float_node_output->height; h++)
+            for (uint32_t h = 0; h < height; h++)
             {
-                for (int c = 0; c < float_node_output->channel; c++)
-                {
-                    for (int w = 0; w < float_node_output->width; w++)
-                        float_node_output->data[n++] = (float)((int8_t *)(raw_fixed_node_output->data))[(c * float_node_output->height * width_aligned) +
-                                                                                                        (h * width_aligned) +
-                                                                                                         w] / ffactor;
-                }
+                for (uint32_t c = 0; c < channel; c++)
+                    dequantize_row(data + (h * channel + c) * width, raw_bytes + (size_t)(c * height + h) * width_aligned * elem_size, is_int16, width,
+                                   (NULL != channel_scale) ? channel_scale[c] : inv_ffactor);
             }
             break;
         case KP_CHANNEL_ORDERING_CVT_HCW2HWC:
-            for (int h = 0; h < float_node_output->height; h++)
+            for (uint32_t h = 0; h < height; h++)
             {
-                for (int w = 0; w < float_node_output->width; w++)
-                {
-                    for (int c = 0; c < float_node_output->channel; c++)
-                        float_node_output->data[n++] = (float)((int8_t *)(raw_fixed_node_output->data))[(h * float_node_output->channel * width_aligned) +
-                                                                                                        (c * width_aligned) +
-                                                                                                         w] / ffactor;
-                }
+                float *out = data + h * width * channel;
+                uint8_t *in = raw_bytes + (size_t)h * channel * width_aligned * elem_size;
+
+                if (NULL != channel_scale)
+                    dequantize_transpose_per_row(out, channel, in, is_int16, width_aligned, channel, width, channel_scale);
+                else
+                    dequantize_transpose(out, channel, in, is_int16, width_aligned, channel, width, inv_ffactor);
             }
             break;
         case KP_CHANNEL_ORDERING_CVT_CHW2HWC:
-            for (int h = 0; h < float_node_output->height; h++)
+            for (uint32_t h = 0; h < height; h++)
             {
-                for (int w = 0; w < float_node_output->width; w++)
-                {
-                    for (int c = 0; c < float_node_output->channel; c++)
-                        float_node_output->data[n++] = (float)((int8_t *)(raw_fixed_node_output->data))[(c * float_node_output->height * width_aligned) +
-                                                                                                        (h * width_aligned) +
-                                                                                                         w] / ffactor;
-                }
+                float *out = data + h * width * channel;
+                uint8_t *in = raw_bytes + (size_t)h * width_aligned * elem_size;
+
+                if (NULL != channel_scale)
+                    dequantize_transpose_per_row(out, channel, in, is_int16, height * width_aligned, channel, width, channel_scale);
+                else
+                    dequantize_transpose(out, channel, in, is_int16, height * width_aligned, channel, width, inv_ffactor);
             }
             break;
         default:
-            for (int i = 0; i < float_node_output->height * float_node_output->channel; i++)
+            /* rows are in the NPU order, HCW on KL520 and CHW otherwise */
+            for (uint32_t i = 0; i < height * channel; i++)
             {
-                for (int j = 0; j < float_node_output->width; j++)
-                    float_node_output->data[n++] = (float)((int8_t *)(raw_fixed_node_output->data))[i * width_aligned + j] / ffactor;
+                uint32_t c = (KP_DEVICE_KL520 == product_id) ? i % channel : i / height;
+
+                dequantize_row(data + i * width, raw_bytes + (size_t)i * width_aligned * elem_size, is_int16, width,
+                               (NULL != channel_scale) ? channel_scale[c] : inv_ffactor);
             }
             break;
         }
     }
 
-    free(raw_fixed_node_output);
-
-    return float_node_output;
+    return KP_SUCCESS;
 }
 
-int kp_customized_inference_send(kp_device_group_t devices, void *header, int header_size, uint8_t *image, int image_size)
+kp_inf_raw_fixed_node_output_t *kp_generic_inference_retrieve_raw_fixed_node(uint32_t node_idx, uint8_t *raw_out_buffer)
 {
-    int ret;
-
-    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    kp_inf_raw_fixed_node_output_t *node_output = (kp_inf_raw_fixed_node_output_t *)malloc(sizeof(kp_inf_raw_fixed_node_output_t));
 
-    kp_usb_device_t *ll_dev = _devices_grp->ll_device[_devices_grp->cur_send++];
+    if (NULL == node_output)
+        return NULL;
 
-    if (_devices_grp->cur_send >= _devices_grp->num_device)
-        _devices_grp->cur_send = 0;
+    if (KP_SUCCESS != get_raw_fixed_node(node_idx, raw_out_buffer, node_output))
+    {
+        free(node_output);
+        return NULL;
+    }
 
-    // help user to set up header stamp
-    kp_inference_header_stamp_t *header_stamp = (kp_inference_header_stamp_t *)header;
+    return node_output;
+}
 
-    if ((MAX_INPUT_NODE_COUNT < header_stamp->total_image) ||
-        (header_stamp->image_index >= header_stamp->total_image)) {
+int kp_generic_inference_retrieve_raw_fixed_node_to_buffer(uint32_t node_idx, uint8_t *raw_out_buffer, kp_inf_raw_fixed_node_output_t *node_output)
+{
+    if ((NULL == raw_out_buffer) || (NULL == node_output))
         return KP_ERROR_INVALID_PARAM_12;
-    }
 
-    header_stamp->magic_type = KDP2_MAGIC_TYPE_INFERENCE;
-    header_stamp->total_size = header_size + image_size;
+    return get_raw_fixed_node(node_idx, raw_out_buffer, node_output);
+}
 
-    if (header_stamp->total_size > _devices_grp->ddr_attr.input_buffer_size)
-        return KP_ERROR_SEND_DATA_TOO_LARGE_15;
+kp_inf_fixed_node_output_t *kp_generic_inference_retrieve_fixed_node(uint32_t node_idx, uint8_t *raw_out_buffer, kp_channel_ordering_t ordering)
+{
+    kdp2_ipc_generic_raw_result_t *raw_result = (kdp2_ipc_generic_raw_result_t *)raw_out_buffer;
+    kp_inf_raw_fixed_node_output_t raw_fixed_node_output;
 
-    ret = kp_usb_write_data(ll_dev, header, header_size, _devices_grp->timeout);
-    int status = check_inf_desc_error(ret);
-    if (status != KP_SUCCESS)
-        return status;
+    if (KP_SUCCESS != get_raw_fixed_node(node_idx, raw_out_buffer, &raw_fixed_node_output))
+        return NULL;
+
+    kp_inf_fixed_node_output_t *fixed_node_output = (kp_inf_fixed_node_output_t *)malloc(get_fixed_node_size(&raw_fixed_node_output));
+
+    if (NULL == fixed_node_output)
+    {
+        printf("memory is insufficient to allocate buffer for node output\n");
+        return NULL;
+    }
 
-    if (image) // someimtes image buffer could be null
+    if (KP_SUCCESS != convert_fixed_node(&raw_fixed_node_output, raw_result->product_id, ordering, fixed_node_output))
     {
-        ret = kp_usb_write_data(ll_dev, image, image_size, _devices_grp->timeout);
-        status = check_send_image_error(ret);
-        if (status != KP_SUCCESS)
-            return status;
+        free(fixed_node_output);
+        return NULL;
     }
 
-    return KP_SUCCESS;
+    return fixed_node_output;
 }
 
-int kp_customized_inference_receive(kp_device_group_t devices, void *result_buffer, int buf_size, int *recv_size)
+int kp_generic_inference_retrieve_fixed_node_to_buffer(uint32_t node_idx, uint8_t *raw_out_buffer, kp_channel_ordering_t ordering, kp_inf_fixed_node_output_t *node_output, uint32_t buf_size)
 {
-    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    kdp2_ipc_generic_raw_result_t *raw_result = (kdp2_ipc_generic_raw_result_t *)raw_out_buffer;
+    kp_inf_raw_fixed_node_output_t raw_fixed_node_output;
 
-    kp_usb_device_t *ll_dev = _devices_grp->ll_device[_devices_grp->cur_recv++];
+    if ((NULL == raw_out_buffer) || (NULL == node_output))
+        return KP_ERROR_INVALID_PARAM_12;
 
-    if (_devices_grp->cur_recv >= _devices_grp->num_device)
-        _devices_grp->cur_recv = 0;
+    int ret = get_raw_fixed_node(node_idx, raw_out_buffer, &raw_fixed_node_output);
 
-    // if return < 0 means libusb error, otherwise return  received size
-    int usb_ret = kp_usb_read_data(ll_dev, result_buffer, buf_size, _devices_grp->timeout);
-    if (usb_ret < 0)
-        return usb_ret;
+    if (KP_SUCCESS != ret)
+        return ret;
 
-    *recv_size = usb_ret;
+    if (get_fixed_node_size(&raw_fixed_node_output) > buf_size)
+        return KP_ERROR_BUFFER_TOO_SMALL_53;
+
+    return convert_fixed_node(&raw_fixed_node_output, raw_result->product_id, ordering, node_output);
+}
+
+kp_inf_float_node_output_t *kp_generic_inference_retrieve_float_node(uint32_t node_idx, uint8_t *raw_out_buffer, kp_channel_ordering_t ordering)
+{
+    kdp2_ipc_generic_raw_result_t *raw_result = (kdp2_ipc_generic_raw_result_t *)raw_out_buffer;
+    kp_inf_raw_fixed_node_output_t raw_fixed_node_output;
+
+    if (KP_SUCCESS != get_raw_fixed_node(node_idx, raw_out_buffer, &raw_fixed_node_output))
+        return NULL;
+
+    kp_inf_float_node_output_t *float_node_output = (kp_inf_float_node_output_t *)malloc(get_float_node_size(&raw_fixed_node_output));
+
+    if (NULL == float_node_output)
+    {
+        printf("memory is insufficient to allocate buffer for node output\n");
+        return NULL;
+    }
+
+    if (KP_SUCCESS != convert_float_node(&raw_fixed_node_output, raw_result->product_id, ordering, NULL, float_node_output))
+    {
+        free(float_node_output);
+        return NULL;
+    }
+
+    return float_node_output;
+}
+
+int kp_generic_inference_retrieve_float_node_to_buffer(uint32_t node_idx, uint8_t *raw_out_buffer, kp_channel_ordering_t ordering, kp_inf_float_node_output_t *node_output, uint32_t buf_size)
+{
+    kdp2_ipc_generic_raw_result_t *raw_result = (kdp2_ipc_generic_raw_result_t *)raw_out_buffer;
+    kp_inf_raw_fixed_node_output_t raw_fixed_node_output;
+
+    if ((NULL == raw_out_buffer) || (NULL == node_output))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    int ret = get_raw_fixed_node(node_idx, raw_out_buffer, &raw_fixed_node_output);
+
+    if (KP_SUCCESS != ret)
+        return ret;
+
+    if (get_float_node_size(&raw_fixed_node_output) > buf_size)
+        return KP_ERROR_BUFFER_TOO_SMALL_53;
+
+    return convert_float_node(&raw_fixed_node_output, raw_result->product_id, ordering, NULL, node_output);
+}
+
+int kp_generic_inference_retrieve_float_node_per_channel_to_buffer(kp_single_model_descriptor_t *model_desc, uint32_t node_idx, uint8_t *raw_out_buffer, kp_channel_ordering_t ordering,
+                                                                   kp_inf_float_node_output_t *node_output, uint32_t buf_size)
+{
+    kdp2_ipc_generic_raw_result_t *raw_result = (kdp2_ipc_generic_raw_result_t *)raw_out_buffer;
+    kp_inf_raw_fixed_node_output_t raw_fixed_node_output;
+    kp_quantization_parameters_t *quantization_parameters = NULL;
+    const float *channel_scale = NULL;
+
+    if ((NULL == model_desc) || (NULL == raw_out_buffer) || (NULL == node_output))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    for (uint32_t i = 0; i < model_desc->output_nodes_num; i++)
+    {
+        if (node_idx == model_desc->output_nodes[i].index)
+        {
+            quantization_parameters = &model_desc->output_nodes[i].quantization_parameters;
+            break;
+        }
+    }
+
+    if (NULL == quantization_parameters)
+        return KP_ERROR_INVALID_PARAM_12;
+
+    int ret = get_raw_fixed_node(node_idx, raw_out_buffer, &raw_fixed_node_output);
+
+    if (KP_SUCCESS != ret)
+        return ret;
+
+    if (get_float_node_size(&raw_fixed_node_output) > buf_size)
+        return KP_ERROR_BUFFER_TOO_SMALL_53;
+
+    /* per-tensor quantized nodes have a single descriptor, the metadata scale/radix is used for them */
+    if ((1 < raw_fixed_node_output.metadata.channel) &&
+        (raw_fixed_node_output.metadata.channel == quantization_parameters->quantized_fixed_point_descriptor_num))
+    {
+        channel_scale = get_quantization_float_scale(quantization_parameters);
+
+        /* descriptors not built by kp_load_model() have no precomputed factors */
+        if ((NULL == channel_scale) && (NULL != quantization_parameters->quantized_fixed_point_descriptor))
+        {
+            float *scale = (float *)malloc(quantization_parameters->quantized_fixed_point_descriptor_num * sizeof(float));
+
+            if (NULL == scale)
+                return KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+
+            for (uint32_t i = 0; i < quantization_parameters->quantized_fixed_point_descriptor_num; i++)
+                scale[i] = dequantize_float_scale(quantization_parameters->quantized_fixed_point_descriptor[i].scale,
+                                                  quantization_parameters->quantized_fixed_point_descriptor[i].radix);
+
+            ret = convert_float_node(&raw_fixed_node_output, raw_result->product_id, ordering, scale, node_output);
+            free(scale);
+
+            return ret;
+        }
+    }
+
+    return convert_float_node(&raw_fixed_node_output, raw_result->product_id, ordering, channel_scale, node_output);
+}
+
+int kp_generic_inference_get_all_float_nodes_size(kp_single_model_descriptor_t *model_desc, uint32_t *buf_size)
+{
+    if ((NULL == model_desc) || (NULL == buf_size))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    uint32_t size = 0;
+
+    for (uint32_t i = 0; i < model_desc->output_nodes_num; i++)
+    {
+        kp_tensor_descriptor_t *node = &model_desc->output_nodes[i];
+        uint32_t num_data = 1;
+
+        if (0 == node->shape_npu_len)
+            return KP_ERROR_INVALID_MODEL_21;
+
+        // npu shape is batch x channel x height x width, batch is always 1
+        for (uint32_t j = 0; j < node->shape_npu_len; j++)
+            num_data *= node->shape_npu[j];
+
+        size += sizeof(kp_inf_float_node_output_t) + num_data * sizeof(float);
+    }
+
+    *buf_size = size;
+
+    return KP_SUCCESS;
+}
+
+int kp_generic_inference_retrieve_all_float_nodes(uint8_t *raw_out_buffer, kp_channel_ordering_t ordering, void *buf, uint32_t buf_size,
+                                                  kp_inf_float_node_output_t *node_outputs[], uint32_t *num_nodes)
+{
+    kdp2_ipc_generic_raw_result_t *raw_result = (kdp2_ipc_generic_raw_result_t *)raw_out_buffer;
+    kp_inf_raw_fixed_node_output_t raw_fixed_node_output;
+    uint32_t used_size = 0;
+
+    if ((NULL == raw_out_buffer) || (NULL == buf) || (NULL == node_outputs) || (NULL == num_nodes))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    uint32_t num_output_node = get_raw_output_node_number(raw_result->product_id, raw_out_buffer + sizeof(kdp2_ipc_generic_raw_result_t));
+
+    if (num_output_node > *num_nodes)
+        return KP_ERROR_BUFFER_TOO_SMALL_53;
+
+    // nodes are laid out back to back, every node size is a multiple of 4 so the floats stay aligned
+    for (uint32_t i = 0; i < num_output_node; i++)
+    {
+        int ret = get_raw_fixed_node(i, raw_out_buffer, &raw_fixed_node_output);
+
+        if (KP_SUCCESS != ret)
+            return ret;
+
+        uint32_t node_size = get_float_node_size(&raw_fixed_node_output);
+
+        if (node_size > buf_size - used_size)
+            return KP_ERROR_BUFFER_TOO_SMALL_53;
+
+        node_outputs[i] = (kp_inf_float_node_output_t *)((uint8_t *)buf + used_size);
+
+        ret = convert_float_node(&raw_fixed_node_output, raw_result->product_id, ordering, NULL, node_outputs[i]);
+
+        if (KP_SUCCESS != ret)
+            return ret;
+
+        used_size += node_size;
+    }
+
+    *num_nodes = num_output_node;
+
+    return KP_SUCCESS;
+}
+
+int kp_generic_inference_retrieve_tensor_view(uint32_t node_idx, uint8_t *raw_out_buffer, kp_inf_tensor_view_t *view)
+{
+    kdp2_ipc_generic_raw_result_t *raw_result = (kdp2_ipc_generic_raw_result_t *)raw_out_buffer;
+    kp_inf_raw_fixed_node_output_t raw_fixed_node_output;
+
+    if ((NULL == raw_out_buffer) || (NULL == view))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    int ret = get_raw_fixed_node(node_idx, raw_out_buffer, &raw_fixed_node_output);
+
+    if (KP_SUCCESS != ret)
+        return ret;
+
+    kp_inf_raw_fixed_node_metadata_t *metadata = &raw_fixed_node_output.metadata;
+
+    view->width = metadata->width;
+    view->height = metadata->height;
+    view->channel = metadata->channel;
+    view->radix = metadata->radix;
+    view->scale = metadata->scale;
+    view->float_scale = dequantize_float_scale(metadata->scale, metadata->radix);
+    view->data_layout = metadata->data_layout;
+    view->fixed_point_dtype = (KP_MODEL_TENSOR_DATA_LAYOUT_8W1C16B == metadata->data_layout) ? KP_FIXED_POINT_DTYPE_INT16 : KP_FIXED_POINT_DTYPE_INT8;
+    view->data = raw_fixed_node_output.data;
+
+    if (KP_MODEL_TENSOR_DATA_LAYOUT_1W16C8B == metadata->data_layout)
+    {
+        /* channel blocks of height x width x 16 channels */
+        view->width_aligned = metadata->width;
+        view->channel_block_shift = 4; // KDP_CHANNEL_MIN_16
+        view->channel_block_stride = metadata->height * metadata->width * KDP_CHANNEL_MIN_16;
+        view->channel_stride = 1;
+        view->height_stride = metadata->width * KDP_CHANNEL_MIN_16;
+        view->width_stride = KDP_CHANNEL_MIN_16;
+    }
+    else
+    {
+        /* rows of padded width, in height x channel x width order on KL520 and channel x height x width order otherwise */
+        view->width_aligned = (KP_FIXED_POINT_DTYPE_INT16 == view->fixed_point_dtype) ? round_up(metadata->width, KDP_COL_MIN_8) : round_up(metadata->width, KDP_COL_MIN_16);
+        view->channel_block_shift = 0;
+        view->width_stride = 1;
+
+        if (KP_DEVICE_KL520 == raw_result->product_id)
+        {
+            view->channel_block_stride = view->width_aligned;
+            view->height_stride = metadata->channel * view->width_aligned;
+        }
+        else
+        {
+            view->channel_block_stride = metadata->height * view->width_aligned;
+            view->height_stride = view->width_aligned;
+        }
+
+        view->channel_stride = view->channel_block_stride;
+    }
+
+    return KP_SUCCESS;
+}
+
+int kp_tensor_view_read_row(const kp_inf_tensor_view_t *view, uint32_t c, uint32_t h, uint32_t w_begin, uint32_t num, float *values)
+{
+    if ((NULL == view) || (NULL == values) || (c >= view->channel) || (h >= view->height) || (w_begin > view->width) || (num > view->width - w_begin))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    bool is_int16 = (KP_FIXED_POINT_DTYPE_INT16 == view->fixed_point_dtype);
+    uint8_t *src = (uint8_t *)view->data + kp_tensor_view_offset(view, c, h, w_begin) * (is_int16 ? sizeof(int16_t) : sizeof(int8_t));
+
+    if (1 == view->width_stride)
+        dequantize_row(values, src, is_int16, num, view->float_scale);
+    else
+        dequantize_transpose(values, 1, src, is_int16, view->width_stride, num, 1, view->float_scale); // a gather of one column
+
+    return KP_SUCCESS;
+}
+
+int kp_tensor_view_read_channels(const kp_inf_tensor_view_t *view, uint32_t h, uint32_t w, uint32_t c_begin, uint32_t num, float *values)
+{
+    if ((NULL == view) || (NULL == values) || (h >= view->height) || (w >= view->width) || (c_begin > view->channel) || (num > view->channel - c_begin))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    bool is_int16 = (KP_FIXED_POINT_DTYPE_INT16 == view->fixed_point_dtype);
+    size_t elem_size = is_int16 ? sizeof(int16_t) : sizeof(int8_t);
+    uint32_t channel_block = 1 << view->channel_block_shift;
+
+    /* channels of a block are read together, then the next block */
+    while (0 < num)
+    {
+        uint8_t *src = (uint8_t *)view->data + kp_tensor_view_offset(view, c_begin, h, w) * elem_size;
+        uint32_t num_c = MIN(num, channel_block - (c_begin & (channel_block - 1)));
+
+        if (1 == channel_block)
+        {
+            // one channel per block, the blocks are gathered at once
+            num_c = num;
+            dequantize_transpose(values, 1, src, is_int16, view->channel_block_stride, num_c, 1, view->float_scale);
+        }
+        else if (1 == view->channel_stride)
+        {
+            dequantize_row(values, src, is_int16, num_c, view->float_scale);
+        }
+        else
+        {
+            dequantize_transpose(values, 1, src, is_int16, view->channel_stride, num_c, 1, view->float_scale);
+        }
+
+        values += num_c;
+        c_begin += num_c;
+        num -= num_c;
+    }
+
+    return KP_SUCCESS;
+}
+
+int kp_customized_inference_send(kp_device_group_t devices, void *header, int header_size, uint8_t *image, int image_size)
+{
+    int ret;
+
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+
+    // help user to set up header stamp
+    kp_inference_header_stamp_t *header_stamp = (kp_inference_header_stamp_t *)header;
+
+    if ((MAX_INPUT_NODE_COUNT < header_stamp->total_image) ||
+        (header_stamp->image_index >= header_stamp->total_image)) {
+        return KP_ERROR_INVALID_PARAM_12;
+    }
+
+    header_stamp->magic_type = KDP2_MAGIC_TYPE_INFERENCE;
+    header_stamp->total_size = header_size + image_size;
+
+    if (header_stamp->total_size > _devices_grp->ddr_attr.input_buffer_size)
+        return KP_ERROR_SEND_DATA_TOO_LARGE_15;
+
+    // the model of a customized header is not known, so it goes to any device
+    int dev_idx = acquire_send_device(_devices_grp, ANY_MODEL_ID);
+
+    // header and image are written in one go, so they are not interleaved with other senders of the device
+    kp_usb_buffer_t usb_buf[2] = {{header, header_size}, {image, image_size}};
+    int num_usb_buf = image ? 2 : 1; // someimtes image buffer could be null
+
+    // the device may be replaced by hotplug, so it is taken under the send lock
+    pthread_mutex_lock(&_devices_grp->send_mutex[dev_idx]);
+    ret = kp_usb_write_data_list(_devices_grp->ll_device[dev_idx], usb_buf, num_usb_buf, _devices_grp->timeout);
+    pthread_mutex_unlock(&_devices_grp->send_mutex[dev_idx]);
+
+    int status = check_send_image_error(ret);
+
+    // customized inference is not requeued, the caller gets the error but the device is taken out of the group
+    if (retire_lost_device(_devices_grp, dev_idx, ret))
+        return status;
+
+    if (status != KP_SUCCESS)
+        release_device(_devices_grp, dev_idx);
+
+    return status;
+}
+
+int kp_customized_inference_receive(kp_device_group_t devices, void *result_buffer, int buf_size, int *recv_size)
+{
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+
+    int dev_idx = 0;
+
+    // results are received by the receiver threads
+    if (NULL != _devices_grp->async)
+        return KP_ERROR_ASYNC_INFERENCE_ENABLED_48;
+
+    // if return < 0 means libusb error, otherwise return  received size
+    int usb_ret = receive_from_any_device(_devices_grp, result_buffer, buf_size, &dev_idx);
+    if (usb_ret < 0)
+        return usb_ret;
+
+    release_device(_devices_grp, dev_idx);
+
+    *recv_size = usb_ret;
 
     // verify result buffer
     int status = verify_result_header_stamp((kp_inference_header_stamp_t *)result_buffer, 0, 0);
@@ -1105,16 +1945,438 @@ int kp_customized_inference_receive(kp_device_group_t devices, void *result_buff
     return KP_SUCCESS;
 }
 
-int kp_customized_command_send(kp_device_group_t devices, void *cmd, int cmd_size, void *return_buf, int return_buf_size)
+#define ASYNC_WAIT_SLICE_MS 100 // receiver threads check the stop request in this interval
+
+// completion queue is an intrusive multi-producer single-consumer queue (D. Vyukov),
+// producers push with one atomic exchange and never block each other
+static void completion_queue_init(_kp_async_inference_t *async)
+{
+    async->queue_stub.next = NULL;
+    async->queue_head = &async->queue_stub;
+    async->queue_tail = &async->queue_stub;
+}
+
+static void completion_queue_push(_kp_async_inference_t *async, _kp_async_result_t *node)
+{
+    __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+    _kp_async_result_t *prev = __atomic_exchange_n(&async->queue_head, node, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+}
+
+// return NULL if the queue is empty or a push is not finished yet, must be called with poll_mutex locked
+static _kp_async_result_t *completion_queue_pop(_kp_async_inference_t *async)
+{
+    _kp_async_result_t *tail = async->queue_tail;
+    _kp_async_result_t *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    if (tail == &async->queue_stub) {
+        if (NULL == next)
+            return NULL;
+
+        async->queue_tail = next;
+        tail = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+    }
+
+    if (NULL != next) {
+        async->queue_tail = next;
+        return tail;
+    }
+
+    if (tail != __atomic_load_n(&async->queue_head, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    // tail is the only node, push the stub back so tail can be detached
+    completion_queue_push(async, &async->queue_stub);
+
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (NULL != next) {
+        async->queue_tail = next;
+        return tail;
+    }
+
+    return NULL;
+}
+
+static void put_async_result(_kp_async_inference_t *async, _kp_async_result_t *node)
+{
+    pthread_mutex_lock(&async->result_mutex);
+    node->next = async->free_list;
+    async->free_list = node;
+    pthread_mutex_unlock(&async->result_mutex);
+}
+
+static _kp_async_result_t *get_async_result(_kp_devices_group_t *_devices_grp, _kp_async_inference_t *async)
+{
+    pthread_mutex_lock(&async->result_mutex);
+
+    _kp_async_result_t *node = async->free_list;
+    if (NULL != node)
+        async->free_list = node->next;
+
+    pthread_mutex_unlock(&async->result_mutex);
+
+    if (NULL != node)
+        return node;
+
+    node = (_kp_async_result_t *)calloc(1, sizeof(_kp_async_result_t));
+    if (NULL == node)
+        return NULL;
+
+    node->result.raw_out_buffer = (uint8_t *)kp_alloc_io_buffer((kp_device_group_t)_devices_grp, async->buf_size);
+    if (NULL == node->result.raw_out_buffer) {
+        free(node);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&async->result_mutex);
+    node->all_next = async->all_list;
+    async->all_list = node;
+    pthread_mutex_unlock(&async->result_mutex);
+
+    return node;
+}
+
+// parse received data (or usb error) into the result, and release the device if its inference is done
+static void parse_async_result(_kp_devices_group_t *_devices_grp, int dev_idx, kp_inference_result_t *result, int usb_ret)
+{
+    uint8_t *raw_out_buffer = result->raw_out_buffer;
+    kp_generic_image_inference_result_header_t *header = &result->header;
+
+    memset(header, 0, sizeof(kp_generic_image_inference_result_header_t));
+    result->port_id = _devices_grp->ll_device[dev_idx]->dev_descp.port_id;
+    result->job_id = 0;
+    result->raw_out_size = 0;
+
+    if (usb_ret < 0) {
+        clear_in_flight(_devices_grp, dev_idx);
+
+        result->status = usb_ret;
+        return;
+    }
+
+    kp_inference_header_stamp_t *stamp = (kp_inference_header_stamp_t *)raw_out_buffer;
+    bool is_last_crop = true;
+
+    result->raw_out_size = usb_ret;
+    result->job_id = stamp->job_id;
+    result->status = verify_result_header_stamp(stamp, 0, 0);
+
+    if (KP_SUCCESS == result->status) {
+        if (KDP2_INF_ID_GENERIC_RAW == stamp->job_id) {
+            kdp2_ipc_generic_raw_result_t *ipc_result = (kdp2_ipc_generic_raw_result_t *)raw_out_buffer;
+
+            is_last_crop = (1 == ipc_result->is_last_crop);
+            header->inference_number = ipc_result->inf_number;
+            header->crop_number = ipc_result->crop_number;
+            header->product_id = ipc_result->product_id;
+            header->num_output_node = get_raw_output_node_number(ipc_result->product_id, raw_out_buffer + sizeof(kdp2_ipc_generic_raw_result_t));
+            header->num_pre_proc_info = ipc_result->num_of_pre_proc_info;
+            memcpy(header->pre_proc_info, ipc_result->pre_proc_info, header->num_pre_proc_info * sizeof(kp_hw_pre_proc_info_t));
+        } else if (KDP2_INF_ID_GENERIC_RAW_BYPASS_PRE_PROC == stamp->job_id) {
+            kdp2_ipc_generic_raw_bypass_pre_proc_result_t *ipc_result = (kdp2_ipc_generic_raw_bypass_pre_proc_result_t *)raw_out_buffer;
+
+            is_last_crop = (1 == ipc_result->is_last_crop);
+            header->inference_number = ipc_result->inf_number;
+            header->crop_number = ipc_result->crop_number;
+            header->product_id = ipc_result->product_id;
+            header->num_output_node = get_raw_output_node_number(ipc_result->product_id, raw_out_buffer + sizeof(kdp2_ipc_generic_raw_bypass_pre_proc_result_t));
+        }
+    }
+
+    if (is_last_crop)
+        finish_inference(_devices_grp, dev_idx, KP_SUCCESS == result->status, header->inference_number);
+}
+
+static void *async_receiver_thread(void *data)
+{
+    _kp_async_receiver_t *receiver = (_kp_async_receiver_t *)data;
+    _kp_devices_group_t *_devices_grp = receiver->devices_grp;
+    _kp_async_inference_t *async = _devices_grp->async;
+    int dev_idx = receiver->dev_idx;
+    kp_usb_device_t *ll_dev = _devices_grp->ll_device[dev_idx];
+    bool *active = &_devices_grp->dev_active[dev_idx]; // cleared when hotplug takes the device out
+
+    while (__atomic_load_n(&async->running, __ATOMIC_ACQUIRE) && __atomic_load_n(active, __ATOMIC_ACQUIRE)) {
+        _kp_async_result_t *node = get_async_result(_devices_grp, async);
+        if (NULL == node) {
+            usleep(ASYNC_WAIT_SLICE_MS * 1000); // out of memory, results in user hands may be released later
+            continue;
+        }
+
+        int index = 0;
+        int usb_ret = kp_usb_submit_read(ll_dev, node->result.raw_out_buffer, async->buf_size);
+
+        if (KP_USB_RET_OK == usb_ret) {
+            do {
+                usb_ret = kp_usb_wait_read_any(&ll_dev, 1, ASYNC_WAIT_SLICE_MS, &index);
+            } while (KP_USB_RET_PENDING == usb_ret && __atomic_load_n(&async->running, __ATOMIC_ACQUIRE) && __atomic_load_n(active, __ATOMIC_ACQUIRE));
+        }
+
+        if (KP_USB_RET_PENDING == usb_ret || KP_USB_USB_INVALID_PARAM == usb_ret) {
+            // stopped, or the posted read is cancelled by flushing device buffers
+            kp_usb_cancel_read(ll_dev);
+            put_async_result(async, node);
+            continue;
+        }
+
+        // inferences of the lost device are sent to other devices, their results come from there
+        if (retire_lost_device(_devices_grp, dev_idx, usb_ret)) {
+            put_async_result(async, node);
+            break;
+        }
+
+        parse_async_result(_devices_grp, dev_idx, &node->result, usb_ret);
+
+        if (NULL != async->callback) {
+            async->callback(&node->result, async->user_data);
+            put_async_result(async, node);
+        } else {
+            completion_queue_push(async, node);
+            sem_post(&async->queue_count);
+        }
+
+        if (usb_ret < 0)
+            break; // device is gone, the error result is the last one of this device
+    }
+
+    return NULL;
+}
+
+// start the receiver of a device, called with slot_mutex locked
+int async_attach_device(_kp_devices_group_t *_devices_grp, int dev_idx)
+{
+    _kp_async_inference_t *async = _devices_grp->async;
+
+    if (NULL == async)
+        return KP_SUCCESS;
+
+    _kp_async_receiver_t *receiver = &async->receiver[dev_idx];
+
+    receiver->devices_grp = _devices_grp;
+    receiver->dev_idx = dev_idx;
+
+    if (0 != pthread_create(&receiver->thread, NULL, async_receiver_thread, receiver))
+        return KP_ERROR_OTHER_99;
+
+    receiver->created = true;
+
+    return KP_SUCCESS;
+}
+
+// wait for the receiver of a device to end, called with slot_mutex locked
+void async_detach_device(_kp_devices_group_t *_devices_grp, int dev_idx)
+{
+    _kp_async_inference_t *async = _devices_grp->async;
+
+    if (NULL == async || !async->receiver[dev_idx].created)
+        return;
+
+    pthread_join(async->receiver[dev_idx].thread, NULL);
+    async->receiver[dev_idx].created = false;
+}
+
+int kp_inference_start_async(kp_device_group_t devices, uint32_t buf_size, kp_inference_callback_t callback, void *user_data)
+{
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+
+    if (NULL != _devices_grp->async)
+        return KP_ERROR_ASYNC_INFERENCE_ENABLED_48;
+
+    if (0 == buf_size)
+        return KP_ERROR_INVALID_PARAM_12;
+
+    _kp_async_inference_t *async = (_kp_async_inference_t *)calloc(1, sizeof(_kp_async_inference_t) + _devices_grp->capacity * sizeof(_kp_async_receiver_t));
+    if (NULL == async)
+        return KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+
+    async->running = 1;
+    async->buf_size = buf_size;
+    async->callback = callback;
+    async->user_data = user_data;
+
+    completion_queue_init(async);
+    sem_init(&async->queue_count, 0, 0);
+    pthread_mutex_init(&async->poll_mutex, NULL);
+    pthread_mutex_init(&async->result_mutex, NULL);
+
+    // reads posted by synchronous receiving are dropped, and async is set under recv_mutex so that direct reads of command replies see it
+    pthread_mutex_lock(&_devices_grp->recv_mutex);
+    for (int i = 0; i < _devices_grp->num_device; i++)
+        kp_usb_cancel_read(_devices_grp->ll_device[i]);
+
+    // devices added or removed by hotplug meanwhile get their receivers attached or detached under slot_mutex
+    pthread_mutex_lock(&_devices_grp->slot_mutex);
+
+    _devices_grp->async = async;
+
+    int ret = KP_SUCCESS;
+    for (int i = 0; i < _devices_grp->num_device && KP_SUCCESS == ret; i++) {
+        if (_devices_grp->dev_active[i])
+            ret = async_attach_device(_devices_grp, i);
+    }
+
+    pthread_mutex_unlock(&_devices_grp->slot_mutex);
+    pthread_mutex_unlock(&_devices_grp->recv_mutex);
+
+    if (KP_SUCCESS != ret) {
+        kp_inference_stop_async(devices);
+        return ret;
+    }
+
+    return KP_SUCCESS;
+}
+
+// a receiver thread cannot join itself, nor free the async state it is running on
+bool is_async_receiver_thread(_kp_devices_group_t *_devices_grp)
+{
+    _kp_async_inference_t *async = _devices_grp->async;
+    pthread_t self = pthread_self();
+
+    if (NULL == async)
+        return false;
+
+    for (int i = 0; i < _devices_grp->capacity; i++) {
+        if (async->receiver[i].created && pthread_equal(async->receiver[i].thread, self))
+            return true;
+    }
+
+    return false;
+}
+
+int kp_inference_stop_async(kp_device_group_t devices)
+{
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    _kp_async_inference_t *async = _devices_grp->async;
+
+    if (NULL == async)
+        return KP_ERROR_ASYNC_INFERENCE_NOT_ENABLED_49;
+
+    if (is_async_receiver_thread(_devices_grp))
+        return KP_ERROR_NOT_ALLOWED_IN_CALLBACK_54;
+
+    pthread_mutex_lock(&_devices_grp->slot_mutex);
+
+    __atomic_store_n(&async->running, 0, __ATOMIC_RELEASE);
+    kp_usb_notify_read_any();
+
+    for (int i = 0; i < _devices_grp->capacity; i++)
+        async_detach_device(_devices_grp, i);
+
+    _devices_grp->async = NULL;
+
+    pthread_mutex_unlock(&_devices_grp->slot_mutex);
+
+    while (NULL != async->all_list) {
+        _kp_async_result_t *node = async->all_list;
+        async->all_list = node->all_next;
+
+        kp_free_io_buffer(devices, node->result.raw_out_buffer);
+        free(node);
+    }
+
+    sem_destroy(&async->queue_count);
+    pthread_mutex_destroy(&async->poll_mutex);
+    pthread_mutex_destroy(&async->result_mutex);
+    free(async);
+
+    return KP_SUCCESS;
+}
+
+int kp_inference_poll(kp_device_group_t devices, int timeout, kp_inference_result_t **result)
 {
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    _kp_async_inference_t *async = _devices_grp->async;
     int ret;
 
+    if (NULL == async)
+        return KP_ERROR_ASYNC_INFERENCE_NOT_ENABLED_49;
+
+    if (NULL != async->callback || NULL == result)
+        return KP_ERROR_INVALID_PARAM_12;
+
+    if (0 > timeout) {
+        while (0 != (ret = sem_wait(&async->queue_count)) && EINTR == errno)
+            ;
+    } else if (0 == timeout) {
+        ret = sem_trywait(&async->queue_count);
+    } else {
+        struct timeval now;
+        struct timespec abstime;
+
+        gettimeofday(&now, NULL);
+        uint64_t nsec = (uint64_t)now.tv_usec * 1000 + (uint64_t)(timeout % 1000) * 1000000;
+        abstime.tv_sec = now.tv_sec + timeout / 1000 + nsec / 1000000000;
+        abstime.tv_nsec = nsec % 1000000000;
+
+        while (0 != (ret = sem_timedwait(&async->queue_count, &abstime)) && EINTR == errno)
+            ;
+    }
+
+    if (0 != ret)
+        return KP_ERROR_POLL_TIMEOUT_50;
+
+    // a result is counted, it can be invisible only for the moment its push is in progress
+    _kp_async_result_t *node;
+
+    pthread_mutex_lock(&async->poll_mutex);
+    while (NULL == (node = completion_queue_pop(async)))
+        sched_yield();
+    pthread_mutex_unlock(&async->poll_mutex);
+
+    *result = &node->result;
+
+    return KP_SUCCESS;
+}
+
+int kp_inference_release_result(kp_device_group_t devices, kp_inference_result_t *result)
+{
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    _kp_async_inference_t *async = _devices_grp->async;
+
+    if (NULL == async)
+        return KP_ERROR_ASYNC_INFERENCE_NOT_ENABLED_49;
 
-    kp_usb_device_t *ll_dev = _devices_grp->ll_device[_devices_grp->cur_send++];
+    if (NULL == result)
+        return KP_ERROR_INVALID_PARAM_12;
+
+    _kp_async_result_t *node = (_kp_async_result_t *)((uint8_t *)result - offsetof(_kp_async_result_t, result));
+    put_async_result(async, node);
+
+    return KP_SUCCESS;
+}
+
+// pick a device whose reply is read directly, called with recv_mutex locked so that receiving posts no read meanwhile;
+// in_flight tells whether the device must have inference in progress, and it is returned with send_mutex locked
+// so that no inference is sent to it before the reply is read
+static int acquire_reply_device(_kp_devices_group_t *_devices_grp, uint32_t *ticket, bool in_flight)
+{
+    int num_device = __atomic_load_n(&_devices_grp->num_device, __ATOMIC_ACQUIRE);
+    int first = take_ticket(ticket, num_device);
+
+    for (int i = 0; i < num_device; i++) {
+        int idx = (first + i) % num_device;
+
+        // a sender may be blocked in writing until results are received, which needs recv_mutex
+        if (0 != pthread_mutex_trylock(&_devices_grp->send_mutex[idx]))
+            continue;
 
-    if (_devices_grp->cur_send >= _devices_grp->num_device)
-        _devices_grp->cur_send = 0;
+        if (__atomic_load_n(&_devices_grp->dev_active[idx], __ATOMIC_ACQUIRE) &&
+            (in_flight == (0 < __atomic_load_n(&_devices_grp->in_flight[idx], __ATOMIC_RELAXED))) &&
+            (NULL == _devices_grp->ll_device[idx]->posted_buf))
+            return idx;
+
+        pthread_mutex_unlock(&_devices_grp->send_mutex[idx]);
+    }
+
+    return -1;
+}
+
+int kp_customized_command_send(kp_device_group_t devices, void *cmd, int cmd_size, void *return_buf, int return_buf_size)
+{
+    int ret;
+
+    _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
 
     // help user to set up header stamp
     kp_inference_header_stamp_t *header_stamp = (kp_inference_header_stamp_t *)cmd;
@@ -1124,11 +2386,29 @@ int kp_customized_command_send(kp_device_group_t devices, void *cmd, int cmd_siz
     if (header_stamp->total_size > _devices_grp->ddr_attr.input_buffer_size)
         return KP_ERROR_SEND_DATA_TOO_LARGE_15;
 
+    pthread_mutex_lock(&_devices_grp->recv_mutex);
+
+    // the reply would be taken by a receiver thread
+    if (NULL != _devices_grp->async) {
+        pthread_mutex_unlock(&_devices_grp->recv_mutex);
+        return KP_ERROR_ASYNC_INFERENCE_ENABLED_48;
+    }
+
+    int dev_idx = acquire_reply_device(_devices_grp, &_devices_grp->cur_send, false);
+    if (0 > dev_idx) {
+        pthread_mutex_unlock(&_devices_grp->recv_mutex);
+        return KP_ERROR_USB_BUSY_N6;
+    }
+
+    kp_usb_device_t *ll_dev = _devices_grp->ll_device[dev_idx];
+
     ret = kp_usb_write_data(ll_dev, cmd, cmd_size, _devices_grp->timeout);
-    if (ret != KP_SUCCESS)
-        return ret;
+    if (ret == KP_SUCCESS)
+        ret = kp_usb_read_data(ll_dev, return_buf, return_buf_size, _devices_grp->timeout);
+
+    pthread_mutex_unlock(&_devices_grp->send_mutex[dev_idx]);
+    pthread_mutex_unlock(&_devices_grp->recv_mutex);
 
-    ret = kp_usb_read_data(ll_dev, return_buf, return_buf_size, _devices_grp->timeout);
     if (ret < 0)
         return ret;
 
@@ -1181,13 +2461,30 @@ int kp_dbg_receive_checkpoint_data(kp_device_group_t devices, void **checkpoint_
     }
 
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
-    kp_usb_device_t *ll_dev = _devices_grp->ll_device[_devices_grp->cur_recv++];
 
-    if (_devices_grp->cur_recv >= _devices_grp->num_device)
-        _devices_grp->cur_recv = 0;
+    pthread_mutex_lock(&_devices_grp->recv_mutex);
+
+    // checkpoint data would be taken by a receiver thread
+    if (NULL != _devices_grp->async) {
+        pthread_mutex_unlock(&_devices_grp->recv_mutex);
+        return KP_ERROR_ASYNC_INFERENCE_ENABLED_48;
+    }
+
+    // checkpoint data comes from a device doing inference
+    int dev_idx = acquire_reply_device(_devices_grp, &_devices_grp->cur_recv, true);
+    if (0 > dev_idx) {
+        pthread_mutex_unlock(&_devices_grp->recv_mutex);
+        return KP_ERROR_USB_BUSY_N6;
+    }
+
+    kp_usb_device_t *ll_dev = _devices_grp->ll_device[dev_idx];
+    pthread_mutex_unlock(&_devices_grp->send_mutex[dev_idx]);
 
     // if return < 0 means libusb error, otherwise return received size
     int usb_ret = kp_usb_read_data(ll_dev, dbg_buf, dbg_buf_size, _devices_grp->timeout);
+
+    pthread_mutex_unlock(&_devices_grp->recv_mutex);
+
     if (usb_ret < 0)
         return usb_ret;
 
@@ -125,8 +125,8 @@ int kp_set_ckey(kp_device_group_t devices, uint32_t ckey)
     cmd_buf.total_size = sizeof(kdp2_ipc_cmd_set_ckey_t);
     cmd_buf.ckey = ckey;
 
-    _set_ckey_command_package cmd_packs[MAX_GROUP_DEVICE];
-    pthread_t set_ckey_thd[MAX_GROUP_DEVICE];
+    _set_ckey_command_package cmd_packs[_devices_grp->num_device];
+    pthread_t set_ckey_thd[_devices_grp->num_device];
 
     cmd_packs[0].dev_idx = 0;
     cmd_packs[0].ll_device = ll_dev[0];
@@ -243,8 +243,8 @@ int kp_set_secure_boot_key(kp_device_group_t devices, uint32_t entry, uint32_t k
     cmd_buf.entry = entry;
     cmd_buf.key = key;
 
-    _set_sbt_key_command_package cmd_packs[MAX_GROUP_DEVICE];
-    pthread_t set_sbt_key_thd[MAX_GROUP_DEVICE];
+    _set_sbt_key_command_package cmd_packs[_devices_grp->num_device];
+    pthread_t set_sbt_key_thd[_devices_grp->num_device];
 
     cmd_packs[0].dev_idx = 0;
     cmd_packs[0].ll_device = ll_dev[0];
@@ -361,8 +361,8 @@ int kp_set_gpio(kp_device_group_t devices, uint32_t pin, uint32_t value)
     cmd_buf.pin = pin;
     cmd_buf.value = value;
 
-    _set_gpio_command_package cmd_packs[MAX_GROUP_DEVICE];
-    pthread_t set_gpio_thd[MAX_GROUP_DEVICE];
+    _set_gpio_command_package cmd_packs[_devices_grp->num_device];
+    pthread_t set_gpio_thd[_devices_grp->num_device];
 
     cmd_packs[0].dev_idx = 0;
     cmd_packs[0].ll_device = ll_dev[0];
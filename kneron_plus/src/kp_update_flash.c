@@ -41,6 +41,14 @@
 
 #define USB_REBOOT_WAIT_DELAY_US (3000 * 1000)
 
+#define FLASH_WRITE_CHUNK_SIZE (64 * 1024) // KL520 programs a chunk while receiving the next one
+#define FLASH_BLOCK_SIZE (4 * 1024)        // KL520 erases flash by 4KB, delta updates compare and write whole blocks
+#define FLASH_HASH_PROBE_TIMEOUT_MS 1000   // KL520 firmware not supporting KDP2_COMMAND_HASH_FLASH does not reply
+#define FLASH_HASH_MAX_BLOCKS 1024         // blocks hashed by a command, hashes and a block fit in the firmware command buffer
+
+#define KL520_FLASH_MODEL_FW_INFO_ADDR 0x00300000 // fw_info.bin, all_models.bin is in the next block
+#define KL520_FLASH_MODEL_ALL_ADDR 0x00301000
+
 typedef struct
 {
     int dev_idx;
@@ -51,10 +59,14 @@ typedef struct
     int timeout;
     bool auto_reboot;
     int sts;
+    kp_flash_write_statistics_t flash_write_stats;
 } _update_kdp2_firmware_package;
 
 int kp_write_data_to_flash(kp_usb_device_t *ll_dev, int timeout, uint32_t flash_offset,
-                           uint32_t length, uint8_t *buffer);
+                           uint32_t length, uint8_t *buffer, kp_flash_write_statistics_t *stats);
+
+int kp_write_changed_data_to_flash(kp_usb_device_t *ll_dev, int timeout, uint32_t flash_offset,
+                                   uint32_t length, uint8_t *buffer, kp_flash_write_statistics_t *stats);
 
 static int check_usb_read_data_error(int ret)
 {
@@ -102,7 +114,8 @@ static void *_update_kdp2_firmware_to_single_device(void *data)
 
             dbg_print("[%s][%d] Start switching to flash boot\n", __FUNCTION__, cmd_pack->dev_idx);
 
-            ret = kp_write_data_to_flash(ll_dev, cmd_pack->timeout, 0x00029000, 8, (uint8_t *)boot_type);
+            ret = kp_write_data_to_flash(ll_dev, cmd_pack->timeout, 0x00029000, 8, (uint8_t *)boot_type,
+                                         &cmd_pack->flash_write_stats);
 
             if (KP_SUCCESS != ret) {
                 cmd_pack->sts = ret;
@@ -113,7 +126,13 @@ static void *_update_kdp2_firmware_to_single_device(void *data)
         dbg_print("[%s][%d] device %p, fw_buf 0x%p, fw_size %d, fw_id %d, timeout %d\n", __FUNCTION__, cmd_pack->dev_idx,
                 ll_dev, cmd_pack->fw_buf, cmd_pack->fw_size, cmd_pack->fw_id, cmd_pack->timeout);
 
-        ret = kp_write_data_to_flash(ll_dev, cmd_pack->timeout, flash_offset, cmd_pack->fw_size, (uint8_t *)cmd_pack->fw_buf);
+        ret = kp_write_changed_data_to_flash(ll_dev, cmd_pack->timeout, flash_offset, cmd_pack->fw_size,
+                                             (uint8_t *)cmd_pack->fw_buf, &cmd_pack->flash_write_stats);
+
+        if (KP_ERROR_UNSUPPORTED_DEVICE_44 == ret) {
+            ret = kp_write_data_to_flash(ll_dev, cmd_pack->timeout, flash_offset, cmd_pack->fw_size, (uint8_t *)cmd_pack->fw_buf,
+                                         &cmd_pack->flash_write_stats);
+        }
     } else if (KP_DEVICE_KL630 == ll_dev->dev_descp.product_id) {
         /** update firmware */
         kdp2_ipc_cmd_update_firmware_t cmd_update_firmware_buf = {0};
@@ -296,7 +315,7 @@ static void *_update_single_device_to_kdp2_usb_boot(void *data)
 
     if (KP_DEVICE_KL520 == ll_dev->dev_descp.product_id) {
         char buffer[8] = "USB-BT..";
-        ret = kp_write_data_to_flash(ll_dev, cmd_pack->timeout, 0x00029000, 8, (uint8_t *)buffer);
+        ret = kp_write_data_to_flash(ll_dev, cmd_pack->timeout, 0x00029000, 8, (uint8_t *)buffer, NULL);
 
         if (KP_SUCCESS != ret) {
             dbg_print("[%s][%d] write cmd_buf failed, error %d\n", __FUNCTION__, cmd_pack->dev_idx, cmd_pack->sts);
@@ -460,8 +479,11 @@ typedef struct
     kdp_model_update_cmd_t *cmd_buf;
     void *total_model_buf;
     int total_model_size;
+    uint8_t *flash_image; // KL520 flash content of fw_info.bin and all_models.bin, NULL to update by KDP_CMD_UPDATE_MODEL
+    int flash_image_size;
     int timeout;
     int sts;
+    kp_flash_write_statistics_t flash_write_stats;
 } _update_model_command_package;
 
 static void *_update_model_to_single_device(void *data)
@@ -535,6 +557,41 @@ static void *_update_model_to_single_device(void *data)
     return NULL;
 }
 
+// write blocks of the models which differ from flash only, firmware not hashing flash is updated by KDP_CMD_UPDATE_MODEL
+static void *_update_changed_model_to_single_device(void *data)
+{
+    _update_model_command_package *cmd_pack = (_update_model_command_package *)data;
+    kp_usb_device_t *ll_dev = cmd_pack->ll_device;
+
+    int ret = kp_write_changed_data_to_flash(ll_dev, cmd_pack->timeout, KL520_FLASH_MODEL_FW_INFO_ADDR, cmd_pack->flash_image_size,
+                                             cmd_pack->flash_image, &cmd_pack->flash_write_stats);
+
+    if (KP_ERROR_UNSUPPORTED_DEVICE_44 == ret) {
+        return _update_model_to_single_device(data);
+    } else if (KP_SUCCESS != ret) {
+        cmd_pack->sts = ret;
+        dbg_print("[%s][%d] write changed models failed, error %d\n", __FUNCTION__, cmd_pack->dev_idx, cmd_pack->sts);
+        return NULL;
+    }
+
+    if (1 == cmd_pack->cmd_buf->auto_reboot) {
+        kp_usb_control_t kctrl = {KDP2_CONTROL_REBOOT, 0, 0};
+
+        // device may be gone before acknowledging it
+        kp_usb_control(ll_dev, &kctrl, cmd_pack->timeout);
+    }
+
+    // devices are re-connected after update, as KDP_CMD_UPDATE_MODEL does
+    usleep(USB_DISCONNECT_WAIT_DELAY_US);
+    kp_usb_disconnect_device(ll_dev);
+    usleep(USB_DISCONNECT_WAIT_DELAY_US);
+
+    cmd_pack->ll_device = NULL;
+    cmd_pack->sts = KP_SUCCESS;
+
+    return NULL;
+}
+
 typedef struct
 {
     kp_usb_device_t *ll_device;
@@ -677,10 +734,10 @@ int _kl630_update_kdp2_usb_loader(kp_device_group_t devices, void *usb_loader_bu
     {
         dbg_print("Start updating loader firmware...\n");
 
-        int port_id_list[MAX_GROUP_DEVICE] = {0};
+        int port_id_list[_devices_grp->num_device];
 
-        _update_kdp2_firmware_package cmd_packs[MAX_GROUP_DEVICE];
-        pthread_t update_fw_thd[MAX_GROUP_DEVICE];
+        _update_kdp2_firmware_package cmd_packs[_devices_grp->num_device];
+        pthread_t update_fw_thd[_devices_grp->num_device];
 
         cmd_packs[0].dev_idx = 0;
         cmd_packs[0].ll_device = ll_dev[0];
@@ -806,8 +863,25 @@ int _update_model(kp_device_group_t devices, void *nef_buf, int nef_size, bool a
     memcpy(total_model_buf, nef_info.fw_info_addr, fw_info_size);
     memcpy(total_model_buf + fw_info_size, nef_info.all_models_addr, all_models_size);
 
+    // KL520 flash holds fw_info.bin in its own block, so that unchanged blocks can be skipped
+    uint8_t *flash_image = NULL;
+    int flash_image_size = KL520_FLASH_MODEL_ALL_ADDR - KL520_FLASH_MODEL_FW_INFO_ADDR + all_models_size;
+
+    if ((KP_DEVICE_KL520 == _devices_grp->product_id) && (KL520_FLASH_MODEL_ALL_ADDR - KL520_FLASH_MODEL_FW_INFO_ADDR >= fw_info_size)) {
+        flash_image = (uint8_t *)malloc(flash_image_size);
+    }
+
+    if (NULL != flash_image) {
+        memset(flash_image, 0xFF, KL520_FLASH_MODEL_ALL_ADDR - KL520_FLASH_MODEL_FW_INFO_ADDR);
+        memcpy(flash_image, nef_info.fw_info_addr, fw_info_size);
+        memcpy(flash_image + KL520_FLASH_MODEL_ALL_ADDR - KL520_FLASH_MODEL_FW_INFO_ADDR, nef_info.all_models_addr, all_models_size);
+    }
+
+    void *(*update_model_to_single_device)(void *) = (NULL != flash_image) ? _update_changed_model_to_single_device
+                                                                            : _update_model_to_single_device;
+
     kdp_model_update_cmd_t cmd_buf;
-    int port_id_list[MAX_GROUP_DEVICE] = {0};
+    int port_id_list[_devices_grp->num_device];
 
     cmd_buf.preamble = KDP_MSG_HDR_CMD;
     cmd_buf.ctrl = 0;
@@ -817,15 +891,21 @@ int _update_model(kp_device_group_t devices, void *nef_buf, int nef_size, bool a
     cmd_buf.all_models_size = all_models_size;
     cmd_buf.auto_reboot = auto_reboot;
 
-    _update_model_command_package cmd_packs[MAX_GROUP_DEVICE];
-    pthread_t update_model_thd[MAX_GROUP_DEVICE];
+    _update_model_command_package cmd_packs[_devices_grp->num_device];
+    pthread_t update_model_thd[_devices_grp->num_device];
 
     cmd_packs[0].ll_device = ll_dev[0];
     cmd_packs[0].cmd_buf = &cmd_buf;
     cmd_packs[0].total_model_buf = total_model_buf;
     cmd_packs[0].total_model_size = total_model_size;
+    cmd_packs[0].flash_image = flash_image;
+    cmd_packs[0].flash_image_size = flash_image_size;
     cmd_packs[0].timeout = _devices_grp->timeout;
 
+    // devices not matching an encrypted model are not updated
+    for (int i = 0; i < _devices_grp->num_device; i++)
+        memset(&cmd_packs[i].flash_write_stats, 0, sizeof(kp_flash_write_statistics_t));
+
     port_id_list[0] = ll_dev[0]->dev_descp.port_id;
 
     for (int i = 1; i < _devices_grp->num_device; i++)
@@ -848,7 +928,7 @@ int _update_model(kp_device_group_t devices, void *nef_buf, int nef_size, bool a
         memcpy((void *)&cmd_packs[i], (void *)&cmd_packs[0], sizeof(_update_model_command_package));
         cmd_packs[i].ll_device = ll_dev[i];
 
-        int thd_ret = pthread_create(&update_model_thd[i], NULL, _update_model_to_single_device, (void *)&cmd_packs[i]);
+        int thd_ret = pthread_create(&update_model_thd[i], NULL, update_model_to_single_device, (void *)&cmd_packs[i]);
 
         if (0 != thd_ret) {
             dbg_print("[%s] thread creation failed ! error %d\n", __FUNCTION__, thd_ret);
@@ -869,7 +949,7 @@ int _update_model(kp_device_group_t devices, void *nef_buf, int nef_size, bool a
     }
 
     // current thread do first device
-    _update_model_to_single_device((void *)&cmd_packs[0]);
+    update_model_to_single_device((void *)&cmd_packs[0]);
 
 AFTER_UPDATE:
 
@@ -886,10 +966,23 @@ AFTER_UPDATE:
         }
     }
 
+    memset(&_devices_grp->flash_write_stats, 0, sizeof(kp_flash_write_statistics_t));
+
+    for (int i = 0; i < _devices_grp->num_device; i++) {
+        _devices_grp->flash_write_stats.bytes_written += cmd_packs[i].flash_write_stats.bytes_written;
+        _devices_grp->flash_write_stats.write_time_us += cmd_packs[i].flash_write_stats.write_time_us;
+        _devices_grp->flash_write_stats.bytes_unverified += cmd_packs[i].flash_write_stats.bytes_unverified;
+        _devices_grp->flash_write_stats.bytes_skipped += cmd_packs[i].flash_write_stats.bytes_skipped;
+    }
+
     free(total_model_buf);
+    free(flash_image);
 
-    if (KP_USB_RET_OK == ret) {
-        ret = load_model_info_from_nef(nef_buf, nef_size, _devices_grp->product_id, &metadata, &nef_info, &(_devices_grp->loaded_model_desc));
+    // the NEF CRC is checked before update, model_desc is built from the same NEF already
+    if ((KP_USB_RET_OK == ret) && (NULL != model_desc)) {
+        ret = share_model_nef_descriptor(model_desc, &(_devices_grp->loaded_model_desc));
+    } else if (KP_USB_RET_OK == ret) {
+        ret = load_model_info_from_nef_without_crc(nef_buf, nef_size, _devices_grp->product_id, &metadata, &nef_info, &(_devices_grp->loaded_model_desc));
     }
 
     dbg_print("Update model process finished, try to re-connect devices...\n");
@@ -950,7 +1043,7 @@ int _update_nef(kp_device_group_t devices, void *nef_buf, int nef_size, bool aut
          return KP_ERROR_INVALID_MODEL_21;
 
     kdp2_ipc_cmd_update_nef_t *cmd_buf = (kdp2_ipc_cmd_update_nef_t *)malloc(sizeof(kdp2_ipc_cmd_update_nef_t));
-    int port_id_list[MAX_GROUP_DEVICE] = {0};
+    int port_id_list[_devices_grp->num_device];
 
     cmd_buf->magic_type = KDP2_MAGIC_TYPE_COMMAND;
     cmd_buf->total_size = sizeof(kdp2_ipc_cmd_update_nef_t);
@@ -958,8 +1051,8 @@ int _update_nef(kp_device_group_t devices, void *nef_buf, int nef_size, bool aut
     cmd_buf->nef_size = nef_size;
     cmd_buf->auto_reboot = (true == auto_reboot) ? 1 : 0;
 
-    _update_nef_command_package cmd_packs[MAX_GROUP_DEVICE];
-    pthread_t update_nef_thd[MAX_GROUP_DEVICE];
+    _update_nef_command_package cmd_packs[_devices_grp->num_device];
+    pthread_t update_nef_thd[_devices_grp->num_device];
 
     cmd_packs[0].ll_device = _devices_grp->ll_device[0];
     cmd_packs[0].cmd_buf = cmd_buf;
@@ -985,7 +1078,7 @@ int _update_nef(kp_device_group_t devices, void *nef_buf, int nef_size, bool aut
         }
 
         dbg_print("[%s] create thread to update model to device %d\n", __FUNCTION__, i);
-        memcpy((void *)&cmd_packs[i], (void *)&cmd_packs[0], sizeof(_update_model_command_package));
+        memcpy((void *)&cmd_packs[i], (void *)&cmd_packs[0], sizeof(_update_nef_command_package));
         cmd_packs[i].ll_device = ll_dev[i];
 
         int thd_ret = pthread_create(&update_nef_thd[i], NULL, _update_nef_to_single_device, (void *)&cmd_packs[i]);
@@ -1028,8 +1121,9 @@ AFTER_UPDATE:
 
     free(cmd_buf);
 
-    if (KP_USB_RET_OK == ret) {
-        ret = load_model_info_from_nef(nef_buf, nef_size, _devices_grp->product_id, &metadata, &nef_info, &(_devices_grp->loaded_model_desc));
+    // the group descriptor is built before update
+    if ((KP_USB_RET_OK == ret) && (NULL != model_desc)) {
+        ret = share_model_nef_descriptor(&(_devices_grp->loaded_model_desc), model_desc);
     }
 
     dbg_print("Update model process finished, try to re-connect devices...\n");
@@ -1108,17 +1202,22 @@ int kp_read_data_from_flash(kp_usb_device_t *ll_dev, int timeout, uint32_t flash
     return ret;
 }
 
+// stats is accumulated if not NULL
 int kp_write_data_to_flash(kp_usb_device_t *ll_dev, int timeout, uint32_t flash_offset,
-                           uint32_t length, uint8_t *buffer)
+                           uint32_t length, uint8_t *buffer, kp_flash_write_statistics_t *stats)
 {
     kdp2_ipc_cmd_write_flash_t cmd_buf;
-    int32_t return_code = -1;
+    kdp2_ipc_response_write_flash_t response;
+    struct timeval t_start, t_end;
+
+    gettimeofday(&t_start, NULL);
 
     cmd_buf.magic_type = KDP2_MAGIC_TYPE_COMMAND;
     cmd_buf.total_size = sizeof(kdp2_ipc_cmd_write_flash_t);
     cmd_buf.command_id = KDP2_COMMAND_WRITE_FLASH;
     cmd_buf.flash_offset = flash_offset;
     cmd_buf.length = length;
+    cmd_buf.chunk_size = FLASH_WRITE_CHUNK_SIZE;
 
     int ret = kp_usb_write_data(ll_dev, (void *)&cmd_buf, cmd_buf.total_size, timeout);
     int status = check_usb_write_data_error(ret);
@@ -1126,19 +1225,160 @@ int kp_write_data_to_flash(kp_usb_device_t *ll_dev, int timeout, uint32_t flash_
         return status;
     }
 
+    // firmware programs every chunk while receiving the next one, so the whole buffer is sent at once
     ret = kp_usb_write_data(ll_dev, (void *)buffer, length, timeout);
     status = check_usb_write_data_error(ret);
     if (status != KP_SUCCESS) {
         return status;
     }
 
-    ret = kp_usb_read_data(ll_dev, (void *)&return_code, sizeof(int32_t), timeout);
+    ret = kp_usb_read_data(ll_dev, (void *)&response, sizeof(response), timeout);
     status = check_usb_read_data_error(ret);
     if (status != KP_SUCCESS) {
         return status;
     }
 
-    return return_code;
+    if (ret < (int)sizeof(int32_t)) {
+        return KP_ERROR_RECEIVE_SIZE_MISMATCH_31;
+    }
+
+    if (KP_SUCCESS != (int32_t)response.return_code) {
+        return (int32_t)response.return_code;
+    }
+
+    // firmware writing all data at once replies return code only, and the written data is not verified
+    if (ret == (int)sizeof(response) && response.sum32 != sum32_cal(buffer, length)) {
+        dbg_print("[%s] flash 0x%08X: sum32 0x%08X is read back, 0x%08X is written\n", __func__, flash_offset,
+                  response.sum32, sum32_cal(buffer, length));
+        return KP_ERROR_FLASH_VERIFY_FAILED_52;
+    }
+
+    gettimeofday(&t_end, NULL);
+
+    uint64_t elapsed_us = (uint64_t)(t_end.tv_sec - t_start.tv_sec) * 1000000 + t_end.tv_usec - t_start.tv_usec;
+
+    dbg_print("[%s] wrote %u bytes to flash 0x%08X in %llu us%s\n", __func__, length, flash_offset,
+              (unsigned long long)elapsed_us, (ret == (int)sizeof(response)) ? ", verified" : "");
+
+    if (NULL != stats) {
+        stats->bytes_written += length;
+        stats->write_time_us += elapsed_us;
+        stats->bytes_unverified += (ret == (int)sizeof(response)) ? 0 : length;
+    }
+
+    return KP_SUCCESS;
+}
+
+// FNV-1a of every block_size bytes, hashes must hold one more, KP_ERROR_UNSUPPORTED_DEVICE_44 if firmware does not support it
+int kp_hash_flash_blocks(kp_usb_device_t *ll_dev, int timeout, uint32_t flash_offset, uint32_t length,
+                         uint32_t block_size, uint32_t *hashes)
+{
+    kdp2_ipc_cmd_hash_flash_t cmd_buf;
+    uint32_t num_blocks = length / block_size;
+    int32_t return_code;
+
+    cmd_buf.magic_type = KDP2_MAGIC_TYPE_COMMAND;
+    cmd_buf.total_size = sizeof(kdp2_ipc_cmd_hash_flash_t);
+    cmd_buf.command_id = KDP2_COMMAND_HASH_FLASH;
+    cmd_buf.flash_offset = flash_offset;
+    cmd_buf.length = length;
+    cmd_buf.block_size = block_size;
+
+    int ret = kp_usb_write_data(ll_dev, (void *)&cmd_buf, cmd_buf.total_size, timeout);
+    int status = check_usb_write_data_error(ret);
+    if (status != KP_SUCCESS)
+        return status;
+
+    // firmware replies return code before reading flash
+    ret = kp_usb_read_data(ll_dev, (void *)&return_code, sizeof(int32_t), FLASH_HASH_PROBE_TIMEOUT_MS);
+
+    if (KP_USB_USB_TIMEOUT == ret) {
+        dbg_print("[%s] firmware does not support hashing flash\n", __func__);
+        return KP_ERROR_UNSUPPORTED_DEVICE_44;
+    }
+
+    status = check_usb_read_data_error(ret);
+    if (status != KP_SUCCESS)
+        return status;
+    else if (ret != sizeof(int32_t))
+        return KP_ERROR_RECEIVE_SIZE_MISMATCH_31;
+    else if (return_code != KP_SUCCESS)
+        return return_code;
+
+    // hashes are followed by return code of reading flash
+    ret = kp_usb_read_data(ll_dev, (void *)hashes, (num_blocks + 1) * sizeof(uint32_t), timeout);
+    status = check_usb_read_data_error(ret);
+    if (status != KP_SUCCESS)
+        return status;
+    else if (ret != (int)((num_blocks + 1) * sizeof(uint32_t)))
+        return KP_ERROR_RECEIVE_SIZE_MISMATCH_31;
+
+    return (int32_t)hashes[num_blocks];
+}
+
+// write the blocks which differ from flash only, the last block is compared as erased after the data,
+// KP_ERROR_UNSUPPORTED_DEVICE_44 if firmware does not tell flash content
+int kp_write_changed_data_to_flash(kp_usb_device_t *ll_dev, int timeout, uint32_t flash_offset,
+                                   uint32_t length, uint8_t *buffer, kp_flash_write_statistics_t *stats)
+{
+    uint32_t num_blocks = (length + FLASH_BLOCK_SIZE - 1) / FLASH_BLOCK_SIZE;
+
+    if (0 == num_blocks)
+        return KP_ERROR_INVALID_PARAM_12;
+
+    uint32_t *hashes = (uint32_t *)malloc((num_blocks + 1) * sizeof(uint32_t));
+    uint8_t *last_block = (uint8_t *)malloc(FLASH_BLOCK_SIZE);
+    int ret = KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+
+    if ((NULL == hashes) || (NULL == last_block))
+        goto FUNC_OUT;
+
+    // hashes of every piece are followed by its return code, which is overwritten by hashes of the next piece
+    for (uint32_t i = 0; i < num_blocks; i += FLASH_HASH_MAX_BLOCKS) {
+        uint32_t piece_blocks = (num_blocks - i < FLASH_HASH_MAX_BLOCKS) ? num_blocks - i : FLASH_HASH_MAX_BLOCKS;
+
+        ret = kp_hash_flash_blocks(ll_dev, timeout, flash_offset + i * FLASH_BLOCK_SIZE, piece_blocks * FLASH_BLOCK_SIZE,
+                                   FLASH_BLOCK_SIZE, hashes + i);
+
+        if (KP_SUCCESS != ret)
+            goto FUNC_OUT;
+    }
+
+    memset(last_block, 0xFF, FLASH_BLOCK_SIZE);
+    memcpy(last_block, buffer + (num_blocks - 1) * FLASH_BLOCK_SIZE, length - (num_blocks - 1) * FLASH_BLOCK_SIZE);
+
+    // runs of changed blocks are written one by one
+    for (uint32_t run_start = 0, i = 0; i <= num_blocks; i++) {
+        uint8_t *block = (i + 1 < num_blocks) ? buffer + i * FLASH_BLOCK_SIZE : last_block;
+        bool changed = (i < num_blocks) && (hashes[i] != fnv1a32_cal(block, FLASH_BLOCK_SIZE));
+
+        if (changed)
+            continue;
+
+        if (run_start < i) {
+            uint32_t offset = run_start * FLASH_BLOCK_SIZE;
+            uint32_t size = ((i < num_blocks) ? i * FLASH_BLOCK_SIZE : length) - offset;
+
+            ret = kp_write_data_to_flash(ll_dev, timeout, flash_offset + offset, size, buffer + offset, stats);
+
+            if (KP_SUCCESS != ret)
+                goto FUNC_OUT;
+        }
+
+        if ((i < num_blocks) && (NULL != stats))
+            stats->bytes_skipped += (i + 1 < num_blocks) ? FLASH_BLOCK_SIZE : length - i * FLASH_BLOCK_SIZE;
+
+        run_start = i + 1;
+    }
+
+    dbg_print("[%s] flash 0x%08X: %u bytes, %llu bytes are skipped in total\n", __func__, flash_offset, length,
+              (NULL != stats) ? (unsigned long long)stats->bytes_skipped : 0ULL);
+
+FUNC_OUT:
+    free(hashes);
+    free(last_block);
+
+    return ret;
 }
 
 int kp_update_kdp2_firmware(kp_device_group_t devices, void *scpu_fw_buf, int scpu_fw_size,
@@ -1155,6 +1395,8 @@ int kp_update_kdp2_firmware(kp_device_group_t devices, void *scpu_fw_buf, int sc
         return kp_update_kdp_firmware(devices, scpu_fw_buf, scpu_fw_size, ncpu_fw_buf, ncpu_fw_size, auto_reboot);
     }
 
+    memset(&_devices_grp->flash_write_stats, 0, sizeof(kp_flash_write_statistics_t));
+
     for (int i = 0; i < _devices_grp->num_device; i++) {
         uint16_t fw_type = (KP_KDP2_FW_FIND_TYPE_MASK_V2 & ll_dev[i]->fw_serial);
         uint16_t fw_type_legacy = (KP_KDP2_FW_FIND_TYPE_MASK & ll_dev[i]->fw_serial);
@@ -1169,10 +1411,10 @@ int kp_update_kdp2_firmware(kp_device_group_t devices, void *scpu_fw_buf, int sc
     {
         dbg_print("Start updating scpu firmware...\n");
 
-        int port_id_list[MAX_GROUP_DEVICE] = {0};
+        int port_id_list[_devices_grp->num_device];
 
-        _update_kdp2_firmware_package cmd_packs[MAX_GROUP_DEVICE];
-        pthread_t update_fw_thd[MAX_GROUP_DEVICE];
+        _update_kdp2_firmware_package cmd_packs[_devices_grp->num_device];
+        pthread_t update_fw_thd[_devices_grp->num_device];
 
         cmd_packs[0].dev_idx = 0;
         cmd_packs[0].ll_device = ll_dev[0];
@@ -1181,6 +1423,7 @@ int kp_update_kdp2_firmware(kp_device_group_t devices, void *scpu_fw_buf, int sc
         cmd_packs[0].fw_id = 1;
         cmd_packs[0].timeout = _devices_grp->timeout;
         cmd_packs[0].auto_reboot = auto_reboot;
+        memset(&cmd_packs[0].flash_write_stats, 0, sizeof(kp_flash_write_statistics_t));
 
         port_id_list[0] = ll_dev[0]->dev_descp.port_id;
 
@@ -1221,6 +1464,14 @@ int kp_update_kdp2_firmware(kp_device_group_t devices, void *scpu_fw_buf, int sc
             }
         }
 
+        for (int i = 0; i < _devices_grp->num_device; i++)
+        {
+            _devices_grp->flash_write_stats.bytes_written += cmd_packs[i].flash_write_stats.bytes_written;
+            _devices_grp->flash_write_stats.write_time_us += cmd_packs[i].flash_write_stats.write_time_us;
+            _devices_grp->flash_write_stats.bytes_unverified += cmd_packs[i].flash_write_stats.bytes_unverified;
+            _devices_grp->flash_write_stats.bytes_skipped += cmd_packs[i].flash_write_stats.bytes_skipped;
+        }
+
         dbg_print("Update scpu firmware process finished, try to re-connect device...\n");
 
         if (true == auto_reboot)
@@ -1256,10 +1507,10 @@ int kp_update_kdp2_firmware(kp_device_group_t devices, void *scpu_fw_buf, int sc
     if (NULL != ncpu_fw_buf) {
         dbg_print("Start updating ncpu firmware...\n");
 
-        int port_id_list[MAX_GROUP_DEVICE] = {0};
+        int port_id_list[_devices_grp->num_device];
 
-        _update_kdp2_firmware_package cmd_packs[MAX_GROUP_DEVICE];
-        pthread_t update_fw_thd[MAX_GROUP_DEVICE];
+        _update_kdp2_firmware_package cmd_packs[_devices_grp->num_device];
+        pthread_t update_fw_thd[_devices_grp->num_device];
 
         cmd_packs[0].dev_idx = 0;
         cmd_packs[0].ll_device = ll_dev[0];
@@ -1268,6 +1519,7 @@ int kp_update_kdp2_firmware(kp_device_group_t devices, void *scpu_fw_buf, int sc
         cmd_packs[0].fw_id = 2;
         cmd_packs[0].timeout = _devices_grp->timeout;
         cmd_packs[0].auto_reboot = auto_reboot;
+        memset(&cmd_packs[0].flash_write_stats, 0, sizeof(kp_flash_write_statistics_t));
 
         port_id_list[0] = ll_dev[0]->dev_descp.port_id;
 
@@ -1308,6 +1560,14 @@ int kp_update_kdp2_firmware(kp_device_group_t devices, void *scpu_fw_buf, int sc
             }
         }
 
+        for (int i = 0; i < _devices_grp->num_device; i++)
+        {
+            _devices_grp->flash_write_stats.bytes_written += cmd_packs[i].flash_write_stats.bytes_written;
+            _devices_grp->flash_write_stats.write_time_us += cmd_packs[i].flash_write_stats.write_time_us;
+            _devices_grp->flash_write_stats.bytes_unverified += cmd_packs[i].flash_write_stats.bytes_unverified;
+            _devices_grp->flash_write_stats.bytes_skipped += cmd_packs[i].flash_write_stats.bytes_skipped;
+        }
+
         dbg_print("Update ncpu firmware process finished, try to re-connect device...\n");
 
         if (true == auto_reboot)
@@ -1340,6 +1600,16 @@ FUNC_OUT:
     return ret;
 }
 
+int kp_get_flash_write_statistics(kp_device_group_t devices, kp_flash_write_statistics_t *statistics)
+{
+    if ((NULL == devices) || (NULL == statistics))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    *statistics = ((_kp_devices_group_t *)devices)->flash_write_stats;
+
+    return KP_SUCCESS;
+}
+
 int kp_update_kdp2_firmware_from_files(kp_device_group_t devices, const char *scpu_fw_file,
                                        const char *ncpu_fw_file, bool auto_reboot)
 {
@@ -1398,7 +1668,7 @@ int kp_update_kdp_firmware(kp_device_group_t devices, void *scpu_fw_buf, int scp
         dbg_print("Start updating scpu firmware...\n");
 
         kdp_firmware_update_cmd_t cmd_buf;
-        int port_id_list[MAX_GROUP_DEVICE] = {0};
+        int port_id_list[_devices_grp->num_device];
 
         cmd_buf.preamble = KDP_MSG_HDR_CMD;
         cmd_buf.ctrl = 0;
@@ -1407,8 +1677,8 @@ int kp_update_kdp_firmware(kp_device_group_t devices, void *scpu_fw_buf, int scp
         cmd_buf.fw_id = 1;
         cmd_buf.auto_reboot = (true == auto_reboot) ? 1 : 0;
 
-        _update_kdp_firmware_command_package cmd_packs[MAX_GROUP_DEVICE];
-        pthread_t update_fw_thd[MAX_GROUP_DEVICE];
+        _update_kdp_firmware_command_package cmd_packs[_devices_grp->num_device];
+        pthread_t update_fw_thd[_devices_grp->num_device];
 
         cmd_packs[0].ll_device = ll_dev[0];
         cmd_packs[0].cmd_buf = &cmd_buf;
@@ -1481,7 +1751,7 @@ int kp_update_kdp_firmware(kp_device_group_t devices, void *scpu_fw_buf, int scp
         dbg_print("Start updating ncpu firmware...\n");
 
         kdp_firmware_update_cmd_t cmd_buf;
-        int port_id_list[MAX_GROUP_DEVICE] = {0};
+        int port_id_list[_devices_grp->num_device];
 
         cmd_buf.preamble = KDP_MSG_HDR_CMD;
         cmd_buf.ctrl = 0;
@@ -1490,8 +1760,8 @@ int kp_update_kdp_firmware(kp_device_group_t devices, void *scpu_fw_buf, int scp
         cmd_buf.fw_id = 2;
         cmd_buf.auto_reboot = (true == auto_reboot) ? 1 : 0;
 
-        _update_kdp_firmware_command_package cmd_packs[MAX_GROUP_DEVICE];
-        pthread_t update_fw_thd[MAX_GROUP_DEVICE];
+        _update_kdp_firmware_command_package cmd_packs[_devices_grp->num_device];
+        pthread_t update_fw_thd[_devices_grp->num_device];
 
         cmd_packs[0].ll_device = ll_dev[0];
         cmd_packs[0].cmd_buf = &cmd_buf;
@@ -1619,7 +1889,7 @@ int kp_update_model_from_file(kp_device_group_t devices, const char *file_path,
     int ret = KP_ERROR_FILE_OPEN_FAILED_20;
 
     if ((NULL != file_path) && ('\0' != file_path[0])) {
-        nef_buf = read_file_to_buffer_auto_malloc(file_path, &nef_size);
+        nef_buf = map_file_to_buffer(file_path, &nef_size);
 
         if (NULL != nef_buf) {
             ret = kp_update_model(devices, (void *)nef_buf, (int)nef_size, auto_reboot, model_desc);
@@ -1627,7 +1897,7 @@ int kp_update_model_from_file(kp_device_group_t devices, const char *file_path,
     }
 
     if (NULL != nef_buf) {
-        free(nef_buf);
+        unmap_file_buffer(nef_buf, nef_size);
     }
 
     return ret;
@@ -1702,8 +1972,8 @@ int kp_update_kdp2_usb_loader_from_file(kp_device_group_t devices, const char *u
 int kp_switch_to_kdp2_usb_boot(kp_device_group_t devices, bool auto_reboot)
 {
     int Ret;
-    int port_id_list[MAX_GROUP_DEVICE] = {0};
     _kp_devices_group_t *_devices_grp = (_kp_devices_group_t *)devices;
+    int port_id_list[_devices_grp->num_device];
     kp_usb_device_t **ll_dev = _devices_grp->ll_device;
 
     for (int i = 0; i < _devices_grp->num_device; i++) {
@@ -1716,8 +1986,8 @@ int kp_switch_to_kdp2_usb_boot(kp_device_group_t devices, bool auto_reboot)
         }
     }
 
-    _update_kdp2_usb_boot_package cmd_packs[MAX_GROUP_DEVICE];
-    pthread_t update_thd[MAX_GROUP_DEVICE];
+    _update_kdp2_usb_boot_package cmd_packs[_devices_grp->num_device];
+    pthread_t update_thd[_devices_grp->num_device];
 
     cmd_packs[0].dev_idx = 0;
     cmd_packs[0].ll_device = ll_dev[0];
@@ -11,8 +11,11 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/time.h>
 
 #include "kp_usb.h"
+#include "kp_usb_sim.h"
 #include "KL720_usb_minion.h"
 #include "kdp2_ipc_cmd.h"
 
@@ -33,76 +36,301 @@
 // Below are internal or static data structure or functions
 // *********************************************************************************************** //
 
+static int __kn_usb_write_data(kp_usb_device_t *dev, void *buf, int len, int timeout);
+static int __kn_usb_write_data_list(kp_usb_device_t *dev, kp_usb_buffer_t buf_list[], int num_buf, int timeout);
+static int __kn_usb_read_data(kp_usb_device_t *dev, void *buf, int len, int timeout);
+static int __kn_usb_control(kp_usb_device_t *dev, kp_usb_control_t *control_request, int timeout);
+static void __kn_usb_flush_out_buffers(kp_usb_device_t *dev);
+static int __kn_usb_disconnect_device(kp_usb_device_t *dev);
+static int __kn_usb_submit_read(kp_usb_device_t *dev, void *buf, int len);
+static int __kn_usb_poll_read(kp_usb_device_t *dev, int *wait_us);
+static void __kn_usb_cancel_read(kp_usb_device_t *dev);
+
+static const kp_usb_transport_t _kn_libusb_transport = {
+	.name = "libusb",
+	.write_data = __kn_usb_write_data,
+	.write_data_list = __kn_usb_write_data_list,
+	.read_data = __kn_usb_read_data,
+	.control = __kn_usb_control,
+	.flush_out_buffers = __kn_usb_flush_out_buffers,
+	.disconnect = __kn_usb_disconnect_device,
+	.submit_read = __kn_usb_submit_read,
+	.poll_read = __kn_usb_poll_read,
+	.cancel_read = __kn_usb_cancel_read,
+};
+
 pthread_mutex_t _g_mutex = PTHREAD_MUTEX_INITIALIZER; // global mutex
 static int _g_libusb_ref_count = 0; // reference count of libusb
 
-static int __kn_usb_bulk_out(kp_usb_device_t *dev, unsigned char endpoint, void *buf, int length, unsigned int timeout)
+static pthread_mutex_t _g_read_any_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _g_read_any_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int _g_read_any_seq = 0; // increased by kp_usb_notify_read_any()
+
+static pthread_t _g_event_thread;
+static volatile int _g_event_thread_running = 0;
+static int _g_event_thread_users = 0; // number of connected devices
+
+static void *__kn_usb_event_thread(void *data)
 {
-	int status;
-	int transferred;
+	while (_g_event_thread_running)
+	{
+		struct timeval tv = {0, 100 * 1000}; // wake up periodically to check if it should stop
+		libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+	}
 
-	int total_txfer = length;
-	int one_txfer = 0;
-	uintptr_t cur_write_address = (uintptr_t)buf;
+	return NULL;
+}
 
-	libusb_device_handle *usbdev = dev->usb_handle;
+static void __start_usb_event_thread()
+{
+	pthread_mutex_lock(&_g_mutex);
+	if (_g_event_thread_users++ == 0)
+	{
+		_g_event_thread_running = 1;
+		if (0 != pthread_create(&_g_event_thread, NULL, __kn_usb_event_thread, NULL))
+		{
+			// transfers will be completed by the waiting threads instead
+			dbg_print("[%s] [kp_usb] create usb event thread failed\n", __func__);
+			_g_event_thread_running = 0;
+		}
+	}
+	pthread_mutex_unlock(&_g_mutex);
+}
+
+static void __stop_usb_event_thread()
+{
+	pthread_mutex_lock(&_g_mutex);
+	if (--_g_event_thread_users == 0 && _g_event_thread_running)
+	{
+		_g_event_thread_running = 0;
+		pthread_join(_g_event_thread, NULL);
+	}
+	pthread_mutex_unlock(&_g_mutex);
+}
+
+static void LIBUSB_CALL __kn_usb_transfer_cb(struct libusb_transfer *transfer)
+{
+	kp_usb_async_slot_t *slot = (kp_usb_async_slot_t *)transfer->user_data;
+	kp_usb_async_queue_t *queue = slot->queue;
+
+	pthread_mutex_lock(&queue->mutex);
+	slot->completed = 1;
+	pthread_cond_broadcast(&queue->cond);
+	pthread_mutex_unlock(&queue->mutex);
+
+	if (queue->notify_read_any)
+		kp_usb_notify_read_any();
+}
+
+static int __kn_usb_init_async_queue(kp_usb_async_queue_t *queue)
+{
+	pthread_mutex_init(&queue->mutex, NULL);
+	pthread_cond_init(&queue->cond, NULL);
+
+	for (int i = 0; i < KP_USB_MAX_QUEUE_DEPTH; i++)
+	{
+		queue->slot[i].queue = queue;
+		queue->slot[i].completed = 1;
+		queue->slot[i].transfer = libusb_alloc_transfer(0);
+		if (NULL == queue->slot[i].transfer)
+			return KP_USB_USB_NO_MEM;
+	}
+
+	return KP_USB_RET_OK;
+}
+
+static void __kn_usb_deinit_async_queue(kp_usb_async_queue_t *queue)
+{
+	for (int i = 0; i < KP_USB_MAX_QUEUE_DEPTH; i++)
+	{
+		if (NULL != queue->slot[i].transfer)
+			libusb_free_transfer(queue->slot[i].transfer);
+		queue->slot[i].transfer = NULL;
+	}
+
+	pthread_mutex_destroy(&queue->mutex);
+	pthread_cond_destroy(&queue->cond);
+}
+
+static int __kn_usb_submit_slot(kp_usb_device_t *dev, kp_usb_async_slot_t *slot, unsigned char endpoint, void *buf, int length, unsigned int timeout)
+{
+	slot->completed = 0;
+	slot->expected_length = length;
+
+	libusb_fill_bulk_transfer(slot->transfer, dev->usb_handle, endpoint, (unsigned char *)buf, length, __kn_usb_transfer_cb, slot, timeout);
+
+	int status = libusb_submit_transfer(slot->transfer);
+	if (status != 0)
+		slot->completed = 1;
+
+	return status;
+}
+
+static void __kn_usb_wait_slot(kp_usb_async_slot_t *slot)
+{
+	kp_usb_async_queue_t *queue = slot->queue;
+
+	if (!_g_event_thread_running)
+	{
+		// no event thread, handle events in caller thread
+		while (!slot->completed)
+			libusb_handle_events_completed(NULL, &slot->completed);
+		return;
+	}
+
+	pthread_mutex_lock(&queue->mutex);
+	while (!slot->completed)
+		pthread_cond_wait(&queue->cond, &queue->mutex);
+	pthread_mutex_unlock(&queue->mutex);
+}
+
+static int __kn_usb_slot_status(kp_usb_async_slot_t *slot)
+{
+	switch (slot->transfer->status)
+	{
+	case LIBUSB_TRANSFER_COMPLETED:
+		return KP_USB_RET_OK;
+	case LIBUSB_TRANSFER_TIMED_OUT:
+		return KP_USB_USB_TIMEOUT;
+	case LIBUSB_TRANSFER_STALL:
+		return KP_USB_USB_PIPE;
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		return KP_USB_USB_NO_DEVICE;
+	case LIBUSB_TRANSFER_OVERFLOW:
+		return KP_USB_USB_OVERFLOW;
+	case LIBUSB_TRANSFER_CANCELLED:
+		return KP_USB_USB_INTERRUPTED;
+	default:
+		return KP_USB_USB_IO;
+	}
+}
+
+// submit one bulk transfer and wait for it, like libusb_bulk_transfer()
+static int __kn_usb_bulk_transfer(kp_usb_device_t *dev, kp_usb_async_queue_t *queue, unsigned char endpoint, void *buf, int length, int *transferred, unsigned int timeout)
+{
+	kp_usb_async_slot_t *slot = &queue->slot[0];
+
+	*transferred = 0;
+
+	int status = __kn_usb_submit_slot(dev, slot, endpoint, buf, length, timeout);
+	if (status != 0)
+		return status;
+
+	__kn_usb_wait_slot(slot);
+
+	*transferred = slot->transfer->actual_length;
+
+	return __kn_usb_slot_status(slot);
+}
+
+// send buffers one after another, the queue is kept full across buffer boundaries
+static int __kn_usb_bulk_out_list(kp_usb_device_t *dev, unsigned char endpoint, kp_usb_buffer_t buf_list[], int num_buf, unsigned int timeout)
+{
+	kp_usb_async_queue_t *queue = &dev->queue_out;
+	int queue_depth = dev->queue_depth;
 	int speed = dev->dev_descp.link_speed;
 	int max_psize = (speed <= LIBUSB_SPEED_HIGH) ? 512 : 1024;
 
+	int status = KP_USB_RET_OK;
+	int head = 0;      // the oldest transfer in flight
+	int in_flight = 0;
+	int buf_idx = 0;   // the buffer being queued
+	int offset = 0;
+	bool cancelled = false;
+
+	// check if need to send zero length packet, it is queued right after the data of each buffer
+	bool zlp_queued = (num_buf > 0) ? ((buf_list[0].len % max_psize) != 0) : true;
+
 	while (1)
 	{
-		if (total_txfer > MAX_TXFER_SIZE)
-			one_txfer = MAX_TXFER_SIZE;
-		else
-			one_txfer = total_txfer;
+		// keep the queue full so that the bus never idles between chunks
+		while (status == KP_USB_RET_OK && in_flight < queue_depth && buf_idx < num_buf)
+		{
+			kp_usb_async_slot_t *slot = &queue->slot[(head + in_flight) % queue_depth];
+			void *txfer_buf;
+			int one_txfer;
 
-		status = libusb_bulk_transfer(usbdev, endpoint, (unsigned char *)cur_write_address, one_txfer, &transferred, timeout);
+			if (offset < buf_list[buf_idx].len)
+			{
+				txfer_buf = (void *)((uintptr_t)buf_list[buf_idx].buf + offset);
+				one_txfer = MIN(buf_list[buf_idx].len - offset, KP_USB_ASYNC_CHUNK_SIZE);
+				offset += one_txfer;
+			}
+			else
+			{
+				txfer_buf = (void *)&queue->zlp_buf;
+				one_txfer = 0;
 
-		if (status != 0)
-			return status;
-		else if (one_txfer != transferred)
-			return status; // FIXME
+				if ((dev->dev_descp.product_id == KP_DEVICE_KL720) ||
+					(dev->dev_descp.product_id == KP_DEVICE_KL720_PREV) ||
+					((dev->fw_serial & KP_KDP2_FW_V2) == KP_KDP2_FW_V2) ||
+					((dev->fw_serial & KP_KDP2_FW) == KP_KDP2_FW))
+				{
+					// use fake ZLP as workaround
+					queue->zlp_buf = 0x11223344;
+					one_txfer = 4;
+				}
 
-		total_txfer -= transferred;
+				zlp_queued = true;
+			}
 
-		if (total_txfer == 0)
-			break; // transfer is done
+			status = __kn_usb_submit_slot(dev, slot, endpoint, txfer_buf, one_txfer, timeout);
+			if (status != KP_USB_RET_OK)
+				break;
 
-		cur_write_address += transferred;
-	}
+			in_flight++;
 
-	// check if need to send zero length packet
-	if ((length % max_psize) == 0)
-	{
-		unsigned int zlp_buf;
-		int len = 0;
-		int transferred;
-
-		if ((dev->dev_descp.product_id == KP_DEVICE_KL720) ||
-			(dev->dev_descp.product_id == KP_DEVICE_KL720_PREV) ||
-			((dev->fw_serial & KP_KDP2_FW_V2) == KP_KDP2_FW_V2) ||
-			((dev->fw_serial & KP_KDP2_FW) == KP_KDP2_FW))
+			if (offset >= buf_list[buf_idx].len && zlp_queued)
+			{
+				// move on to next buffer
+				offset = 0;
+				if (++buf_idx < num_buf)
+					zlp_queued = ((buf_list[buf_idx].len % max_psize) != 0);
+			}
+		}
+
+		if (in_flight == 0)
+			break; // transfer is done
+
+		if (status != KP_USB_RET_OK && !cancelled)
 		{
-			// use fake ZLP as workaround
-			zlp_buf = 0x11223344;
-			len = 4;
+			// abort all pending transfers of this write
+			for (int i = 0; i < in_flight; i++)
+				libusb_cancel_transfer(queue->slot[(head + i) % queue_depth].transfer);
+			cancelled = true;
 		}
 
-		status = libusb_bulk_transfer(usbdev, endpoint, (unsigned char *)&zlp_buf, len, &transferred, timeout);
+		kp_usb_async_slot_t *slot = &queue->slot[head];
+		__kn_usb_wait_slot(slot);
 
-		if (status != 0 || transferred != len)
+		head = (head + 1) % queue_depth;
+		in_flight--;
+
+		if (status == KP_USB_RET_OK)
 		{
-			dbg_print("[%s] [kp_usb] send fake ZLP failed error: %s\n", __func__, libusb_strerror((enum libusb_error)status));
-			return status;
+			status = __kn_usb_slot_status(slot);
+
+			if (status == KP_USB_RET_OK && slot->transfer->actual_length != slot->expected_length)
+				status = KP_USB_RET_ERR;
+
+			if (status != KP_USB_RET_OK)
+				dbg_print("[%s] [kp_usb] send data failed error: %s\n", __func__, libusb_strerror((enum libusb_error)status));
 		}
 	}
 
-	return KP_USB_RET_OK;
+	return status;
+}
+
+static int __kn_usb_bulk_out(kp_usb_device_t *dev, unsigned char endpoint, void *buf, int length, unsigned int timeout)
+{
+	kp_usb_buffer_t usb_buf = {buf, length};
+
+	return __kn_usb_bulk_out_list(dev, endpoint, &usb_buf, 1, timeout);
 }
 
 static int __kn_usb_bulk_in(kp_usb_device_t *dev, unsigned char endpoint, void *buf, int buf_size, int *recv_size, unsigned int timeout)
 {
-	libusb_device_handle *usbdev = dev->usb_handle;
+	kp_usb_async_queue_t *queue = &dev->queue_in;
 
 	int status;
 	int transferred;
@@ -112,13 +340,15 @@ static int __kn_usb_bulk_in(kp_usb_device_t *dev, unsigned char endpoint, void *
 
 	*recv_size = 0;
 
+	// bulk-in chunks are not queued ahead, a short packet ends the message and
+	// a pending read would consume the beginning of the next one
 	int _buf_size = buf_size;
 	while (1)
 	{
 		int one_buf_size = MIN(_buf_size, MAX_TXFER_SIZE);
 		_buf_size -= one_buf_size;
 
-		status = libusb_bulk_transfer(usbdev, endpoint, (unsigned char *)cur_read_address, one_buf_size, &transferred, timeout);
+		status = __kn_usb_bulk_transfer(dev, queue, endpoint, (void *)cur_read_address, one_buf_size, &transferred, timeout);
 
 		if (status != 0)
 		{
@@ -137,9 +367,7 @@ static int __kn_usb_bulk_in(kp_usb_device_t *dev, unsigned char endpoint, void *
 	// try to receive zlp
 	if (buf_size == *recv_size && (*recv_size & (max_psize - 1)) == 0)
 	{
-		int zlp_buf;
-
-		status = libusb_bulk_transfer(usbdev, endpoint, (unsigned char *)&zlp_buf, 4, &transferred, 5);
+		status = __kn_usb_bulk_transfer(dev, queue, endpoint, (void *)&queue->zlp_buf, 4, &transferred, 5);
 
 		if (status != 0)
 		{
@@ -570,7 +798,8 @@ kp_devices_list_t *kp_usb_scan_devices()
 		return NULL;
 	}
 
-	int need_buf_size = sizeof(int) + cnt * sizeof(kp_device_descriptor_t);
+	int num_sim_dev = kp_usb_sim_get_num_devices();
+	int need_buf_size = sizeof(int) + (cnt + num_sim_dev) * sizeof(kp_device_descriptor_t);
 
 	if (need_buf_size > kdev_list_size)
 	{
@@ -674,6 +903,12 @@ kp_devices_list_t *kp_usb_scan_devices()
 
 	libusb_free_device_list(devs_list, 1);
 
+	for (int i = 0; i < num_sim_dev; i++)
+	{
+		if (kp_usb_sim_is_plugged(i))
+			kp_usb_sim_get_device_descriptor(i, &kdev_list->device[kdev_list->num_dev++]);
+	}
+
 	__decrease_usb_refcnt();
 
 	return kdev_list;
@@ -707,10 +942,11 @@ static void get_port_id_and_path(libusb_device *usbdev, uint32_t *port_id, char
 	*port_id = port_uuid;
 }
 
-#define MAX_GROUP_DEVICE 20
-
 int kp_usb_connect_multiple_devices_v2(int num_dev, int port_id[], kp_usb_device_t *output_devs[], int try_count)
 {
+	if (num_dev > 0 && kp_usb_sim_is_port_id((uint32_t)port_id[0]))
+		return kp_usb_sim_connect_devices(num_dev, port_id, output_devs);
+
 	__increase_usb_refcnt();
 
 	// this is a workaround for Faraday DFU status and for KN_NUMBER
@@ -721,7 +957,7 @@ int kp_usb_connect_multiple_devices_v2(int num_dev, int port_id[], kp_usb_device
 	for (int i = 0; i < num_dev; i++)
 		output_devs[i] = NULL;
 
-	libusb_device *wanted_usbdev[MAX_GROUP_DEVICE] = {NULL};
+	libusb_device *wanted_usbdev[num_dev];
 	bool all_connectable = false;
 	struct libusb_device_descriptor desc;
 	libusb_device **devs_list = NULL;
@@ -853,6 +1089,8 @@ int kp_usb_connect_multiple_devices_v2(int num_dev, int port_id[], kp_usb_device
 			break;
 		}
 
+		dev->transport = &_kn_libusb_transport;
+		dev->transport_priv = NULL;
 		dev->usb_handle = usbdev_handle;
 		get_port_id_and_path(wanted_usbdev[i], &dev->dev_descp.port_id, dev->dev_descp.port_path);
 		dev->dev_descp.isConnectable = true;
@@ -880,6 +1118,29 @@ int kp_usb_connect_multiple_devices_v2(int num_dev, int port_id[], kp_usb_device
 			dev->dev_descp.kn_number = sernum;
 		}
 
+		pthread_mutex_init(&dev->mutex_send, NULL);
+		pthread_mutex_init(&dev->mutex_recv, NULL);
+
+		dev->queue_depth = KP_USB_DEFAULT_QUEUE_DEPTH;
+		memset(&dev->queue_out, 0, sizeof(kp_usb_async_queue_t));
+		memset(&dev->queue_in, 0, sizeof(kp_usb_async_queue_t));
+		dev->posted_buf = NULL;
+
+		__increase_usb_refcnt();
+		__start_usb_event_thread();
+
+		int sts_out = __kn_usb_init_async_queue(&dev->queue_out);
+		int sts_in = __kn_usb_init_async_queue(&dev->queue_in);
+
+		dev->queue_in.notify_read_any = true;
+
+		if ((KP_USB_RET_OK != sts_out) || (KP_USB_RET_OK != sts_in))
+		{
+			kp_usb_disconnect_device(dev);
+			ret_code = KP_USB_USB_NO_MEM;
+			break; // error
+		}
+
 		if (0 != __kn_configure_usb_device(usbdev_handle))
 		{
 			kp_usb_disconnect_device(dev);
@@ -887,12 +1148,7 @@ int kp_usb_connect_multiple_devices_v2(int num_dev, int port_id[], kp_usb_device
 			break; // error
 		}
 
-		pthread_mutex_init(&dev->mutex_send, NULL);
-		pthread_mutex_init(&dev->mutex_recv, NULL);
-
 		output_devs[num_connected++] = dev;
-
-		__increase_usb_refcnt();
 	}
 
 	if (ret_code != KP_USB_RET_OK)
@@ -911,9 +1167,21 @@ int kp_usb_connect_multiple_devices_v2(int num_dev, int port_id[], kp_usb_device
 }
 
 int kp_usb_disconnect_device(kp_usb_device_t *dev)
+{
+	kp_usb_cancel_read(dev);
+
+	return dev->transport->disconnect(dev);
+}
+
+static int __kn_usb_disconnect_device(kp_usb_device_t *dev)
 {
 	libusb_device_handle *usbdev = dev->usb_handle;
 	libusb_close(usbdev);
+
+	__kn_usb_deinit_async_queue(&dev->queue_out);
+	__kn_usb_deinit_async_queue(&dev->queue_in);
+
+	__stop_usb_event_thread();
 	__decrease_usb_refcnt();
 
 	pthread_mutex_destroy(&dev->mutex_send);
@@ -938,6 +1206,165 @@ int kp_usb_disconnect_multiple_devices(int num_dev, kp_usb_device_t *devs[])
 	return KP_USB_RET_OK;
 }
 
+// *********************************************************************************************** //
+// APIs for hotplug
+// *********************************************************************************************** //
+
+#define KP_USB_MAX_HOTPLUG_CALLBACK 8
+
+typedef struct
+{
+	kp_usb_hotplug_callback_t callback;
+	void *user_data;
+} kp_usb_hotplug_entry_t;
+
+static pthread_mutex_t _g_hotplug_reg_mutex = PTHREAD_MUTEX_INITIALIZER; // serializes register and deregister
+static pthread_mutex_t _g_hotplug_mutex = PTHREAD_MUTEX_INITIALIZER;     // protects callback entries
+static kp_usb_hotplug_entry_t _g_hotplug_entry[KP_USB_MAX_HOTPLUG_CALLBACK];
+static int _g_hotplug_users = 0; // protected by _g_hotplug_reg_mutex
+static bool _g_libusb_hotplug_registered = false;
+static libusb_hotplug_callback_handle _g_libusb_hotplug_handle;
+
+static int LIBUSB_CALL __kn_usb_hotplug_cb(libusb_context *ctx, libusb_device *usbdev, libusb_hotplug_event event, void *user_data)
+{
+	struct libusb_device_descriptor desc;
+	uint32_t port_id;
+
+	if (0 != libusb_get_device_descriptor(usbdev, &desc))
+		return 0;
+
+	get_port_id_and_path(usbdev, &port_id, NULL);
+	kp_usb_notify_hotplug(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED == event, port_id, desc.idProduct);
+
+	return 0; // keep the callback registered
+}
+
+bool kp_usb_has_hotplug()
+{
+	__increase_usb_refcnt();
+	bool has_hotplug = (0 != libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG));
+	__decrease_usb_refcnt();
+
+	return has_hotplug;
+}
+
+int kp_usb_register_hotplug(kp_usb_hotplug_callback_t callback, void *user_data)
+{
+	int handle = KP_USB_USB_NO_MEM;
+
+	pthread_mutex_lock(&_g_hotplug_reg_mutex);
+	pthread_mutex_lock(&_g_hotplug_mutex);
+
+	for (int i = 0; i < KP_USB_MAX_HOTPLUG_CALLBACK; i++)
+	{
+		if (NULL == _g_hotplug_entry[i].callback)
+		{
+			_g_hotplug_entry[i].callback = callback;
+			_g_hotplug_entry[i].user_data = user_data;
+			handle = i;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&_g_hotplug_mutex);
+
+	if (0 <= handle && 0 == _g_hotplug_users++)
+	{
+		// libusb events are handled by the usb event thread while any callback is registered
+		__increase_usb_refcnt();
+
+		if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG) &&
+			(LIBUSB_SUCCESS == libusb_hotplug_register_callback(NULL, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, LIBUSB_HOTPLUG_NO_FLAGS,
+																VID_KNERON, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+																__kn_usb_hotplug_cb, NULL, &_g_libusb_hotplug_handle)))
+		{
+			_g_libusb_hotplug_registered = true;
+			__start_usb_event_thread();
+		}
+	}
+
+	pthread_mutex_unlock(&_g_hotplug_reg_mutex);
+
+	return handle;
+}
+
+void kp_usb_deregister_hotplug(int handle)
+{
+	if (handle < 0 || handle >= KP_USB_MAX_HOTPLUG_CALLBACK)
+		return;
+
+	pthread_mutex_lock(&_g_hotplug_reg_mutex);
+	pthread_mutex_lock(&_g_hotplug_mutex);
+
+	bool registered = (NULL != _g_hotplug_entry[handle].callback);
+	_g_hotplug_entry[handle].callback = NULL;
+
+	pthread_mutex_unlock(&_g_hotplug_mutex);
+
+	// the event thread may be in a callback waiting for _g_hotplug_mutex, so it is stopped without the lock
+	if (registered && 0 == --_g_hotplug_users)
+	{
+		if (_g_libusb_hotplug_registered)
+		{
+			libusb_hotplug_deregister_callback(NULL, _g_libusb_hotplug_handle);
+			_g_libusb_hotplug_registered = false;
+			__stop_usb_event_thread();
+		}
+
+		__decrease_usb_refcnt();
+	}
+
+	pthread_mutex_unlock(&_g_hotplug_reg_mutex);
+}
+
+void kp_usb_notify_hotplug(bool arrived, uint32_t port_id, uint16_t product_id)
+{
+	// a callback is never called after it is deregistered
+	pthread_mutex_lock(&_g_hotplug_mutex);
+
+	for (int i = 0; i < KP_USB_MAX_HOTPLUG_CALLBACK; i++)
+	{
+		if (NULL != _g_hotplug_entry[i].callback)
+			_g_hotplug_entry[i].callback(arrived, port_id, product_id, _g_hotplug_entry[i].user_data);
+	}
+
+	pthread_mutex_unlock(&_g_hotplug_mutex);
+}
+
+bool kp_usb_is_port_present(uint32_t port_id)
+{
+	if (kp_usb_sim_is_port_id(port_id))
+		return kp_usb_sim_is_plugged((int)(port_id - KP_USB_SIM_PORT_ID_BASE));
+
+	libusb_device **devs_list;
+	bool present = false;
+
+	__increase_usb_refcnt();
+
+	pthread_mutex_lock(&_g_mutex);
+	ssize_t cnt = libusb_get_device_list(NULL, &devs_list);
+	pthread_mutex_unlock(&_g_mutex);
+
+	for (ssize_t i = 0; i < cnt && !present; i++)
+	{
+		struct libusb_device_descriptor desc;
+		uint32_t dev_port_id;
+
+		if (0 != libusb_get_device_descriptor(devs_list[i], &desc) || VID_KNERON != desc.idVendor)
+			continue;
+
+		get_port_id_and_path(devs_list[i], &dev_port_id, NULL);
+		present = (dev_port_id == port_id);
+	}
+
+	if (cnt >= 0)
+		libusb_free_device_list(devs_list, 1);
+
+	__decrease_usb_refcnt();
+
+	return present;
+}
+
 kp_device_descriptor_t *kp_usb_get_device_descriptor(kp_usb_device_t *dev)
 {
 	return &dev->dev_descp;
@@ -945,31 +1372,87 @@ kp_device_descriptor_t *kp_usb_get_device_descriptor(kp_usb_device_t *dev)
 
 void kp_usb_flush_out_buffers(kp_usb_device_t *dev)
 {
-	void *temp_buf = NULL;
+	kp_usb_cancel_read(dev);
+
+	dev->transport->flush_out_buffers(dev);
+}
+
+#define FLUSH_BUFFER_SIZE (256 * 1024)    // a multiple of max packet size, longer data is drained by the following reads
+#define FLUSH_MAX_SIZE (4 * 1024 * 1024) // OS may cache up to this much of previous transfers
+#define FLUSH_READ_TIMEOUT_MS 20         // data left is already queued in OS or device, the first empty read ends draining
+
+static void __kn_usb_flush_out_buffers(kp_usb_device_t *dev)
+{
+	void *temp_buf = malloc(FLUSH_BUFFER_SIZE);
 
-	/**
-	 * FIXME: Ubuntu/Windows need to reserved enough buffer (4 MB) to receive previous redundent OS cache buffer
-	 */
-	uint32_t buff_size = 4 * 1024 * 1024;
+	if (NULL == temp_buf)
+		return;
 
-	if (!temp_buf)
-		temp_buf = (void *)malloc(buff_size);
+	pthread_mutex_lock(&dev->mutex_recv);
 
-	// MAX limit 4MB
-	for (int i = 0; i < 8; i++)
+	for (int drained = 0; drained < FLUSH_MAX_SIZE;)
 	{
 		int recv_size = 0;
-		int sts = __kn_usb_bulk_in(dev, dev->endpoint_cmd_in, temp_buf, buff_size, &recv_size, 200);
-		if (sts == 0) {
-			continue; // maybe more ?
-		} else {
-			break; // we done ?
+		int sts = __kn_usb_bulk_in(dev, dev->endpoint_cmd_in, temp_buf, FLUSH_BUFFER_SIZE, &recv_size, FLUSH_READ_TIMEOUT_MS);
+
+		if (LIBUSB_ERROR_OVERFLOW == sts)
+		{
+			drained += FLUSH_BUFFER_SIZE; // rest of a long message, dropped by libusb
+			continue;
 		}
-	}
 
-	if (temp_buf) {
-		free(temp_buf);
+		if ((0 != sts) || (0 == recv_size))
+			break;
+
+		drained += recv_size;
 	}
+
+	pthread_mutex_unlock(&dev->mutex_recv);
+
+	free(temp_buf);
+}
+
+int kp_usb_set_queue_depth(kp_usb_device_t *dev, int queue_depth)
+{
+	if (queue_depth < 1 || queue_depth > KP_USB_MAX_QUEUE_DEPTH)
+		return KP_USB_USB_INVALID_PARAM;
+
+	if (dev->transport != &_kn_libusb_transport)
+		return KP_USB_RET_UNSUPPORTED;
+
+	pthread_mutex_lock(&dev->mutex_send);
+	dev->queue_depth = queue_depth;
+	pthread_mutex_unlock(&dev->mutex_send);
+
+	return KP_USB_RET_OK;
+}
+
+void *kp_usb_dev_mem_alloc(kp_usb_device_t *dev, size_t size)
+{
+	if (dev->transport != &_kn_libusb_transport)
+		return NULL;
+
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+	// usbfs mmap, only supported on Linux, it returns NULL on other platforms
+	return libusb_dev_mem_alloc(dev->usb_handle, size);
+#else
+	(void)size;
+	return NULL;
+#endif
+}
+
+int kp_usb_dev_mem_free(kp_usb_device_t *dev, void *buf, size_t size)
+{
+	if (dev->transport != &_kn_libusb_transport)
+		return KP_USB_RET_UNSUPPORTED;
+
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+	return libusb_dev_mem_free(dev->usb_handle, (unsigned char *)buf, size);
+#else
+	(void)buf;
+	(void)size;
+	return KP_USB_RET_UNSUPPORTED;
+#endif
 }
 
 // *********************************************************************************************** //
@@ -977,6 +1460,21 @@ void kp_usb_flush_out_buffers(kp_usb_device_t *dev)
 // *********************************************************************************************** //
 
 int kp_usb_write_data(kp_usb_device_t *dev, void *buf, int len, int timeout)
+{
+	return dev->transport->write_data(dev, buf, len, timeout);
+}
+
+int kp_usb_write_data_list(kp_usb_device_t *dev, kp_usb_buffer_t buf_list[], int num_buf, int timeout)
+{
+	return dev->transport->write_data_list(dev, buf_list, num_buf, timeout);
+}
+
+int kp_usb_read_data(kp_usb_device_t *dev, void *buf, int len, int timeout)
+{
+	return dev->transport->read_data(dev, buf, len, timeout);
+}
+
+static int __kn_usb_write_data(kp_usb_device_t *dev, void *buf, int len, int timeout)
 {
 	pthread_mutex_lock(&dev->mutex_send);
 	int ret = __kn_usb_bulk_out(dev, dev->endpoint_cmd_out, buf, len, timeout);
@@ -985,12 +1483,23 @@ int kp_usb_write_data(kp_usb_device_t *dev, void *buf, int len, int timeout)
 	return ret;
 }
 
-int kp_usb_read_data(kp_usb_device_t *dev, void *buf, int len, int timeout)
+static int __kn_usb_write_data_list(kp_usb_device_t *dev, kp_usb_buffer_t buf_list[], int num_buf, int timeout)
+{
+	pthread_mutex_lock(&dev->mutex_send);
+	int ret = __kn_usb_bulk_out_list(dev, dev->endpoint_cmd_out, buf_list, num_buf, timeout);
+	pthread_mutex_unlock(&dev->mutex_send);
+
+	return ret;
+}
+
+static int __kn_usb_read_data(kp_usb_device_t *dev, void *buf, int len, int timeout)
 {
 	int read_len;
+	int sts = KP_USB_USB_BUSY;
 
 	pthread_mutex_lock(&dev->mutex_recv);
-	int sts = __kn_usb_bulk_in(dev, dev->endpoint_cmd_in, buf, len, &read_len, timeout);
+	if (NULL == dev->posted_buf)
+		sts = __kn_usb_bulk_in(dev, dev->endpoint_cmd_in, buf, len, &read_len, timeout);
 	pthread_mutex_unlock(&dev->mutex_recv);
 
 	if (sts == KP_USB_RET_OK)
@@ -999,16 +1508,232 @@ int kp_usb_read_data(kp_usb_device_t *dev, void *buf, int len, int timeout)
 		return sts;
 }
 
+// *********************************************************************************************** //
+// APIs for posted read
+// *********************************************************************************************** //
+
+int kp_usb_submit_read(kp_usb_device_t *dev, void *buf, int len)
+{
+	return dev->transport->submit_read(dev, buf, len);
+}
+
+void kp_usb_cancel_read(kp_usb_device_t *dev)
+{
+	// no lock here, a blocking kp_usb_read_data() holds mutex_recv and never coexists with a posted read
+	if (NULL != dev->posted_buf)
+		dev->transport->cancel_read(dev);
+}
+
+void kp_usb_notify_read_any()
+{
+	pthread_mutex_lock(&_g_read_any_mutex);
+	_g_read_any_seq++;
+	pthread_cond_broadcast(&_g_read_any_cond);
+	pthread_mutex_unlock(&_g_read_any_mutex);
+}
+
+int kp_usb_wait_read_any(kp_usb_device_t *devs[], int num_dev, int timeout, int *index)
+{
+	int wait_us = (timeout > 0) ? timeout * 1000 : -1; // -1 means waiting until notified
+	bool handle_events = false;
+
+	// notifications after this point are not missed, devices are polled without any global lock held
+	pthread_mutex_lock(&_g_read_any_mutex);
+	unsigned int seq = _g_read_any_seq;
+	pthread_mutex_unlock(&_g_read_any_mutex);
+
+	for (int i = 0; i < num_dev; i++)
+	{
+		int dev_wait_us = -1;
+		int ret = devs[i]->transport->poll_read(devs[i], &dev_wait_us);
+
+		if (KP_USB_RET_PENDING != ret)
+		{
+			*index = i;
+			return ret;
+		}
+
+		if (dev_wait_us >= 0 && (wait_us < 0 || dev_wait_us < wait_us))
+			wait_us = dev_wait_us;
+
+		if (devs[i]->transport == &_kn_libusb_transport && !_g_event_thread_running)
+			handle_events = true;
+	}
+
+	if (handle_events)
+	{
+		// no event thread, transfers are completed in caller thread
+		struct timeval tv = {0, (wait_us >= 0 && wait_us < 10000) ? wait_us : 10000};
+		libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+		return KP_USB_RET_PENDING;
+	}
+
+	struct timespec ts;
+
+	if (wait_us >= 0)
+	{
+		struct timeval now;
+		gettimeofday(&now, NULL);
+
+		uint64_t wake_us = (uint64_t)now.tv_sec * 1000000 + now.tv_usec + wait_us;
+		ts.tv_sec = wake_us / 1000000;
+		ts.tv_nsec = (wake_us % 1000000) * 1000;
+	}
+
+	pthread_mutex_lock(&_g_read_any_mutex);
+
+	while (seq == _g_read_any_seq)
+	{
+		if (wait_us < 0)
+			pthread_cond_wait(&_g_read_any_cond, &_g_read_any_mutex);
+		else if (ETIMEDOUT == pthread_cond_timedwait(&_g_read_any_cond, &_g_read_any_mutex, &ts))
+			break;
+	}
+
+	pthread_mutex_unlock(&_g_read_any_mutex);
+
+	return KP_USB_RET_PENDING;
+}
+
+// called with mutex_recv locked
+static int __kn_usb_submit_posted_chunk(kp_usb_device_t *dev)
+{
+	kp_usb_async_queue_t *queue = &dev->queue_in;
+	void *buf = (void *)((uintptr_t)dev->posted_buf + dev->posted_recv);
+	int length = MIN(dev->posted_len - dev->posted_recv, MAX_TXFER_SIZE);
+
+	if (dev->posted_zlp)
+		return __kn_usb_submit_slot(dev, &queue->slot[0], dev->endpoint_cmd_in, (void *)&queue->zlp_buf, 4, 5);
+
+	return __kn_usb_submit_slot(dev, &queue->slot[0], dev->endpoint_cmd_in, buf, length, 0);
+}
+
+static int __kn_usb_submit_read(kp_usb_device_t *dev, void *buf, int len)
+{
+	int status = KP_USB_USB_BUSY;
+
+	pthread_mutex_lock(&dev->mutex_recv);
+
+	if (NULL == dev->posted_buf)
+	{
+		dev->posted_buf = buf;
+		dev->posted_len = len;
+		dev->posted_recv = 0;
+		dev->posted_zlp = false;
+
+		status = __kn_usb_submit_posted_chunk(dev);
+		if (status != KP_USB_RET_OK)
+			dev->posted_buf = NULL;
+	}
+
+	pthread_mutex_unlock(&dev->mutex_recv);
+
+	return status;
+}
+
+// same as __kn_usb_bulk_in(), chunks and the ZLP are submitted one after another as the previous one completes
+static int __kn_usb_poll_read(kp_usb_device_t *dev, int *wait_us)
+{
+	kp_usb_async_queue_t *queue = &dev->queue_in;
+	kp_usb_async_slot_t *slot = &queue->slot[0];
+	int max_psize = (dev->dev_descp.link_speed <= LIBUSB_SPEED_HIGH) ? 512 : 1024;
+	int ret = KP_USB_RET_PENDING;
+
+	*wait_us = -1;
+
+	pthread_mutex_lock(&dev->mutex_recv);
+
+	if (NULL == dev->posted_buf)
+	{
+		pthread_mutex_unlock(&dev->mutex_recv);
+		return KP_USB_USB_INVALID_PARAM;
+	}
+
+	pthread_mutex_lock(&queue->mutex);
+	int completed = slot->completed;
+	pthread_mutex_unlock(&queue->mutex);
+
+	if (!completed)
+		goto FUNC_OUT;
+
+	int status = __kn_usb_slot_status(slot);
+	int transferred = slot->transfer->actual_length;
+
+	if (status != KP_USB_RET_OK)
+	{
+		dbg_print("[kp_usb] posted read failed error: %s\n", libusb_strerror((enum libusb_error)status));
+		ret = status;
+	}
+	else if (dev->posted_zlp)
+	{
+		ret = (0 == transferred) ? dev->posted_recv : KP_USB_RET_ERR;
+	}
+	else
+	{
+		dev->posted_recv += transferred;
+
+		if (transferred == slot->expected_length && dev->posted_recv < dev->posted_len)
+			status = __kn_usb_submit_posted_chunk(dev);
+		else if (dev->posted_recv == dev->posted_len && (dev->posted_recv & (max_psize - 1)) == 0)
+		{
+			dev->posted_zlp = true;
+			status = __kn_usb_submit_posted_chunk(dev);
+		}
+		else
+			ret = dev->posted_recv;
+
+		if (status != KP_USB_RET_OK)
+			ret = status;
+	}
+
+	if (KP_USB_RET_PENDING != ret)
+		dev->posted_buf = NULL;
+
+FUNC_OUT:
+	pthread_mutex_unlock(&dev->mutex_recv);
+
+	return ret;
+}
+
+static void __kn_usb_cancel_read(kp_usb_device_t *dev)
+{
+	kp_usb_async_slot_t *slot = &dev->queue_in.slot[0];
+
+	pthread_mutex_lock(&dev->mutex_recv);
+
+	if (NULL != dev->posted_buf)
+	{
+		libusb_cancel_transfer(slot->transfer);
+		__kn_usb_wait_slot(slot);
+		dev->posted_buf = NULL;
+	}
+
+	pthread_mutex_unlock(&dev->mutex_recv);
+}
+
 int kp_usb_endpoint_write_data(kp_usb_device_t *dev, int endpoint, void *buf, int len, int timeout)
 {
+	if (dev->transport != &_kn_libusb_transport)
+		return KP_USB_RET_UNSUPPORTED;
+
+	pthread_mutex_lock(&dev->mutex_send);
 	int ret = __kn_usb_bulk_out(dev, (unsigned char)endpoint, buf, len, timeout);
+	pthread_mutex_unlock(&dev->mutex_send);
+
 	return ret;
 }
 
 int kp_usb_endpoint_read_data(kp_usb_device_t *dev, int endpoint, void *buf, int len, int timeout)
 {
 	int read_len;
+
+	if (dev->transport != &_kn_libusb_transport)
+		return KP_USB_RET_UNSUPPORTED;
+
+	pthread_mutex_lock(&dev->mutex_recv);
 	int sts = __kn_usb_bulk_in(dev, (unsigned char)endpoint, buf, len, &read_len, timeout);
+	pthread_mutex_unlock(&dev->mutex_recv);
+
 	if (sts == KP_USB_RET_OK)
 		return read_len;
 	else
@@ -1020,6 +1745,11 @@ int kp_usb_endpoint_read_data(kp_usb_device_t *dev, int endpoint, void *buf, int
 // *********************************************************************************************** //
 
 int kp_usb_control(kp_usb_device_t *dev, kp_usb_control_t *control_request, int timeout)
+{
+	return dev->transport->control(dev, control_request, timeout);
+}
+
+static int __kn_usb_control(kp_usb_device_t *dev, kp_usb_control_t *control_request, int timeout)
 {
 	uint8_t bmRequestType = 0x40;
 	uint8_t bRequest = control_request->command;
@@ -1036,6 +1766,10 @@ int kp_usb_control(kp_usb_device_t *dev, kp_usb_control_t *control_request, int
 int kp_usb_read_firmware_log(kp_usb_device_t *dev, void *buf, int len, int timeout)
 {
 	int read_len;
+
+	if (dev->transport != &_kn_libusb_transport)
+		return KP_USB_RET_UNSUPPORTED;
+
 	int sts = __kn_usb_interrupt_in(dev, dev->endpoint_log_in, buf, len, &read_len, timeout);
 
 	if (sts == KP_USB_RET_OK)
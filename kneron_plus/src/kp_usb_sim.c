@@ -0,0 +1,1186 @@
+/**
+ * @file        kp_usb_sim.c
+ * @brief       simulated devices speaking KDP2 protocol behind kp_usb transport interface
+ * @version     0.1
+ * @date        2026-10-18
+ *
+ * @copyright   Copyright (c) 2021 Kneron Inc. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/time.h>
+
+#include "kp_usb_sim.h"
+#include "kdp2_ipc_cmd.h"
+#include "kdp2_inf_generic_raw.h"
+#include "internal_func.h"
+
+#ifdef DEBUG_PRINT
+#define dbg_print(format, ...) printf(format, ##__VA_ARGS__)
+#else
+#define dbg_print(format, ...)
+#endif
+
+#define err_print(format, ...) { printf(format, ##__VA_ARGS__); fflush(stdout); }
+
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+#define MAX(x, y) (((x) > (y)) ? (x) : (y))
+
+#define SIM_VENDOR_ID 0x3231
+#define SIM_FW_SERIAL (KP_KDP2_FW_FLASH_TYPE_V2 | KP_KDP2_FW_COMPANION_MODE_V2) // flash boot, loading another model reboots the device
+#define SIM_KN_NUMBER_BASE 0x5A000000
+#define SIM_DDR_BEGIN 0x80000000
+#define SIM_DDR_END 0x88000000 // 128 MB
+#define SIM_BUFFER_SIZE_10_KB (10 * 1024)
+
+// KL720 npu data format, refer to setup_reader.c
+#define SIM_DATA_FMT_KL720_1W16C8B 0
+#define SIM_DATA_FMT_KL720_4W4C8B 4
+#define SIM_DATA_FMT_KL720_16W1C8B 5
+#define SIM_DATA_FMT_KL720_8W1C16B 6
+#define SIM_KL720_MAX_OUTPUT_NODE 40
+
+typedef struct _sim_packet
+{
+	struct _sim_packet *next;
+	uint64_t ready_us; // can be read by host after this time
+	bool is_inference; // inference result takes a FIFO queue result buffer
+	uint32_t size;
+	uint32_t offset; // size already read by host
+	uint8_t data[];
+} _sim_packet_t;
+
+enum
+{
+	SIM_RX_IDLE = 0,  // waiting for command or inference header
+	SIM_RX_MODEL,     // receiving all_models data of KDP2_COMMAND_LOAD_MODEL
+	SIM_RX_INFERENCE, // receiving image data of inference
+	SIM_RX_DISCARD,   // discarding data of unsupported request
+};
+
+typedef struct
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	kp_usb_device_t *conn; // current connection, NULL if disconnected or rebooted
+	bool unplugged;        // not reported by scanning and cannot be connected
+
+	// host to device
+	int rx_state;
+	uint32_t rx_remaining;
+	uint32_t rx_offset;
+	kp_inference_header_stamp_t rx_stamp;
+	uint32_t rx_inference_number;
+	uint32_t rx_model_id;
+	uint32_t rx_crop_count;
+	kp_inf_crop_box_t rx_inf_crop[MAX_CROP_BOX];
+	kp_hw_pre_proc_info_t rx_pre_proc_info[MAX_INPUT_NODE_COUNT];
+
+	// loaded models
+	char *fw_info;
+	uint32_t fw_info_size;
+	char *all_models;
+	uint32_t all_models_size;
+	uint32_t num_models;
+	kp_model_setup_location_t *setup_location;
+	kp_model_nef_descriptor_t model_desc;
+	uint8_t **result_template; // generic raw result of each model, output node data are all zeros
+	uint32_t *result_template_size;
+
+	// FIFO queue
+	bool fifoq_allocated;
+	kp_fifo_queue_config_t fifoq_config;
+	int num_inference_pending; // images received but results not yet read by host
+	uint64_t npu_free_us;
+
+	// device to host
+	_sim_packet_t *tx_head;
+	_sim_packet_t *tx_tail;
+} _sim_device_t;
+
+static int __sim_write_data(kp_usb_device_t *dev, void *buf, int len, int timeout);
+static int __sim_write_data_list(kp_usb_device_t *dev, kp_usb_buffer_t buf_list[], int num_buf, int timeout);
+static int __sim_read_data(kp_usb_device_t *dev, void *buf, int len, int timeout);
+static int __sim_control(kp_usb_device_t *dev, kp_usb_control_t *control_request, int timeout);
+static void __sim_flush_out_buffers(kp_usb_device_t *dev);
+static int __sim_disconnect_device(kp_usb_device_t *dev);
+static int __sim_submit_read(kp_usb_device_t *dev, void *buf, int len);
+static int __sim_poll_read(kp_usb_device_t *dev, int *wait_us);
+static void __sim_cancel_read(kp_usb_device_t *dev);
+
+static const kp_usb_transport_t _sim_transport = {
+	.name = "sim",
+	.write_data = __sim_write_data,
+	.write_data_list = __sim_write_data_list,
+	.read_data = __sim_read_data,
+	.control = __sim_control,
+	.flush_out_buffers = __sim_flush_out_buffers,
+	.disconnect = __sim_disconnect_device,
+	.submit_read = __sim_submit_read,
+	.poll_read = __sim_poll_read,
+	.cancel_read = __sim_cancel_read,
+};
+
+static pthread_mutex_t _sim_mutex = PTHREAD_MUTEX_INITIALIZER;
+static kp_sim_device_config_t _sim_config = {0};
+static int _sim_fw_version[4] = {0};
+static bool _sim_devices_inited = false;
+static _sim_device_t _sim_devices[KP_USB_SIM_MAX_DEVICE];
+
+// *********************************************************************************************** //
+// Below are internal functions, called with the device mutex locked unless noted
+// *********************************************************************************************** //
+
+static uint64_t __sim_now_us()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static uint64_t __sim_transfer_time_us(int len)
+{
+	uint64_t delay_us = _sim_config.usb_latency_us;
+
+	if (_sim_config.usb_bandwidth_mbps > 0)
+		delay_us += (uint64_t)len / _sim_config.usb_bandwidth_mbps; // 1 MB/s is 1 byte/us
+
+	return delay_us;
+}
+
+// called without any mutex locked
+static void __sim_transfer_delay(int len)
+{
+	uint64_t delay_us = __sim_transfer_time_us(len);
+
+	if (delay_us > 0)
+		usleep(delay_us);
+}
+
+// wait for signal until wake_us, wake_us = 0 means no time limit
+static void __sim_wait_until(_sim_device_t *sdev, uint64_t wake_us)
+{
+	if (0 == wake_us)
+	{
+		pthread_cond_wait(&sdev->cond, &sdev->mutex);
+		return;
+	}
+
+	struct timespec ts;
+	ts.tv_sec = wake_us / 1000000;
+	ts.tv_nsec = (wake_us % 1000000) * 1000;
+
+	pthread_cond_timedwait(&sdev->cond, &sdev->mutex, &ts);
+}
+
+static int __sim_push_packet(_sim_device_t *sdev, void *data, uint32_t size, uint64_t ready_us, bool is_inference)
+{
+	_sim_packet_t *pkt = (_sim_packet_t *)malloc(sizeof(_sim_packet_t) + size);
+	if (NULL == pkt)
+		return KP_USB_USB_NO_MEM;
+
+	pkt->next = NULL;
+	pkt->ready_us = ready_us;
+	pkt->is_inference = is_inference;
+	pkt->size = size;
+	pkt->offset = 0;
+
+	if (NULL != data)
+		memcpy(pkt->data, data, size);
+
+	if (NULL == sdev->tx_tail)
+		sdev->tx_head = pkt;
+	else
+		sdev->tx_tail->next = pkt;
+
+	sdev->tx_tail = pkt;
+
+	pthread_cond_broadcast(&sdev->cond);
+	kp_usb_notify_read_any();
+
+	return KP_USB_RET_OK;
+}
+
+static void __sim_pop_packet(_sim_device_t *sdev)
+{
+	_sim_packet_t *pkt = sdev->tx_head;
+
+	sdev->tx_head = pkt->next;
+	if (NULL == sdev->tx_head)
+		sdev->tx_tail = NULL;
+
+	if (pkt->is_inference && sdev->num_inference_pending > 0)
+		sdev->num_inference_pending--;
+
+	free(pkt);
+
+	pthread_cond_broadcast(&sdev->cond);
+}
+
+static void __sim_clear_packets(_sim_device_t *sdev)
+{
+	while (NULL != sdev->tx_head)
+		__sim_pop_packet(sdev);
+
+	sdev->num_inference_pending = 0;
+	sdev->npu_free_us = 0;
+	sdev->rx_state = SIM_RX_IDLE;
+	sdev->rx_remaining = 0;
+}
+
+static void __sim_release_models(_sim_device_t *sdev)
+{
+	for (uint32_t i = 0; i < sdev->num_models; i++)
+	{
+		if (NULL != sdev->result_template)
+			free(sdev->result_template[i]);
+	}
+
+	free(sdev->result_template);
+	free(sdev->result_template_size);
+	free(sdev->setup_location);
+	free(sdev->fw_info);
+	free(sdev->all_models);
+	deconstruct_model_nef_descriptor(&sdev->model_desc);
+
+	sdev->result_template = NULL;
+	sdev->result_template_size = NULL;
+	sdev->setup_location = NULL;
+	sdev->fw_info = NULL;
+	sdev->fw_info_size = 0;
+	sdev->all_models = NULL;
+	sdev->all_models_size = 0;
+	sdev->num_models = 0;
+}
+
+// power cycle, the connection is gone and everything in DDR is lost
+static void __sim_reboot(_sim_device_t *sdev)
+{
+	__sim_clear_packets(sdev);
+	__sim_release_models(sdev);
+
+	sdev->fifoq_allocated = false;
+	memset(&sdev->fifoq_config, 0, sizeof(kp_fifo_queue_config_t));
+	sdev->conn = NULL;
+
+	pthread_cond_broadcast(&sdev->cond);
+}
+
+static uint32_t __sim_kl720_data_format(uint32_t data_layout)
+{
+	switch (data_layout)
+	{
+	case KP_MODEL_TENSOR_DATA_LAYOUT_4W4C8B:
+		return SIM_DATA_FMT_KL720_4W4C8B;
+	case KP_MODEL_TENSOR_DATA_LAYOUT_1W16C8B:
+		return SIM_DATA_FMT_KL720_1W16C8B;
+	case KP_MODEL_TENSOR_DATA_LAYOUT_8W1C16B:
+		return SIM_DATA_FMT_KL720_8W1C16B;
+	case KP_MODEL_TENSOR_DATA_LAYOUT_16W1C8B:
+	default:
+		return SIM_DATA_FMT_KL720_16W1C8B;
+	}
+}
+
+static uint32_t __sim_kl720_node_size(uint32_t data_format, uint32_t channel, uint32_t height, uint32_t width)
+{
+	switch (data_format)
+	{
+	case SIM_DATA_FMT_KL720_8W1C16B:
+		return channel * height * ((width + 7) / 8 * 8) * 2;
+	case SIM_DATA_FMT_KL720_1W16C8B:
+		return (channel + 15) / 16 * height * width * 16;
+	default:
+		return channel * height * ((width + 15) / 16 * 16);
+	}
+}
+
+static uint32_t __sim_shape_dim(kp_tensor_descriptor_t *tensor, uint32_t index)
+{
+	// shape_npu is [1, channel, height, width]
+	if (NULL == tensor->shape_npu || index >= tensor->shape_npu_len || 0 == tensor->shape_npu[index])
+		return 1;
+
+	return tensor->shape_npu[index];
+}
+
+// build generic raw result (KL720 layout) of one model, only header stamp and inference related fields are changed per result
+static int __sim_build_result_template(kp_single_model_descriptor_t *model, uint8_t **template, uint32_t *template_size)
+{
+	uint32_t header_size = sizeof(kdp2_ipc_generic_raw_result_t) + sizeof(_720_raw_cnn_res_t);
+	uint32_t size = MAX(model->max_raw_out_size, header_size);
+
+	*template = (uint8_t *)calloc(1, size);
+	if (NULL == *template)
+		return KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+
+	*template_size = size;
+
+	_720_raw_cnn_res_t *raw_cnn_res = (_720_raw_cnn_res_t *)(*template + sizeof(kdp2_ipc_generic_raw_result_t));
+	uint32_t capacity = size - header_size;
+	uint32_t offset = 0;
+
+	raw_cnn_res->total_nodes = MIN(model->output_nodes_num, SIM_KL720_MAX_OUTPUT_NODE);
+
+	for (int i = 0; i < raw_cnn_res->total_nodes; i++)
+	{
+		kp_tensor_descriptor_t *tensor = &model->output_nodes[i];
+		_720_raw_onode_t *onode = &raw_cnn_res->onode_a[i];
+
+		onode->data_format = __sim_kl720_data_format(tensor->data_layout);
+		onode->ch_length = __sim_shape_dim(tensor, 1);
+		onode->row_length = __sim_shape_dim(tensor, 2);
+		onode->col_length = __sim_shape_dim(tensor, 3);
+		onode->node_id = i;
+		onode->output_index = tensor->index;
+		onode->start_offset = offset;
+		onode->buf_len = MIN(__sim_kl720_node_size(onode->data_format, onode->ch_length, onode->row_length, onode->col_length), capacity - offset);
+
+		float scale = 1.0f;
+
+		if (0 < tensor->quantization_parameters.quantized_fixed_point_descriptor_num)
+		{
+			scale = tensor->quantization_parameters.quantized_fixed_point_descriptor[0].scale;
+			onode->output_radix = (uint32_t)tensor->quantization_parameters.quantized_fixed_point_descriptor[0].radix;
+		}
+
+		memcpy(&onode->output_scale, &scale, sizeof(uint32_t));
+
+		offset += onode->buf_len;
+	}
+
+	raw_cnn_res->total_raw_len = offset;
+
+	return KP_SUCCESS;
+}
+
+static void __sim_finish_load_model(_sim_device_t *sdev)
+{
+	kp_nef_info_t nef_info = {0};
+	char *setups = NULL;
+	uint32_t setups_size = 0;
+
+	nef_info.target = KP_MODEL_TARGET_CHIP_KL720;
+	nef_info.fw_info_addr = sdev->fw_info;
+	nef_info.fw_info_size = sdev->fw_info_size;
+	nef_info.all_models_addr = sdev->all_models;
+	nef_info.all_models_size = sdev->all_models_size;
+
+	int ret = get_model_setup_location_list(&nef_info, &sdev->setup_location, &sdev->num_models);
+	if (KP_SUCCESS != ret)
+		goto FUNC_OUT;
+
+	// model descriptor is built the same way as kp_get_model_info() does from device
+	for (uint32_t i = 0; i < sdev->num_models; i++)
+		setups_size += sdev->setup_location[i].setup_size;
+
+	setups = (char *)malloc(MAX(setups_size, 1));
+	if (NULL == setups)
+	{
+		ret = KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+		goto FUNC_OUT;
+	}
+
+	for (uint32_t i = 0, offset = 0; i < sdev->num_models; i++)
+	{
+		memcpy(setups + offset, sdev->all_models + sdev->setup_location[i].setup_offset, sdev->setup_location[i].setup_size);
+		offset += sdev->setup_location[i].setup_size;
+	}
+
+	nef_info.all_models_addr = setups;
+	nef_info.all_models_size = setups_size;
+
+	ret = build_model_nef_descriptor_from_device(&nef_info, &sdev->model_desc);
+	if (KP_SUCCESS != ret)
+		goto FUNC_OUT;
+
+	sdev->result_template = (uint8_t **)calloc(sdev->num_models, sizeof(uint8_t *));
+	sdev->result_template_size = (uint32_t *)calloc(sdev->num_models, sizeof(uint32_t));
+
+	if (NULL == sdev->result_template || NULL == sdev->result_template_size)
+	{
+		ret = KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+		goto FUNC_OUT;
+	}
+
+	for (uint32_t i = 0; i < sdev->model_desc.num_models && i < sdev->num_models; i++)
+	{
+		ret = __sim_build_result_template(&sdev->model_desc.models[i], &sdev->result_template[i], &sdev->result_template_size[i]);
+		if (KP_SUCCESS != ret)
+			goto FUNC_OUT;
+	}
+
+FUNC_OUT:
+	free(setups);
+
+	if (KP_SUCCESS != ret)
+	{
+		err_print("[%s] simulated device failed to load model, error %d\n", __func__, ret);
+		__sim_release_models(sdev);
+	}
+}
+
+static int __sim_find_model(_sim_device_t *sdev, uint32_t model_id)
+{
+	for (uint32_t i = 0; i < sdev->model_desc.num_models && i < sdev->num_models; i++)
+	{
+		if (model_id == sdev->model_desc.models[i].id && NULL != sdev->result_template[i])
+			return (int)i;
+	}
+
+	return -1;
+}
+
+static void __sim_finish_inference(_sim_device_t *sdev)
+{
+	uint32_t image_index = sdev->rx_stamp.image_index;
+	uint32_t total_image = MAX(sdev->rx_stamp.total_image, 1);
+
+	if (image_index + 1 < total_image)
+		return; // wait for the other input node images
+
+	int model_index = __sim_find_model(sdev, sdev->rx_model_id);
+	uint32_t crop_count = (KDP2_INF_ID_GENERIC_RAW == sdev->rx_stamp.job_id) ? MIN(sdev->rx_crop_count, MAX_CROP_BOX) : 0;
+	uint32_t num_result = MAX(crop_count, 1);
+
+	for (uint32_t crop = 0; crop < num_result; crop++)
+	{
+		uint64_t npu_start_us = MAX(__sim_now_us(), sdev->npu_free_us);
+		sdev->npu_free_us = npu_start_us + _sim_config.npu_time_us + (uint64_t)(sdev - _sim_devices) * _sim_config.npu_time_step_us;
+
+		if (0 > model_index)
+		{
+			kp_inference_header_stamp_t stamp = sdev->rx_stamp;
+
+			stamp.total_size = sizeof(kp_inference_header_stamp_t);
+			stamp.status_code = KP_ERROR_MODEL_NOT_LOADED_35;
+			__sim_push_packet(sdev, &stamp, sizeof(stamp), sdev->npu_free_us, false);
+			continue;
+		}
+
+		uint32_t size = sdev->result_template_size[model_index];
+
+		if (KP_USB_RET_OK != __sim_push_packet(sdev, sdev->result_template[model_index], size, sdev->npu_free_us, true))
+			continue;
+
+		kdp2_ipc_generic_raw_result_t *result = (kdp2_ipc_generic_raw_result_t *)sdev->tx_tail->data;
+
+		result->header_stamp.magic_type = KDP2_MAGIC_TYPE_INFERENCE;
+		result->header_stamp.total_size = size;
+		result->header_stamp.job_id = sdev->rx_stamp.job_id;
+		result->header_stamp.status_code = KP_SUCCESS;
+		result->header_stamp.total_image = 1;
+		result->header_stamp.image_index = 0;
+		result->num_of_pre_proc_info = MIN(total_image, MAX_INPUT_NODE_COUNT);
+		result->product_id = KP_DEVICE_KL720;
+		result->inf_number = sdev->rx_inference_number;
+		result->crop_number = crop;
+		result->is_last_crop = (crop + 1 == num_result) ? 1 : 0;
+
+		memcpy(result->pre_proc_info, sdev->rx_pre_proc_info, sizeof(result->pre_proc_info));
+
+		if (0 < crop_count)
+			result->pre_proc_info[0].crop_area = sdev->rx_inf_crop[crop];
+
+		sdev->num_inference_pending++;
+	}
+}
+
+static uint32_t __sim_receive_command(_sim_device_t *sdev, uint8_t *data, uint32_t len)
+{
+	uint32_t command_id = ((uint32_t *)data)[2];
+	uint32_t return_code = KP_SUCCESS;
+
+	switch (command_id)
+	{
+	case KDP2_COMMAND_LOAD_MODEL:
+	{
+		kdp2_ipc_cmd_load_model_t *cmd = (kdp2_ipc_cmd_load_model_t *)data;
+
+		if (len < sizeof(kdp2_ipc_cmd_load_model_t) || len < sizeof(kdp2_ipc_cmd_load_model_t) + cmd->fw_info_size)
+		{
+			return_code = KP_FW_LOAD_MODEL_FAILED_104;
+			__sim_push_packet(sdev, &return_code, sizeof(uint32_t), 0, false);
+			return len;
+		}
+
+		__sim_release_models(sdev);
+
+		sdev->fw_info = (char *)malloc(MAX(cmd->fw_info_size, 1));
+		sdev->all_models = (char *)malloc(MAX(cmd->model_size, 1));
+
+		if (NULL == sdev->fw_info || NULL == sdev->all_models)
+		{
+			__sim_release_models(sdev);
+			return_code = KP_FW_DDR_MALLOC_FAILED_102;
+			__sim_push_packet(sdev, &return_code, sizeof(uint32_t), 0, false);
+			return len;
+		}
+
+		memcpy(sdev->fw_info, cmd->fw_info, cmd->fw_info_size);
+		sdev->fw_info_size = cmd->fw_info_size;
+		sdev->all_models_size = cmd->model_size;
+
+		sdev->rx_state = SIM_RX_MODEL;
+		sdev->rx_remaining = cmd->model_size;
+		sdev->rx_offset = 0;
+
+		__sim_push_packet(sdev, &return_code, sizeof(uint32_t), 0, false);
+
+		if (0 == sdev->rx_remaining)
+		{
+			sdev->rx_state = SIM_RX_IDLE;
+			__sim_finish_load_model(sdev);
+		}
+
+		return sizeof(kdp2_ipc_cmd_load_model_t) + cmd->fw_info_size;
+	}
+	case KDP2_COMMAND_GET_SYSTEM_INFO:
+	{
+		kdp2_ipc_response_get_system_info_t response = {0};
+
+		response.return_code = KP_SUCCESS;
+		response.system_info.kn_number = sdev->conn->dev_descp.kn_number;
+		response.system_info.firmware_version.major = _sim_fw_version[0];
+		response.system_info.firmware_version.minor = _sim_fw_version[1];
+		response.system_info.firmware_version.update = _sim_fw_version[2];
+		response.system_info.firmware_version.build = _sim_fw_version[3];
+
+		__sim_push_packet(sdev, &response, sizeof(response), 0, false);
+		break;
+	}
+	case KDP2_COMMAND_GET_MODEL_INFO:
+	{
+		uint32_t empty_fw_info[4] = {0}; // model_num, model_dram_addr_end, model_total_size, model_checksum
+		kdp2_ipc_response_get_model_info_fw_info_t fw_info_response = {0};
+		kdp2_ipc_response_get_model_info_setup_t setup_response = {0};
+		bool has_model = (0 < sdev->model_desc.num_models);
+
+		fw_info_response.return_code = KP_SUCCESS;
+		fw_info_response.fw_info_size = has_model ? sdev->fw_info_size : sizeof(empty_fw_info);
+		fw_info_response.target_chip = KP_MODEL_TARGET_CHIP_KL720;
+
+		__sim_push_packet(sdev, &fw_info_response, sizeof(fw_info_response), 0, false);
+		__sim_push_packet(sdev, has_model ? (void *)sdev->fw_info : (void *)empty_fw_info, fw_info_response.fw_info_size, 0, false);
+
+		setup_response.return_code = KP_SUCCESS;
+
+		for (uint32_t i = 0; has_model && i < sdev->num_models; i++)
+			setup_response.setup_size += sdev->setup_location[i].setup_size;
+
+		__sim_push_packet(sdev, &setup_response, sizeof(setup_response), 0, false);
+
+		for (uint32_t i = 0; has_model && i < sdev->num_models; i++)
+		{
+			setup_response.setup_size = sdev->setup_location[i].setup_size;
+
+			__sim_push_packet(sdev, &setup_response, sizeof(setup_response), 0, false);
+			__sim_push_packet(sdev, sdev->all_models + sdev->setup_location[i].setup_offset, setup_response.setup_size, 0, false);
+		}
+		break;
+	}
+	case KDP2_COMMAND_GET_DDR_CONFIG:
+	{
+		kp_available_ddr_config_t ddr_config = {0};
+
+		ddr_config.ddr_available_begin = SIM_DDR_BEGIN;
+		ddr_config.ddr_available_end = SIM_DDR_END;
+		ddr_config.ddr_model_end = SIM_DDR_BEGIN + (sdev->all_models_size + SIM_BUFFER_SIZE_10_KB - 1) / SIM_BUFFER_SIZE_10_KB * SIM_BUFFER_SIZE_10_KB;
+		ddr_config.ddr_fifoq_allocated = sdev->fifoq_allocated ? 1 : 0;
+
+		__sim_push_packet(sdev, &ddr_config, sizeof(ddr_config), 0, false);
+		break;
+	}
+	case KDP2_COMMAND_GET_FIFOQ_CONFIG:
+		__sim_push_packet(sdev, &sdev->fifoq_config, sizeof(kp_fifo_queue_config_t), 0, false);
+		break;
+	default:
+		dbg_print("[%s] unsupported command 0x%X\n", __func__, command_id);
+		return_code = KP_FW_ERROR_UNKNOWN_APP;
+		__sim_push_packet(sdev, &return_code, sizeof(uint32_t), 0, false);
+		break;
+	}
+
+	return len;
+}
+
+// return consumed size, or < 0 for kp_usb_status_t error
+static int __sim_receive_inference(_sim_device_t *sdev, kp_usb_device_t *dev, uint8_t *data, uint32_t len, int timeout)
+{
+	kp_inference_header_stamp_t *stamp = (kp_inference_header_stamp_t *)data;
+	uint32_t header_size = 0;
+
+	if (KDP2_INF_ID_GENERIC_RAW == stamp->job_id)
+		header_size = sizeof(kdp2_ipc_generic_raw_inf_header_t);
+	else if (KDP2_INF_ID_GENERIC_RAW_BYPASS_PRE_PROC == stamp->job_id)
+		header_size = sizeof(kdp2_ipc_generic_raw_inf_bypass_pre_proc_header_t);
+
+	if (0 == header_size || len < header_size || stamp->total_size < header_size)
+	{
+		// not generic raw inference, report error after discarding the rest of data
+		kp_inference_header_stamp_t result = *stamp;
+
+		result.total_size = sizeof(kp_inference_header_stamp_t);
+		result.status_code = KP_FW_ERROR_UNKNOWN_APP;
+		__sim_push_packet(sdev, &result, sizeof(result), 0, false);
+
+		sdev->rx_state = (stamp->total_size > len) ? SIM_RX_DISCARD : SIM_RX_IDLE;
+		sdev->rx_remaining = (stamp->total_size > len) ? stamp->total_size - len : 0;
+
+		return len;
+	}
+
+	// images wait on host side if all FIFO queue buffers are occupied
+	uint64_t deadline_us = (timeout > 0) ? __sim_now_us() + (uint64_t)timeout * 1000 : 0;
+	int max_pending = (int)(sdev->fifoq_config.fifoq_input_buf_count + sdev->fifoq_config.fifoq_result_buf_count);
+
+	while (sdev->fifoq_allocated && 0 == stamp->image_index && sdev->num_inference_pending >= max_pending)
+	{
+		if (sdev->conn != dev)
+			return KP_USB_USB_NO_DEVICE;
+
+		if (0 != deadline_us && __sim_now_us() >= deadline_us)
+			return KP_USB_USB_TIMEOUT;
+
+		__sim_wait_until(sdev, deadline_us);
+	}
+
+	uint32_t image_index = MIN(stamp->image_index, MAX_INPUT_NODE_COUNT - 1);
+	kp_hw_pre_proc_info_t *pre_proc_info = &sdev->rx_pre_proc_info[image_index];
+
+	sdev->rx_stamp = *stamp;
+	sdev->rx_crop_count = 0;
+	memset(pre_proc_info, 0, sizeof(kp_hw_pre_proc_info_t));
+
+	if (KDP2_INF_ID_GENERIC_RAW == stamp->job_id)
+	{
+		kdp2_ipc_generic_raw_inf_header_t *header = (kdp2_ipc_generic_raw_inf_header_t *)data;
+
+		sdev->rx_inference_number = header->inference_number;
+		sdev->rx_model_id = header->model_id;
+		sdev->rx_crop_count = header->image_header.crop_count;
+		memcpy(sdev->rx_inf_crop, header->image_header.inf_crop, sizeof(sdev->rx_inf_crop));
+
+		pre_proc_info->img_width = header->image_header.width;
+		pre_proc_info->img_height = header->image_header.height;
+	}
+	else
+	{
+		kdp2_ipc_generic_raw_inf_bypass_pre_proc_header_t *header = (kdp2_ipc_generic_raw_inf_bypass_pre_proc_header_t *)data;
+
+		sdev->rx_inference_number = header->inference_number;
+		sdev->rx_model_id = header->model_id;
+	}
+
+	int model_index = __sim_find_model(sdev, sdev->rx_model_id);
+
+	if (0 <= model_index && image_index < sdev->model_desc.models[model_index].input_nodes_num)
+	{
+		kp_tensor_descriptor_t *input_node = &sdev->model_desc.models[model_index].input_nodes[image_index];
+
+		pre_proc_info->model_input_width = __sim_shape_dim(input_node, 3);
+		pre_proc_info->model_input_height = __sim_shape_dim(input_node, 2);
+		pre_proc_info->resized_img_width = pre_proc_info->model_input_width;
+		pre_proc_info->resized_img_height = pre_proc_info->model_input_height;
+	}
+
+	sdev->rx_state = SIM_RX_INFERENCE;
+	sdev->rx_remaining = stamp->total_size - header_size;
+
+	if (0 == sdev->rx_remaining)
+	{
+		sdev->rx_state = SIM_RX_IDLE;
+		__sim_finish_inference(sdev);
+	}
+
+	return header_size;
+}
+
+static uint32_t __sim_receive_payload(_sim_device_t *sdev, uint8_t *data, uint32_t len)
+{
+	uint32_t size = MIN(len, sdev->rx_remaining);
+
+	if (SIM_RX_MODEL == sdev->rx_state)
+	{
+		memcpy(sdev->all_models + sdev->rx_offset, data, size);
+		sdev->rx_offset += size;
+	}
+
+	sdev->rx_remaining -= size;
+
+	if (0 == sdev->rx_remaining)
+	{
+		int rx_state = sdev->rx_state;
+
+		sdev->rx_state = SIM_RX_IDLE;
+
+		if (SIM_RX_MODEL == rx_state)
+			__sim_finish_load_model(sdev);
+		else if (SIM_RX_INFERENCE == rx_state)
+			__sim_finish_inference(sdev);
+	}
+
+	return size;
+}
+
+// *********************************************************************************************** //
+// Below are transport functions
+// *********************************************************************************************** //
+
+static int __sim_write_data(kp_usb_device_t *dev, void *buf, int len, int timeout)
+{
+	_sim_device_t *sdev = (_sim_device_t *)dev->transport_priv;
+	uint8_t *data = (uint8_t *)buf;
+	int ret = KP_USB_RET_OK;
+
+	__sim_transfer_delay(len);
+
+	pthread_mutex_lock(&sdev->mutex);
+
+	// a command or inference header always comes at the beginning of one write
+	while (len > 0)
+	{
+		int consumed = 0;
+
+		if (sdev->conn != dev)
+		{
+			ret = KP_USB_USB_NO_DEVICE;
+			break;
+		}
+
+		if (SIM_RX_IDLE != sdev->rx_state)
+			consumed = __sim_receive_payload(sdev, data, len);
+		else if (len < 3 * sizeof(uint32_t))
+			consumed = len; // too short to be a command or header
+		else if (KDP2_MAGIC_TYPE_COMMAND == ((uint32_t *)data)[0])
+			consumed = __sim_receive_command(sdev, data, len);
+		else
+			consumed = __sim_receive_inference(sdev, dev, data, len, timeout);
+
+		if (consumed < 0)
+		{
+			ret = consumed;
+			break;
+		}
+
+		data += consumed;
+		len -= consumed;
+	}
+
+	pthread_mutex_unlock(&sdev->mutex);
+
+	return ret;
+}
+
+static int __sim_write_data_list(kp_usb_device_t *dev, kp_usb_buffer_t buf_list[], int num_buf, int timeout)
+{
+	int ret = KP_USB_RET_OK;
+
+	for (int i = 0; i < num_buf && KP_USB_RET_OK == ret; i++)
+		ret = __sim_write_data(dev, buf_list[i].buf, buf_list[i].len, timeout);
+
+	return ret;
+}
+
+static int __sim_read_data(kp_usb_device_t *dev, void *buf, int len, int timeout)
+{
+	_sim_device_t *sdev = (_sim_device_t *)dev->transport_priv;
+	uint64_t deadline_us = (timeout > 0) ? __sim_now_us() + (uint64_t)timeout * 1000 : 0;
+	int ret = 0;
+
+	if (len <= 0)
+		return 0;
+
+	pthread_mutex_lock(&dev->mutex_recv);
+
+	if (NULL != dev->posted_buf)
+	{
+		pthread_mutex_unlock(&dev->mutex_recv);
+		return KP_USB_USB_BUSY;
+	}
+
+	pthread_mutex_lock(&sdev->mutex);
+
+	while (1)
+	{
+		if (sdev->conn != dev)
+		{
+			ret = KP_USB_USB_NO_DEVICE;
+			break;
+		}
+
+		uint64_t now_us = __sim_now_us();
+		uint64_t wake_us = deadline_us;
+
+		if (NULL != sdev->tx_head)
+		{
+			if (sdev->tx_head->ready_us <= now_us)
+			{
+				// the rest of a packet is kept for next read if buffer is not large enough
+				_sim_packet_t *pkt = sdev->tx_head;
+
+				ret = MIN((uint32_t)len, pkt->size - pkt->offset);
+				memcpy(buf, pkt->data + pkt->offset, ret);
+				pkt->offset += ret;
+
+				if (pkt->offset == pkt->size)
+					__sim_pop_packet(sdev);
+
+				break;
+			}
+
+			if (0 == wake_us || sdev->tx_head->ready_us < wake_us)
+				wake_us = sdev->tx_head->ready_us;
+		}
+
+		if (0 != deadline_us && now_us >= deadline_us)
+		{
+			ret = KP_USB_USB_TIMEOUT;
+			break;
+		}
+
+		__sim_wait_until(sdev, wake_us);
+	}
+
+	pthread_mutex_unlock(&sdev->mutex);
+	pthread_mutex_unlock(&dev->mutex_recv);
+
+	if (ret > 0)
+		__sim_transfer_delay(ret);
+
+	return ret;
+}
+
+static int __sim_submit_read(kp_usb_device_t *dev, void *buf, int len)
+{
+	int ret = KP_USB_USB_BUSY;
+
+	pthread_mutex_lock(&dev->mutex_recv);
+
+	if (NULL == dev->posted_buf)
+	{
+		dev->posted_buf = buf;
+		dev->posted_len = len;
+		dev->posted_recv = 0;
+		ret = KP_USB_RET_OK;
+	}
+
+	pthread_mutex_unlock(&dev->mutex_recv);
+
+	return ret;
+}
+
+// the posted read completes once the packet is ready and its transfer time has passed
+static int __sim_poll_read(kp_usb_device_t *dev, int *wait_us)
+{
+	_sim_device_t *sdev = (_sim_device_t *)dev->transport_priv;
+	int ret = KP_USB_RET_PENDING;
+
+	*wait_us = -1;
+
+	pthread_mutex_lock(&dev->mutex_recv);
+
+	if (NULL == dev->posted_buf)
+	{
+		pthread_mutex_unlock(&dev->mutex_recv);
+		return KP_USB_USB_INVALID_PARAM;
+	}
+
+	pthread_mutex_lock(&sdev->mutex);
+
+	if (sdev->conn != dev)
+	{
+		ret = KP_USB_USB_NO_DEVICE;
+	}
+	else if (NULL != sdev->tx_head)
+	{
+		_sim_packet_t *pkt = sdev->tx_head;
+		int size = MIN((uint32_t)dev->posted_len, pkt->size - pkt->offset);
+		uint64_t done_us = pkt->ready_us + __sim_transfer_time_us(size);
+		uint64_t now_us = __sim_now_us();
+
+		if (done_us <= now_us)
+		{
+			memcpy(dev->posted_buf, pkt->data + pkt->offset, size);
+			pkt->offset += size;
+
+			if (pkt->offset == pkt->size)
+				__sim_pop_packet(sdev);
+
+			ret = size;
+		}
+		else
+		{
+			*wait_us = (int)MIN(done_us - now_us, 1000000);
+		}
+	}
+
+	pthread_mutex_unlock(&sdev->mutex);
+
+	if (KP_USB_RET_PENDING != ret)
+		dev->posted_buf = NULL;
+
+	pthread_mutex_unlock(&dev->mutex_recv);
+
+	return ret;
+}
+
+static void __sim_cancel_read(kp_usb_device_t *dev)
+{
+	pthread_mutex_lock(&dev->mutex_recv);
+	dev->posted_buf = NULL;
+	pthread_mutex_unlock(&dev->mutex_recv);
+}
+
+static int __sim_control(kp_usb_device_t *dev, kp_usb_control_t *control_request, int timeout)
+{
+	_sim_device_t *sdev = (_sim_device_t *)dev->transport_priv;
+	int ret = KP_USB_RET_OK;
+
+	__sim_transfer_delay(0);
+
+	pthread_mutex_lock(&sdev->mutex);
+
+	if (sdev->conn != dev)
+	{
+		pthread_mutex_unlock(&sdev->mutex);
+		return KP_USB_USB_NO_DEVICE;
+	}
+
+	switch (control_request->command)
+	{
+	case KDP2_CONTROL_FIFOQ_RESET:
+		__sim_clear_packets(sdev);
+		break;
+	case KDP2_CONTROL_FIFOQ_CONFIGURE:
+		sdev->fifoq_config.fifoq_input_buf_count = (control_request->arg1 & 0x7) + 1;
+		sdev->fifoq_config.fifoq_input_buf_size = ((control_request->arg1 >> 3) + 1) * SIM_BUFFER_SIZE_10_KB;
+		sdev->fifoq_config.fifoq_result_buf_count = (control_request->arg2 & 0x7) + 1;
+		sdev->fifoq_config.fifoq_result_buf_size = ((control_request->arg2 >> 3) + 1) * SIM_BUFFER_SIZE_10_KB;
+		sdev->fifoq_allocated = true;
+		break;
+	case KDP2_CONTROL_REBOOT:
+	case KDP2_CONTROL_REBOOT_SYSTEM:
+	case KDP2_CONTROL_SHUTDOWN:
+		__sim_reboot(sdev);
+		ret = KP_USB_USB_NO_DEVICE; // same as most real devices disappear before the control transfer completes
+		break;
+	default:
+		break;
+	}
+
+	pthread_mutex_unlock(&sdev->mutex);
+
+	return ret;
+}
+
+static void __sim_flush_out_buffers(kp_usb_device_t *dev)
+{
+	_sim_device_t *sdev = (_sim_device_t *)dev->transport_priv;
+
+	pthread_mutex_lock(&sdev->mutex);
+
+	if (sdev->conn == dev)
+	{
+		// drop results not yet read, FIFO queue buffers are released by KDP2_CONTROL_FIFOQ_RESET
+		while (NULL != sdev->tx_head)
+			__sim_pop_packet(sdev);
+	}
+
+	pthread_mutex_unlock(&sdev->mutex);
+}
+
+static int __sim_disconnect_device(kp_usb_device_t *dev)
+{
+	_sim_device_t *sdev = (_sim_device_t *)dev->transport_priv;
+
+	pthread_mutex_lock(&sdev->mutex);
+
+	if (sdev->conn == dev)
+	{
+		sdev->conn = NULL;
+		sdev->rx_state = SIM_RX_IDLE;
+		sdev->rx_remaining = 0;
+		pthread_cond_broadcast(&sdev->cond);
+	}
+
+	pthread_mutex_unlock(&sdev->mutex);
+
+	pthread_mutex_destroy(&dev->mutex_send);
+	pthread_mutex_destroy(&dev->mutex_recv);
+	free(dev);
+
+	return KP_USB_RET_OK;
+}
+
+// *********************************************************************************************** //
+// Below are functions called by kp_usb.c and kp_core.c
+// *********************************************************************************************** //
+
+int kp_usb_sim_configure(kp_sim_device_config_t *config, const int fw_version[4])
+{
+	if (KP_USB_SIM_MAX_DEVICE < config->num_devices)
+		return KP_ERROR_DEVICES_NUMBER_26;
+
+	if (0 < config->num_devices && KP_DEVICE_KL720 != config->product_id)
+		return KP_ERROR_UNSUPPORTED_DEVICE_44;
+
+	pthread_mutex_lock(&_sim_mutex);
+
+	if (false == _sim_devices_inited)
+	{
+		memset(_sim_devices, 0, sizeof(_sim_devices));
+
+		for (int i = 0; i < KP_USB_SIM_MAX_DEVICE; i++)
+		{
+			pthread_mutex_init(&_sim_devices[i].mutex, NULL);
+			pthread_cond_init(&_sim_devices[i].cond, NULL);
+		}
+
+		_sim_devices_inited = true;
+	}
+
+	memcpy(&_sim_config, config, sizeof(kp_sim_device_config_t));
+	memcpy(_sim_fw_version, fw_version, sizeof(_sim_fw_version));
+
+	pthread_mutex_unlock(&_sim_mutex);
+
+	return KP_SUCCESS;
+}
+
+int kp_usb_sim_get_num_devices()
+{
+	return (int)_sim_config.num_devices;
+}
+
+void kp_usb_sim_get_device_descriptor(int index, kp_device_descriptor_t *dev_descp)
+{
+	memset(dev_descp, 0, sizeof(kp_device_descriptor_t));
+
+	dev_descp->port_id = KP_USB_SIM_PORT_ID_BASE + index;
+	dev_descp->vendor_id = SIM_VENDOR_ID;
+	dev_descp->product_id = (uint16_t)_sim_config.product_id;
+	dev_descp->link_speed = KP_USB_SPEED_SUPER;
+	dev_descp->kn_number = SIM_KN_NUMBER_BASE + index;
+	dev_descp->isConnectable = true;
+
+	snprintf(dev_descp->port_path, sizeof(dev_descp->port_path), "sim-%d", index);
+	snprintf(dev_descp->firmware, sizeof(dev_descp->firmware), "KDP2 Comp/F (Sim)");
+}
+
+bool kp_usb_sim_is_port_id(uint32_t port_id)
+{
+	return (port_id >= KP_USB_SIM_PORT_ID_BASE) && (port_id < KP_USB_SIM_PORT_ID_BASE + KP_USB_SIM_MAX_DEVICE);
+}
+
+bool kp_usb_sim_is_plugged(int index)
+{
+	if (index < 0 || index >= (int)_sim_config.num_devices)
+		return false;
+
+	return !__atomic_load_n(&_sim_devices[index].unplugged, __ATOMIC_ACQUIRE);
+}
+
+int kp_usb_sim_set_plugged(int index, bool plugged)
+{
+	if (index < 0 || index >= (int)_sim_config.num_devices)
+		return KP_USB_USB_NOT_FOUND;
+
+	_sim_device_t *sdev = &_sim_devices[index];
+
+	pthread_mutex_lock(&sdev->mutex);
+
+	bool changed = (sdev->unplugged == plugged);
+
+	// unplugging loses power, the connection fails from now on
+	if (changed && !plugged)
+		__sim_reboot(sdev);
+
+	__atomic_store_n(&sdev->unplugged, !plugged, __ATOMIC_RELEASE);
+
+	pthread_mutex_unlock(&sdev->mutex);
+
+	if (changed)
+	{
+		kp_usb_notify_read_any(); // posted reads of the connection fail
+		kp_usb_notify_hotplug(plugged, KP_USB_SIM_PORT_ID_BASE + index, (uint16_t)_sim_config.product_id);
+	}
+
+	return KP_USB_RET_OK;
+}
+
+int kp_usb_sim_connect_devices(int num_dev, int port_id[], kp_usb_device_t *output_devs[])
+{
+	int ret = KP_USB_RET_OK;
+
+	for (int i = 0; i < num_dev; i++)
+		output_devs[i] = NULL;
+
+	for (int i = 0; i < num_dev; i++)
+	{
+		uint32_t index = (uint32_t)port_id[i] - KP_USB_SIM_PORT_ID_BASE;
+
+		if (!kp_usb_sim_is_port_id((uint32_t)port_id[i]) || index >= _sim_config.num_devices)
+		{
+			ret = KP_USB_USB_NOT_FOUND;
+			break;
+		}
+
+		_sim_device_t *sdev = &_sim_devices[index];
+		kp_usb_device_t *dev = (kp_usb_device_t *)calloc(1, sizeof(kp_usb_device_t));
+
+		if (NULL == dev)
+		{
+			ret = KP_USB_USB_NO_MEM;
+			break;
+		}
+
+		dev->transport = &_sim_transport;
+		dev->transport_priv = sdev;
+		dev->fw_serial = SIM_FW_SERIAL;
+		dev->queue_depth = 1;
+		dev->posted_buf = NULL;
+		kp_usb_sim_get_device_descriptor(index, &dev->dev_descp);
+		pthread_mutex_init(&dev->mutex_send, NULL);
+		pthread_mutex_init(&dev->mutex_recv, NULL);
+
+		pthread_mutex_lock(&sdev->mutex);
+
+		if (sdev->unplugged)
+		{
+			ret = KP_USB_USB_NOT_FOUND;
+		}
+		else if (NULL != sdev->conn)
+		{
+			ret = KP_USB_USB_BUSY;
+		}
+		else
+		{
+			sdev->conn = dev;
+			sdev->rx_state = SIM_RX_IDLE;
+			sdev->rx_remaining = 0;
+		}
+
+		pthread_mutex_unlock(&sdev->mutex);
+
+		if (KP_USB_RET_OK != ret)
+		{
+			pthread_mutex_destroy(&dev->mutex_send);
+			pthread_mutex_destroy(&dev->mutex_recv);
+			free(dev);
+			break;
+		}
+
+		output_devs[i] = dev;
+	}
+
+	if (KP_USB_RET_OK != ret)
+		kp_usb_disconnect_multiple_devices(num_dev, output_devs);
+
+	return ret;
+}
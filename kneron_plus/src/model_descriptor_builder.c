@@ -20,7 +20,9 @@
 // #define DEBUG_PRINT
 
 #include "internal_func.h"
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "kdp2_inf_generic_raw.h"
@@ -126,178 +128,400 @@ int deconstruct_model_setup_memory_info_list(_model_setup_memory_info_list_t* mo
     return ret;
 }
 
-int deconstruct_quantization_parameters(kp_quantization_parameters_t* quantization_parameters) {
-    int ret = KP_SUCCESS;
+/******************************************************************
+ * kp_model_nef_descriptor_t arena
+ ******************************************************************/
 
-    quantization_parameters->quantized_fixed_point_descriptor = realloc_zero(quantization_parameters->quantized_fixed_point_descriptor, 0);
-    quantization_parameters->quantized_fixed_point_descriptor_num = 0;
+/**
+ * A built kp_model_nef_descriptor_t lives in one block: the arena header, then
+ * the model list, tensor lists, shapes, quantization parameters and strings.
+ * Descriptors sharing the block hold a reference, the last release frees it.
+ *
+ * Every fixed-point descriptor list is followed by its floating-point factors, which are internal and
+ * not part of kp_quantization_parameters_t. They are found by get_quantization_float_scale() through
+ * the list of live arenas.
+ */
+#define MODEL_DESC_ARENA_MAGIC      0x4D444152
+#define MODEL_DESC_ARENA_ALIGNMENT  8
 
-    if (NULL != quantization_parameters->quantized_fixed_point_descriptor) {
-        err_print("deconstruct tensor quantization fixed point parameter in model_descriptor fail ...\n");
-        ret = KP_ERROR_MEMORY_FREE_FAILURE_39;
+typedef struct
+{
+    uint32_t magic;
+    int32_t ref_count;
+    uint32_t size;
+    uint32_t reserved;
+} __attribute__((aligned(MODEL_DESC_ARENA_ALIGNMENT))) _model_desc_arena_header_t;
+
+static pthread_mutex_t _arena_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _model_desc_arena_header_t **_arena_list = NULL;
+static uint32_t _arena_list_num = 0;
+static uint32_t _arena_list_capacity = 0;
+
+#define _ARENA_ALIGN(size) (((size) + MODEL_DESC_ARENA_ALIGNMENT - 1) & ~((size_t)MODEL_DESC_ARENA_ALIGNMENT - 1))
+
+// an arena left out of the list only loses its precomputed factors
+static void _register_model_desc_arena(_model_desc_arena_header_t *arena) {
+    pthread_mutex_lock(&_arena_list_mutex);
+
+    if (_arena_list_num == _arena_list_capacity) {
+        uint32_t capacity = (0 == _arena_list_capacity) ? 8 : 2 * _arena_list_capacity;
+        _model_desc_arena_header_t **list = (_model_desc_arena_header_t **)realloc(_arena_list, capacity * sizeof(_model_desc_arena_header_t *));
+
+        if (NULL != list) {
+            _arena_list = list;
+            _arena_list_capacity = capacity;
+        }
     }
 
-    return ret;
+    if (_arena_list_num < _arena_list_capacity)
+        _arena_list[_arena_list_num++] = arena;
+
+    pthread_mutex_unlock(&_arena_list_mutex);
 }
 
-int deconstruct_tensor_descriptor(kp_tensor_descriptor_t* tensor_descriptor) {
-    int ret = KP_SUCCESS;
-    kp_quantization_parameters_t *quantization_parameters = NULL;
+static void _unregister_model_desc_arena(_model_desc_arena_header_t *arena) {
+    pthread_mutex_lock(&_arena_list_mutex);
 
-    tensor_descriptor->name =       realloc_zero(tensor_descriptor->name, 0);
-    tensor_descriptor->shape_npu =  realloc_zero(tensor_descriptor->shape_npu, 0);
-    tensor_descriptor->shape_onnx = realloc_zero(tensor_descriptor->shape_onnx, 0);
+    for (uint32_t i = 0; i < _arena_list_num; i++) {
+        if (arena == _arena_list[i]) {
+            _arena_list[i] = _arena_list[--_arena_list_num];
+            break;
+        }
+    }
 
-    if (NULL != tensor_descriptor->name ||
-        NULL != tensor_descriptor->shape_npu ||
-        NULL != tensor_descriptor->shape_onnx) {
-        err_print("deconstruct tensor descriptor in model_descriptor fail ...\n");
-        ret = KP_ERROR_MEMORY_FREE_FAILURE_39;
-        goto FUNC_OUT;
+    pthread_mutex_unlock(&_arena_list_mutex);
+}
+
+const float* get_quantization_float_scale(const kp_quantization_parameters_t *quantization_parameters) {
+    const float *float_scale = NULL;
+
+    if (NULL == quantization_parameters || NULL == quantization_parameters->quantized_fixed_point_descriptor)
+        return NULL;
+
+    uintptr_t descriptor = (uintptr_t)quantization_parameters->quantized_fixed_point_descriptor;
+    size_t descriptor_size = _ARENA_ALIGN(quantization_parameters->quantized_fixed_point_descriptor_num * sizeof(kp_quantized_fixed_point_descriptor_t));
+    size_t scale_size = quantization_parameters->quantized_fixed_point_descriptor_num * sizeof(float);
+
+    pthread_mutex_lock(&_arena_list_mutex);
+
+    for (uint32_t i = 0; i < _arena_list_num; i++) {
+        uintptr_t begin = (uintptr_t)_arena_list[i] + sizeof(_model_desc_arena_header_t);
+        uintptr_t end = (uintptr_t)_arena_list[i] + _arena_list[i]->size;
+
+        if (descriptor >= begin && descriptor < end) {
+            if (descriptor_size + scale_size <= end - descriptor)
+                float_scale = (const float *)(descriptor + descriptor_size);
+
+            break;
+        }
     }
 
-    quantization_parameters = &(tensor_descriptor->quantization_parameters);
-    ret = deconstruct_quantization_parameters(quantization_parameters);
+    pthread_mutex_unlock(&_arena_list_mutex);
 
-    if (KP_SUCCESS != ret) {
-        err_print("deconstruct tensor quantization parameters in model_descriptor fail ...\n");
-        goto FUNC_OUT;
+    return float_scale;
+}
+
+static _model_desc_arena_header_t* _get_model_desc_arena(kp_model_nef_descriptor_t* model_desc) {
+    if (0x5AA55AA5 != model_desc->magic || NULL == model_desc->models)
+        return NULL;
+
+    _model_desc_arena_header_t *arena = (_model_desc_arena_header_t *)((uintptr_t)model_desc->models - sizeof(_model_desc_arena_header_t));
+
+    return (MODEL_DESC_ARENA_MAGIC == arena->magic) ? arena : NULL;
+}
+
+// copy into the arena, or only count the size if base is NULL
+static void* _place_in_arena(uint8_t *base, size_t *offset, const void *src, size_t size) {
+    void *dst = NULL;
+
+    if (NULL != base && NULL != src && 0 < size) {
+        dst = memcpy(base + *offset, src, size);
     }
 
-    memset(tensor_descriptor, 0, sizeof(kp_tensor_descriptor_t));
+    if (NULL != src) {
+        *offset += _ARENA_ALIGN(size);
+    }
 
-FUNC_OUT:
-    return ret;
+    return dst;
 }
 
-int deconstruct_single_model_descriptor(kp_single_model_descriptor_t* single_model_descriptor) {
-    int ret = KP_SUCCESS;
-    kp_tensor_descriptor_t *tensor_descriptor = NULL;
+// reserve space in the arena to be filled by the caller, or only count the size if base is NULL
+static void* _reserve_in_arena(uint8_t *base, size_t *offset, size_t size) {
+    void *dst = (NULL != base && 0 < size) ? base + *offset : NULL;
+
+    *offset += _ARENA_ALIGN(size);
+
+    return dst;
+}
+
+static char* _place_string_in_arena(uint8_t *base, size_t *offset, const char *src) {
+    return (char *)_place_in_arena(base, offset, src, (NULL != src) ? strlen(src) + 1 : 0);
+}
+
+static kp_tensor_descriptor_t* _place_tensor_list_in_arena(uint8_t *base, size_t *offset, kp_tensor_descriptor_t *src, uint32_t num) {
+    kp_tensor_descriptor_t *dst = (kp_tensor_descriptor_t *)_place_in_arena(base, offset, src, num * sizeof(kp_tensor_descriptor_t));
+
+    for (uint32_t i = 0; i < num; i++) {
+        kp_quantization_parameters_t *quantization_parameters = &(src[i].quantization_parameters);
+
+        char *name = _place_string_in_arena(base, offset, src[i].name);
+        uint32_t *shape_npu = (uint32_t *)_place_in_arena(base, offset, src[i].shape_npu, src[i].shape_npu_len * sizeof(uint32_t));
+        uint32_t *shape_onnx = (uint32_t *)_place_in_arena(base, offset, src[i].shape_onnx, src[i].shape_onnx_len * sizeof(uint32_t));
+        kp_quantized_fixed_point_descriptor_t *quantized_fixed_point_descriptor = (kp_quantized_fixed_point_descriptor_t *)_place_in_arena(base, offset, quantization_parameters->quantized_fixed_point_descriptor,
+                                                                                                                                          quantization_parameters->quantized_fixed_point_descriptor_num * sizeof(kp_quantized_fixed_point_descriptor_t));
 
-    for (int i = 0; i < single_model_descriptor->input_nodes_num; i++) {
-        tensor_descriptor = &(single_model_descriptor->input_nodes[i]);
-        ret = deconstruct_tensor_descriptor(tensor_descriptor);
+        // factors are computed once here, so that per-channel dequantization does no division per inference,
+        // they follow the descriptor list as get_quantization_float_scale() expects
+        if (NULL != quantization_parameters->quantized_fixed_point_descriptor) {
+            float *quantized_fixed_point_float_scale = (float *)_reserve_in_arena(base, offset, quantization_parameters->quantized_fixed_point_descriptor_num * sizeof(float));
 
-        if (KP_SUCCESS != ret) {
-            err_print("deconstruct input tensor descriptor fail ...\n");
-            goto FUNC_OUT;
+            for (uint32_t j = 0; NULL != quantized_fixed_point_float_scale && j < quantization_parameters->quantized_fixed_point_descriptor_num; j++) {
+                quantized_fixed_point_float_scale[j] = dequantize_float_scale(quantization_parameters->quantized_fixed_point_descriptor[j].scale,
+                                                                              quantization_parameters->quantized_fixed_point_descriptor[j].radix);
+            }
+        }
+
+        if (NULL != dst) {
+            dst[i].name = name;
+            dst[i].shape_npu = shape_npu;
+            dst[i].shape_onnx = shape_onnx;
+            dst[i].quantization_parameters.quantized_fixed_point_descriptor = quantized_fixed_point_descriptor;
         }
     }
 
-    for (int i = 0; i < single_model_descriptor->output_nodes_num; i++) {
-        tensor_descriptor = &(single_model_descriptor->output_nodes[i]);
-        ret = deconstruct_tensor_descriptor(tensor_descriptor);
+    return dst;
+}
+
+static size_t _place_model_nef_descriptor_in_arena(uint8_t *base, kp_model_nef_descriptor_t* src, kp_model_nef_descriptor_t* dst) {
+    size_t offset = sizeof(_model_desc_arena_header_t);
+
+    // the model list comes first, the arena is found from it
+    kp_single_model_descriptor_t *models = (kp_single_model_descriptor_t *)_place_in_arena(base, &offset, src->models, src->num_models * sizeof(kp_single_model_descriptor_t));
 
-        if (KP_SUCCESS != ret) {
-            err_print("deconstruct output tensor descriptor fail ...\n");
-            goto FUNC_OUT;
+    for (uint32_t i = 0; i < src->num_models; i++) {
+        kp_tensor_descriptor_t *input_nodes = _place_tensor_list_in_arena(base, &offset, src->models[i].input_nodes, src->models[i].input_nodes_num);
+        kp_tensor_descriptor_t *output_nodes = _place_tensor_list_in_arena(base, &offset, src->models[i].output_nodes, src->models[i].output_nodes_num);
+
+        if (NULL != models) {
+            models[i].input_nodes = input_nodes;
+            models[i].output_nodes = output_nodes;
         }
     }
 
-    single_model_descriptor->input_nodes =  realloc_zero(single_model_descriptor->input_nodes, 0);
-    single_model_descriptor->output_nodes = realloc_zero(single_model_descriptor->output_nodes, 0);
+    char *toolchain_version = _place_string_in_arena(base, &offset, src->metadata.toolchain_version);
+    char *compiler_version = _place_string_in_arena(base, &offset, src->metadata.compiler_version);
+    char *platform = _place_string_in_arena(base, &offset, src->metadata.platform);
 
-    if (NULL != single_model_descriptor->input_nodes ||
-        NULL != single_model_descriptor->output_nodes) {
-        err_print("deconstruct single model descriptor attributes in model_descriptor fail ...\n");
-        ret = KP_ERROR_MEMORY_FREE_FAILURE_39;
-        goto FUNC_OUT;
+    if (NULL != base) {
+        memcpy(dst, src, sizeof(kp_model_nef_descriptor_t));
+        dst->models = (kp_single_model_descriptor_t *)(base + sizeof(_model_desc_arena_header_t));
+        dst->metadata.toolchain_version = toolchain_version;
+        dst->metadata.compiler_version = compiler_version;
+        dst->metadata.platform = platform;
     }
 
-    memset(single_model_descriptor, 0, sizeof(kp_single_model_descriptor_t));
+    return offset;
+}
 
-FUNC_OUT:
-    return ret;
+// pack a descriptor built in scratch memory into its own arena
+static int _pack_model_nef_descriptor(kp_model_nef_descriptor_t* src, kp_model_nef_descriptor_t* dst) {
+    size_t size = _place_model_nef_descriptor_in_arena(NULL, src, NULL);
+    // zeroed, so alignment gaps are deterministic when the arena is written to the cache
+    _model_desc_arena_header_t *arena = (_model_desc_arena_header_t *)calloc(1, size);
+
+    if (NULL == arena) {
+        err_print("pack model descriptor fail: malloc %u bytes fail ...\n", (uint32_t)size);
+        return KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+    }
+
+    arena->magic = MODEL_DESC_ARENA_MAGIC;
+    arena->ref_count = 1;
+    arena->size = (uint32_t)size;
+    arena->reserved = 0;
+
+    _place_model_nef_descriptor_in_arena((uint8_t *)arena, src, dst);
+    _register_model_desc_arena(arena);
+
+    return KP_SUCCESS;
 }
 
-int deconstruct_model_des_nef_metadata(kp_model_nef_metadata_t* metadata) {
-    int ret = KP_SUCCESS;
+/**
+ * An arena image is a copy of the arena with every pointer turned into its offset from the arena base,
+ * so that it can be stored and placed at any address again. Offsets are checked to be inside the image.
+ */
 
-    if (NULL == metadata) {
-        return ret;
+// return ptr moved from base address 'from' to base address 'to', its data is at *local in the image
+static void* _rebase_in_arena(uint8_t *image, size_t size, uintptr_t from, uintptr_t to, void *ptr, size_t bytes, void **local, bool *valid) {
+    uintptr_t offset = (uintptr_t)ptr - from;
+
+    if (NULL != local)
+        *local = NULL;
+
+    if (NULL == ptr)
+        return NULL;
+
+    if (offset < sizeof(_model_desc_arena_header_t) || offset > size || bytes > size - offset ||
+        0 != (offset & (MODEL_DESC_ARENA_ALIGNMENT - 1))) {
+        *valid = false;
+        return NULL;
     }
 
-    metadata->toolchain_version =           realloc_zero(metadata->toolchain_version, 0);
-    metadata->compiler_version =            realloc_zero(metadata->compiler_version, 0);
-    metadata->platform =                    realloc_zero(metadata->platform, 0);
-    metadata->kn_num =                      0;
+    if (NULL != local)
+        *local = image + offset;
 
-    if (NULL != metadata->toolchain_version ||
-        NULL != metadata->compiler_version ||
-        NULL != metadata->platform) {
-        err_print("deconstruct nef metadata attributes in model_descriptor fail ...\n");
-        ret = KP_ERROR_MEMORY_FREE_FAILURE_39;
-        goto FUNC_OUT;
+    return (void *)(to + offset);
+}
+
+static void* _rebase_list_in_arena(uint8_t *image, size_t size, uintptr_t from, uintptr_t to, void *ptr, uint32_t num, size_t element_size, void **local, bool *valid) {
+    if (num > size / element_size) {
+        *valid = false;
+        return NULL;
     }
 
-    memset(metadata, 0, sizeof(kp_model_nef_metadata_t));
+    return _rebase_in_arena(image, size, from, to, ptr, num * element_size, local, valid);
+}
 
-FUNC_OUT:
-    return ret;
+static char* _rebase_string_in_arena(uint8_t *image, size_t size, uintptr_t from, uintptr_t to, char *ptr, bool *valid) {
+    char *str = NULL;
+    char *rebased = (char *)_rebase_in_arena(image, size, from, to, ptr, 1, (void **)&str, valid);
+
+    if (NULL != str && NULL == memchr(str, '\0', (size_t)(image + size - (uint8_t *)str))) {
+        *valid = false;
+        return NULL;
+    }
+
+    return rebased;
 }
 
-int deconstruct_model_des_nef_info(kp_model_nef_descriptor_t* model_desc) {
-    int ret = KP_SUCCESS;
+static kp_tensor_descriptor_t* _rebase_tensor_list_in_arena(uint8_t *image, size_t size, uintptr_t from, uintptr_t to, kp_tensor_descriptor_t *ptr, uint32_t num, bool *valid) {
+    kp_tensor_descriptor_t *tensors = NULL;
+    kp_tensor_descriptor_t *rebased = (kp_tensor_descriptor_t *)_rebase_list_in_arena(image, size, from, to, ptr, num, sizeof(kp_tensor_descriptor_t), (void **)&tensors, valid);
 
-    if (NULL == model_desc) {
-        goto FUNC_OUT;
+    for (uint32_t i = 0; *valid && NULL != tensors && i < num; i++) {
+        kp_quantization_parameters_t *quantization_parameters = &(tensors[i].quantization_parameters);
+
+        tensors[i].name = _rebase_string_in_arena(image, size, from, to, tensors[i].name, valid);
+        tensors[i].shape_npu = (uint32_t *)_rebase_list_in_arena(image, size, from, to, tensors[i].shape_npu, tensors[i].shape_npu_len, sizeof(uint32_t), NULL, valid);
+        tensors[i].shape_onnx = (uint32_t *)_rebase_list_in_arena(image, size, from, to, tensors[i].shape_onnx, tensors[i].shape_onnx_len, sizeof(uint32_t), NULL, valid);
+        quantization_parameters->quantized_fixed_point_descriptor = (kp_quantized_fixed_point_descriptor_t *)_rebase_list_in_arena(image, size, from, to, quantization_parameters->quantized_fixed_point_descriptor,
+                                                                                                                                    quantization_parameters->quantized_fixed_point_descriptor_num, sizeof(kp_quantized_fixed_point_descriptor_t), NULL, valid);
     }
 
-    kp_single_model_descriptor_t *single_model_descriptor = NULL;
-    for (int i = 0; i < model_desc->num_models; i++) {
-        single_model_descriptor = &(model_desc->models[i]);
-        ret = deconstruct_single_model_descriptor(single_model_descriptor);
+    return rebased;
+}
+
+// move the pointers of model_desc and of the arena at image from base address 'from' to base address 'to'
+static bool _rebase_model_nef_descriptor(kp_model_nef_descriptor_t* model_desc, uint8_t *image, size_t size, uintptr_t from, uintptr_t to) {
+    bool valid = true;
+    kp_single_model_descriptor_t *models = NULL;
 
-        if (KP_SUCCESS != ret) {
-            err_print("deconstruct single model descriptor in model_descriptor fail ...\n");
-            goto FUNC_OUT;
-        }
+    // the model list must come first, the arena is found from it
+    if ((uintptr_t)model_desc->models - from != sizeof(_model_desc_arena_header_t))
+        return false;
+
+    model_desc->models = (kp_single_model_descriptor_t *)_rebase_list_in_arena(image, size, from, to, model_desc->models, model_desc->num_models,
+                                                                               sizeof(kp_single_model_descriptor_t), (void **)&models, &valid);
+
+    for (uint32_t i = 0; valid && NULL != models && i < model_desc->num_models; i++) {
+        models[i].input_nodes = _rebase_tensor_list_in_arena(image, size, from, to, models[i].input_nodes, models[i].input_nodes_num, &valid);
+        models[i].output_nodes = _rebase_tensor_list_in_arena(image, size, from, to, models[i].output_nodes, models[i].output_nodes_num, &valid);
     }
 
-    model_desc->models =        realloc_zero(model_desc->models, 0);
-    model_desc->num_models =    0;
-    model_desc->crc =           0;
-    model_desc->target =        0;
+    model_desc->metadata.toolchain_version = _rebase_string_in_arena(image, size, from, to, model_desc->metadata.toolchain_version, &valid);
+    model_desc->metadata.compiler_version = _rebase_string_in_arena(image, size, from, to, model_desc->metadata.compiler_version, &valid);
+    model_desc->metadata.platform = _rebase_string_in_arena(image, size, from, to, model_desc->metadata.platform, &valid);
 
-    if (NULL != model_desc->models) {
-        err_print("deconstruct nef info attributes in model_descriptor fail ...\n");
-        ret = KP_ERROR_MEMORY_FREE_FAILURE_39;
-        goto FUNC_OUT;
+    return valid;
+}
+
+int export_model_nef_descriptor_image(kp_model_nef_descriptor_t* model_desc, kp_model_nef_descriptor_t* image_desc, void **image, uint32_t *image_size) {
+    if (NULL == model_desc || NULL == image_desc || NULL == image || NULL == image_size)
+        return KP_ERROR_INVALID_PARAM_12;
+
+    _model_desc_arena_header_t *arena = _get_model_desc_arena(model_desc);
+
+    if (NULL == arena)
+        return KP_ERROR_INVALID_PARAM_12;
+
+    _model_desc_arena_header_t *copy = (_model_desc_arena_header_t *)malloc(arena->size);
+
+    if (NULL == copy)
+        return KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+
+    memcpy(copy, arena, arena->size);
+    memcpy(image_desc, model_desc, sizeof(kp_model_nef_descriptor_t));
+
+    copy->ref_count = 0;
+
+    if (false == _rebase_model_nef_descriptor(image_desc, (uint8_t *)copy, copy->size, (uintptr_t)arena, 0)) {
+        free(copy);
+        return KP_ERROR_INVALID_PARAM_12;
     }
 
-FUNC_OUT:
-    return ret;
+    *image = copy;
+    *image_size = copy->size;
+
+    return KP_SUCCESS;
 }
 
-int deconstruct_model_nef_descriptor(kp_model_nef_descriptor_t* loaded_model_desc) {
-    int ret = KP_SUCCESS;
+// on success the image (allocated by malloc) becomes the arena of model_desc, otherwise it is left to the caller
+int import_model_nef_descriptor_image(kp_model_nef_descriptor_t* image_desc, void *image, uint32_t image_size, kp_model_nef_descriptor_t* model_desc) {
+    if (NULL == image_desc || NULL == image || NULL == model_desc)
+        return KP_ERROR_INVALID_PARAM_12;
 
-    if (NULL == loaded_model_desc) {
-        ret = KP_ERROR_INVALID_PARAM_12;
-        goto FUNC_OUT;
+    _model_desc_arena_header_t *arena = (_model_desc_arena_header_t *)image;
+    kp_model_nef_descriptor_t desc;
+
+    memcpy(&desc, image_desc, sizeof(kp_model_nef_descriptor_t));
+
+    if (image_size < sizeof(_model_desc_arena_header_t) || MODEL_DESC_ARENA_MAGIC != arena->magic || image_size != arena->size ||
+        0x5AA55AA5 != desc.magic || false == _rebase_model_nef_descriptor(&desc, (uint8_t *)image, image_size, 0, (uintptr_t)image)) {
+        return KP_ERROR_INVALID_MODEL_21;
     }
 
-    if (0x5AA55AA5 != loaded_model_desc->magic)
-        goto FUNC_OUT;
+    deconstruct_model_nef_descriptor(model_desc);
 
-    ret = deconstruct_model_des_nef_metadata(&(loaded_model_desc->metadata));
+    arena->ref_count = 1;
+    memcpy(model_desc, &desc, sizeof(kp_model_nef_descriptor_t));
+    _register_model_desc_arena(arena);
 
-    if (KP_SUCCESS != ret) {
-        err_print("deconstruct nef metadata in model_descriptor fail ...\n");
-        goto FUNC_OUT;
+    return KP_SUCCESS;
+}
+
+int share_model_nef_descriptor(kp_model_nef_descriptor_t* src_model_desc, kp_model_nef_descriptor_t* dst_model_desc) {
+    if (NULL == src_model_desc ||
+        NULL == dst_model_desc) {
+        return KP_ERROR_INVALID_PARAM_12;
     }
 
-    ret = deconstruct_model_des_nef_info(loaded_model_desc);
+    if (src_model_desc == dst_model_desc)
+        return KP_SUCCESS;
 
-    if (KP_SUCCESS != ret) {
-        err_print("deconstruct nef info in model_descriptor fail ...\n");
-        goto FUNC_OUT;
+    int ret = deconstruct_model_nef_descriptor(dst_model_desc);
+    _model_desc_arena_header_t *arena = _get_model_desc_arena(src_model_desc);
+
+    if (NULL != arena) {
+        __atomic_add_fetch(&arena->ref_count, 1, __ATOMIC_RELAXED);
+        memcpy(dst_model_desc, src_model_desc, sizeof(kp_model_nef_descriptor_t));
+    }
+
+    return ret;
+}
+
+int deconstruct_model_nef_descriptor(kp_model_nef_descriptor_t* loaded_model_desc) {
+    if (NULL == loaded_model_desc)
+        return KP_ERROR_INVALID_PARAM_12;
+
+    _model_desc_arena_header_t *arena = _get_model_desc_arena(loaded_model_desc);
+
+    if (NULL != arena && 0 == __atomic_sub_fetch(&arena->ref_count, 1, __ATOMIC_ACQ_REL)) {
+        _unregister_model_desc_arena(arena);
+        free(arena);
     }
 
-FUNC_OUT:
     memset(loaded_model_desc, 0, sizeof(kp_model_nef_descriptor_t));
 
-    return ret;
+    return KP_SUCCESS;
 }
 
 /******************************************************************
@@ -308,20 +532,20 @@ _single_model_setup_memory_info_t* realloc_model_setup_memory_info_list(_single_
     return (_single_model_setup_memory_info_t*)realloc_zero(model_setup_memory_info_list, element_num * sizeof(_single_model_setup_memory_info_t));
 }
 
-kp_single_model_descriptor_t* realloc_model_descriptor_list(kp_single_model_descriptor_t *model_descriptor_list, uint32_t element_num) {
-    return (kp_single_model_descriptor_t*)realloc_zero(model_descriptor_list, element_num * sizeof(kp_single_model_descriptor_t));
+kp_single_model_descriptor_t* alloc_model_descriptor_list(scratch_arena_t *scratch, uint32_t element_num) {
+    return (kp_single_model_descriptor_t*)scratch_alloc(scratch, element_num * sizeof(kp_single_model_descriptor_t));
 }
 
-uint32_t* realloc_tensor_shape(uint32_t *shape, uint32_t element_num) {
-    return (uint32_t *)realloc_zero(shape, element_num * sizeof(uint32_t));
+uint32_t* alloc_tensor_shape(scratch_arena_t *scratch, uint32_t element_num) {
+    return (uint32_t *)scratch_alloc(scratch, element_num * sizeof(uint32_t));
 }
 
-kp_tensor_descriptor_t* realloc_tensor_list(kp_tensor_descriptor_t *tensor_list, uint32_t element_num) {
-    return (kp_tensor_descriptor_t*)realloc_zero(tensor_list, element_num * sizeof(kp_tensor_descriptor_t));
+kp_tensor_descriptor_t* alloc_tensor_list(scratch_arena_t *scratch, uint32_t element_num) {
+    return (kp_tensor_descriptor_t*)scratch_alloc(scratch, element_num * sizeof(kp_tensor_descriptor_t));
 }
 
-kp_quantized_fixed_point_descriptor_t* realloc_quantized_fixed_point_descriptor_list(kp_quantized_fixed_point_descriptor_t *quantized_fixed_point_descriptor_list, uint32_t element_num) {
-    return (kp_quantized_fixed_point_descriptor_t*)realloc_zero(quantized_fixed_point_descriptor_list, element_num * sizeof(kp_quantized_fixed_point_descriptor_t));
+kp_quantized_fixed_point_descriptor_t* alloc_quantized_fixed_point_descriptor_list(scratch_arena_t *scratch, uint32_t element_num) {
+    return (kp_quantized_fixed_point_descriptor_t*)scratch_alloc(scratch, element_num * sizeof(kp_quantized_fixed_point_descriptor_t));
 }
 
 int initialize_model_des_nef_magic(kp_model_nef_descriptor_t* loaded_model_nef_descriptor) {
@@ -339,7 +563,7 @@ int initialize_model_des_nef_magic(kp_model_nef_descriptor_t* loaded_model_nef_d
     return KP_SUCCESS;
 }
 
-int construct_model_des_nef_metadata(kp_metadata_t *metadata, kp_model_nef_descriptor_t* loaded_model_nef_descriptor) {
+int construct_model_des_nef_metadata(kp_metadata_t *metadata, scratch_arena_t *scratch, kp_model_nef_descriptor_t* loaded_model_nef_descriptor) {
     if (NULL == metadata ||
         NULL == loaded_model_nef_descriptor) {
         err_print("construct nef metadata in model_descriptor fail: NULL pointer input parameters ...\n");
@@ -349,9 +573,9 @@ int construct_model_des_nef_metadata(kp_metadata_t *metadata, kp_model_nef_descr
     kp_model_nef_metadata_t *loaded_model_nef_metadata = &(loaded_model_nef_descriptor->metadata);
 
     loaded_model_nef_metadata->kn_num =                         metadata->kn_num;
-    loaded_model_nef_metadata->compiler_version =               strcpy_dst_realloc(loaded_model_nef_metadata->compiler_version,     metadata->compiler_ver);
-    loaded_model_nef_metadata->toolchain_version =              strcpy_dst_realloc(loaded_model_nef_metadata->toolchain_version,    metadata->tc_ver);
-    loaded_model_nef_metadata->platform =                       strcpy_dst_realloc(loaded_model_nef_metadata->platform,             metadata->platform);
+    loaded_model_nef_metadata->compiler_version =               scratch_strdup(scratch,     metadata->compiler_ver);
+    loaded_model_nef_metadata->toolchain_version =              scratch_strdup(scratch,     metadata->tc_ver);
+    loaded_model_nef_metadata->platform =                       scratch_strdup(scratch,     metadata->platform);
     loaded_model_nef_metadata->nef_schema_version.major =       metadata->nef_schema_version.major;
     loaded_model_nef_metadata->nef_schema_version.minor =       metadata->nef_schema_version.minor;
     loaded_model_nef_metadata->nef_schema_version.revision =    metadata->nef_schema_version.revision;
@@ -456,7 +680,7 @@ int _parse_setup_memory_info(_model_firmware_info_list_t *model_firmware_info_li
     return KP_SUCCESS;
 }
 
-int construct_model_des_nef_info(kp_nef_info_t *nef_info, bool from_device, kp_model_nef_descriptor_t* loaded_model_desc) {
+int construct_model_des_nef_info(kp_nef_info_t *nef_info, bool from_device, scratch_arena_t *scratch, kp_model_nef_descriptor_t* loaded_model_desc) {
     if (NULL == nef_info ||
         NULL == loaded_model_desc) {
         err_print("construct nef firmware info in model_descriptor fail: NULL pointer input parameters ...\n");
@@ -487,9 +711,9 @@ int construct_model_des_nef_info(kp_nef_info_t *nef_info, bool from_device, kp_m
         goto FUNC_OUT;
     }
 
-    // realloc model descriptor list
+    // alloc model descriptor list
     loaded_model_desc->num_models = model_firmware_info_list.model_num;
-    loaded_model_desc->models = realloc_model_descriptor_list(loaded_model_desc->models, loaded_model_desc->num_models);
+    loaded_model_desc->models = alloc_model_descriptor_list(scratch, loaded_model_desc->num_models);
 
     if (0 < loaded_model_desc->num_models &&
         NULL == loaded_model_desc->models) {
@@ -539,7 +763,7 @@ int construct_model_des_nef_info(kp_nef_info_t *nef_info, bool from_device, kp_m
             setup_buff_size = single_model_setup_memory_info->setup_mem_len;
             setup_buff = all_model_buff + setup_buff_instance_offset;
 
-            status = construct_single_setup_info(setup_buff, setup_buff_size, single_model_descriptor);
+            status = construct_single_setup_info(setup_buff, setup_buff_size, scratch, single_model_descriptor);
 
             if (KP_SUCCESS != status)
                 goto FUNC_OUT;
@@ -570,6 +794,49 @@ FUNC_OUT:
     return status;
 }
 
+int get_model_setup_location_list(kp_nef_info_t *nef_info, kp_model_setup_location_t **location_list, uint32_t *model_num) {
+    if (NULL == nef_info ||
+        NULL == location_list ||
+        NULL == model_num) {
+        err_print("get model setup location list fail: NULL pointer input parameters ...\n");
+        return KP_ERROR_INVALID_PARAM_12;
+    }
+
+    _model_firmware_info_list_t model_firmware_info_list = {0};
+    int status = _parse_firmware_info(nef_info, &model_firmware_info_list);
+
+    if (KP_SUCCESS != status)
+        return status;
+
+    *model_num = model_firmware_info_list.model_num;
+    *location_list = (kp_model_setup_location_t *)realloc_zero(NULL, *model_num * sizeof(kp_model_setup_location_t));
+
+    if (0 < *model_num &&
+        NULL == *location_list) {
+        err_print("get model setup location list fail: malloc location list fail ...\n");
+        return KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+    }
+
+    uint32_t all_model_base = (0 < *model_num) ? model_firmware_info_list.model_firmware_info[0].cmd_mem_addr : 0;
+
+    for (int i = 0; i < *model_num; i++) {
+        _single_model_firmware_info_t *single_model_firmware_info = &(model_firmware_info_list.model_firmware_info[i]);
+
+        (*location_list)[i].model_id =      single_model_firmware_info->model_type;
+        (*location_list)[i].setup_offset =  single_model_firmware_info->setup_mem_addr - all_model_base;
+        (*location_list)[i].setup_size =    single_model_firmware_info->setup_mem_len;
+
+        if ((*location_list)[i].setup_offset + (*location_list)[i].setup_size > nef_info->all_models_size) {
+            err_print("get model setup location list fail: invalid setup location of model %u ...\n", (*location_list)[i].model_id);
+            *location_list = realloc_zero(*location_list, 0);
+            *model_num = 0;
+            return KP_ERROR_INVALID_MODEL_21;
+        }
+    }
+
+    return KP_SUCCESS;
+}
+
 /******************************************************************
  * nef info print
  ******************************************************************/
@@ -696,56 +963,50 @@ int _check_model_platform(kp_product_id_t target_pid, kp_model_target_chip_t mod
     return ret;
 }
 
-int build_model_nef_descriptor_from_nef(kp_metadata_t *metadata, kp_nef_info_t *nef_info, kp_model_nef_descriptor_t* loaded_model_desc) {
-    if ((NULL == metadata) || (NULL == nef_info))
-    {
-        dbg_print("invalid parameters, null pointer ...\n");
-        return KP_ERROR_INVALID_PARAM_12;
-    }
-
-    // parse nef header/fw_info.bin/setup.bin from nef file
-    if (0 >= nef_info->fw_info_size)
-    {
-        dbg_print("invalid model format, fw_info size %d ...\n", nef_info->fw_info_size);
-        return KP_ERROR_INVALID_MODEL_21;
-    }
-
+// descriptor is built in scratch memory, then packed into its own arena
+static int _build_model_nef_descriptor(kp_metadata_t *metadata, kp_nef_info_t *nef_info, bool from_device, kp_model_nef_descriptor_t* loaded_model_desc) {
     int ret = KP_SUCCESS;
-    bool from_device = false;
+    scratch_arena_t scratch = {0};
+    kp_model_nef_descriptor_t scratch_model_desc = {0};
 
     ret = deconstruct_model_nef_descriptor(loaded_model_desc);
     if (KP_SUCCESS != ret)
     {
-        err_print("construct model nef descriptor failed: %d...\n", ret);
+        err_print("deconstruct model nef descriptor failed: %d...\n", ret);
         return ret;
     }
 
-    ret = initialize_model_des_nef_magic(loaded_model_desc);
+    ret = initialize_model_des_nef_magic(&scratch_model_desc);
     if (KP_SUCCESS != ret)
     {
         err_print("initialize magic number of model nef descriptor failed: %d...\n", ret);
-        return ret;
+        goto FUNC_OUT;
     }
 
-    ret = construct_model_des_nef_metadata(metadata, loaded_model_desc);
+    ret = construct_model_des_nef_metadata(metadata, &scratch, &scratch_model_desc);
     if (KP_SUCCESS != ret)
     {
         err_print("construct model nef matadata failed: %d...\n", ret);
-        return ret;
+        goto FUNC_OUT;
     }
 
-    ret = construct_model_des_nef_info(nef_info, from_device, loaded_model_desc);
+    ret = construct_model_des_nef_info(nef_info, from_device, &scratch, &scratch_model_desc);
     if (KP_SUCCESS != ret)
     {
         err_print("construct model nef information failed: %d...\n", ret);
-        return ret;
+        goto FUNC_OUT;
     }
 
+    ret = _pack_model_nef_descriptor(&scratch_model_desc, loaded_model_desc);
+
+FUNC_OUT:
+    scratch_release(&scratch);
+
     return ret;
 }
 
-int build_model_nef_descriptor_from_device(kp_nef_info_t *nef_info, kp_model_nef_descriptor_t* loaded_model_desc) {
-    if (NULL == nef_info)
+int build_model_nef_descriptor_from_nef(kp_metadata_t *metadata, kp_nef_info_t *nef_info, kp_model_nef_descriptor_t* loaded_model_desc) {
+    if ((NULL == metadata) || (NULL == nef_info))
     {
         dbg_print("invalid parameters, null pointer ...\n");
         return KP_ERROR_INVALID_PARAM_12;
@@ -758,47 +1019,37 @@ int build_model_nef_descriptor_from_device(kp_nef_info_t *nef_info, kp_model_nef
         return KP_ERROR_INVALID_MODEL_21;
     }
 
-    int ret = KP_SUCCESS;
-    bool from_device = true;
+    bool from_device = false;
 
-    // init empty metadata
-    kp_metadata_t metadata = {0};
-    metadata.compiler_ver = "";
-    metadata.platform = "";
-    metadata.tc_ver = "";
+    return _build_model_nef_descriptor(metadata, nef_info, from_device, loaded_model_desc);
+}
 
-    ret = deconstruct_model_nef_descriptor(loaded_model_desc);
-    if (KP_SUCCESS != ret)
+int build_model_nef_descriptor_from_device(kp_nef_info_t *nef_info, kp_model_nef_descriptor_t* loaded_model_desc) {
+    if (NULL == nef_info)
     {
-        err_print("deconstruct model nef descriptor failed: %d...\n", ret);
-        return ret;
+        dbg_print("invalid parameters, null pointer ...\n");
+        return KP_ERROR_INVALID_PARAM_12;
     }
 
-    ret = initialize_model_des_nef_magic(loaded_model_desc);
-    if (KP_SUCCESS != ret)
+    // parse nef header/fw_info.bin/setup.bin from nef file
+    if (0 >= nef_info->fw_info_size)
     {
-        err_print("initialize magic number of model nef descriptor failed: %d...\n", ret);
-        return ret;
+        dbg_print("invalid model format, fw_info size %d ...\n", nef_info->fw_info_size);
+        return KP_ERROR_INVALID_MODEL_21;
     }
 
-    ret = construct_model_des_nef_metadata(&metadata, loaded_model_desc);
-    if (KP_SUCCESS != ret)
-    {
-        err_print("construct model nef matadata failed: %d...\n", ret);
-        return ret;
-    }
+    bool from_device = true;
 
-    ret = construct_model_des_nef_info(nef_info, from_device, loaded_model_desc);
-    if (KP_SUCCESS != ret)
-    {
-        err_print("construct model nef information failed: %d...\n", ret);
-        return ret;
-    }
+    // init empty metadata
+    kp_metadata_t metadata = {0};
+    metadata.compiler_ver = "";
+    metadata.platform = "";
+    metadata.tc_ver = "";
 
-    return ret;
+    return _build_model_nef_descriptor(&metadata, nef_info, from_device, loaded_model_desc);
 }
 
-int load_model_info_from_nef(void *nef_buf, int nef_size, kp_product_id_t target_pid /* input */, kp_metadata_t *metadata, kp_nef_info_t *nef_info, kp_model_nef_descriptor_t *loaded_model_desc /* output */)
+static int _load_model_info_from_nef(void *nef_buf, int nef_size, bool check_crc, kp_product_id_t target_pid, kp_metadata_t *metadata, kp_nef_info_t *nef_info, kp_model_nef_descriptor_t *loaded_model_desc)
 {
     if ((NULL == metadata) || (NULL == nef_info))
     {
@@ -809,7 +1060,7 @@ int load_model_info_from_nef(void *nef_buf, int nef_size, kp_product_id_t target
     memset(metadata, 0, sizeof(kp_metadata_t));
     memset(nef_info, 0, sizeof(kp_nef_info_t));
 
-    int ret = read_nef(nef_buf, nef_size, metadata, nef_info);
+    int ret = check_crc ? read_nef(nef_buf, nef_size, metadata, nef_info) : parse_nef(nef_buf, nef_size, metadata, nef_info);
     if (ret != 0)
     {
         dbg_print("getting model data failed: %d...\n", ret);
@@ -820,8 +1071,28 @@ int load_model_info_from_nef(void *nef_buf, int nef_size, kp_product_id_t target
     if (KP_SUCCESS != ret)
         return ret;
 
-    if (NULL != loaded_model_desc)
-        return build_model_nef_descriptor_from_nef(metadata, nef_info, loaded_model_desc);
-    else
+    if (NULL == loaded_model_desc)
+        return KP_SUCCESS;
+
+    if (KP_SUCCESS == load_model_nef_descriptor_from_cache(nef_buf, nef_size, loaded_model_desc))
         return KP_SUCCESS;
+
+    ret = build_model_nef_descriptor_from_nef(metadata, nef_info, loaded_model_desc);
+
+    // an entry is only written for a NEF with a good CRC, the CRC names the entry
+    if (KP_SUCCESS == ret && is_model_desc_cache_enabled() && (check_crc || 0 == check_nef_crc((char *)nef_buf, nef_size)))
+        save_model_nef_descriptor_to_cache(nef_buf, nef_size, loaded_model_desc);
+
+    return ret;
+}
+
+int load_model_info_from_nef(void *nef_buf, int nef_size, kp_product_id_t target_pid /* input */, kp_metadata_t *metadata, kp_nef_info_t *nef_info, kp_model_nef_descriptor_t *loaded_model_desc /* output */)
+{
+    return _load_model_info_from_nef(nef_buf, nef_size, true, target_pid, metadata, nef_info, loaded_model_desc);
+}
+
+// the NEF CRC is left to the caller, see check_nef_crc()
+int load_model_info_from_nef_without_crc(void *nef_buf, int nef_size, kp_product_id_t target_pid /* input */, kp_metadata_t *metadata, kp_nef_info_t *nef_info, kp_model_nef_descriptor_t *loaded_model_desc /* output */)
+{
+    return _load_model_info_from_nef(nef_buf, nef_size, false, target_pid, metadata, nef_info, loaded_model_desc);
 }
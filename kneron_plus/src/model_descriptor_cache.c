@@ -0,0 +1,229 @@
+/**
+ * @file        model_descriptor_cache.c
+ * @brief       NEF model related functions - keep built model descriptors in an on-disk cache
+ * @version     0.1
+ * @date        2026-10-18
+ *
+ * @copyright   Copyright (c) 2021 Kneron Inc. All rights reserved.
+ */
+
+/**
+ * [Description]
+ *  Model descriptor cache keeps the arena image of a built kp_model_nef_descriptor_t in a cache directory,
+ *  so that a NEF loaded again (by this or another process) is not parsed again.
+ *
+ *  An entry is named by the CRC and size of the NEF, and is only used if it is written by the same PLUS version
+ *  and the same descriptor layout. Entries are written to a temporary file and renamed, a broken entry is a miss.
+ *
+ * [Architecture Hierarchical]
+ *  model_descriptor_cache
+ *      |- model_descriptor_builder
+ */
+
+// #define DEBUG_PRINT
+
+#include "internal_func.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "kp_core.h"
+
+#ifdef DEBUG_PRINT
+#define dbg_print(format, ...) { printf(format, ##__VA_ARGS__); fflush(stdout); }
+#else
+#define dbg_print(format, ...)
+#endif
+
+#define MODEL_DESC_CACHE_MAGIC          0x4350444B  /* "KDPC" */
+#define MODEL_DESC_CACHE_FORMAT_VERSION 3  /* 3: float factors follow the quantization parameters in the arena */
+#define MODEL_DESC_CACHE_MAX_PATH       1024
+
+/**
+ * cache file: this header, then the arena image of the descriptor
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t format_version;
+    char sdk_version[16];                   /**< kp_get_version() of the writer */
+    uint32_t header_size;                   /**< changes with the descriptor layout and pointer size */
+    uint32_t nef_crc;                       /**< CRC stored at the end of the NEF */
+    uint32_t nef_size;
+    uint32_t image_size;
+    uint32_t image_crc;                     /**< CRC of the arena image */
+    uint32_t desc_crc;                      /**< CRC of model_desc */
+    kp_model_nef_descriptor_t model_desc;   /**< pointers are offsets in the arena image */
+} _model_desc_cache_header_t;
+
+static pthread_mutex_t _cache_dir_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char _cache_dir[MODEL_DESC_CACHE_MAX_PATH] = {0};
+
+// the cache file of a NEF, false if the cache is disabled
+static bool _get_cache_file_path(void *nef_buf, int nef_size, char *path, size_t path_size, uint32_t *nef_crc) {
+    bool enabled = false;
+
+    if (NULL == nef_buf || nef_size <= (int)sizeof(uint32_t))
+        return false;
+
+    memcpy(nef_crc, (char *)nef_buf + nef_size - sizeof(uint32_t), sizeof(uint32_t));
+
+    pthread_mutex_lock(&_cache_dir_mutex);
+
+    if ('\0' != _cache_dir[0]) {
+        int len = snprintf(path, path_size, "%s/nef_%08x_%08x.kpdesc", _cache_dir, *nef_crc, (uint32_t)nef_size);
+        enabled = (0 < len && (size_t)len < path_size);
+    }
+
+    pthread_mutex_unlock(&_cache_dir_mutex);
+
+    return enabled;
+}
+
+static void _init_cache_header(_model_desc_cache_header_t *header, uint32_t nef_crc, int nef_size) {
+    memset(header, 0, sizeof(_model_desc_cache_header_t));
+
+    header->magic = MODEL_DESC_CACHE_MAGIC;
+    header->format_version = MODEL_DESC_CACHE_FORMAT_VERSION;
+    snprintf(header->sdk_version, sizeof(header->sdk_version), "%s", kp_get_version());
+    header->header_size = sizeof(_model_desc_cache_header_t);
+    header->nef_crc = nef_crc;
+    header->nef_size = (uint32_t)nef_size;
+}
+
+bool is_model_desc_cache_enabled() {
+    pthread_mutex_lock(&_cache_dir_mutex);
+    bool enabled = ('\0' != _cache_dir[0]);
+    pthread_mutex_unlock(&_cache_dir_mutex);
+
+    return enabled;
+}
+
+int load_model_nef_descriptor_from_cache(void *nef_buf, int nef_size, kp_model_nef_descriptor_t *model_desc) {
+    char path[MODEL_DESC_CACHE_MAX_PATH];
+    uint32_t nef_crc = 0;
+    _model_desc_cache_header_t expected;
+    _model_desc_cache_header_t header;
+    void *image = NULL;
+    int ret = KP_ERROR_FILE_OPEN_FAILED_20;
+
+    if (NULL == model_desc || false == _get_cache_file_path(nef_buf, nef_size, path, sizeof(path), &nef_crc))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    FILE *file = fopen(path, "rb");
+
+    if (NULL == file)
+        return KP_ERROR_FILE_OPEN_FAILED_20;
+
+    _init_cache_header(&expected, nef_crc, nef_size);
+
+    if (1 != fread(&header, sizeof(_model_desc_cache_header_t), 1, file) ||
+        0 != memcmp(&header, &expected, offsetof(_model_desc_cache_header_t, image_size)) ||
+        header.desc_crc != crc_cal((uint8_t *)&header.model_desc, sizeof(kp_model_nef_descriptor_t))) {
+        dbg_print("[%s] %s is out of date or broken\n", __func__, path);
+        ret = KP_ERROR_INVALID_MODEL_21;
+        goto FUNC_OUT;
+    }
+
+    image = malloc(header.image_size);
+
+    if (NULL == image) {
+        ret = KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+        goto FUNC_OUT;
+    }
+
+    if (1 != fread(image, header.image_size, 1, file) ||
+        header.image_crc != crc_cal((uint8_t *)image, header.image_size)) {
+        dbg_print("[%s] %s is broken\n", __func__, path);
+        ret = KP_ERROR_INVALID_MODEL_21;
+        goto FUNC_OUT;
+    }
+
+    ret = import_model_nef_descriptor_image(&header.model_desc, image, header.image_size, model_desc);
+
+    if (KP_SUCCESS == ret)
+        image = NULL;
+
+FUNC_OUT:
+    fclose(file);
+    free(image);
+
+    dbg_print("[%s] %s: %d\n", __func__, path, ret);
+
+    return ret;
+}
+
+// the NEF CRC must have been checked, the entry is found by it
+int save_model_nef_descriptor_to_cache(void *nef_buf, int nef_size, kp_model_nef_descriptor_t *model_desc) {
+    char path[MODEL_DESC_CACHE_MAX_PATH];
+    char tmp_path[MODEL_DESC_CACHE_MAX_PATH + 32];
+    uint32_t nef_crc = 0;
+    _model_desc_cache_header_t header;
+    void *image = NULL;
+    uint32_t image_size = 0;
+
+    if (NULL == model_desc || false == _get_cache_file_path(nef_buf, nef_size, path, sizeof(path), &nef_crc))
+        return KP_ERROR_INVALID_PARAM_12;
+
+    _init_cache_header(&header, nef_crc, nef_size);
+
+    int ret = export_model_nef_descriptor_image(model_desc, &header.model_desc, &image, &image_size);
+
+    if (KP_SUCCESS != ret)
+        return ret;
+
+    header.image_size = image_size;
+    header.image_crc = crc_cal((uint8_t *)image, image_size);
+    header.desc_crc = crc_cal((uint8_t *)&header.model_desc, sizeof(kp_model_nef_descriptor_t));
+
+    // processes loading the same NEF write their own file, the last rename wins
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, (int)getpid());
+
+    FILE *file = fopen(tmp_path, "wb");
+
+    if (NULL == file) {
+        free(image);
+        return KP_ERROR_FILE_OPEN_FAILED_20;
+    }
+
+    bool written = (1 == fwrite(&header, sizeof(_model_desc_cache_header_t), 1, file)) &&
+                   (1 == fwrite(image, image_size, 1, file));
+
+    written = (0 == fclose(file)) && written;
+
+#ifdef _WIN32
+    if (written)
+        remove(path);
+#endif
+
+    if (false == written || 0 != rename(tmp_path, path)) {
+        remove(tmp_path);
+        ret = KP_ERROR_FILE_OPEN_FAILED_20;
+    }
+
+    free(image);
+
+    dbg_print("[%s] %s: %d\n", __func__, path, ret);
+
+    return ret;
+}
+
+int kp_set_model_descriptor_cache_dir(const char *cache_dir) {
+    struct stat dir_stat;
+
+    if (NULL != cache_dir && '\0' != cache_dir[0]) {
+        if (MODEL_DESC_CACHE_MAX_PATH - 32 <= strlen(cache_dir) ||
+            0 != stat(cache_dir, &dir_stat) || !S_ISDIR(dir_stat.st_mode)) {
+            return KP_ERROR_INVALID_PARAM_12;
+        }
+    }
+
+    pthread_mutex_lock(&_cache_dir_mutex);
+    snprintf(_cache_dir, sizeof(_cache_dir), "%s", (NULL != cache_dir) ? cache_dir : "");
+    pthread_mutex_unlock(&_cache_dir_mutex);
+
+    return KP_SUCCESS;
+}
@@ -344,7 +344,7 @@ uint32_t convert_data_format_to_kp_tensor_format(uint32_t data_format, uint32_t
     return KP_MODEL_TENSOR_DATA_LAYOUT_UNKNOWN;
 }
 
-int construct_single_setup_info_legacy(uintptr_t setup_buff, size_t setup_buff_size, kp_single_model_descriptor_t *single_model_descriptor) {
+int construct_single_setup_info_legacy(uintptr_t setup_buff, size_t setup_buff_size, scratch_arena_t *scratch, kp_single_model_descriptor_t *single_model_descriptor) {
     if (NULL == (void *)setup_buff ||
         0 == setup_buff_size ||
         NULL == single_model_descriptor) {
@@ -374,8 +374,8 @@ int construct_single_setup_info_legacy(uintptr_t setup_buff, size_t setup_buff_s
         goto FUNC_OUT;
     }
 
-    single_model_descriptor->input_nodes = realloc_tensor_list(single_model_descriptor->input_nodes, single_model_descriptor->input_nodes_num);
-    single_model_descriptor->output_nodes = realloc_tensor_list(single_model_descriptor->output_nodes, single_model_descriptor->output_nodes_num);
+    single_model_descriptor->input_nodes = alloc_tensor_list(scratch, single_model_descriptor->input_nodes_num);
+    single_model_descriptor->output_nodes = alloc_tensor_list(scratch, single_model_descriptor->output_nodes_num);
 
     if ((0 < single_model_descriptor->input_nodes_num &&
         NULL == single_model_descriptor->input_nodes) ||
@@ -396,17 +396,17 @@ int construct_single_setup_info_legacy(uintptr_t setup_buff, size_t setup_buff_s
 
         tensor_info = &(single_model_descriptor->input_nodes[0]);
         tensor_info->index = 0;
-        tensor_info->name = strcpy_dst_realloc(tensor_info->name, "");
+        tensor_info->name = scratch_strdup(scratch, "");
         tensor_info->data_layout = convert_data_format_to_kp_tensor_format(DATA_FMT_KL520_4W4C8B, KP_MODEL_TARGET_CHIP_KL520);
 
         tensor_info->shape_npu_len = 4;
-        tensor_info->shape_npu = realloc_tensor_shape(tensor_info->shape_npu, tensor_info->shape_npu_len);
+        tensor_info->shape_npu = alloc_tensor_shape(scratch, tensor_info->shape_npu_len);
         tensor_info->shape_onnx_len = 0;
-        tensor_info->shape_onnx = realloc_tensor_shape(tensor_info->shape_onnx, tensor_info->shape_onnx_len);
+        tensor_info->shape_onnx = alloc_tensor_shape(scratch, tensor_info->shape_onnx_len);
 
         quantization_parameters = &tensor_info->quantization_parameters;
         quantization_parameters->quantized_fixed_point_descriptor_num = 1;
-        quantization_parameters->quantized_fixed_point_descriptor = realloc_quantized_fixed_point_descriptor_list(quantization_parameters->quantized_fixed_point_descriptor, quantization_parameters->quantized_fixed_point_descriptor_num);
+        quantization_parameters->quantized_fixed_point_descriptor = alloc_quantized_fixed_point_descriptor_list(scratch, quantization_parameters->quantized_fixed_point_descriptor_num);
 
         status = is_tensor_info_reallocted(tensor_info);
 
@@ -464,17 +464,17 @@ int construct_single_setup_info_legacy(uintptr_t setup_buff, size_t setup_buff_s
 
             tensor_info = &(single_model_descriptor->output_nodes[out_node->output_index]);
             tensor_info->index = out_node->output_index;
-            tensor_info->name = strcpy_dst_realloc(tensor_info->name, "");
+            tensor_info->name = scratch_strdup(scratch, "");
             tensor_info->data_layout = convert_data_format_to_kp_tensor_format(out_node->data_format, single_model_descriptor->target);
 
             tensor_info->shape_npu_len = 4;
-            tensor_info->shape_npu = realloc_tensor_shape(tensor_info->shape_npu, tensor_info->shape_npu_len);
+            tensor_info->shape_npu = alloc_tensor_shape(scratch, tensor_info->shape_npu_len);
             tensor_info->shape_onnx_len = 0;
-            tensor_info->shape_onnx = realloc_tensor_shape(tensor_info->shape_onnx, tensor_info->shape_onnx_len);
+            tensor_info->shape_onnx = alloc_tensor_shape(scratch, tensor_info->shape_onnx_len);
 
             quantization_parameters = &tensor_info->quantization_parameters;
             quantization_parameters->quantized_fixed_point_descriptor_num = 1;
-            quantization_parameters->quantized_fixed_point_descriptor = realloc_quantized_fixed_point_descriptor_list(quantization_parameters->quantized_fixed_point_descriptor, quantization_parameters->quantized_fixed_point_descriptor_num);
+            quantization_parameters->quantized_fixed_point_descriptor = alloc_quantized_fixed_point_descriptor_list(scratch, quantization_parameters->quantized_fixed_point_descriptor_num);
 
             status = is_tensor_info_reallocted(tensor_info);
 
@@ -503,17 +503,17 @@ int construct_single_setup_info_legacy(uintptr_t setup_buff, size_t setup_buff_s
 
                 tensor_info = &(single_model_descriptor->input_nodes[net_input_node->input_index]);
                 tensor_info->index = net_input_node->input_index;
-                tensor_info->name = strcpy_dst_realloc(tensor_info->name, "");
+                tensor_info->name = scratch_strdup(scratch, "");
                 tensor_info->data_layout = convert_data_format_to_kp_tensor_format(net_input_node->input_format, single_model_descriptor->target);
 
                 tensor_info->shape_npu_len = 4;
-                tensor_info->shape_npu = realloc_tensor_shape(tensor_info->shape_npu, tensor_info->shape_npu_len);
+                tensor_info->shape_npu = alloc_tensor_shape(scratch, tensor_info->shape_npu_len);
                 tensor_info->shape_onnx_len = 0;
-                tensor_info->shape_onnx = realloc_tensor_shape(tensor_info->shape_onnx, tensor_info->shape_onnx_len);
+                tensor_info->shape_onnx = alloc_tensor_shape(scratch, tensor_info->shape_onnx_len);
 
                 quantization_parameters = &tensor_info->quantization_parameters;
                 quantization_parameters->quantized_fixed_point_descriptor_num = 1;
-                quantization_parameters->quantized_fixed_point_descriptor = realloc_quantized_fixed_point_descriptor_list(quantization_parameters->quantized_fixed_point_descriptor, quantization_parameters->quantized_fixed_point_descriptor_num);
+                quantization_parameters->quantized_fixed_point_descriptor = alloc_quantized_fixed_point_descriptor_list(scratch, quantization_parameters->quantized_fixed_point_descriptor_num);
 
                 status = is_tensor_info_reallocted(tensor_info);
 
@@ -595,7 +595,7 @@ int construct_single_setup_info_header_flatbuffer(Kneron_INFContent_table_t root
     return KP_SUCCESS;
 }
 
-int construct_single_setup_info_quantization_parameters_flatbuffer(Kneron_QuantizationParameters_table_t quantization_parameters_flatbuffer, kp_quantization_parameters_t *quantization_parameters) {
+int construct_single_setup_info_quantization_parameters_flatbuffer(Kneron_QuantizationParameters_table_t quantization_parameters_flatbuffer, scratch_arena_t *scratch, kp_quantization_parameters_t *quantization_parameters) {
     if (NULL == quantization_parameters_flatbuffer ||
         NULL == quantization_parameters) {
         err_print("construct nef single model information quantization parameters in model_descriptor fail: NULL pointer input parameters ...\n");
@@ -605,7 +605,7 @@ int construct_single_setup_info_quantization_parameters_flatbuffer(Kneron_Quanti
     Kneron_FxpInfo_vec_t fxp_info_vec_flatbuffer = Kneron_QuantizationParameters_fxp_info(quantization_parameters_flatbuffer);
 
     quantization_parameters->quantized_fixed_point_descriptor_num = Kneron_FxpInfo_vec_len(fxp_info_vec_flatbuffer);
-    quantization_parameters->quantized_fixed_point_descriptor =     realloc_quantized_fixed_point_descriptor_list(quantization_parameters->quantized_fixed_point_descriptor, quantization_parameters->quantized_fixed_point_descriptor_num);
+    quantization_parameters->quantized_fixed_point_descriptor =     alloc_quantized_fixed_point_descriptor_list(scratch, quantization_parameters->quantized_fixed_point_descriptor_num);
 
     if (0 < quantization_parameters->quantized_fixed_point_descriptor_num &&
         NULL == quantization_parameters->quantized_fixed_point_descriptor) {
@@ -624,7 +624,7 @@ int construct_single_setup_info_quantization_parameters_flatbuffer(Kneron_Quanti
     return KP_SUCCESS;
 }
 
-int construct_single_setup_info_tensor_flatbuffer(Kneron_Tensor_table_t tensor, uint32_t target_chip, kp_tensor_descriptor_t *tensor_info) {
+int construct_single_setup_info_tensor_flatbuffer(Kneron_Tensor_table_t tensor, uint32_t target_chip, scratch_arena_t *scratch, kp_tensor_descriptor_t *tensor_info) {
     if (NULL == tensor ||
         NULL == tensor_info) {
         err_print("construct nef single model information tensor in model_descriptor fail: NULL pointer input parameters ...\n");
@@ -633,22 +633,22 @@ int construct_single_setup_info_tensor_flatbuffer(Kneron_Tensor_table_t tensor,
 
     int status = KP_SUCCESS;
 
-    tensor_info->name =                     strcpy_dst_realloc(tensor_info->name, (char*)Kneron_Tensor_name(tensor));
+    tensor_info->name =                     scratch_strdup(scratch, (char*)Kneron_Tensor_name(tensor));
     tensor_info->data_layout =              convert_data_format_to_kp_tensor_format(Kneron_Tensor_format(tensor), target_chip);
 
     flatbuffers_int32_vec_t shape_npu =     Kneron_Tensor_shape(tensor);
     tensor_info->shape_npu_len =            flatbuffers_int32_vec_len(shape_npu);
-    tensor_info->shape_npu =                realloc_tensor_shape(tensor_info->shape_npu, tensor_info->shape_npu_len);
+    tensor_info->shape_npu =                alloc_tensor_shape(scratch, tensor_info->shape_npu_len);
     memcpy(tensor_info->shape_npu, shape_npu, tensor_info->shape_npu_len * flatbuffers_int32__size());
 
     flatbuffers_int32_vec_t shape_onnx =    Kneron_Tensor_raw_shape(tensor);
     tensor_info->shape_onnx_len =           flatbuffers_int32_vec_len(shape_onnx);
-    tensor_info->shape_onnx =               realloc_tensor_shape(tensor_info->shape_onnx, tensor_info->shape_onnx_len);
+    tensor_info->shape_onnx =               alloc_tensor_shape(scratch, tensor_info->shape_onnx_len);
     memcpy(tensor_info->shape_onnx, shape_onnx, tensor_info->shape_onnx_len * flatbuffers_int32__size());
 
     kp_quantization_parameters_t *quantization_parameters = &(tensor_info->quantization_parameters);
     Kneron_QuantizationParameters_table_t quantization_parameters_flatbuffer = Kneron_Tensor_quantization(tensor);
-    status = construct_single_setup_info_quantization_parameters_flatbuffer(quantization_parameters_flatbuffer, quantization_parameters);
+    status = construct_single_setup_info_quantization_parameters_flatbuffer(quantization_parameters_flatbuffer, scratch, quantization_parameters);
 
     if (KP_SUCCESS != status)
         goto FUNC_OUT;
@@ -660,7 +660,7 @@ FUNC_OUT:
     return status;
 }
 
-int construct_single_setup_info_inputs_tensor_flatbuffer(Kneron_INFContent_table_t root, kp_single_model_descriptor_t *single_model_descriptor) {
+int construct_single_setup_info_inputs_tensor_flatbuffer(Kneron_INFContent_table_t root, scratch_arena_t *scratch, kp_single_model_descriptor_t *single_model_descriptor) {
     if (NULL == root ||
         NULL == single_model_descriptor) {
         err_print("construct nef single model information inputs tensor in model_descriptor fail: NULL pointer input parameters ...\n");
@@ -677,7 +677,7 @@ int construct_single_setup_info_inputs_tensor_flatbuffer(Kneron_INFContent_table
     }
 
     single_model_descriptor->input_nodes_num =  Kneron_Tensor_vec_len(tensor_vec);
-    single_model_descriptor->input_nodes =      realloc_tensor_list(single_model_descriptor->input_nodes, single_model_descriptor->input_nodes_num);
+    single_model_descriptor->input_nodes =      alloc_tensor_list(scratch, single_model_descriptor->input_nodes_num);
 
     if (0 < single_model_descriptor->input_nodes_num &&
         NULL == single_model_descriptor->input_nodes) {
@@ -693,7 +693,7 @@ int construct_single_setup_info_inputs_tensor_flatbuffer(Kneron_INFContent_table
         tensor_info = &(single_model_descriptor->input_nodes[i]);
 
         tensor_info->index = i;
-        status = construct_single_setup_info_tensor_flatbuffer(tensor, single_model_descriptor->target, tensor_info);
+        status = construct_single_setup_info_tensor_flatbuffer(tensor, single_model_descriptor->target, scratch, tensor_info);
 
         if (KP_SUCCESS != status) {
             err_print("construct nef single model information inputs tensor in model_descriptor fail: constuct tensor fail ...\n");
@@ -706,7 +706,7 @@ FUNC_OUT:
     return status;
 }
 
-int construct_single_setup_info_outputs_tensor_flatbuffer(Kneron_INFContent_table_t root, kp_single_model_descriptor_t *single_model_descriptor) {
+int construct_single_setup_info_outputs_tensor_flatbuffer(Kneron_INFContent_table_t root, scratch_arena_t *scratch, kp_single_model_descriptor_t *single_model_descriptor) {
     if (NULL == root ||
         NULL == single_model_descriptor) {
         err_print("construct nef single model information outputs tensor in model_descriptor fail: NULL pointer input parameters ...\n");
@@ -723,7 +723,7 @@ int construct_single_setup_info_outputs_tensor_flatbuffer(Kneron_INFContent_tabl
     }
 
     single_model_descriptor->output_nodes_num =  Kneron_Tensor_vec_len(tensor_vec);
-    single_model_descriptor->output_nodes =      realloc_tensor_list(single_model_descriptor->output_nodes, single_model_descriptor->output_nodes_num);
+    single_model_descriptor->output_nodes =      alloc_tensor_list(scratch, single_model_descriptor->output_nodes_num);
 
     if (0 < single_model_descriptor->output_nodes_num &&
         NULL == single_model_descriptor->output_nodes) {
@@ -738,7 +738,7 @@ int construct_single_setup_info_outputs_tensor_flatbuffer(Kneron_INFContent_tabl
         tensor_info = &(single_model_descriptor->output_nodes[i]);
 
         tensor_info->index = i;
-        status = construct_single_setup_info_tensor_flatbuffer(tensor, single_model_descriptor->target, tensor_info);
+        status = construct_single_setup_info_tensor_flatbuffer(tensor, single_model_descriptor->target, scratch, tensor_info);
 
         if (KP_SUCCESS != status) {
             err_print("construct nef single model information outputs tensor in model_descriptor fail: constuct tensor fail ...\n");
@@ -751,7 +751,7 @@ FUNC_OUT:
     return status;
 }
 
-int construct_single_setup_info_flatbuffer(uintptr_t setup_buff, kp_single_model_descriptor_t *single_model_descriptor) {
+int construct_single_setup_info_flatbuffer(uintptr_t setup_buff, scratch_arena_t *scratch, kp_single_model_descriptor_t *single_model_descriptor) {
     if (NULL == (void *)setup_buff ||
         NULL == single_model_descriptor) {
         err_print("construct nef single model information in model_descriptor fail: NULL pointer input parameters ...\n");
@@ -778,11 +778,11 @@ int construct_single_setup_info_flatbuffer(uintptr_t setup_buff, kp_single_model
     if (KP_SUCCESS != status)
         goto FUNC_OUT;
 
-    status = construct_single_setup_info_inputs_tensor_flatbuffer(root, single_model_descriptor);
+    status = construct_single_setup_info_inputs_tensor_flatbuffer(root, scratch, single_model_descriptor);
     if (KP_SUCCESS != status)
         goto FUNC_OUT;
 
-    status = construct_single_setup_info_outputs_tensor_flatbuffer(root, single_model_descriptor);
+    status = construct_single_setup_info_outputs_tensor_flatbuffer(root, scratch, single_model_descriptor);
     if (KP_SUCCESS != status)
         goto FUNC_OUT;
 
@@ -795,13 +795,13 @@ FUNC_OUT:
  * setup reader
  ******************************************************************/
 
-int construct_single_setup_info(uintptr_t setup_buff, size_t setup_buff_size, kp_single_model_descriptor_t *single_model_descriptor) {
+int construct_single_setup_info(uintptr_t setup_buff, size_t setup_buff_size, scratch_arena_t *scratch, kp_single_model_descriptor_t *single_model_descriptor) {
     int ret;
 
     if (SETUP_LEGACY_MAGIC_NUM == *((uint32_t*)setup_buff))
-        ret = construct_single_setup_info_legacy(setup_buff, setup_buff_size, single_model_descriptor);
+        ret = construct_single_setup_info_legacy(setup_buff, setup_buff_size, scratch, single_model_descriptor);
     else
-        ret = construct_single_setup_info_flatbuffer(setup_buff, single_model_descriptor);
+        ret = construct_single_setup_info_flatbuffer(setup_buff, scratch, single_model_descriptor);
 
     return ret;
 }
@@ -48,20 +48,72 @@ void* realloc_zero(void* memory, size_t new_size) {
     return _NewMemory;
 }
 
-void* strcpy_dst_realloc(char* dst_buff, const char* src_buff) {
+#define SCRATCH_CHUNK_SIZE  (16 * 1024)
+#define SCRATCH_ALIGNMENT   8
+
+struct scratch_chunk_s {
+    struct scratch_chunk_s* next;
+    size_t size;
+    size_t used;
+    uint8_t data[];
+};
+
+void* scratch_alloc(scratch_arena_t* scratch, size_t size) {
+    /**
+     * allocate zeroed memory from scratch arena, it is released with the whole arena
+     *
+     * note: return NULL when size is zero (as realloc_zero) or malloc fail.
+     */
+
+    if (0 == size) {
+        return NULL;
+    }
+
+    size = (size + SCRATCH_ALIGNMENT - 1) & ~((size_t)SCRATCH_ALIGNMENT - 1);
+
+    scratch_chunk_t* chunk = scratch->head;
+
+    if (NULL == chunk || chunk->size - chunk->used < size) {
+        size_t chunk_size = (size > SCRATCH_CHUNK_SIZE) ? size : SCRATCH_CHUNK_SIZE;
+
+        chunk = (scratch_chunk_t*)malloc(sizeof(scratch_chunk_t) + chunk_size);
+
+        if (NULL == chunk) {
+            err_print("[%s] malloc memory fail, line %d.\n", __FUNCTION__, __LINE__);
+            return NULL;
+        }
+
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        chunk->next = scratch->head;
+        scratch->head = chunk;
+    }
+
+    void* memory = chunk->data + chunk->used;
+    chunk->used += size;
+
+    return memset(memory, 0, size);
+}
+
+char* scratch_strdup(scratch_arena_t* scratch, const char* src_buff) {
     if (NULL == src_buff) {
         err_print("[%s] src_buff is NULL, line %d.\n", __FUNCTION__, __LINE__);
         return NULL;
     }
 
-    char* new_dst_buff = realloc_zero(dst_buff, strlen(src_buff) + 1);
+    char* dst_buff = (char*)scratch_alloc(scratch, strlen(src_buff) + 1);
 
-    if (NULL == new_dst_buff) {
-        err_print("[%s] realloc memory fail, line %d.\n", __FUNCTION__, __LINE__);
-        return NULL;
+    if (NULL != dst_buff) {
+        strcpy(dst_buff, src_buff);
     }
 
-    strcpy(new_dst_buff, src_buff);
+    return dst_buff;
+}
 
-    return new_dst_buff;
+void scratch_release(scratch_arena_t* scratch) {
+    while (NULL != scratch->head) {
+        scratch_chunk_t* chunk = scratch->head;
+        scratch->head = chunk->next;
+        free(chunk);
+    }
 }
@@ -61,6 +61,10 @@ void DisplayHelpMessage()
     std::cout << "    --type                : [argument required]   type of device (\"KL520\", \"KL630\" or \"KL720\")" << std::endl;
     std::cout << "    --port                : [argument required]   port id set (\"all\" or specified multiple port ids \"13,537\")" << std::endl;
     std::cout << std::endl;
+    std::cout << "[Update dongles in parallel] (Only works with --kl520-update, --kl720-update and --model-to-flash)" << std::endl;
+    std::cout << "    --fleet               : [argument required]   number of dongles updated at the same time" << std::endl;
+    std::cout << "    --retry               : [argument required]   number of retries for a failed dongle (default " << FLEET_DEFAULT_RETRY << ")" << std::endl;
+    std::cout << std::endl;
     std::cout << "[Get Current DFUT console Version]" << std::endl;
     std::cout << "    --version             : [no argument]         display the version of DFUT console" << std::endl;
     std::cout << std::endl;
@@ -78,6 +82,7 @@ void ParseArguments(int argc, char *argv[], std::unordered_map<char, std::string
                                   {"model-to-flash", required_argument, nullptr, ON_FLASH_MODEL},
                                   {"port", required_argument, nullptr, ON_PORT}, {"type", required_argument, nullptr, ON_TYPE},
                                   {"scpu", required_argument, nullptr, ON_SCPU}, {"ncpu", required_argument, nullptr, ON_NCPU},
+                                  {"fleet", required_argument, nullptr, ON_FLEET}, {"retry", required_argument, nullptr, ON_RETRY},
                                   {"help", no_argument, nullptr, ON_HELP},
                                   {"version", no_argument, nullptr, ON_VERSION}, {"quiet", no_argument, nullptr, ON_QUIET},
                                   {nullptr, no_argument, nullptr, 0}};
@@ -120,6 +125,12 @@ void ParseArguments(int argc, char *argv[], std::unordered_map<char, std::string
             case ON_NCPU:
                 ArgumentMap[ON_NCPU] = optarg;
                 break;
+            case ON_FLEET:
+                ArgumentMap[ON_FLEET] = optarg;
+                break;
+            case ON_RETRY:
+                ArgumentMap[ON_RETRY] = optarg;
+                break;
             case ON_VERSION:
                 DisplayVersion();
                 exit(0);
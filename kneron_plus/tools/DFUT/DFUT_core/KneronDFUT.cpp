@@ -11,6 +11,11 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <sstream>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
 #include <string.h>
 
 extern "C" {
@@ -26,7 +31,6 @@ extern "C" {
 
 #include "WarningMessages.h"
 
-#define MAX_GROUP_DEVICE                    20
 #define KNERON_PRODUCT_USB_VID              0x3231
 #define UBUNTU_ACCEPT_VERSION               "18.04"
 
@@ -56,7 +60,7 @@ typedef struct
     // private
     int cur_send; // record current sending device index
     int cur_recv; // record current receiving device index
-    kp_usb_device_t *ll_device[MAX_GROUP_DEVICE];
+    kp_usb_device_t **ll_device;
 
 } __attribute__((aligned(4))) _kp_devices_group_t;
 
@@ -247,6 +251,32 @@ kp_device_group_t RebootAndReconnect(kp_device_group_t Devices, int PortId, int
     return Devices;
 }
 
+void PrintFlashWriteStatistics(kp_device_group_t Devices, std::ostream &Log)
+{
+    kp_flash_write_statistics_t Statistics;
+
+    if ((KP_SUCCESS != kp_get_flash_write_statistics(Devices, &Statistics)) ||
+        (0 == Statistics.bytes_written + Statistics.bytes_skipped)) {
+        return;
+    }
+
+    Log << "Wrote " << Statistics.bytes_written << " bytes to flash";
+
+    if (0 < Statistics.write_time_us) {
+        Log << ", " << (Statistics.bytes_written * 1000000 / Statistics.write_time_us) << " bytes/s";
+    }
+
+    if (0 < Statistics.bytes_skipped) {
+        Log << ", " << Statistics.bytes_skipped << " unchanged bytes are skipped";
+    }
+
+    if (0 < Statistics.bytes_unverified) {
+        Log << ", " << Statistics.bytes_unverified << " bytes are not verified by the device firmware";
+    }
+
+    Log << std::endl;
+}
+
 // return true: User enter 'y' or 'Y'
 // return false: User enter 'n' or 'N'
 bool GetResponseFromUser(std::string WarningMessage, std::string ConfirmMessage)
@@ -458,13 +488,27 @@ int CheckArgument(std::unordered_map<char, std::string> ArgumentMap)
         }
     }
 
+    if ((false == ArgumentMap[ON_FLEET].empty()) || (false == ArgumentMap[ON_RETRY].empty())) {
+        if ((true == ArgumentMap[ON_520_UPDATE].empty()) && (true == ArgumentMap[ON_720_UPDATE].empty()) &&
+            (true == ArgumentMap[ON_FLASH_MODEL].empty())) {
+            std::cout << "[Error] Parallel update only works with firmware or model update to flash." << std::endl;
+            return -1;
+        } else if ((false == IsNumber(ArgumentMap[ON_FLEET])) || (0 >= std::stoi(ArgumentMap[ON_FLEET]))) {
+            std::cout << "[Error] Number of dongles updated at the same time must be a positive number." << std::endl;
+            return -1;
+        } else if ((false == ArgumentMap[ON_RETRY].empty()) && (false == IsNumber(ArgumentMap[ON_RETRY]))) {
+            std::cout << "[Error] Number of retries must be a number." << std::endl;
+            return -1;
+        }
+    }
+
     return 0;
 }
 
 int CheckModel(std::string strModelFilePath)
 {
-    size_t nef_size;
-    char *nef_buf = read_file_to_buffer_auto_malloc(strModelFilePath.c_str(), &nef_size);
+    long nef_size;
+    char *nef_buf = map_file_to_buffer(strModelFilePath.c_str(), &nef_size);
 
     if (!nef_buf) {
         return -1;
@@ -476,6 +520,9 @@ int CheckModel(std::string strModelFilePath)
     memset(&nef_info, 0, sizeof(kp_nef_info_t));
 
     int Ret = read_nef(nef_buf, static_cast<uint32_t>(nef_size), &metadata, &nef_info);
+
+    unmap_file_buffer(nef_buf, nef_size);
+
     if (0 != Ret) {
         return -1;
     }
@@ -675,6 +722,134 @@ bool IsBinSizeReasonable(std::string strFilePath, std::string strProductName, st
     }
 }
 
+static void PrintDeviceLog(int PortId, std::string strLog)
+{
+    std::istringstream Stream(strLog);
+    std::string strLine;
+
+    while (std::getline(Stream, strLine)) {
+        if (false == strLine.empty()) {
+            std::cout << "[Port Id " << PortId << "] " << strLine << std::endl;
+        }
+    }
+}
+
+// run UpdateDevice on every port with a pool of workers, a device which reboots or reconnects only occupies its own worker
+// failed devices are put back to the end of the queue, so that they are retried after the others instead of blocking them
+int UpdateFleet(std::vector<int> PortIdList, std::unordered_map<char, std::string> ArgumentMap, std::string strTarget,
+                std::function<int(int PortId, std::ostream &Log)> UpdateDevice)
+{
+    struct FleetDevice {
+        int PortId;
+        int Attempts;
+        int Ret;
+    };
+
+    std::vector<FleetDevice> DeviceList;
+    std::deque<size_t> PendingQueue;
+    std::mutex FleetMutex;
+    std::vector<std::thread> Workers;
+    int Concurrency = std::stoi(ArgumentMap[ON_FLEET]);
+    int MaxRetry = (true == ArgumentMap[ON_RETRY].empty()) ? FLEET_DEFAULT_RETRY : std::stoi(ArgumentMap[ON_RETRY]);
+    int Running = 0;
+    int Succeeded = 0;
+    int Failed = 0;
+    int Total = static_cast<int>(PortIdList.size());
+    auto StartTime = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < PortIdList.size(); i++) {
+        DeviceList.push_back({PortIdList[i], 0, DEVICE_SKIPPED});
+        PendingQueue.push_back(i);
+    }
+
+    Concurrency = std::min(Concurrency, Total);
+
+    std::cout << std::endl;
+    std::cout << "Start Update " << strTarget << " to " << Total << " Devices, " << Concurrency << " at a time" << std::endl;
+
+    auto Worker = [&]() {
+        while (true) {
+            FleetDevice *pDevice;
+            std::ostringstream Log;
+            int Ret;
+
+            {
+                std::lock_guard<std::mutex> Lock(FleetMutex);
+
+                // a device put back by a running worker is picked up by that worker itself, nothing is left behind
+                if (true == PendingQueue.empty()) {
+                    return;
+                }
+
+                pDevice = &DeviceList[PendingQueue.front()];
+                PendingQueue.pop_front();
+                pDevice->Attempts++;
+                Running++;
+
+                std::cout << "[Port Id " << pDevice->PortId << "] Start Update " << strTarget;
+                if (1 < pDevice->Attempts) {
+                    std::cout << " (Retry " << (pDevice->Attempts - 1) << " of " << MaxRetry << ")";
+                }
+                std::cout << std::endl;
+            }
+
+            if (1 < pDevice->Attempts) {
+                SLEEP(USB_WAIT_AFTER_REBOOT); // give a device which dropped off the bus time to come back
+            }
+
+            Ret = UpdateDevice(pDevice->PortId, Log);
+
+            {
+                std::lock_guard<std::mutex> Lock(FleetMutex);
+
+                Running--;
+                pDevice->Ret = Ret;
+
+                PrintDeviceLog(pDevice->PortId, Log.str());
+
+                if (0 == Ret) {
+                    Succeeded++;
+                    std::cout << "[Port Id " << pDevice->PortId << "] Succeeded" << std::endl;
+                } else if ((DEVICE_SKIPPED != Ret) && (MaxRetry >= pDevice->Attempts)) {
+                    PendingQueue.push_back(pDevice - &DeviceList[0]);
+                    std::cout << "[Port Id " << pDevice->PortId << "] Failed with Error Code: " << Ret << ", will retry" << std::endl;
+                } else {
+                    Failed++;
+                    std::cout << "[Port Id " << pDevice->PortId << "] Failed with Error Code: " << Ret << std::endl;
+                }
+
+                std::cout << "==== Progress: " << (Succeeded + Failed) << "/" << Total << " Done (" << Succeeded << " Succeeded, "
+                          << Failed << " Failed), " << Running << " In Progress ====" << std::endl;
+            }
+        }
+    };
+
+    for (int i = 0; i < Concurrency; i++) {
+        Workers.push_back(std::thread(Worker));
+    }
+
+    for (size_t i = 0; i < Workers.size(); i++) {
+        Workers[i].join();
+    }
+
+    auto ElapsedSeconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - StartTime).count();
+
+    std::cout << std::endl;
+    std::cout << "==== Update " << strTarget << " to " << Total << " Devices: " << Succeeded << " Succeeded, " << Failed
+              << " Failed in " << ElapsedSeconds << " secs ====" << std::endl;
+
+    for (size_t i = 0; i < DeviceList.size(); i++) {
+        if (0 != DeviceList[i].Ret) {
+            std::cout << "    Port Id " << DeviceList[i].PortId << " Failed with Error Code: " << DeviceList[i].Ret
+                      << " after " << DeviceList[i].Attempts << " attempt(s)" << std::endl;
+        }
+    }
+
+    std::cout << std::endl;
+
+    return 0;
+}
+
 int UpdateKl520ToUsbLoader(std::vector<int> PortIdList, std::unordered_map<char, std::string> ArgumentMap, std::string strPlusLoaderPath, std::string strFlashHelperPath)
 {
     for (size_t i = 0; i < PortIdList.size(); i++) {
@@ -877,6 +1052,10 @@ int UpdateKl520ToFlashBoot(std::vector<int> PortIdList, std::unordered_map<char,
 
         if (true == AUTO_REBOOT) {
             Ret = kp_update_kdp2_firmware_from_files(Devices, ArgumentMap[ON_SCPU].c_str(), ArgumentMap[ON_NCPU].c_str(), true);
+
+            if (KP_SUCCESS == Ret) {
+                PrintFlashWriteStatistics(Devices, std::cout);
+            }
         } else {
             Ret = kp_update_kdp2_firmware_from_files(Devices, ArgumentMap[ON_SCPU].c_str(), nullptr, false);
 
@@ -884,6 +1063,8 @@ int UpdateKl520ToFlashBoot(std::vector<int> PortIdList, std::unordered_map<char,
                 goto FLASH_LOOP_OUT;
             }
 
+            PrintFlashWriteStatistics(Devices, std::cout);
+
             Devices = RebootAndReconnect(Devices, PortId, &Ret);
 
             if (nullptr == Devices) {
@@ -898,6 +1079,8 @@ int UpdateKl520ToFlashBoot(std::vector<int> PortIdList, std::unordered_map<char,
                 goto FLASH_LOOP_OUT;
             }
 
+            PrintFlashWriteStatistics(Devices, std::cout);
+
             Devices = RebootAndReconnect(Devices, PortId, &Ret);
         }
 
@@ -1062,6 +1245,109 @@ FLASH_LOOP_OUT:
     return 0;
 }
 
+static int UpdateFwToSingleDevice(int PortId, std::unordered_map<char, std::string> ArgumentMap, std::string strFlashHelperPath, std::ostream &Log)
+{
+    int ErrorCode = KDP_MAGIC_CONNECTION_PASS;
+    kp_device_group_t Devices;
+    _kp_devices_group_t *pDeviceList;
+    int Ret = DEVICE_SKIPPED;
+
+    Devices = kp_connect_devices(1, &PortId, &ErrorCode);
+    pDeviceList = reinterpret_cast<_kp_devices_group_t *>(Devices);
+
+    if ((nullptr == Devices) || (1 > pDeviceList->num_device)) {
+        Ret = KP_ERROR_DEVICE_NOT_EXIST_10;
+        goto KDP_LOOP_OUT;
+    }
+
+    if ((KL520_PRODUCT_ID != pDeviceList->ll_device[0]->dev_descp.product_id) && (false == ArgumentMap[ON_520_UPDATE].empty())) {
+        Log << std::endl;
+        Log << "Device with Port Id " << PortId << " is not " << KL520_PRODUCT_NAME << std::endl;
+        goto KDP_LOOP_OUT;
+    } else if ((KL720_PRODUCT_ID_1 != pDeviceList->ll_device[0]->dev_descp.product_id) &&
+                (KL720_PRODUCT_ID_2 != pDeviceList->ll_device[0]->dev_descp.product_id) &&
+                (false == ArgumentMap[ON_720_UPDATE].empty())) {
+        Log << std::endl;
+        Log << "Device with Port Id " << PortId << " is not " << KL720_PRODUCT_NAME << std::endl;
+        goto KDP_LOOP_OUT;
+    } else if ((KL630_PRODUCT_ID != pDeviceList->ll_device[0]->dev_descp.product_id) &&
+               (false == ArgumentMap[ON_630_UPDATE_LOADER].empty())) {
+        Log << std::endl;
+        Log << "Device with Port Id " << PortId << " is not " << KL720_PRODUCT_NAME << std::endl;
+        goto KDP_LOOP_OUT;
+    } else if (KP_USB_SPEED_SUPER != pDeviceList->ll_device[0]->dev_descp.link_speed) {
+        if ((KL720_PRODUCT_ID_1 == pDeviceList->ll_device[0]->dev_descp.product_id) || (KL720_PRODUCT_ID_2 == pDeviceList->ll_device[0]->dev_descp.product_id)) {
+            Log << std::endl;
+            Log << "KL720 with Port Id " << PortId << " is not on Usb Super-Speed. Update process skips this device..." << std::endl;
+            goto KDP_LOOP_OUT;
+        }
+    }
+
+    kp_set_timeout(Devices, 20000); // 20 secs timeout
+
+    if (KDP2_LOADER_ONLY == std::string(pDeviceList->ll_device[0]->dev_descp.firmware)) {
+        Ret = kp_load_firmware_from_file(Devices, strFlashHelperPath.c_str(), nullptr);
+
+        if (KP_SUCCESS != Ret) {
+            goto KDP_LOOP_OUT;
+        }
+
+        SLEEP(USB_WAIT_CONNECT_DELAY_MS);
+    }
+
+    if ((false == ArgumentMap[ON_520_UPDATE].empty()) || (false == ArgumentMap[ON_720_UPDATE].empty())) {
+        if (true == AUTO_REBOOT) {
+            Ret = kp_update_kdp_firmware_from_files(Devices, ArgumentMap[ON_SCPU].c_str(), ArgumentMap[ON_NCPU].c_str(), true);
+        } else {
+            Ret = kp_update_kdp_firmware_from_files(Devices, ArgumentMap[ON_SCPU].c_str(), nullptr, false);
+
+            if (KP_SUCCESS != Ret) {
+                goto KDP_LOOP_OUT;
+            }
+
+            Devices = RebootAndReconnect(Devices, PortId, &Ret);
+
+            if (nullptr == Devices) {
+                goto KDP_LOOP_OUT;
+            }
+
+            kp_set_timeout(Devices, 20000); // 20 secs timeout
+
+            Ret = kp_update_kdp_firmware_from_files(Devices, nullptr, ArgumentMap[ON_NCPU].c_str(), false);
+
+            if (KP_SUCCESS != Ret) {
+                goto KDP_LOOP_OUT;
+            }
+
+            Devices = RebootAndReconnect(Devices, PortId, &Ret);
+        }
+    } else if (false == ArgumentMap[ON_630_UPDATE_LOADER].empty()) {
+        if (true == AUTO_REBOOT) {
+            Ret = kp_update_kdp2_usb_loader_from_file(Devices, ArgumentMap[ON_SCPU].c_str(), true);
+        } else {
+            Ret = kp_update_kdp2_usb_loader_from_file(Devices, ArgumentMap[ON_SCPU].c_str(), false);
+
+            if (KP_SUCCESS != Ret) {
+                goto KDP_LOOP_OUT;
+            }
+
+            Devices = RebootAndReconnect(Devices, PortId, &Ret);
+
+            if (nullptr == Devices) {
+                goto KDP_LOOP_OUT;
+            }
+        }
+    }
+
+KDP_LOOP_OUT:
+
+    if ((nullptr != Devices) && (KP_ERROR_DEVICE_NOT_EXIST_10 != Ret)) {
+        kp_disconnect_devices(Devices);
+    }
+
+    return Ret;
+}
+
 int UpdateFwToFlash(std::vector<int> PortIdList, std::unordered_map<char, std::string> ArgumentMap, std::string strFlashHelperPath)
 {
     std::string strScpuFilePath = ArgumentMap[ON_SCPU];
@@ -1175,108 +1461,22 @@ int UpdateFwToFlash(std::vector<int> PortIdList, std::unordered_map<char, std::s
         return -1;
     }
 
+    if (false == ArgumentMap[ON_FLEET].empty()) {
+        return UpdateFleet(PortIdList, ArgumentMap, "Firmware",
+                           [&](int PortId, std::ostream &Log) {
+                               return UpdateFwToSingleDevice(PortId, ArgumentMap, strFlashHelperPath, Log);
+                           });
+    }
+
     for (size_t i = 0; i < PortIdList.size(); i++) {
-        int ErrorCode = KDP_MAGIC_CONNECTION_PASS;
-        kp_device_group_t Devices;
-        _kp_devices_group_t *pDeviceList;
-        int Ret = -1;
         int PortId = PortIdList[i];
 
         std::cout << std::endl;
         std::cout << "Start Update Firmware to Device with Port Id " << PortId << std::endl;
 
-        Devices = kp_connect_devices(1, &PortId, &ErrorCode);
-        pDeviceList = reinterpret_cast<_kp_devices_group_t *>(Devices);
-
-        if ((nullptr == Devices) || (1 > pDeviceList->num_device)) {
-            Ret = KP_ERROR_DEVICE_NOT_EXIST_10;
-            goto KDP_LOOP_OUT;
-        }
-
-        if ((KL520_PRODUCT_ID != pDeviceList->ll_device[0]->dev_descp.product_id) && (false == ArgumentMap[ON_520_UPDATE].empty())) {
-            std::cout << std::endl;
-            std::cout << "Device with Port Id " << PortId << " is not " << KL520_PRODUCT_NAME << std::endl;
-            goto KDP_LOOP_OUT;
-        } else if ((KL720_PRODUCT_ID_1 != pDeviceList->ll_device[0]->dev_descp.product_id) &&
-                    (KL720_PRODUCT_ID_2 != pDeviceList->ll_device[0]->dev_descp.product_id) &&
-                    (false == ArgumentMap[ON_720_UPDATE].empty())) {
-            std::cout << std::endl;
-            std::cout << "Device with Port Id " << PortId << " is not " << KL720_PRODUCT_NAME << std::endl;
-            goto KDP_LOOP_OUT;
-        } else if ((KL630_PRODUCT_ID != pDeviceList->ll_device[0]->dev_descp.product_id) &&
-                   (false == ArgumentMap[ON_630_UPDATE_LOADER].empty())) {
-           std::cout << std::endl;
-           std::cout << "Device with Port Id " << PortId << " is not " << KL720_PRODUCT_NAME << std::endl;
-           goto KDP_LOOP_OUT;
-       } else if (KP_USB_SPEED_SUPER != pDeviceList->ll_device[0]->dev_descp.link_speed) {
-            if ((KL720_PRODUCT_ID_1 == pDeviceList->ll_device[0]->dev_descp.product_id) || (KL720_PRODUCT_ID_2 == pDeviceList->ll_device[0]->dev_descp.product_id)) {
-                std::cout << std::endl;
-                std::cout << "KL720 with Port Id " << PortId << " is not on Usb Super-Speed. Update process skips this device..." << std::endl;
-                goto KDP_LOOP_OUT;
-            }
-        }
-
-        kp_set_timeout(Devices, 20000); // 20 secs timeout
-
-        if (KDP2_LOADER_ONLY == std::string(pDeviceList->ll_device[0]->dev_descp.firmware)) {
-            Ret = kp_load_firmware_from_file(Devices, strFlashHelperPath.c_str(), nullptr);
-
-            if (KP_SUCCESS != Ret) {
-                goto KDP_LOOP_OUT;
-            }
-
-            SLEEP(USB_WAIT_CONNECT_DELAY_MS);
-        }
-
-        if ((false == ArgumentMap[ON_520_UPDATE].empty()) || (false == ArgumentMap[ON_720_UPDATE].empty())) {
-            if (true == AUTO_REBOOT) {
-                Ret = kp_update_kdp_firmware_from_files(Devices, ArgumentMap[ON_SCPU].c_str(), ArgumentMap[ON_NCPU].c_str(), true);
-            } else {
-                Ret = kp_update_kdp_firmware_from_files(Devices, ArgumentMap[ON_SCPU].c_str(), nullptr, false);
-
-                if (KP_SUCCESS != Ret) {
-                    goto KDP_LOOP_OUT;
-                }
-
-                Devices = RebootAndReconnect(Devices, PortId, &Ret);
-
-                if (nullptr == Devices) {
-                    goto KDP_LOOP_OUT;
-                }
-
-                kp_set_timeout(Devices, 20000); // 20 secs timeout
-
-                Ret = kp_update_kdp_firmware_from_files(Devices, nullptr, ArgumentMap[ON_NCPU].c_str(), false);
-
-                if (KP_SUCCESS != Ret) {
-                    goto KDP_LOOP_OUT;
-                }
-
-                Devices = RebootAndReconnect(Devices, PortId, &Ret);
-            }
-        } else if (false == ArgumentMap[ON_630_UPDATE_LOADER].empty()) {
-            if (true == AUTO_REBOOT) {
-                Ret = kp_update_kdp2_usb_loader_from_file(Devices, ArgumentMap[ON_SCPU].c_str(), true);
-            } else {
-                Ret = kp_update_kdp2_usb_loader_from_file(Devices, ArgumentMap[ON_SCPU].c_str(), false);
-
-                if (KP_SUCCESS != Ret) {
-                    goto KDP_LOOP_OUT;
-                }
-
-                Devices = RebootAndReconnect(Devices, PortId, &Ret);
+        int Ret = UpdateFwToSingleDevice(PortId, ArgumentMap, strFlashHelperPath, std::cout);
 
-                if (nullptr == Devices) {
-                    goto KDP_LOOP_OUT;
-                }
-            }
-        }
-
-KDP_LOOP_OUT:
-
-        if ((nullptr != Devices) && (KP_ERROR_DEVICE_NOT_EXIST_10 != Ret)) {
-            kp_disconnect_devices(Devices);
-        } else if (KP_ERROR_DEVICE_NOT_EXIST_10 == Ret) {
+        if (KP_ERROR_DEVICE_NOT_EXIST_10 == Ret) {
             if ((false == ArgumentMap[ON_520_UPDATE].empty()) &&
                 (false == IsDriverInstalled(KP_DEVICE_KL520))) {
                 Ret = InstallDriver(ArgumentMap);
@@ -1302,102 +1502,125 @@ KDP_LOOP_OUT:
     return 0;
 }
 
-int UpdateModelToFlash(std::vector<int> PortIdList, std::unordered_map<char, std::string> ArgumentMap, std::string strFlashHelperPath)
+static int UpdateModelToSingleDevice(int PortId, std::unordered_map<char, std::string> ArgumentMap, std::string strFlashHelperPath, int ModelTarget, std::ostream &Log)
 {
-    int ModelTarget = CheckModel(ArgumentMap[ON_FLASH_MODEL]);
+    int ErrorCode = KDP_MAGIC_CONNECTION_PASS;
+    kp_device_group_t Devices;
+    _kp_devices_group_t *pDeviceList;
+    int Ret = DEVICE_SKIPPED;
 
-    for (size_t i = 0; i < PortIdList.size(); i++) {
-        int ErrorCode = KDP_MAGIC_CONNECTION_PASS;
-        kp_device_group_t Devices;
-        _kp_devices_group_t *pDeviceList;
-        int Ret = -1;
-        int PortId = PortIdList[i];
+    Devices = kp_connect_devices(1, &PortId, &ErrorCode);
+    pDeviceList = reinterpret_cast<_kp_devices_group_t *>(Devices);
 
-        std::cout << std::endl;
-        std::cout << "Start Update Model to Device with Port Id " << PortId << std::endl;
+    if (nullptr == Devices) {
+        Ret = KP_ERROR_DEVICE_NOT_EXIST_10;
+        goto MODEL_LOOP_OUT;
+    }
 
-        if (true == ArgumentMap[ON_QUIET].empty() &&
-            false == GetResponseFromUser(UPDATE_MODEL_TIME_WARNING, UPDATE_PROCEED_MSG))
-        {
-            exit(0);
+    if (KL520_PRODUCT_NAME == ArgumentMap[ON_TYPE]) {
+        if (KL520_PRODUCT_ID != pDeviceList->ll_device[0]->dev_descp.product_id) {
+            Log << std::endl;
+            Log << "Device with Port Id " << PortId << " is not " << ArgumentMap[ON_TYPE] << std::endl;
+            goto MODEL_LOOP_OUT;
+        } else if (KL520_PRODUCT_ID != ModelTarget) {
+            Log << std::endl;
+            Log << "This Model is not for "<< KL520_PRODUCT_NAME << ", but Device with Port Id " << PortId << " is " << KL520_PRODUCT_NAME << std::endl;
+            goto MODEL_LOOP_OUT;
         }
-
-        Devices = kp_connect_devices(1, &PortId, &ErrorCode);
-        pDeviceList = reinterpret_cast<_kp_devices_group_t *>(Devices);
-
-        if (nullptr == Devices) {
-            Ret = KP_ERROR_DEVICE_NOT_EXIST_10;
+    } else if (KL630_PRODUCT_NAME == ArgumentMap[ON_TYPE]) {
+        if (KL630_PRODUCT_ID != pDeviceList->ll_device[0]->dev_descp.product_id) {
+            Log << std::endl;
+            Log << "Device with Port Id " << PortId << " is not " << ArgumentMap[ON_TYPE] << std::endl;
+            goto MODEL_LOOP_OUT;
+        } else if (KL630_PRODUCT_ID != ModelTarget) {
+            Log << std::endl;
+            Log << "This Model is not for "<< KL630_PRODUCT_NAME << ", but Device with Port Id " << PortId << " is " << KL520_PRODUCT_NAME << std::endl;
             goto MODEL_LOOP_OUT;
         }
-
-        if (KL520_PRODUCT_NAME == ArgumentMap[ON_TYPE]) {
-            if (KL520_PRODUCT_ID != pDeviceList->ll_device[0]->dev_descp.product_id) {
-                std::cout << std::endl;
-                std::cout << "Device with Port Id " << PortId << " is not " << ArgumentMap[ON_TYPE] << std::endl;
-                goto MODEL_LOOP_OUT;
-            } else if (KL520_PRODUCT_ID != ModelTarget) {
-                std::cout << std::endl;
-                std::cout << "This Model is not for "<< KL520_PRODUCT_NAME << ", but Device with Port Id " << PortId << " is " << KL520_PRODUCT_NAME << std::endl;
-                goto MODEL_LOOP_OUT;
-            }
-        } else if (KL630_PRODUCT_NAME == ArgumentMap[ON_TYPE]) {
-            if (KL630_PRODUCT_ID != pDeviceList->ll_device[0]->dev_descp.product_id) {
-                std::cout << std::endl;
-                std::cout << "Device with Port Id " << PortId << " is not " << ArgumentMap[ON_TYPE] << std::endl;
-                goto MODEL_LOOP_OUT;
-            } else if (KL630_PRODUCT_ID != ModelTarget) {
-                std::cout << std::endl;
-                std::cout << "This Model is not for "<< KL630_PRODUCT_NAME << ", but Device with Port Id " << PortId << " is " << KL520_PRODUCT_NAME << std::endl;
-                goto MODEL_LOOP_OUT;
-            }
-        } else if (KL720_PRODUCT_NAME == ArgumentMap[ON_TYPE]) {
-            if ((KL720_PRODUCT_ID_1 != pDeviceList->ll_device[0]->dev_descp.product_id) && (KL720_PRODUCT_ID_2 != pDeviceList->ll_device[0]->dev_descp.product_id)) {
-                std::cout << std::endl;
-                std::cout << "Device with Port Id " << PortId << " is not " << ArgumentMap[ON_TYPE] << std::endl;
-                goto MODEL_LOOP_OUT;
-            } else if (KP_USB_SPEED_SUPER != pDeviceList->ll_device[0]->dev_descp.link_speed) {
-                std::cout << std::endl;
-                std::cout << "KL720 with Port Id " << PortId << " is not on Usb Super-Speed." << std::endl;
-                goto MODEL_LOOP_OUT;
-            } else if (KL720_PRODUCT_ID_2 != ModelTarget) {
-                std::cout << std::endl;
-                std::cout << "This Model is not for "<< KL720_PRODUCT_NAME << ", but Device with Port Id " << PortId << " is " << KL720_PRODUCT_NAME << std::endl;
-                goto MODEL_LOOP_OUT;
-            }
-        } else {
-            std::cout << std::endl;
-            std::cout << ArgumentMap[ON_TYPE] << " is not supported." << std::endl;
+    } else if (KL720_PRODUCT_NAME == ArgumentMap[ON_TYPE]) {
+        if ((KL720_PRODUCT_ID_1 != pDeviceList->ll_device[0]->dev_descp.product_id) && (KL720_PRODUCT_ID_2 != pDeviceList->ll_device[0]->dev_descp.product_id)) {
+            Log << std::endl;
+            Log << "Device with Port Id " << PortId << " is not " << ArgumentMap[ON_TYPE] << std::endl;
+            goto MODEL_LOOP_OUT;
+        } else if (KP_USB_SPEED_SUPER != pDeviceList->ll_device[0]->dev_descp.link_speed) {
+            Log << std::endl;
+            Log << "KL720 with Port Id " << PortId << " is not on Usb Super-Speed." << std::endl;
+            goto MODEL_LOOP_OUT;
+        } else if (KL720_PRODUCT_ID_2 != ModelTarget) {
+            Log << std::endl;
+            Log << "This Model is not for "<< KL720_PRODUCT_NAME << ", but Device with Port Id " << PortId << " is " << KL720_PRODUCT_NAME << std::endl;
             goto MODEL_LOOP_OUT;
         }
+    } else {
+        Log << std::endl;
+        Log << ArgumentMap[ON_TYPE] << " is not supported." << std::endl;
+        goto MODEL_LOOP_OUT;
+    }
 
-        kp_set_timeout(Devices, 200000); // 200 secs timeout, write model to flash need longer time than usual
-
-        if ((KDP_FIRMWARE != std::string(pDeviceList->ll_device[0]->dev_descp.firmware)) &&
-            ((KL520_PRODUCT_ID == pDeviceList->ll_device[0]->dev_descp.product_id) ||
-             (KL630_PRODUCT_ID == pDeviceList->ll_device[0]->dev_descp.product_id))) {
-            Ret = kp_load_firmware_from_file(Devices, strFlashHelperPath.c_str(), nullptr);
-
-            if (KP_SUCCESS != Ret) {
-                goto MODEL_LOOP_OUT;
-            }
-        }
+    kp_set_timeout(Devices, 200000); // 200 secs timeout, write model to flash need longer time than usual
 
-        Ret = kp_update_model_from_file(Devices, ArgumentMap[ON_FLASH_MODEL].c_str(), AUTO_REBOOT, NULL);
+    if ((KDP_FIRMWARE != std::string(pDeviceList->ll_device[0]->dev_descp.firmware)) &&
+        ((KL520_PRODUCT_ID == pDeviceList->ll_device[0]->dev_descp.product_id) ||
+         (KL630_PRODUCT_ID == pDeviceList->ll_device[0]->dev_descp.product_id))) {
+        Ret = kp_load_firmware_from_file(Devices, strFlashHelperPath.c_str(), nullptr);
 
         if (KP_SUCCESS != Ret) {
             goto MODEL_LOOP_OUT;
         }
+    }
 
-        if (false == AUTO_REBOOT) {
-            Devices = RebootAndReconnect(Devices, PortId, &Ret);
-        }
+    Ret = kp_update_model_from_file(Devices, ArgumentMap[ON_FLASH_MODEL].c_str(), AUTO_REBOOT, NULL);
+
+    if (KP_SUCCESS != Ret) {
+        goto MODEL_LOOP_OUT;
+    }
+
+    PrintFlashWriteStatistics(Devices, Log);
+
+    if (false == AUTO_REBOOT) {
+        Devices = RebootAndReconnect(Devices, PortId, &Ret);
+    }
 
 MODEL_LOOP_OUT:
 
-        if (nullptr != Devices) {
-            kp_disconnect_devices(Devices);
+    if (nullptr != Devices) {
+        kp_disconnect_devices(Devices);
+    }
+
+    return Ret;
+}
+
+int UpdateModelToFlash(std::vector<int> PortIdList, std::unordered_map<char, std::string> ArgumentMap, std::string strFlashHelperPath)
+{
+    int ModelTarget = CheckModel(ArgumentMap[ON_FLASH_MODEL]);
+
+    if (false == ArgumentMap[ON_FLEET].empty()) {
+        if (true == ArgumentMap[ON_QUIET].empty() &&
+            false == GetResponseFromUser(UPDATE_MODEL_TIME_WARNING, UPDATE_PROCEED_MSG))
+        {
+            exit(0);
         }
 
+        return UpdateFleet(PortIdList, ArgumentMap, "Model",
+                           [&](int PortId, std::ostream &Log) {
+                               return UpdateModelToSingleDevice(PortId, ArgumentMap, strFlashHelperPath, ModelTarget, Log);
+                           });
+    }
+
+    for (size_t i = 0; i < PortIdList.size(); i++) {
+        int PortId = PortIdList[i];
+
+        std::cout << std::endl;
+        std::cout << "Start Update Model to Device with Port Id " << PortId << std::endl;
+
+        if (true == ArgumentMap[ON_QUIET].empty() &&
+            false == GetResponseFromUser(UPDATE_MODEL_TIME_WARNING, UPDATE_PROCEED_MSG))
+        {
+            exit(0);
+        }
+
+        int Ret = UpdateModelToSingleDevice(PortId, ArgumentMap, strFlashHelperPath, ModelTarget, std::cout);
+
         std::string strMessage = (0 == Ret) ? " Succeeded" : (" Failed with Error Code: " + std::to_string(Ret));
 
         std::cout << std::endl;
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <functional>
+#include <ostream>
 
 extern "C" {
 #include "kp_struct.h"
@@ -63,6 +65,9 @@ extern "C" {
 
 #define AUTO_REBOOT                 false
 
+#define DEVICE_SKIPPED              -1  // device is not the target of the update, retrying does not help
+#define FLEET_DEFAULT_RETRY         2
+
 enum BinCheckErrorCode {
     BCEC_OK = 0,
     BCEC_FILE_NOT_EXIST = 1,
@@ -96,6 +101,8 @@ typedef enum {
     ON_TYPE = 15,
     ON_SCPU = 16,
     ON_NCPU = 17,
+    ON_FLEET = 18,
+    ON_RETRY = 19,
 } OptionNumber;
 
 char *read_file_to_buffer_auto_malloc(const char *file_path, size_t *buffer_size);
@@ -124,5 +131,7 @@ int UpdateKl630ToUsbLoader(std::vector<int> PortIdList, std::unordered_map<char,
 int UpdateKl630ToFlashBoot(std::vector<int> PortIdList, std::unordered_map<char, std::string> ArgumentMap, std::string strFlashHelperPath);
 int UpdateFwToFlash(std::vector<int> PortIdList, std::unordered_map<char, std::string> ArgumentMap, std::string strFlashHelperPath);
 int UpdateModelToFlash(std::vector<int> PortIdList, std::unordered_map<char, std::string> ArgumentMap, std::string strFlashHelperPath);
+int UpdateFleet(std::vector<int> PortIdList, std::unordered_map<char, std::string> ArgumentMap, std::string strTarget,
+                std::function<int(int PortId, std::ostream &Log)> UpdateDevice);
 
 #endif // KNERON_DEVICE_FIRMWARE_UPGRADE_TOOL_H
@@ -0,0 +1,209 @@
+/**
+ * @file        checksum_benchmark.c
+ * @brief       measure throughput of the checksums for NEF and firmware data
+ * @version     0.1
+ * @date        2026-10-18
+ *
+ * @copyright   Copyright (c) 2021 Kneron Inc. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <sys/time.h>
+
+#include "kp_core.h"
+#include "internal_func.h"
+
+static char _file_path[256] = {0};
+static int _size_mb = 16;
+static int _repeat = 10;
+
+void print_settings()
+{
+    printf("checksum_benchmark\n");
+    printf("\n");
+    printf("  measure CRC32 (NEF), CRC16 (KL720 USB boot), sum32 (firmware image) and FNV-1a (KL520 flash blocks)\n");
+    printf("  over a buffer, and the byte-wise CRC32 and bit-wise CRC16 they replace\n");
+    printf("\n");
+    printf("Arguments:\n");
+    printf("-help, h   : print help message\n");
+    printf("-file, f   : [file path] = (checksum the file instead of random data)\n");
+    printf("-size, s   : [random data size in MB] = (default %d)\n", _size_mb);
+    printf("-repeat, r : [repeat count] = (default %d)\n", _repeat);
+    printf("\n");
+
+    return;
+}
+
+bool parse_arguments(int argc, char *argv[])
+{
+    int opt = 0;
+
+    static struct option long_options[] = {
+        {"help",   no_argument,       0, 'h'},
+        {"file",   required_argument, 0, 'f'},
+        {"size",   required_argument, 0, 's'},
+        {"repeat", required_argument, 0, 'r'},
+        {0, 0, 0, 0}};
+
+    int option_index = 0;
+
+    while ((opt = getopt_long(argc, argv, "hf:s:r:", long_options, &option_index)) != -1)
+    {
+        switch (opt)
+        {
+        case 'f':
+            snprintf(_file_path, sizeof(_file_path), "%s", optarg);
+            break;
+        case 's':
+            _size_mb = atoi(optarg);
+            break;
+        case 'r':
+            _repeat = atoi(optarg);
+            break;
+        case 'h':
+        case '?':
+        default:
+            print_settings();
+            exit(0);
+        }
+    }
+
+    return true;
+}
+
+static double get_time_ms()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (double)tv.tv_sec * 1000 + (double)tv.tv_usec / 1000;
+}
+
+static uint32_t byte_wise_crc32(uint8_t *data, uint32_t size)
+{
+    static uint32_t table[256] = {0};
+
+    if (0 == table[1])
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? (c >> 1) ^ 0xEDB88320 : (c >> 1);
+
+            table[n] = c;
+        }
+    }
+
+    uint32_t crc = ~0U;
+
+    while (size--)
+        crc = table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+
+    return crc ^ ~0U;
+}
+
+static uint16_t bit_wise_crc16(uint8_t *data, uint32_t size)
+{
+    uint16_t out = 0;
+    int bits_read = 0, bit_flag, i;
+
+    while (size > 0)
+    {
+        bit_flag = out >> 15;
+        out <<= 1;
+        out |= (*data >> bits_read) & 1;
+
+        if (++bits_read > 7)
+        {
+            bits_read = 0;
+            data++;
+            size--;
+        }
+
+        if (bit_flag)
+            out ^= 0x8005;
+    }
+
+    for (i = 0; i < 16; ++i)
+    {
+        bit_flag = out >> 15;
+        out <<= 1;
+        if (bit_flag)
+            out ^= 0x8005;
+    }
+
+    uint16_t crc = 0;
+
+    for (i = 0; i < 16; i++)
+    {
+        if (out & (0x8000 >> i))
+            crc |= (1 << i);
+    }
+
+    return crc;
+}
+
+#define MEASURE(name, expression)                                                      \
+    {                                                                                  \
+        uint32_t value = 0;                                                            \
+        double t_start = get_time_ms();                                                \
+        for (int i = 0; i < _repeat; i++)                                              \
+            value = (uint32_t)(expression);                                            \
+        double t_used = (get_time_ms() - t_start) / _repeat;                           \
+        printf("%-16s | %10.3f | %10.1f | 0x%08X\n", name, t_used,                     \
+               (double)size / 1024 / 1024 / (t_used / 1000), value);                   \
+    }
+
+int main(int argc, char *argv[])
+{
+    long size = 0;
+    uint8_t *data = NULL;
+
+    parse_arguments(argc, argv);
+
+    if ('\0' != _file_path[0])
+    {
+        data = (uint8_t *)map_file_to_buffer(_file_path, &size);
+        if (NULL == data)
+        {
+            printf("read file %s failed\n", _file_path);
+            return -1;
+        }
+    }
+    else
+    {
+        size = (long)_size_mb * 1024 * 1024;
+        data = (uint8_t *)malloc(size);
+        if (NULL == data)
+        {
+            printf("allocate %ld bytes failed\n", size);
+            return -1;
+        }
+
+        srand(0);
+        for (long i = 0; i < size; i++)
+            data[i] = (uint8_t)rand();
+    }
+
+    printf("data: %ld bytes, repeat %d times\n\n", size, _repeat);
+    printf("checksum         |  time (ms) |     MB/s   | value\n");
+
+    MEASURE("crc32", crc_cal(data, size));
+    MEASURE("crc32 byte-wise", byte_wise_crc32(data, size));
+    MEASURE("crc16", crc16_cal(data, size));
+    MEASURE("crc16 bit-wise", bit_wise_crc16(data, size));
+    MEASURE("sum32", sum32_cal(data, size));
+    MEASURE("fnv1a32", fnv1a32_cal(data, size));
+
+    if ('\0' != _file_path[0])
+        unmap_file_buffer((char *)data, size);
+    else
+        free(data);
+
+    return 0;
+}
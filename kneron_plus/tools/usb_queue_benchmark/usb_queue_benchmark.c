@@ -0,0 +1,424 @@
+/**
+ * @file        usb_queue_benchmark.c
+ * @brief       measure USB bulk throughput with several transfers kept in flight
+ * @version     0.1
+ * @date        2026-10-18
+ *
+ * @copyright   Copyright (c) 2021 Kneron Inc. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <sys/time.h>
+
+#include "kp_core.h"
+#include "kp_internal.h"
+#include "kdp2_ipc_cmd.h"
+
+static const int _queue_depths[] = {1, 2, 4, 8, 16};
+
+static int _max_devices = 0; /* 0 for all found devices */
+static int _size_mb = 16;
+static int _repeat = 5;
+static uint32_t _address = 0;
+static int _timeout = 5000;
+
+void print_settings()
+{
+    printf("usb_queue_benchmark\n");
+    printf("\n");
+    printf("  bulk-out: write a DDR region of the first device with each USB queue depth (1 is one transfer at a time)\n");
+    printf("  bulk-in : read the region of all devices one by one, then with posted reads waited together\n");
+    printf("\n");
+    printf("  the region is read first and the same data is written back, by default it is the DDR space\n");
+    printf("  after the models, which is not used until the FIFO queue is set up by loading a model\n");
+    printf("\n");
+    printf("Arguments:\n");
+    printf("-help, h    : print help message\n");
+    printf("-num, n     : [max device count] = (default all found devices)\n");
+    printf("-size, s    : [data size in MB] = (default %d)\n", _size_mb);
+    printf("-repeat, r  : [repeat count] = (default %d)\n", _repeat);
+    printf("-address, a : [DDR address] = (default the DDR space after the models)\n");
+    printf("\n");
+
+    return;
+}
+
+bool parse_arguments(int argc, char *argv[])
+{
+    int opt = 0;
+
+    static struct option long_options[] = {
+        {"help",    no_argument,       0, 'h'},
+        {"num",     required_argument, 0, 'n'},
+        {"size",    required_argument, 0, 's'},
+        {"repeat",  required_argument, 0, 'r'},
+        {"address", required_argument, 0, 'a'},
+        {0, 0, 0, 0}};
+
+    int option_index = 0;
+
+    while ((opt = getopt_long(argc, argv, "hn:s:r:a:", long_options, &option_index)) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            _max_devices = atoi(optarg);
+            break;
+        case 's':
+            _size_mb = atoi(optarg);
+            break;
+        case 'r':
+            _repeat = atoi(optarg);
+            break;
+        case 'a':
+            _address = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'h':
+        case '?':
+        default:
+            print_settings();
+            exit(0);
+        }
+    }
+
+    return true;
+}
+
+static double get_time_ms()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (double)tv.tv_sec * 1000 + (double)tv.tv_usec / 1000;
+}
+
+static int read_return_code(kp_usb_device_t *ll_dev)
+{
+    uint32_t return_code;
+
+    int ret = kp_usb_read_data(ll_dev, (void *)&return_code, sizeof(uint32_t), _timeout);
+
+    if (ret < 0)
+        return ret;
+    else if (ret != sizeof(uint32_t))
+        return KP_ERROR_OTHER_99;
+
+    return (int)return_code;
+}
+
+static int get_ddr_config(kp_usb_device_t *ll_dev, kp_available_ddr_config_t *ddr_config)
+{
+    kdp2_ipc_cmd_get_available_ddr_config_t cmd_buf;
+
+    cmd_buf.magic_type = KDP2_MAGIC_TYPE_COMMAND;
+    cmd_buf.total_size = sizeof(kdp2_ipc_cmd_get_available_ddr_config_t);
+    cmd_buf.command_id = KDP2_COMMAND_GET_DDR_CONFIG;
+
+    int ret = kp_usb_write_data(ll_dev, (void *)&cmd_buf, cmd_buf.total_size, _timeout);
+    if (KP_USB_RET_OK != ret)
+        return ret;
+
+    ret = kp_usb_read_data(ll_dev, (void *)ddr_config, sizeof(kp_available_ddr_config_t), _timeout);
+    if (ret < 0)
+        return ret;
+    else if (ret != sizeof(kp_available_ddr_config_t))
+        return KP_ERROR_OTHER_99;
+
+    return KP_SUCCESS;
+}
+
+static int send_memory_command(kp_usb_device_t *ll_dev, uint32_t command_id, uint32_t address, uint32_t length)
+{
+    kdp2_ipc_cmd_memory_read_write_t cmd_buf;
+
+    cmd_buf.magic_type = KDP2_MAGIC_TYPE_COMMAND;
+    cmd_buf.total_size = sizeof(kdp2_ipc_cmd_memory_read_write_t);
+    cmd_buf.command_id = command_id;
+    cmd_buf.start_address = address;
+    cmd_buf.length = length;
+
+    int ret = kp_usb_write_data(ll_dev, (void *)&cmd_buf, cmd_buf.total_size, _timeout);
+    if (KP_USB_RET_OK != ret)
+        return ret;
+
+    // memory is read before the return code is sent, data follows it
+    if (KDP2_COMMAND_MEMORY_READ == command_id)
+        return read_return_code(ll_dev);
+
+    return KP_SUCCESS;
+}
+
+// the data is split into chunks and queued as deep as the USB queue depth of the device
+static int write_memory(kp_usb_device_t *ll_dev, uint32_t address, uint32_t length, uint8_t *buffer)
+{
+    int ret = send_memory_command(ll_dev, KDP2_COMMAND_MEMORY_WRITE, address, length);
+    if (KP_SUCCESS != ret)
+        return ret;
+
+    ret = kp_usb_write_data(ll_dev, (void *)buffer, (int)length, _timeout);
+    if (KP_USB_RET_OK != ret)
+        return ret;
+
+    return read_return_code(ll_dev);
+}
+
+// one read is in flight at a time, other devices wait for their turn
+static int read_memory_one_by_one(kp_usb_device_t *ll_devs[], int num_devices, uint32_t address, uint32_t length, uint8_t *buffers[])
+{
+    for (int i = 0; i < num_devices; i++)
+    {
+        int ret = send_memory_command(ll_devs[i], KDP2_COMMAND_MEMORY_READ, address, length);
+        if (KP_SUCCESS != ret)
+            return ret;
+
+        ret = kp_usb_read_data(ll_devs[i], (void *)buffers[i], (int)length, _timeout);
+        if (ret < 0)
+            return ret;
+        else if (ret != (int)length)
+            return KP_ERROR_OTHER_99;
+    }
+
+    return KP_SUCCESS;
+}
+
+// a read of every device is in flight at the same time, they are completed in any order
+static int read_memory_posted(kp_usb_device_t *ll_devs[], int num_devices, uint32_t address, uint32_t length, uint8_t *buffers[])
+{
+    kp_usb_device_t *pending[num_devices];
+    int num_pending = 0;
+    int ret = KP_SUCCESS;
+
+    for (int i = 0; i < num_devices; i++)
+    {
+        ret = send_memory_command(ll_devs[i], KDP2_COMMAND_MEMORY_READ, address, length);
+        if (KP_SUCCESS != ret)
+            break;
+
+        ret = kp_usb_submit_read(ll_devs[i], (void *)buffers[i], (int)length);
+        if (KP_USB_RET_OK != ret)
+            break;
+
+        pending[num_pending++] = ll_devs[i];
+    }
+
+    double t_deadline = get_time_ms() + _timeout;
+
+    while (0 < num_pending)
+    {
+        int index;
+        int recv_size = kp_usb_wait_read_any(pending, num_pending, _timeout, &index);
+
+        if (KP_USB_RET_PENDING == recv_size)
+        {
+            if (get_time_ms() < t_deadline)
+                continue;
+
+            ret = KP_ERROR_USB_TIMEOUT_N7;
+            break;
+        }
+
+        if (KP_SUCCESS == ret)
+        {
+            if (recv_size < 0)
+                ret = recv_size;
+            else if (recv_size != (int)length)
+                ret = KP_ERROR_OTHER_99;
+        }
+
+        pending[index] = pending[--num_pending];
+    }
+
+    for (int i = 0; i < num_pending; i++)
+        kp_usb_cancel_read(pending[i]);
+
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    int num_found = 0;
+    int ret;
+
+    parse_arguments(argc, argv);
+
+    /******* collect connectable devices of the first found target platform *******/
+    kp_devices_list_t *device_list = kp_scan_devices();
+
+    if (1 > device_list->num_dev)
+    {
+        printf("no connectable device is found\n");
+        return -1;
+    }
+
+    int port_ids[device_list->num_dev];
+
+    for (int i = 0; i < device_list->num_dev; i++)
+    {
+        kp_device_descriptor_t *dev = &device_list->device[i];
+
+        if (dev->isConnectable && (dev->product_id == device_list->device[0].product_id))
+            port_ids[num_found++] = dev->port_id;
+    }
+
+    if ((0 >= _max_devices) || (_max_devices > num_found))
+        _max_devices = num_found;
+
+    if (1 > _max_devices)
+    {
+        printf("no connectable device is found\n");
+        return -1;
+    }
+
+    int num_devices = _max_devices;
+
+    kp_device_group_t devices = kp_connect_devices_without_check(num_devices, port_ids, &ret);
+    if (NULL == devices)
+    {
+        printf("connect %d devices failed, error = %d (%s)\n", num_devices, ret, kp_error_string(ret));
+        return -1;
+    }
+
+    kp_set_timeout(devices, _timeout);
+
+    kp_usb_device_t **ll_devs = ((_kp_devices_group_t *)devices)->ll_device;
+    uint32_t length = (uint32_t)_size_mb * 1024 * 1024;
+    uint8_t *buffers[num_devices];
+    uint8_t *posted_buffers[num_devices];
+
+    memset(buffers, 0, sizeof(buffers));
+    memset(posted_buffers, 0, sizeof(posted_buffers));
+
+    /******* the DDR space after the models is free on every device until the FIFO queue is set up *******/
+    if (0 == _address)
+    {
+        uint32_t free_end = 0xFFFFFFFF;
+
+        for (int i = 0; i < num_devices; i++)
+        {
+            kp_available_ddr_config_t ddr_config;
+
+            ret = get_ddr_config(ll_devs[i], &ddr_config);
+            if (KP_SUCCESS != ret)
+            {
+                printf("get DDR config of device %d failed, error = %d (%s)\n", i, ret, kp_error_string(ret));
+                goto FUNC_OUT;
+            }
+
+            if (0 != ddr_config.ddr_fifoq_allocated)
+            {
+                ret = KP_ERROR_INVALID_PARAM_12;
+                printf("FIFO queue of device %d is set up, reboot it or give the address of a free DDR region\n", i);
+                goto FUNC_OUT;
+            }
+
+            if (ddr_config.ddr_model_end > _address)
+                _address = ddr_config.ddr_model_end;
+
+            if (ddr_config.ddr_available_end < free_end)
+                free_end = ddr_config.ddr_available_end;
+        }
+
+        if (free_end < _address)
+            free_end = _address;
+
+        if (length > free_end - _address)
+            length = free_end - _address;
+    }
+
+    length &= ~(uint32_t)(1024 - 1); // a multiple of max packet size as images are
+
+    for (int i = 0; i < num_devices; i++)
+    {
+        buffers[i] = (uint8_t *)malloc(length);
+        posted_buffers[i] = (uint8_t *)malloc(length);
+
+        if ((NULL == buffers[i]) || (NULL == posted_buffers[i]))
+        {
+            ret = KP_ERROR_MEMORY_ALLOCATION_FAILURE_9;
+            printf("allocate %u bytes failed\n", length);
+            goto FUNC_OUT;
+        }
+    }
+
+    printf("devices: %d, address: 0x%08X, data: %u bytes, repeat %d times\n\n", num_devices, _address, length, _repeat);
+
+    /******* bulk-out: one device, the queue is kept full across chunks *******/
+    ret = read_memory_one_by_one(ll_devs, 1, _address, length, buffers);
+    if (KP_SUCCESS != ret)
+    {
+        printf("read memory failed, error = %d (%s)\n", ret, kp_error_string(ret));
+        goto FUNC_OUT;
+    }
+
+    printf("bulk-out (device 0)   |  time (ms) |     MB/s\n");
+
+    for (int d = 0; d < (int)(sizeof(_queue_depths) / sizeof(_queue_depths[0])); d++)
+    {
+        kp_set_usb_queue_depth(devices, _queue_depths[d]);
+
+        double t_start = get_time_ms();
+        for (int i = 0; i < _repeat && KP_SUCCESS == ret; i++)
+            ret = write_memory(ll_devs[0], _address, length, buffers[0]);
+        double t_used = (get_time_ms() - t_start) / _repeat;
+
+        if (KP_SUCCESS != ret)
+        {
+            printf("write memory failed, error = %d (%s)\n", ret, kp_error_string(ret));
+            goto FUNC_OUT;
+        }
+
+        printf("queue depth %-2d        | %10.3f | %8.1f\n", _queue_depths[d], t_used, (double)length / 1024 / 1024 / (t_used / 1000));
+    }
+
+    kp_set_usb_queue_depth(devices, KP_USB_DEFAULT_QUEUE_DEPTH);
+
+    /******* bulk-in: all devices, one read in flight or one read per device in flight *******/
+    printf("\nbulk-in (%2d devices)  |  time (ms) |     MB/s\n", num_devices);
+
+    double t_start = get_time_ms();
+    for (int i = 0; i < _repeat && KP_SUCCESS == ret; i++)
+        ret = read_memory_one_by_one(ll_devs, num_devices, _address, length, buffers);
+    double t_one_by_one = (get_time_ms() - t_start) / _repeat;
+
+    if (KP_SUCCESS == ret)
+    {
+        t_start = get_time_ms();
+        for (int i = 0; i < _repeat && KP_SUCCESS == ret; i++)
+            ret = read_memory_posted(ll_devs, num_devices, _address, length, posted_buffers);
+    }
+    double t_posted = (get_time_ms() - t_start) / _repeat;
+
+    if (KP_SUCCESS != ret)
+    {
+        printf("read memory failed, error = %d (%s)\n", ret, kp_error_string(ret));
+        goto FUNC_OUT;
+    }
+
+    double total_mb = (double)length * num_devices / 1024 / 1024;
+
+    printf("one by one            | %10.3f | %8.1f\n", t_one_by_one, total_mb / (t_one_by_one / 1000));
+    printf("posted reads          | %10.3f | %8.1f\n", t_posted, total_mb / (t_posted / 1000));
+
+    for (int i = 0; i < num_devices; i++)
+    {
+        if (0 != memcmp(buffers[i], posted_buffers[i], length))
+        {
+            ret = KP_ERROR_OTHER_99;
+            printf("data of posted read of device %d is different\n", i);
+        }
+    }
+
+FUNC_OUT:
+    for (int i = 0; i < num_devices; i++)
+    {
+        free(buffers[i]);
+        free(posted_buffers[i]);
+    }
+
+    kp_disconnect_devices(devices);
+
+    return (KP_SUCCESS == ret) ? 0 : -1;
+}